@@ -54,4 +54,17 @@ set(IMGUI_SRC ${imgui_SOURCE_DIR})
 set(IMGUI_BUILD_SDL3_BINDING ON)
 include(imgui)
 
+# google benchmark, only for PathTracerBench
+if (PATH_TRACER_BENCH)
+  CPMAddPackage(
+    NAME benchmark
+    GITHUB_REPOSITORY google/benchmark
+    GIT_TAG v1.9.1
+    OPTIONS
+    "BENCHMARK_ENABLE_TESTING OFF"
+    "BENCHMARK_ENABLE_GTEST_TESTS OFF"
+    "BENCHMARK_ENABLE_INSTALL OFF"
+  )
+endif()
+
 set(PROJECT_NAME ${PROJECT_NAME_STORE})
\ No newline at end of file
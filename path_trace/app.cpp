@@ -1,25 +1,36 @@
 #include "app.h"
 #include "imgui/imgui_impl_wisdom.h"
+#include "profiler.h"
+#include "camera_path.h"
+#include "cpu_tracer.h"
+#include "task_graph.h"
+#include "vertex_format.h"
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 
-w::App::App()
+w::App::App(LaunchOptions xoptions)
     : window("Path Tracing", 1280, 720)
     , gfx(window.GetPlatformExtension())
     , swapchain(CreateSwapchain())
-    , scene(gfx)
+    , uploads(gfx)
+    , frame_constants(gfx)
+    , graph(gfx)
+    , options(std::move(xoptions))
 {
-    wis::Result result = wis::success;
+    auto init_start = std::chrono::steady_clock::now();
     InitResources();
-
-    auto [w, h] = window.PixelSize();
-    CreateSizeDependentResources(uint32_t(w), uint32_t(h));
-    scene.Bind(gfx, desc_storage);
+    init_resources_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
 }
 
 w::App::~App()
 {
     swapchain.Throttle();
+    if (checkpointer) {
+        checkpointer->Finish();
+    }
     ImGui_ImplWisdom_Shutdown();
 }
 
@@ -27,65 +38,127 @@ int w::App::run()
 {
     float dt = 1 / 60.0f;
 
-    while (ProcessEvents()) {
+    // replay drives the camera and settings at fixed steps, so frame N shows the same image on every run
+    std::optional<CameraPath> replay;
+    if (!options.replay.empty()) {
+        replay = CameraPath::Load(options.replay);
+    }
+    CameraPath recording;
+    std::vector<double> frame_ms;
+    auto start = std::chrono::steady_clock::now();
+    auto frame_start = start;
+
+    W_PROFILE_THREAD("Main");
+    for (uint32_t frame = 0; ProcessEvents(); frame++) {
+        W_PROFILE_FRAME();
+        W_PROFILE_SCOPE("Main loop");
         uint32_t frame_index = swapchain.CurrentFrame();
 
-        ImGui_ImplWisdom_NewFrame();
-        ImGui_ImplSDL3_NewFrame();
-        ImGui::NewFrame();
+        if (replay) {
+            if (frame == options.frames) {
+                break;
+            }
+            auto k = replay->Sample(replay->FrameTime(frame, options.frames));
+            scene->SetCameraState(k.camera);
+            if (scene->GetRenderSettings() != k.settings) {
+                scene->SetRenderSettings(k.settings);
+            }
+        }
 
-        Frame();
+        {
+            W_PROFILE_SCOPE("UI");
+            ImGui_ImplWisdom_NewFrame();
+            ImGui_ImplSDL3_NewFrame();
+            ImGui::NewFrame();
+
+            RenderUI();
+            ImGui::Render();
+        }
 
-        RenderUI();
-        ImGui::Render();
+        Frame();
 
-        auto& uicl = ui_command_list[frame_index];
-        auto& tex = swapchain.GetTexture(frame_index);
-        auto res = uicl.Reset();
+        {
+            W_PROFILE_SCOPE("Submit and present");
+            gfx.ExecuteCommandLists({ command_list[frame_index] });
+            frame_constants.EndFrame();
+            swapchain.Present(gfx);
+        }
+        if (frame == 0) {
+            ReportStartup();
+        }
 
-        if (scene.GammaCorrection()) {
-            RenderToSwapchain();
-        } else {
-            CopyToSwapchain();
+        auto now = std::chrono::steady_clock::now();
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(now - frame_start).count());
+        frame_ms_average = frame_ms_average > 0.0 ? frame_ms_average * 0.9 + frame_ms.back() * 0.1 : frame_ms.back();
+        scene->EndFrame(frame_ms.back());
+        frame_start = now;
+        if (!options.record.empty()) {
+            recording.Record(std::chrono::duration<double>(now - start).count(), scene->GetCameraState(), scene->GetRenderSettings());
         }
 
-        wis::DX12RenderPassRenderTargetDesc rt_desc{
-            .target = swapchain.GetRenderTarget(frame_index),
-            .load_op = wis::LoadOperation::Load,
-            .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f }
-        };
-        wis::RenderPassDesc rpd{
-            .target_count = 1,
-            .targets = &rt_desc,
-        };
-        uicl.BeginRenderPass(rpd);
-
-        ImGui_ImplWisdom_RenderDrawData(ImGui::GetDrawData(), uicl);
-
-        wis::TextureBarrier barrier_out{
-            .sync_before = wis::BarrierSync::RenderTarget,
-            .sync_after = wis::BarrierSync::Draw,
-            .access_before = wis::ResourceAccess::RenderTarget,
-            .access_after = wis::ResourceAccess::Common,
-            .state_before = wis::TextureState::RenderTarget,
-            .state_after = wis::TextureState::Present
-        };
-        uicl.TextureBarrier(barrier_out, tex);
-
-        uicl.EndRenderPass();
-        uicl.Close();
-
-        gfx.ExecuteCommandLists({ command_list[frame_index], uicl });
-        swapchain.Present(gfx);
+        input_frames -= input_frames > 0;
+        if (!replay && !input_frames && scene->Converged()) {
+            frame_start += Idle();
+        }
     }
 
+    if (!options.record.empty()) {
+        recording.Save(options.record);
+    }
+    if (idle.waits) {
+        std::cout << wis::format("Idle {} times for {:.1f} s, about {} frames skipped\n", idle.waits, idle.seconds, idle.skipped_frames);
+    }
+    if (auto& samples = scene->GetSampleStats(); samples.samples) {
+        std::cout << wis::format("Accumulated {:.0f} samples/s, {:.0f} samples/s at one sample per frame\n",
+                                 samples.SamplesPerSecond(), samples.SingleSamplesPerSecond());
+    }
+    if (replay) {
+        auto measured = std::span{ frame_ms }.subspan(std::min<size_t>(options.warmup, frame_ms.size()));
+        std::cout << wis::format("Replay {}x{}: {}\n", width, height, FormatFrameTimeStats(ComputeFrameTimeStats(measured)));
+        if (!options.report.empty()) {
+            WriteFrameTimes(options.report, frame_ms);
+        }
+    }
     return 0;
 }
 
+void w::App::ReportStartup()
+{
+    gfx.WaitForGpu(); // once, so the first frame has been drawn and not only submitted
+    auto& shaders = gfx.shaders.GetStats();
+    double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - created).count();
+    std::cout << wis::format("First frame after {:.1f} ms: resources {:.1f} ms, {} shader files ({:.1f} KiB, {} unique) loaded in {:.1f} ms\n",
+                             total, init_resources_ms, shaders.files, shaders.bytes / 1024.0, shaders.shaders, shaders.milliseconds);
+}
+
+std::chrono::steady_clock::duration w::App::Idle()
+{
+    W_PROFILE_FUNCTION();
+    // the last frame stays on screen, a checkpoint copy in flight is written now instead of after two more frames
+    gfx.WaitForGpu();
+    if (checkpointer) {
+        checkpointer->Finish();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SDL_WaitEvent(nullptr); // leaves the event in the queue for ProcessEvents
+    auto waited = std::chrono::steady_clock::now() - start;
+
+    double ms = std::chrono::duration<double, std::milli>(waited).count();
+    idle.waits++;
+    idle.seconds += ms / 1000.0;
+    if (frame_ms_average > 0.0) {
+        idle.skipped_frames += uint64_t(ms / frame_ms_average);
+    }
+    return waited;
+}
+
 uint32_t w::App::ProcessEvents()
 {
+    W_PROFILE_FUNCTION();
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
+        input_frames = settle_frames;
         ImGui_ImplSDL3_ProcessEvent(&event);
         switch (event.type) {
         case SDL_EVENT_QUIT:
@@ -132,13 +205,13 @@ void w::App::OnKeyPressed(const SDL_Event& event)
 void w::App::OnMouseMove(const SDL_Event& event)
 {
     if (event.motion.state & SDL_BUTTON_LMASK) {
-        scene.RotateCamera(float(event.motion.xrel), float(event.motion.yrel));
+        scene->RotateCamera(float(event.motion.xrel), float(event.motion.yrel));
     }
 }
 
 void w::App::OnWheel(const SDL_Event& event)
 {
-    scene.ZoomCamera(float(event.wheel.y));
+    scene->ZoomCamera(float(event.wheel.y));
 }
 
 w::Swapchain w::App::CreateSwapchain()
@@ -151,14 +224,8 @@ w::Swapchain w::App::CreateSwapchain()
                          uint32_t(w), uint32_t(h) };
 }
 
-void w::App::InitImGui(std::span<wis::DescriptorBindingDesc> bindings)
+void w::App::InitImGui(std::span<wis::DescriptorBindingDesc> bindings, const wis::Shader& vs, const wis::Shader& ps)
 {
-    wis::Result result = wis::success;
-    auto vertex_shader = LoadShader("shaders/imgui.vs");
-    auto vs = gfx.device.CreateShader(result, vertex_shader.data(), uint32_t(vertex_shader.size()));
-    auto pixel_shader = LoadShader("shaders/imgui.ps");
-    auto ps = gfx.device.CreateShader(result, pixel_shader.data(), uint32_t(pixel_shader.size()));
-
     ImGui_ImplWisdom_InitInfo init_info{
         .extensions = nullptr,
         .device = &gfx.device,
@@ -187,21 +254,13 @@ void w::App::InitImGui(std::span<wis::DescriptorBindingDesc> bindings)
 
 void w::App::InitResources()
 {
-    wis::Result result = wis::success;
-    auto& device = gfx.GetDevice();
-
+    W_PROFILE_FUNCTION();
     uint32_t requirements_count = 0;
     ImGui_ImplWisdom_DescriptorRequirement* reqs =
             ImGui_ImplWisdom_GetDescriptorRequirements(&requirements_count);
     std::span<ImGui_ImplWisdom_DescriptorRequirement> requirements{ reqs, requirements_count };
 
-    wis::DescriptorBindingDesc bindings[] = {
-        { wis::DescriptorType::Texture, 1, 1, 0 },
-        { wis::DescriptorType::Sampler, 2, 1, 0 },
-        { wis::DescriptorType::RWTexture, 3, 1, 2 },
-        { wis::DescriptorType::AccelerationStructure, 4, 1, 2 },
-        { wis::DescriptorType::Buffer, 5, 2, 2 },
-    };
+    auto bindings = w::Scene::DescriptorBindings();
 
     for (auto& req : requirements) {
         switch (req.type) {
@@ -214,29 +273,95 @@ void w::App::InitResources()
         }
     }
 
-    desc_storage = gfx.device.CreateDescriptorStorage(result, bindings, uint32_t(std::size(bindings)));
-    InitImGui(bindings);
-
-    for (uint32_t i = 0; i < w::swap_frames; i++) {
-        command_list[i] = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
-        ui_command_list[i] = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
-    }
-    aux_command_list = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
-
-    scene.CreatePipeline(gfx, bindings);
-
-    // Load shaders
-    auto filter_code = w::LoadShader("shaders/filter.vs");
-    wis::Shader filter_vs = device.CreateShader(result, filter_code.data(), filter_code.size());
+    // Device object creation runs on the pool, everything that records into the upload list or submits to the queue
+    // stays on this thread. The shader store is not thread safe, the pipeline task loads its shaders after the others.
+    w::TaskGraph startup;
+    constexpr bool main_thread = true;
+    using Task = w::TaskGraph::TaskId;
+
+    w::CompressedMesh sphere_mesh;
+    Task mesh = startup.Add("Sphere mesh", [&]() { sphere_mesh = SphereStatic::Generate(); });
+    Task geometry = startup.Add("Scene geometry", [&]() {
+        scene = std::make_unique<w::Scene>(gfx, uploads, sphere_mesh);
+        if (options.replay.empty()) { // replays measure full resolution frames of one sample
+            scene->SetPreviewTarget(float(options.preview_ms));
+            scene->SetFrameBudget(float(options.budget_ms));
+        }
+    }, { mesh }, main_thread);
+
+    std::unique_ptr<CpuScene> cpu_scene;
+    Task cpu_bvh = startup.Add("CPU BVH", [&]() { cpu_scene = std::make_unique<CpuScene>(); });
+    startup.Add("CPU scene", [&]() { scene->SetCpuScene(std::move(cpu_scene)); }, { geometry, cpu_bvh }, main_thread);
+
+    const wis::Shader *imgui_vs = nullptr, *imgui_ps = nullptr, *filter_vs = nullptr, *filter_ps = nullptr;
+    Task shaders = startup.Add("Load shaders", [&]() {
+        imgui_vs = &gfx.LoadShader("shaders/imgui.vs");
+        imgui_ps = &gfx.LoadShader("shaders/imgui.ps");
+        filter_vs = &gfx.LoadShader("shaders/filter.vs");
+        filter_ps = &gfx.LoadShader("shaders/filter.ps");
+    });
+    Task fonts = startup.Add("Font atlas", [&]() {
+        unsigned char* pixels = nullptr;
+        int font_width = 0, font_height = 0;
+        ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &font_width, &font_height);
+    });
+    Task storage = startup.Add("Descriptor storage", [&]() {
+        wis::Result result = wis::success;
+        desc_storage = gfx.device.CreateDescriptorStorage(result, bindings.data(), uint32_t(bindings.size()));
+        CheckResult(result);
+    });
+    Task commands = startup.Add("Command lists", [&]() {
+        wis::Result result = wis::success;
+        for (uint32_t i = 0; i < w::swap_frames; i++) {
+            command_list[i] = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
+            CheckResult(result);
+        }
+    });
+
+    Task trace = startup.Add("Trace pipeline", [&]() { scene->CreatePipeline(gfx, bindings); }, { geometry, shaders });
+    startup.Add("Filter pipeline", [&]() { CreateFilterPipeline(*filter_vs, *filter_ps); }, { trace });
+    Task imgui = startup.Add("ImGui", [&]() { InitImGui(bindings, *imgui_vs, *imgui_ps); }, { shaders, fonts, storage }, main_thread);
+
+    // read before the checkpointer lays out the file for the window size
+    std::optional<Checkpoint> checkpoint;
+    Task load = startup.Add("Load checkpoint", [&]() {
+        if (options.resume) {
+            checkpoint = Checkpointer::Load(options.checkpoint);
+            if (!checkpoint) {
+                std::cerr << wis::format("No checkpoint in {}, starting over\n", options.checkpoint.string());
+            }
+        }
+        if (!options.checkpoint.empty()) {
+            checkpointer = std::make_unique<Checkpointer>(gfx, options.checkpoint, std::chrono::seconds(options.checkpoint_interval));
+        }
+    });
+
+    Task size = startup.Add("Size dependent resources", [&]() {
+        auto [w, h] = window.PixelSize();
+        CreateSizeDependentResources(uint32_t(w), uint32_t(h));
+        scene->Bind(gfx, desc_storage);
+    }, { geometry, storage, load }, main_thread);
+
+    // geometry copies and AS builds resolve on a single fence
+    Task upload = startup.Add("Geometry upload", [&]() { uploads.WaitIdle(); }, { geometry, imgui, size }, main_thread);
+    startup.Add("Resume", [&]() {
+        if (checkpoint) {
+            Resume(*checkpoint);
+        }
+    }, { upload, trace, commands }, main_thread);
 
-    filter_code = w::LoadShader("shaders/filter.ps");
-    wis::Shader filter_ps = device.CreateShader(result, filter_code.data(), filter_code.size());
+    startup.Run();
+    std::cout << "Startup: " << startup.FormatTimeline();
+}
 
+void w::App::CreateFilterPipeline(const wis::Shader& vs, const wis::Shader& ps)
+{
+    wis::Result result = wis::success;
     wis::GraphicsPipelineDesc filter_pipeline_desc{
-        .root_signature = scene.root,
+        .root_signature = scene->root,
         .shaders = {
-                .vertex = filter_vs,
-                .pixel = filter_ps,
+                .vertex = vs,
+                .pixel = ps,
         },
         .attachments = {
                 .attachment_formats = { w::swap_format },
@@ -244,43 +369,58 @@ void w::App::InitResources()
         },
     };
 
-    filter_pipeline = device.CreateGraphicsPipeline(result, filter_pipeline_desc);
+    filter_pipeline = gfx.device.CreateGraphicsPipeline(result, filter_pipeline_desc);
 }
 
 void w::App::Frame()
 {
+    W_PROFILE_FUNCTION();
     uint32_t frame_index = swapchain.CurrentFrame();
     auto& cmd = command_list[frame_index];
     cmd.Reset();
-    scene.RenderScene(gfx, cmd, desc_storage, frame_index);
+    frame_constants.BeginFrame(frame_index);
+    if (checkpointer) {
+        checkpointer->BeginFrame();
+    }
+
+    // swapchain images are handed back in the present state every frame
+    w::RGState swap_state{ .layout = wis::TextureState::Present };
+
+    graph.Reset();
+    auto output = graph.ImportTexture(uav_texture[frame_index], uav_state[frame_index]);
+    auto back_buffer = graph.ImportTexture(swapchain.GetTexture(frame_index), swap_state, w::RGUsage::Present);
+
+    scene->AddPasses(graph, gfx, frame_constants, desc_storage, frame_index, output, 0);
+    if (scene->GammaCorrection() || scene->Previewing()) {
+        graph.AddPass("Filter", { { output, w::RGUsage::PixelStorageRead }, { back_buffer, w::RGUsage::RenderTarget } },
+                      [this, frame_index](wis::CommandList& cmd) { RenderToSwapchain(cmd, frame_index); });
+    } else {
+        graph.AddPass("Copy", { { output, w::RGUsage::CopySource }, { back_buffer, w::RGUsage::CopyDest } },
+                      [this, frame_index](wis::CommandList& cmd) { CopyToSwapchain(cmd, frame_index); });
+    }
+    graph.AddPass("UI", { { back_buffer, w::RGUsage::RenderTarget } },
+                  [this, frame_index](wis::CommandList& cmd) { DrawUI(cmd, frame_index); });
+
+    // a checkpoint holds both accumulation textures, the frame count is read once this frame's trace is recorded
+    if (checkpointer && checkpointer->Due() && !scene->ResetPending()) {
+        static_assert(w::flight_frames == 2);
+        uint32_t next_index = (frame_index + 1) % w::flight_frames;
+        auto next = graph.ImportTexture(uav_texture[next_index], uav_state[next_index]);
+        graph.AddPass("Checkpoint", { { next, w::RGUsage::CopySource }, { output, w::RGUsage::CopySource } },
+                      [this, frame_index, next_index](wis::CommandList& cmd) {
+                          std::array<const wis::Texture*, w::flight_frames> textures{ &uav_texture[next_index], &uav_texture[frame_index] };
+                          checkpointer->Copy(cmd, textures,
+                                             { uint32_t(width), uint32_t(height), scene->FrameCount(), scene->Rendered().camera.GetState(), scene->Rendered().settings });
+                      });
+    }
+
+    graph.Compile();
+    graph.Execute(cmd);
     cmd.Close();
 }
 
-void w::App::CopyToSwapchain()
+void w::App::CopyToSwapchain(wis::CommandList& cmd, uint32_t frame_index)
 {
-    uint32_t frame_index = swapchain.CurrentFrame();
-    auto& cmd = ui_command_list[frame_index];
-    auto& uav_tex = uav_texture[frame_index];
-    auto& swap_tex = swapchain.GetTexture(frame_index);
-
-    wis::TextureBarrier2 barriers_in[]{
-        { .barrier = { .sync_before = wis::BarrierSync::Raytracing,
-                       .sync_after = wis::BarrierSync::Copy,
-                       .access_before = wis::ResourceAccess::UnorderedAccess,
-                       .access_after = wis::ResourceAccess::CopySource,
-                       .state_before = wis::TextureState::UnorderedAccess,
-                       .state_after = wis::TextureState::CopySource },
-          .texture = uav_tex },
-        { .barrier = { .sync_before = wis::BarrierSync::None,
-                       .sync_after = wis::BarrierSync::Copy,
-                       .access_before = wis::ResourceAccess::NoAccess,
-                       .access_after = wis::ResourceAccess::CopyDest,
-                       .state_before = wis::TextureState::Present,
-                       .state_after = wis::TextureState::CopyDest },
-          .texture = swap_tex }
-    };
-    cmd.TextureBarriers(barriers_in, std::size(barriers_in));
-
     wis::TextureCopyRegion region{
         .src = {
                 .size = { uint32_t(width), uint32_t(height), 1 },
@@ -291,45 +431,11 @@ void w::App::CopyToSwapchain()
                 .format = w::swap_format,
         },
     };
-    cmd.CopyTexture(uav_tex, swap_tex, &region, 1);
-
-    wis::TextureBarrier2 barriers_out[]{
-        { .barrier = { .sync_before = wis::BarrierSync::Copy,
-                       .sync_after = wis::BarrierSync::Raytracing,
-                       .access_before = wis::ResourceAccess::CopySource,
-                       .access_after = wis::ResourceAccess::UnorderedAccess,
-                       .state_before = wis::TextureState::CopySource,
-                       .state_after = wis::TextureState::UnorderedAccess },
-          .texture = uav_tex },
-        { .barrier = { .sync_before = wis::BarrierSync::Copy,
-                       .sync_after = wis::BarrierSync::RenderTarget,
-                       .access_before = wis::ResourceAccess::CopyDest,
-                       .access_after = wis::ResourceAccess::RenderTarget,
-                       .state_before = wis::TextureState::CopyDest,
-                       .state_after = wis::TextureState::RenderTarget },
-          .texture = swap_tex }
-    };
-    cmd.TextureBarriers(barriers_out, std::size(barriers_out));
+    cmd.CopyTexture(uav_texture[frame_index], swapchain.GetTexture(frame_index), &region, 1);
 }
 
-void w::App::RenderToSwapchain()
+void w::App::RenderToSwapchain(wis::CommandList& cmd, uint32_t frame_index)
 {
-    uint32_t frame_index = swapchain.CurrentFrame();
-    auto& cmd = ui_command_list[frame_index];
-    auto& uav_tex = uav_texture[frame_index];
-    auto& swap_tex = swapchain.GetTexture(frame_index);
-
-    wis::TextureBarrier2 barriers_in[]{
-        { .barrier = { .sync_before = wis::BarrierSync::None,
-                       .sync_after = wis::BarrierSync::RenderTarget,
-                       .access_before = wis::ResourceAccess::NoAccess,
-                       .access_after = wis::ResourceAccess::RenderTarget,
-                       .state_before = wis::TextureState::Present,
-                       .state_after = wis::TextureState::RenderTarget },
-          .texture = swap_tex }
-    };
-    cmd.TextureBarriers(barriers_in, std::size(barriers_in));
-
     wis::RenderPassRenderTargetDesc rprtd{
         .target = swapchain.GetRenderTarget(frame_index),
         .load_op = wis::LoadOperation::DontCare,
@@ -341,9 +447,9 @@ void w::App::RenderToSwapchain()
     cmd.BeginRenderPass(rpd);
 
     cmd.SetPipelineState(filter_pipeline);
-    cmd.SetRootSignature(scene.root);
+    cmd.SetRootSignature(scene->root);
     cmd.SetDescriptorStorage(desc_storage);
-    cmd.SetPushConstants(&frame_index, 1, 0, wis::ShaderStages::All);
+    scene->PushFilterConstants(cmd, frame_index);
     cmd.IASetPrimitiveTopology(wis::PrimitiveTopology::TriangleList);
     cmd.RSSetScissor({ 0, 0, width, height });
     cmd.RSSetViewport({ 0.0f, 0.0f, float(width), float(height), 0.0f, 1.0f });
@@ -351,6 +457,22 @@ void w::App::RenderToSwapchain()
     cmd.EndRenderPass();
 }
 
+void w::App::DrawUI(wis::CommandList& cmd, uint32_t frame_index)
+{
+    wis::RenderPassRenderTargetDesc rt_desc{
+        .target = swapchain.GetRenderTarget(frame_index),
+        .load_op = wis::LoadOperation::Load,
+        .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f }
+    };
+    wis::RenderPassDesc rpd{
+        .target_count = 1,
+        .targets = &rt_desc,
+    };
+    cmd.BeginRenderPass(rpd);
+    ImGui_ImplWisdom_RenderDrawData(ImGui::GetDrawData(), cmd);
+    cmd.EndRenderPass();
+}
+
 void w::App::CreateSizeDependentResources(uint32_t width, uint32_t height)
 {
     using namespace wis; // for flag operators
@@ -362,13 +484,13 @@ void w::App::CreateSizeDependentResources(uint32_t width, uint32_t height)
 
     this->width = width;
     this->height = height;
-    scene.UpdateDispatch(width, height);
+    scene->UpdateDispatch(width, height);
 
     // Create UAV texture
     wis::TextureDesc desc{
         .format = w::swap_format,
         .size = { width, height, 1 },
-        .usage = wis::TextureUsage::CopySrc | wis::TextureUsage::UnorderedAccess,
+        .usage = wis::TextureUsage::CopySrc | wis::TextureUsage::CopyDst | wis::TextureUsage::UnorderedAccess,
     };
     // Create UAV output
     wis::UnorderedAccessDesc uav_desc{
@@ -381,38 +503,75 @@ void w::App::CreateSizeDependentResources(uint32_t width, uint32_t height)
         uav_texture[i] = gfx.allocator.CreateTexture(result, desc);
         uav_output[i] = gfx.device.CreateUnorderedAccessTexture(result, uav_texture[i], uav_desc);
         desc_storage.WriteRWTexture(2, i, uav_output[i]);
+        uav_state[i] = {}; // new contents are undefined, the first trace pass transitions them
+    }
+    if (checkpointer) {
+        checkpointer->Resize(width, height);
     }
-
-    MakeTransitions();
 }
 
-void w::App::MakeTransitions()
+void w::App::Resume(const Checkpoint& checkpoint)
 {
-    auto& cmd = aux_command_list;
-    std::ignore = cmd.Reset();
-    // Transition UAV texture to UAV state
-    wis::TextureBarrier2 barriers[w::flight_frames] = {
-        { .barrier = { .sync_before = wis::BarrierSync::None,
-                       .sync_after = wis::BarrierSync::None,
-                       .access_before = wis::ResourceAccess::NoAccess,
-                       .access_after = wis::ResourceAccess::NoAccess,
-                       .state_before = wis::TextureState::Undefined,
-                       .state_after = wis::TextureState::UnorderedAccess },
-          .texture = uav_texture[0] }
-    };
-    for (uint32_t i = 1; i < w::flight_frames; i++) {
-        barriers[i] = barriers[0];
-        barriers[i].texture = uav_texture[i];
+    W_PROFILE_FUNCTION();
+    using namespace wis; // for flag operators
+    const auto& state = checkpoint.state;
+    if (state.width != uint32_t(width) || state.height != uint32_t(height)) {
+        throw w::Exception(wis::format("Checkpoint {} is {}x{}, the window is {}x{}",
+                                       options.checkpoint.string(), state.width, state.height, width, height));
     }
 
-    cmd.TextureBarriers(barriers, std::size(barriers));
-    cmd.Close();
+    // the texture the next frame accumulates into gets the checkpoint's next texture
+    uint32_t frame_index = swapchain.CurrentFrame();
+    uint64_t texture_size = Checkpointer::RowPitch(width) * height;
+    wis::Result result = wis::success;
+    auto upload = gfx.allocator.CreateUploadBuffer(result, texture_size * w::flight_frames);
+    CheckResult(result);
+    auto* rows = upload.Map<std::byte>();
+    size_t row_bytes = size_t(width) * Checkpointer::texel_size;
+    for (uint32_t i = 0; i < w::flight_frames; i++) {
+        for (uint32_t y = 0; y < uint32_t(height); y++) {
+            std::memcpy(rows + i * texture_size + y * Checkpointer::RowPitch(width), checkpoint.textures[i].data() + y * row_bytes, row_bytes);
+        }
+    }
+    upload.Unmap();
 
+    auto& cmd = command_list[frame_index];
+    CheckResult(cmd.Reset());
+    graph.Reset();
+    static_assert(w::flight_frames == 2);
+    uint32_t next_index = (frame_index + 1) % w::flight_frames;
+    auto first = graph.ImportTexture(uav_texture[frame_index], uav_state[frame_index]);
+    auto second = graph.ImportTexture(uav_texture[next_index], uav_state[next_index]);
+    graph.AddPass("Restore checkpoint", { { first, w::RGUsage::CopyDest }, { second, w::RGUsage::CopyDest } },
+                  [&](wis::CommandList& cmd) {
+                      for (uint32_t i = 0; i < w::flight_frames; i++) {
+                          auto regions = Checkpointer::CopyRegions(width, height, texture_size * i);
+                          cmd.CopyBufferToTexture(upload, uav_texture[(frame_index + i) % w::flight_frames], regions.data(), uint32_t(regions.size()));
+                      }
+                  });
+    graph.Compile();
+    graph.Execute(cmd);
+    cmd.Close();
     gfx.ExecuteCommandLists({ cmd });
     gfx.WaitForGpu();
+
+    scene->SetCameraState(state.camera);
+    scene->SetRenderSettings(state.settings);
+    scene->RestoreFrames(state.frame_count);
+    std::cout << wis::format("Resumed {} at {} samples\n", options.checkpoint.string(), state.frame_count);
 }
 
 void w::App::RenderUI()
 {
-    scene.RenderUI();
+    scene->RenderUI();
+    ImGui::Begin("Settings", nullptr);
+    ImGui::Text(wis::format("Idle: {:.1f} s, {} frames skipped", idle.seconds, idle.skipped_frames).c_str());
+    auto ui_upload = ImGui_ImplWisdom_GetUploadStats();
+    ImGui::Text(wis::format("UI upload: {:.1f} KiB, {:.1f} KiB unchanged", ui_upload.bytes_uploaded / 1024.0, ui_upload.bytes_skipped / 1024.0).c_str());
+    auto& samples = scene->GetSampleStats();
+    ImGui::Text(wis::format("Samples/s: {:.0f} (1 spp per frame: {:.0f})", samples.SamplesPerSecond(), samples.SingleSamplesPerSecond()).c_str());
+    ImGui::End();
+#if defined(W_PROFILE)
+    w::prof::Profiler::Get().RenderUI();
+#endif
 }
\ No newline at end of file
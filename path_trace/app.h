@@ -2,12 +2,18 @@
 #include "window.h"
 #include "scene.h"
 #include "graphics.h"
+#include "upload.h"
+#include "frame_allocator.h"
+#include "render_graph.h"
+#include "replay.h"
+#include "checkpoint.h"
+#include <chrono>
 
 namespace w {
 class App
 {
 public:
-    App();
+    explicit App(LaunchOptions options = {});
     ~App();
 
 public:
@@ -15,6 +21,8 @@ public:
 
 private:
     uint32_t ProcessEvents();
+    // blocks until the next event once the image converged, returns the time spent waiting
+    std::chrono::steady_clock::duration Idle();
 
     void OnKeyPressed(const SDL_Event& event);
     void OnMouseMove(const SDL_Event& event);
@@ -22,37 +30,60 @@ private:
 
 private:
     w::Swapchain CreateSwapchain();
-    void InitImGui(std::span<wis::DescriptorBindingDesc> bindings);
+    void InitImGui(std::span<wis::DescriptorBindingDesc> bindings, const wis::Shader& vs, const wis::Shader& ps);
+    // startup after the device and swapchain, independent steps run concurrently
     void InitResources();
+    void CreateFilterPipeline(const wis::Shader& vs, const wis::Shader& ps);
 
     void Frame();
-    void CopyToSwapchain();
-    void RenderToSwapchain();
+    void CopyToSwapchain(wis::CommandList& cmd, uint32_t frame_index);
+    void RenderToSwapchain(wis::CommandList& cmd, uint32_t frame_index);
+    void DrawUI(wis::CommandList& cmd, uint32_t frame_index);
 
     void CreateSizeDependentResources(uint32_t width, uint32_t height);
-    void MakeTransitions();
+    void Resume(const Checkpoint& checkpoint);
 
 private:
     void RenderUI();
+    void ReportStartup();
 
 private:
+    // first, so time to first frame includes the window and device
+    std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+    double init_resources_ms = 0.0;
+
     int width = 0;
     int height = 0;
 
     w::Window window;
     w::Graphics gfx;
     w::Swapchain swapchain;
+    w::UploadManager uploads;
 
     wis::DescriptorStorage desc_storage;
 
     wis::CommandList command_list[w::flight_frames];
-    wis::CommandList ui_command_list[w::flight_frames];
-    wis::CommandList aux_command_list;
+    w::FrameAllocator frame_constants;
+    w::RenderGraph graph;
 
     wis::Texture uav_texture[w::flight_frames];
     wis::UnorderedAccessTexture uav_output[w::flight_frames];
+    w::RGState uav_state[w::flight_frames]; // tracked by the render graph between frames
 
-    w::Scene scene;
+    std::unique_ptr<w::Scene> scene; // created by InitResources
     wis::PipelineState filter_pipeline;
+
+    LaunchOptions options;
+    std::unique_ptr<Checkpointer> checkpointer;
+
+    // the loop stops drawing while the image is converged and nothing changes, see Scene::Converged
+    struct IdleCounters {
+        uint64_t waits = 0;
+        uint64_t skipped_frames = 0; // estimated from the average frame time before each wait
+        double seconds = 0.0;
+    } idle;
+    static constexpr uint32_t settle_frames = 3; // drawn after each event, ImGui needs a few to settle hover and clicks
+    uint32_t input_frames = settle_frames;
+    double frame_ms_average = 0.0;
 };
 } // namespace w
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "asset_loader.h"
+#include "cpu_tracer.h"
+#include "mesh_optimizer.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+w::AssetLoader::AssetLoader(uint32_t thread_count)
+{
+    for (uint32_t i = 0; i < std::max(1u, thread_count); i++) {
+        workers.emplace_back([this](std::stop_token stop) { Work(stop); });
+    }
+}
+
+w::AssetLoader::~AssetLoader()
+{
+    for (auto& worker : workers) {
+        worker.request_stop();
+    }
+    queued.notify_all();
+    workers.clear();
+}
+
+void w::AssetLoader::Add(std::string name, std::function<MeshData()> load, std::vector<Placement> placements)
+{
+    {
+        std::scoped_lock lock{ mutex };
+        jobs.push_back({ std::move(name), std::move(load), std::move(placements) });
+        stats.queued++;
+    }
+    queued.notify_one();
+}
+
+void w::AssetLoader::OnReady(std::function<void()> callback)
+{
+    std::scoped_lock lock{ mutex };
+    on_ready = std::move(callback);
+}
+
+uint32_t w::AssetLoader::Publish(CpuScene& scene)
+{
+    std::vector<Built> ready;
+    {
+        std::scoped_lock lock{ mutex };
+        if (built.empty()) {
+            return 0;
+        }
+        ready.swap(built);
+    }
+
+    W_PROFILE_FUNCTION();
+    uint32_t published = 0;
+    for (auto& asset : ready) {
+        if (!asset.mesh) {
+            std::cerr << wis::format("Mesh {} skipped: {}\n", asset.name, asset.error);
+            continue;
+        }
+        uint32_t mesh = scene.AddMesh(std::move(asset.mesh));
+        for (auto& placement : asset.placements) {
+            scene.AddInstance(mesh, placement.object_to_world, placement.material);
+        }
+        published++;
+    }
+    std::scoped_lock lock{ mutex };
+    stats.published += published;
+    return published;
+}
+
+uint32_t w::AssetLoader::Pending() const
+{
+    std::scoped_lock lock{ mutex };
+    return uint32_t(jobs.size() + building + built.size());
+}
+
+bool w::AssetLoader::Ready() const
+{
+    std::scoped_lock lock{ mutex };
+    return !built.empty();
+}
+
+w::AssetLoader::Stats w::AssetLoader::GetStats() const
+{
+    std::scoped_lock lock{ mutex };
+    return stats;
+}
+
+void w::AssetLoader::Work(std::stop_token stop)
+{
+    W_PROFILE_THREAD("Asset loader");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock{ mutex };
+            if (!queued.wait(lock, stop, [&]() { return !jobs.empty(); })) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            building++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Built result{ std::move(job.name), nullptr, std::move(job.placements) };
+        try {
+            W_PROFILE_SCOPE("Build mesh");
+            MeshData data = job.load();
+            if (data.normals.size() != data.positions.size() || data.indices.size() % 3 ||
+                (!data.indices.empty() && *std::ranges::max_element(data.indices) >= data.positions.size())) {
+                throw w::Exception(wis::format("{} positions, {} normals and {} indices do not make a mesh",
+                                               data.positions.size(), data.normals.size(), data.indices.size()));
+            }
+            w::OptimizeMesh(data.positions, data.normals, data.indices);
+
+            auto mesh = std::make_shared<CpuMesh>();
+            mesh->bvh = BVH{ data.positions, data.indices };
+            mesh->normals = std::move(data.normals);
+            mesh->indices = std::move(data.indices);
+            result.mesh = std::move(mesh);
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::function<void()> callback;
+        {
+            std::scoped_lock lock{ mutex };
+            building--;
+            stats.build_ms += ms;
+            if (result.mesh) {
+                stats.triangles += result.mesh->indices.size() / 3;
+            } else {
+                stats.failed++;
+            }
+            built.push_back(std::move(result));
+            callback = on_ready;
+        }
+        if (callback) {
+            callback();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "sphere.h"
+#include <DirectXMath.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace w {
+struct CpuMesh;
+class CpuScene;
+
+// Meshes loaded, optimized and given a BVH on worker threads, then added to a CpuScene between frames.
+// The renderer calls Publish once per frame: it only moves finished meshes and their instances into the scene,
+// so ingestion costs the render loop a few pointer copies however large the meshes are.
+class AssetLoader
+{
+public:
+    struct MeshData {
+        std::vector<DirectX::XMFLOAT3> positions;
+        std::vector<DirectX::XMFLOAT3> normals; // per vertex
+        std::vector<uint32_t> indices;
+    };
+    struct Placement {
+        DirectX::XMFLOAT4X4 object_to_world;
+        MaterialCBuffer material;
+    };
+    struct Stats {
+        uint32_t queued = 0;
+        uint32_t published = 0; // meshes, their instances are published with them
+        uint32_t failed = 0;
+        uint64_t triangles = 0;
+        double build_ms = 0.0; // load, optimize and BVH, summed over workers
+    };
+
+public:
+    // 0 - one worker, loading competes with the renderer for cores
+    explicit AssetLoader(uint32_t thread_count = 0);
+    ~AssetLoader();
+
+public:
+    // load runs on a worker, a mesh that fails to load is reported by Publish and skipped
+    void Add(std::string name, std::function<MeshData()> load, std::vector<Placement> placements);
+    // Adds every mesh finished since the last call with all of its instances, returns the number of meshes.
+    // Call between frames, the scene must not be traced while it changes.
+    uint32_t Publish(CpuScene& scene);
+
+    // meshes added and not published yet
+    uint32_t Pending() const;
+    // something for the next Publish
+    bool Ready() const;
+    Stats GetStats() const;
+    // called on a worker once a mesh is ready to publish, to wake a renderer that waits for changes
+    void OnReady(std::function<void()> callback);
+
+private:
+    struct Job {
+        std::string name;
+        std::function<MeshData()> load;
+        std::vector<Placement> placements;
+    };
+    struct Built {
+        std::string name;
+        std::shared_ptr<const CpuMesh> mesh; // empty if loading failed
+        std::vector<Placement> placements;
+        std::string error;
+    };
+
+private:
+    void Work(std::stop_token stop);
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable_any queued;
+    std::deque<Job> jobs;
+    std::vector<Built> built;
+    std::function<void()> on_ready;
+    Stats stats;
+    uint32_t building = 0;
+
+    std::vector<std::jthread> workers; // last, stopped before the queues go away
+};
+} // namespace w
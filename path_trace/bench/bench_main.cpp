@@ -0,0 +1,588 @@
+// CPU kernels of the path tracer, run with --benchmark_format=json for machine readable results
+// or through the bench_json target, which also writes aggregates to bench.json for compare.py
+#include "asset_loader.h"
+#include "bvh.h"
+#include "camera.h"
+#include "camera_rays.h"
+#include "cpu_tracer.h"
+#include "draw_list_cache.h"
+#include "intersect.h"
+#include "offset_allocator.h"
+#include "shading.h"
+#include "snapshot.h"
+#include "sphere.h"
+#include "temporal_reprojection.h"
+#include "uv_sphere.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr uint32_t batch = 1024; // inputs per iteration, fixed seed so every run sees the same data
+
+struct ShadingInputs {
+    std::array<DirectX::XMFLOAT2, batch> sigma;
+    std::array<DirectX::XMFLOAT3, batch> normal;
+    std::array<DirectX::XMFLOAT3, batch> view;
+    std::array<DirectX::XMFLOAT3, batch> light;
+    std::array<float, batch> roughness;
+
+    ShadingInputs()
+    {
+        using namespace DirectX;
+        std::mt19937 rng{ 42 };
+        std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+        std::uniform_real_distribution<float> signed_unit{ -1.0f, 1.0f };
+        auto direction = [&]() {
+            XMFLOAT3 d;
+            XMStoreFloat3(&d, XMVector3Normalize(XMVectorSet(signed_unit(rng), signed_unit(rng), signed_unit(rng), 0.0f)));
+            return d;
+        };
+        for (uint32_t i = 0; i < batch; i++) {
+            sigma[i] = { unit(rng), unit(rng) };
+            normal[i] = direction();
+            view[i] = direction();
+            light[i] = direction();
+            roughness[i] = 0.05f + 0.95f * unit(rng);
+        }
+    }
+};
+const ShadingInputs& Inputs()
+{
+    static const ShadingInputs inputs;
+    return inputs;
+}
+
+void UvSphereGenerate(benchmark::State& state)
+{
+    uint32_t segments = uint32_t(state.range(0));
+    for (auto _ : state) {
+        auto mesh = uv_sphere_generator::generate(segments, segments);
+        benchmark::DoNotOptimize(mesh);
+    }
+    state.SetItemsProcessed(state.iterations() * segments * segments * 2);
+}
+BENCHMARK(UvSphereGenerate)->Arg(16)->Arg(32)->Arg(128);
+
+void CameraPutCBuffer(benchmark::State& state)
+{
+    w::Camera camera;
+    camera.SetPerspective(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    bool rotate = state.range(0) != 0; // dirty view forces RecalculateView
+    for (auto _ : state) {
+        if (rotate) {
+            camera.Rotate(0.001f, 0.0f);
+        }
+        camera.PutCBuffer(&cbuffer);
+        benchmark::DoNotOptimize(cbuffer);
+    }
+}
+BENCHMARK(CameraPutCBuffer)->ArgName("recalculate")->Arg(0)->Arg(1);
+
+// primary rays of a 256x256 image, "rays/ns" is directly comparable between the two paths
+constexpr uint32_t ray_image_size = 256;
+
+w::Camera::CBuffer RayCamera()
+{
+    w::Camera camera;
+    camera.SetPerspective(DirectX::XM_PIDIV4, 1.0f, 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    return cbuffer;
+}
+
+// what RayGeneration does for every pixel
+void PrimaryRaysMatrix(benchmark::State& state)
+{
+    using namespace DirectX;
+    auto cbuffer = RayCamera();
+    XMMATRIX inv_view = XMLoadFloat4x4A(&cbuffer.inv_view);
+    XMMATRIX inv_projection = XMLoadFloat4x4A(&cbuffer.inv_projection);
+    std::vector<w::Ray> rays(ray_image_size * ray_image_size);
+    for (auto _ : state) {
+        for (uint32_t y = 0; y < ray_image_size; y++) {
+            for (uint32_t x = 0; x < ray_image_size; x++) {
+                float dx = (float(x) + 0.5f) / float(ray_image_size) * 2.0f - 1.0f;
+                float dy = (float(y) + 0.5f) / float(ray_image_size) * 2.0f - 1.0f;
+                XMVECTOR target = XMVector4Transform(XMVectorSet(dx, dy, 1.0f, 1.0f), inv_projection);
+                auto& ray = rays[y * ray_image_size + x];
+                XMStoreFloat3(&ray.origin, XMVector4Transform(g_XMIdentityR3, inv_view));
+                XMStoreFloat3(&ray.direction, XMVector4Transform(XMVectorSetW(XMVector3Normalize(target), 0.0f), inv_view));
+            }
+        }
+        benchmark::DoNotOptimize(rays.data());
+    }
+    double count = double(state.iterations()) * ray_image_size * ray_image_size;
+    state.SetItemsProcessed(int64_t(count));
+    state.counters["rays/ns"] = benchmark::Counter(count * 1e-9, benchmark::Counter::kIsRate);
+}
+BENCHMARK(PrimaryRaysMatrix);
+
+// Arg: 0 - pixel centers, 1 - jitter, 2 - jitter and thin lens
+void PrimaryRaysTile(benchmark::State& state)
+{
+    constexpr uint32_t tile = 16;
+    constexpr uint32_t tiles_per_row = ray_image_size / tile;
+    static_assert(ray_image_size % tile == 0);
+    auto cbuffer = RayCamera();
+    w::CameraRays camera{ cbuffer, ray_image_size, ray_image_size,
+                          { .jitter = state.range(0) >= 1, .aperture_radius = state.range(0) >= 2 ? 0.1f : 0.0f } };
+    std::vector<w::Ray> rays(ray_image_size * ray_image_size);
+    std::array<uint32_t, tile * tile> seeds;
+    for (auto _ : state) {
+        for (uint32_t y0 = 0; y0 < ray_image_size; y0 += tile) {
+            for (uint32_t x0 = 0; x0 < ray_image_size; x0 += tile) {
+                for (uint32_t i = 0; i < tile * tile; i++) {
+                    seeds[i] = x0 + y0 * ray_image_size + i;
+                }
+                // tiles are stored one after another, tile * tile rays each
+                uint32_t first = (y0 / tile * tiles_per_row + x0 / tile) * tile * tile;
+                camera.GenerateTile(x0, y0, tile, tile, seeds, std::span{ rays }.subspan(first, tile * tile));
+            }
+        }
+        benchmark::DoNotOptimize(rays.data());
+    }
+    double count = double(state.iterations()) * ray_image_size * ray_image_size;
+    state.SetItemsProcessed(int64_t(count));
+    state.counters["rays/ns"] = benchmark::Counter(count * 1e-9, benchmark::Counter::kIsRate);
+}
+BENCHMARK(PrimaryRaysTile)->ArgName("sampling")->Arg(0)->Arg(1)->Arg(2);
+
+void GatherInstanceTransform(benchmark::State& state)
+{
+    w::ObjectView view{ .data = { .pos = { 1.0f, 2.0f, 3.0f }, .scale = { 0.5f, 0.5f, 0.5f } } };
+    wis::AccelerationInstance instance{};
+    for (auto _ : state) {
+        view.GatherInstanceTransform(instance);
+        benchmark::DoNotOptimize(instance);
+    }
+}
+BENCHMARK(GatherInstanceTransform);
+
+void CosineWeightedHemisphereSample(benchmark::State& state)
+{
+    auto& in = Inputs();
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < batch; i++) {
+            auto dir = w::shading::CosineWeightedHemisphereSample(in.sigma[i], DirectX::XMLoadFloat3(&in.normal[i]));
+            benchmark::DoNotOptimize(dir);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(CosineWeightedHemisphereSample);
+
+void GetGGXMicrofacet(benchmark::State& state)
+{
+    auto& in = Inputs();
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < batch; i++) {
+            auto h = w::shading::GetGGXMicrofacet(in.sigma[i], DirectX::XMLoadFloat3(&in.normal[i]), in.roughness[i]);
+            benchmark::DoNotOptimize(h);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(GetGGXMicrofacet);
+
+void EvaluateCookTorrance(benchmark::State& state)
+{
+    using namespace DirectX;
+    auto& in = Inputs();
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < batch; i++) {
+            float f = w::shading::EvaluateCookTorrance(XMLoadFloat3(&in.normal[i]), XMLoadFloat3(&in.view[i]), XMLoadFloat3(&in.light[i]), in.roughness[i]);
+            benchmark::DoNotOptimize(f);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(EvaluateCookTorrance);
+
+void OffsetRay(benchmark::State& state)
+{
+    auto& in = Inputs();
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < batch; i++) {
+            auto p = w::shading::OffsetRay(in.view[i], in.normal[i]);
+            benchmark::DoNotOptimize(p);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(OffsetRay);
+
+void IntersectTriangle(benchmark::State& state)
+{
+    auto& in = Inputs();
+    // rays from the origin against a triangle covering roughly half of the directions' +z hemisphere
+    const DirectX::XMFLOAT3 v0{ -2.0f, -2.0f, 1.0f }, v1{ 2.0f, -2.0f, 1.0f }, v2{ 0.0f, 2.0f, 1.0f };
+    for (auto _ : state) {
+        uint32_t hits = 0;
+        for (uint32_t i = 0; i < batch; i++) {
+            w::TriangleHit hit;
+            hits += w::IntersectTriangle({ .origin = { 0.0f, 0.0f, 0.0f }, .direction = in.light[i] }, v0, v1, v2, hit);
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(IntersectTriangle);
+
+void BVHBuild(benchmark::State& state)
+{
+    uint32_t segments = uint32_t(state.range(0));
+    auto [vertices, normals, indices] = uv_sphere_generator::generate(segments, segments);
+    for (auto _ : state) {
+        w::BVH bvh{ vertices, indices };
+        benchmark::DoNotOptimize(bvh);
+    }
+    state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+BENCHMARK(BVHBuild)->Arg(32)->Arg(128);
+
+void BVHIntersect(benchmark::State& state)
+{
+    auto& in = Inputs();
+    uint32_t segments = uint32_t(state.range(0));
+    auto [vertices, normals, indices] = uv_sphere_generator::generate(segments, segments);
+    w::BVH bvh{ vertices, indices };
+    // rays from outside the unit sphere towards its center, perturbed so some of them miss
+    uint64_t nodes = 0, triangles = 0;
+    for (auto _ : state) {
+        w::TraceCounters counters;
+        uint32_t hits = 0;
+        for (uint32_t i = 0; i < batch; i++) {
+            auto& l = in.light[i];
+            auto& v = in.view[i];
+            w::BVHHit hit;
+            hits += bvh.Intersect({ .origin = { l.x * 3.0f, l.y * 3.0f, l.z * 3.0f }, .direction = { v.x * 0.4f - l.x, v.y * 0.4f - l.y, v.z * 0.4f - l.z } }, hit, counters);
+        }
+        benchmark::DoNotOptimize(hits);
+        nodes += counters.nodes;
+        triangles += counters.primitives;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["nodes/ray"] = benchmark::Counter(double(nodes) / batch, benchmark::Counter::kAvgIterations);
+    state.counters["triangles/ray"] = benchmark::Counter(double(triangles) / batch, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BVHIntersect)->Arg(32)->Arg(128);
+
+// One sample of the default scene on one thread, with the path loop specialized for the sampling function and BRDF
+// or switching on them at every bounce. Args are specialized, sampling_fn, brdf.
+void TracePathKernel(benchmark::State& state)
+{
+    constexpr uint32_t width = 64, height = 36;
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    w::CpuScene scene;
+    scene.Update(instances, materials);
+
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    w::CameraRays rays{ cbuffer, width, height };
+
+    w::CpuTracer tracer{ 1, state.range(0) != 0 };
+    w::Scene::RenderSettings settings{ .sampling_fn = int32_t(state.range(1)), .brdf = int32_t(state.range(2)), .max_depth = 6 };
+    w::Image image{ width, height };
+    uint32_t frame = 0;
+    for (auto _ : state) {
+        tracer.Render(scene, rays, settings, frame++, image);
+        benchmark::DoNotOptimize(image.pixels.data());
+    }
+    state.SetItemsProcessed(state.iterations() * width * height);
+    state.SetLabel(wis::format("{} {}", w::SAMPLING_LABELS[state.range(1)], w::BRDF_LABELS[state.range(2)]));
+}
+BENCHMARK(TracePathKernel)
+        ->ArgNames({ "specialized", "sampling", "brdf" })
+        ->ArgsProduct({ { 0, 1 }, { 1 }, { 1 } })
+        ->ArgsProduct({ { 0, 1 }, { 2 }, { 2 } })
+        ->ArgsProduct({ { 0, 1 }, { 3 }, { 3 } });
+
+// A render loop of the default scene on one thread while a loader builds range(0) meshes of up to 128x128 segments
+// and the loop publishes them between frames. Frame times are of the whole loop, publish times of Publish alone.
+void IngestWhileRendering(benchmark::State& state)
+{
+    using namespace DirectX;
+    using clock = std::chrono::steady_clock;
+    constexpr uint32_t width = 64, height = 36, min_frames = 16;
+    const uint32_t mesh_count = uint32_t(state.range(0));
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    w::CameraRays rays{ cbuffer, width, height };
+    w::CpuTracer tracer{ 1 };
+    w::Image image{ width, height };
+
+    std::vector<double> frame_ms, publish_ms;
+    for (auto _ : state) {
+        w::CpuScene scene;
+        scene.Update(instances, materials);
+        w::AssetLoader loader;
+        for (uint32_t i = 0; i < mesh_count; i++) {
+            uint32_t segments = 16 + (i * 16) % 112;
+            XMFLOAT4X4 transform;
+            XMStoreFloat4x4(&transform, XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixTranslation(float(i % 8) * 2.0f - 7.0f, -1.0f, float(i / 8) * -2.0f));
+            loader.Add(wis::format("Sphere {}", i), [segments]() {
+                auto [positions, normals, indices] = uv_sphere_generator::generate(segments, segments);
+                return w::AssetLoader::MeshData{ std::move(positions), std::move(normals), std::move(indices) };
+            }, { { transform, materials[2] } });
+        }
+
+        for (uint32_t frame = 0; frame < min_frames || loader.Pending(); frame++) {
+            auto start = clock::now();
+            loader.Publish(scene);
+            auto published = clock::now();
+            tracer.Render(scene, rays, {}, frame, image);
+            frame_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+            publish_ms.push_back(std::chrono::duration<double, std::milli>(published - start).count());
+        }
+    }
+    std::ranges::sort(frame_ms);
+    state.counters["frames"] = double(frame_ms.size()) / state.iterations();
+    state.counters["frame_ms_p50"] = frame_ms[frame_ms.size() / 2];
+    state.counters["frame_ms_max"] = frame_ms.back();
+    state.counters["publish_ms_max"] = std::ranges::max(publish_ms);
+}
+BENCHMARK(IngestWhileRendering)->ArgName("meshes")->Arg(0)->Arg(64)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+// Frames of range(0) samples per pixel of the default scene at a small size, where the fixed cost of a frame, the
+// thread start and tile hand out of Render, is a visible share. Items are samples per pixel, compare items_per_second.
+void AccumulateSamplesPerFrame(benchmark::State& state)
+{
+    constexpr uint32_t width = 64, height = 36;
+    const uint32_t samples = uint32_t(state.range(0));
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    w::CpuScene scene;
+    scene.Update(instances, materials);
+
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    w::CameraRays rays{ cbuffer, width, height };
+    w::CpuTracer tracer;
+    w::Image image{ width, height };
+
+    uint32_t frame_count = 0;
+    for (auto _ : state) {
+        tracer.Render(scene, rays, {}, frame_count, image, nullptr, samples);
+        frame_count += samples;
+        benchmark::DoNotOptimize(image.pixels.data());
+    }
+    state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(AccumulateSamplesPerFrame)->ArgName("samples")->Arg(1)->Arg(4)->Arg(16);
+
+// Synthetic camera move: 64 spp of the default scene are reprojected to the view orbited by range(0) milliradians and
+// zoomed out by half as much, then one sample is added. Times are of the reprojection including its primary rays.
+// Counters are the fraction of pixels that kept history and the RMSE against a 256 spp reference of the new view,
+// next to the RMSE of starting over with one sample.
+void TemporalReproject(benchmark::State& state)
+{
+    constexpr uint32_t width = 64, height = 36;
+    const float step = float(state.range(0)) / 1000.0f;
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    w::CpuScene scene;
+    scene.Update(instances, materials);
+
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    camera.ResetOrientation();
+    w::Camera::CBuffer from, to;
+    camera.PutCBuffer(&from);
+    auto moved = camera.GetState();
+    moved.orientation.y += step;
+    moved.radius *= 1.0f + step * 0.5f;
+    camera.SetState(moved);
+    camera.PutCBuffer(&to);
+
+    w::TemporalAccumulator reference, restarted, temporal;
+    reference.SetCamera(scene, to, width, height);
+    reference.Accumulate(scene, {}, 256);
+    restarted.SetCamera(scene, to, width, height);
+    restarted.Accumulate(scene, {}, 1);
+    temporal.SetCamera(scene, from, width, height);
+    temporal.Accumulate(scene, {}, 64);
+    temporal.SetCamera(scene, to, width, height);
+    temporal.Accumulate(scene, {}, 1);
+    state.counters["kept"] = temporal.GetStats().KeptFraction();
+    state.counters["rmse"] = w::RMSE(temporal.GetImage(), reference.GetImage());
+    state.counters["rmse_restarted"] = w::RMSE(restarted.GetImage(), reference.GetImage());
+
+    // back and forth, every iteration reprojects
+    for (auto _ : state) {
+        temporal.SetCamera(scene, from, width, height);
+        temporal.SetCamera(scene, to, width, height);
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * width * height);
+}
+BENCHMARK(TemporalReproject)->ArgName("mrad")->Arg(10)->Arg(50)->Arg(200)->Unit(benchmark::kMicrosecond);
+
+struct SnapshotPayload {
+    std::array<uint64_t, 64> words{};
+};
+w::SnapshotChannel<SnapshotPayload, 4> snapshot_channel;
+std::jthread snapshot_writer;
+
+// Readers on every benchmark thread take the latest version while a writer publishes without pause
+void SnapshotReadUnderContention(benchmark::State& state)
+{
+    if (state.thread_index() == 0) {
+        snapshot_writer = std::jthread([](std::stop_token stop) {
+            SnapshotPayload payload;
+            for (uint64_t i = 1; !stop.stop_requested(); i++) {
+                payload.words.fill(i);
+                snapshot_channel.Publish(payload);
+            }
+        });
+    }
+    uint64_t versions = 0, last_version = 0;
+    for (auto _ : state) {
+        auto view = snapshot_channel.Read();
+        benchmark::DoNotOptimize(view->words[0]);
+        versions += view.Version() != last_version;
+        last_version = view.Version();
+    }
+    if (state.thread_index() == 0) {
+        snapshot_writer = {};
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["new_versions"] = benchmark::Counter(double(versions), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(SnapshotReadUnderContention)->Threads(1)->Threads(2)->Threads(4);
+
+// A UI frame of draw lists copied into one mapped buffer, range(0) in 64ths of the lists change every frame.
+// 64 is the cost of hashing on top of copying everything, compare with DrawListCopyAll.
+constexpr size_t ui_lists = 64;
+constexpr size_t ui_list_bytes = 16 * 1024;
+
+struct UiFrame {
+    std::vector<std::vector<std::byte>> lists{ ui_lists, std::vector<std::byte>(ui_list_bytes) };
+    std::vector<std::byte> buffer = std::vector<std::byte>(ui_lists * ui_list_bytes);
+    std::mt19937 rng{ 42 };
+
+    void Change(size_t count)
+    {
+        for (size_t list = 0; list < count; list++) {
+            lists[list][rng() % ui_list_bytes] = std::byte(rng());
+        }
+    }
+};
+
+void DrawListUpload(benchmark::State& state)
+{
+    UiFrame frame;
+    w::DrawListCache cache;
+    size_t changed = size_t(state.range(0)), uploaded = 0;
+    for (auto _ : state) {
+        frame.Change(changed);
+        cache.Begin(ui_lists);
+        for (size_t list = 0; list < ui_lists; list++) {
+            auto& data = frame.lists[list];
+            // vertices and indices in the same buffer, only the offsets matter to the cache
+            if (cache.Update(list, std::span{ data }.first(ui_list_bytes / 2), std::span{ data }.last(ui_list_bytes / 2), list * ui_list_bytes, 0)) {
+                std::memcpy(frame.buffer.data() + list * ui_list_bytes, data.data(), data.size());
+            }
+        }
+        uploaded += cache.GetStats().bytes_uploaded;
+        benchmark::DoNotOptimize(frame.buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * ui_lists * ui_list_bytes);
+    state.counters["uploaded_bytes"] = benchmark::Counter(double(uploaded), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(DrawListUpload)->ArgName("changed")->Arg(0)->Arg(4)->Arg(64);
+
+void DrawListCopyAll(benchmark::State& state)
+{
+    UiFrame frame;
+    for (auto _ : state) {
+        frame.Change(4);
+        for (size_t list = 0; list < ui_lists; list++) {
+            std::memcpy(frame.buffer.data() + list * ui_list_bytes, frame.lists[list].data(), ui_list_bytes);
+        }
+        benchmark::DoNotOptimize(frame.buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * ui_lists * ui_list_bytes);
+}
+BENCHMARK(DrawListCopyAll);
+
+void GrowCapacitySequence(benchmark::State& state)
+{
+    // buffers grown one element at a time reallocate a logarithmic number of times
+    size_t growths = 0;
+    for (auto _ : state) {
+        size_t capacity = 0;
+        growths = 0;
+        for (size_t required = 1; required <= 1'000'000; required += 97) {
+            size_t next = w::GrowCapacity(capacity, required, 5000);
+            growths += next != capacity;
+            capacity = next;
+            benchmark::DoNotOptimize(capacity);
+        }
+    }
+    state.counters["growths"] = double(growths);
+}
+BENCHMARK(GrowCapacitySequence);
+
+void OffsetAllocatorAllocFree(benchmark::State& state)
+{
+    w::OffsetAllocator allocator{ 1u << 24, 1u << 16 };
+    std::mt19937 rng{ 42 };
+    std::uniform_int_distribution<uint32_t> size{ 1, 4096 };
+    std::array<w::OffsetAllocator::Allocation, batch> live{};
+    std::array<uint32_t, batch> sizes{};
+    for (auto& s : sizes) {
+        s = size(rng);
+    }
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < batch; i++) {
+            live[i] = allocator.Allocate(sizes[i]);
+        }
+        for (uint32_t i = 0; i < batch; i += 2) { // free in a scattered order to exercise coalescing
+            allocator.Free(live[i]);
+        }
+        for (uint32_t i = 1; i < batch; i += 2) {
+            allocator.Free(live[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(OffsetAllocatorAllocFree);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,177 @@
+#include "buffer_pool.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+uint64_t AlignUp(uint64_t v, uint64_t a) noexcept
+{
+    return (v + a - 1) / a * a;
+}
+} // namespace
+
+w::BufferHandle w::BufferPool::Allocate(uint64_t size, uint64_t alignment)
+{
+    uint32_t id = 0;
+    if (!free_entries.empty()) {
+        id = free_entries.back();
+        free_entries.pop_back();
+    } else {
+        id = uint32_t(entries.size());
+        entries.emplace_back();
+    }
+
+    Entry& entry = entries[id];
+    if (!TryAllocate(entry, size, std::max<uint64_t>(alignment, desc.granularity))) {
+        free_entries.push_back(id);
+        throw w::Exception(wis::format("Buffer pool failed to allocate {} bytes", size));
+    }
+    return { id };
+}
+
+bool w::BufferPool::TryAllocate(Entry& entry, uint64_t size, uint64_t alignment)
+{
+    // over-allocate when the alignment exceeds the allocator unit
+    uint64_t padding = alignment - desc.granularity;
+    uint64_t units = AlignUp(size + padding, desc.granularity) / desc.granularity;
+
+    auto place = [&](uint32_t block_index) {
+        Block& block = *blocks[block_index];
+        auto allocation = block.allocator.Allocate(uint32_t(units));
+        if (!allocation.Valid()) {
+            return false;
+        }
+        block.allocations++;
+        entry = {
+            .block = block_index,
+            .allocation = allocation,
+            .offset = AlignUp(uint64_t(allocation.offset) * desc.granularity, alignment),
+            .size = size,
+            .alignment = alignment,
+            .live = true,
+        };
+        return true;
+    };
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (blocks[i] && place(i)) {
+            return true;
+        }
+    }
+    return place(CreateBlock(units * desc.granularity));
+}
+
+uint32_t w::BufferPool::CreateBlock(uint64_t min_size)
+{
+    wis::Result result = wis::success;
+    uint64_t size = std::max(desc.block_size, AlignUp(min_size, desc.granularity));
+
+    auto block = std::make_unique<Block>();
+    if (allocator) {
+        block->buffer = allocator->CreateBuffer(result, size, desc.usage);
+        CheckResult(result);
+    }
+    block->allocator = OffsetAllocator{ uint32_t(size / desc.granularity), desc.max_allocations_per_block };
+    block->size = size;
+
+    // reuse a released dedicated slot
+    auto it = std::find(blocks.begin(), blocks.end(), nullptr);
+    if (it != blocks.end()) {
+        *it = std::move(block);
+        return uint32_t(it - blocks.begin());
+    }
+    blocks.push_back(std::move(block));
+    return uint32_t(blocks.size() - 1);
+}
+
+void w::BufferPool::Free(BufferHandle handle)
+{
+    if (!handle.Valid() || handle.id >= entries.size() || !entries[handle.id].live) {
+        return;
+    }
+
+    Entry& entry = entries[handle.id];
+    auto& block = blocks[entry.block];
+    block->allocator.Free(entry.allocation);
+    block->allocations--;
+
+    // dedicated blocks go away with their only allocation
+    if (block->allocations == 0 && block->size > desc.block_size) {
+        block.reset();
+    }
+
+    entry = {};
+    free_entries.push_back(handle.id);
+}
+
+w::BufferSlice w::BufferPool::View(BufferHandle handle) const noexcept
+{
+    const Entry& entry = entries[handle.id];
+    return { &blocks[entry.block]->buffer, entry.offset, entry.size };
+}
+
+w::BufferPoolStats w::BufferPool::Stats() const noexcept
+{
+    BufferPoolStats stats;
+    for (auto& block : blocks) {
+        if (!block) {
+            continue;
+        }
+        auto report = block->allocator.Report();
+        stats.block_count++;
+        stats.allocation_count += block->allocations;
+        stats.reserved_bytes += block->size;
+        stats.free_bytes += uint64_t(report.total_free) * desc.granularity;
+        stats.largest_free_bytes = std::max(stats.largest_free_bytes, uint64_t(report.largest_free) * desc.granularity);
+    }
+    for (auto& entry : entries) {
+        stats.used_bytes += entry.live ? entry.size : 0;
+    }
+    stats.fragmentation = stats.free_bytes == 0 ? 0.0f : 1.0f - float(stats.largest_free_bytes) / float(stats.free_bytes);
+    return stats;
+}
+
+std::vector<w::BufferMove> w::BufferPool::Defragment()
+{
+    std::vector<uint32_t> live;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        if (entries[i].live) {
+            live.push_back(i);
+        }
+    }
+    // largest first packs tightest into the new blocks
+    std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) { return entries[a].size > entries[b].size; });
+
+    auto old_blocks = std::move(blocks);
+    blocks.clear();
+
+    std::vector<BufferMove> moves;
+    moves.reserve(live.size());
+    for (uint32_t id : live) {
+        Entry old = entries[id];
+        if (!TryAllocate(entries[id], old.size, old.alignment)) {
+            throw w::Exception("Buffer pool defragmentation failed to place an allocation");
+        }
+        moves.push_back({
+                .handle = { id },
+                .src = &old_blocks[old.block]->buffer,
+                .src_offset = old.offset,
+                .dst = &blocks[entries[id].block]->buffer,
+                .dst_offset = entries[id].offset,
+                .size = old.size,
+        });
+    }
+
+    for (auto& block : old_blocks) {
+        if (block) {
+            retired.push_back(std::move(block));
+        }
+    }
+    return moves;
+}
+
+void w::BufferPool::RecordMoves(wis::CommandList& cmd_list, std::span<const BufferMove> moves)
+{
+    for (auto& move : moves) {
+        cmd_list.CopyBuffer(*move.src, *move.dst, { .src_offset = move.src_offset, .dst_offset = move.dst_offset, .size_bytes = move.size });
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "consts.h"
+#include "offset_allocator.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace w {
+// Stable handle into a BufferPool, survives defragmentation
+struct BufferHandle {
+    static constexpr uint32_t invalid = 0xFFFFFFFF;
+    uint32_t id = invalid;
+
+    bool Valid() const noexcept
+    {
+        return id != invalid;
+    }
+};
+
+// Resolved suballocation, only valid until the next Defragment
+struct BufferSlice {
+    const wis::Buffer* buffer = nullptr;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    uint64_t GetGPUAddress() const noexcept
+    {
+        return buffer->GetGPUAddress() + offset;
+    }
+};
+
+struct BufferPoolDesc {
+    wis::BufferUsage usage = wis::BufferUsage::None;
+    uint64_t block_size = 64ull << 20;
+    uint32_t granularity = 256; // allocator unit, every offset is aligned to it (AS data needs 256)
+    uint32_t max_allocations_per_block = 16 * 1024;
+};
+
+struct BufferPoolStats {
+    uint32_t block_count = 0;
+    uint32_t allocation_count = 0;
+    uint64_t reserved_bytes = 0; // sum of block sizes
+    uint64_t used_bytes = 0; // requested sizes
+    uint64_t free_bytes = 0;
+    uint64_t largest_free_bytes = 0;
+    float fragmentation = 0.0f; // 1 - largest free / free, over all blocks
+};
+
+// Single copy of a live suballocation performed by Defragment
+struct BufferMove {
+    BufferHandle handle;
+    const wis::Buffer* src = nullptr;
+    uint64_t src_offset = 0;
+    const wis::Buffer* dst = nullptr;
+    uint64_t dst_offset = 0;
+    uint64_t size = 0;
+};
+
+// Packs many small GPU buffers into large blocks through OffsetAllocator.
+// Buffers that are larger than a block get a dedicated block of their own.
+class BufferPool
+{
+public:
+    BufferPool() = default;
+    BufferPool(const wis::ResourceAllocator& allocator, const BufferPoolDesc& desc)
+        : allocator(&allocator), desc(desc)
+    {
+    }
+    // Layout only, blocks get no buffers and slices point at empty ones. Plans placement and defragmentation on the CPU.
+    explicit BufferPool(const BufferPoolDesc& desc)
+        : desc(desc)
+    {
+    }
+
+public:
+    BufferHandle Allocate(uint64_t size, uint64_t alignment = 0);
+    void Free(BufferHandle handle);
+    BufferSlice View(BufferHandle handle) const noexcept;
+
+    BufferPoolStats Stats() const noexcept;
+
+    // Repacks all live allocations into fresh blocks, largest first. Record the moves with
+    // RecordMoves, then call ReleaseRetired once the GPU is done with the copies.
+    // Slices resolved before the call are invalid afterwards. Acceleration structures
+    // cannot be moved with plain copies, their owners must rebuild them instead.
+    std::vector<BufferMove> Defragment();
+    static void RecordMoves(wis::CommandList& cmd_list, std::span<const BufferMove> moves);
+    void ReleaseRetired() noexcept
+    {
+        retired.clear();
+    }
+
+private:
+    struct Block {
+        wis::Buffer buffer;
+        OffsetAllocator allocator;
+        uint64_t size = 0;
+        uint32_t allocations = 0;
+    };
+    struct Entry {
+        uint32_t block = 0;
+        OffsetAllocator::Allocation allocation;
+        uint64_t offset = 0; // aligned, bytes
+        uint64_t size = 0; // requested, bytes
+        uint64_t alignment = 0;
+        bool live = false;
+    };
+
+    bool TryAllocate(Entry& entry, uint64_t size, uint64_t alignment);
+    uint32_t CreateBlock(uint64_t min_size);
+
+private:
+    const wis::ResourceAllocator* allocator = nullptr;
+    BufferPoolDesc desc;
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::vector<std::unique_ptr<Block>> retired; // old blocks kept alive for in-flight copies
+    std::vector<Entry> entries;
+    std::vector<uint32_t> free_entries;
+};
+} // namespace w
@@ -0,0 +1,223 @@
+#include "bvh.h"
+#include "profiler.h"
+#include <numeric>
+
+w::BVH::BVH(std::span<const DirectX::XMFLOAT3> positions, std::span<const uint32_t> indices)
+{
+    W_PROFILE_FUNCTION();
+    uint32_t triangle_count = uint32_t(indices.size() / 3);
+    if (triangle_count == 0) {
+        nodes.push_back({});
+        return;
+    }
+
+    std::vector<AABB> tri_bounds(triangle_count);
+    std::vector<DirectX::XMFLOAT3> centroids(triangle_count);
+    AABB root;
+    for (uint32_t i = 0; i < triangle_count; i++) {
+        for (uint32_t k = 0; k < 3; k++) {
+            tri_bounds[i].Grow(positions[indices[i * 3 + k]]);
+        }
+        auto& b = tri_bounds[i];
+        centroids[i] = { (b.min.x + b.max.x) * 0.5f, (b.min.y + b.max.y) * 0.5f, (b.min.z + b.max.z) * 0.5f };
+        root.Grow(b);
+    }
+
+    primitives.resize(triangle_count);
+    std::iota(primitives.begin(), primitives.end(), 0u);
+    nodes.reserve(size_t(triangle_count) * 2);
+    nodes.push_back({ .bounds = root, .first = 0, .count = triangle_count });
+    Subdivide(0, 1, tri_bounds, centroids);
+    nodes.shrink_to_fit();
+
+    triangles.resize(triangle_count);
+    for (uint32_t i = 0; i < triangle_count; i++) {
+        uint32_t p = primitives[i];
+        triangles[i] = { positions[indices[p * 3]], positions[indices[p * 3 + 1]], positions[indices[p * 3 + 2]] };
+    }
+}
+
+void w::BVH::Subdivide(uint32_t node_index, uint32_t depth, std::span<const AABB> tri_bounds, std::span<const DirectX::XMFLOAT3> centroids)
+{
+    auto axis_of = [](const DirectX::XMFLOAT3& v, uint32_t axis) { return axis == 0 ? v.x : axis == 1 ? v.y : v.z; };
+
+    uint32_t first = nodes[node_index].first;
+    uint32_t count = nodes[node_index].count;
+    if (count <= 2 || depth >= max_depth) { // degenerate splits may peel off one triangle per level
+        return;
+    }
+
+    AABB centroid_bounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        centroid_bounds.Grow(centroids[primitives[i]]);
+    }
+
+    // binned SAH over all three axes, cost of a node visit and a triangle test are both 1
+    struct Bin {
+        AABB bounds;
+        uint32_t count = 0;
+    };
+    float best_cost = FLT_MAX;
+    uint32_t best_axis = 0;
+    uint32_t best_split = 0;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        float lo = axis_of(centroid_bounds.min, axis), hi = axis_of(centroid_bounds.max, axis);
+        if (hi <= lo) {
+            continue;
+        }
+        std::array<Bin, bin_count> bins{};
+        float scale = bin_count / (hi - lo);
+        for (uint32_t i = first; i < first + count; i++) {
+            uint32_t p = primitives[i];
+            uint32_t b = std::min(bin_count - 1, uint32_t((axis_of(centroids[p], axis) - lo) * scale));
+            bins[b].count++;
+            bins[b].bounds.Grow(tri_bounds[p]);
+        }
+
+        std::array<float, bin_count - 1> left_cost{};
+        AABB left;
+        uint32_t left_count = 0;
+        for (uint32_t b = 0; b < bin_count - 1; b++) {
+            left.Grow(bins[b].bounds);
+            left_count += bins[b].count;
+            left_cost[b] = left.Area() * float(left_count);
+        }
+        AABB right;
+        uint32_t right_count = 0;
+        for (uint32_t b = bin_count - 1; b > 0; b--) {
+            right.Grow(bins[b].bounds);
+            right_count += bins[b].count;
+            float cost = left_cost[b - 1] + right.Area() * float(right_count);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    float area = nodes[node_index].bounds.Area();
+    float split_cost = area > 0.0f ? 1.0f + best_cost / area : FLT_MAX;
+    if (split_cost >= float(count) && count <= max_leaf_size) {
+        return;
+    }
+
+    uint32_t* begin = primitives.data() + first;
+    uint32_t* mid = begin;
+    if (best_cost < FLT_MAX) {
+        float lo = axis_of(centroid_bounds.min, best_axis), hi = axis_of(centroid_bounds.max, best_axis);
+        float scale = bin_count / (hi - lo);
+        mid = std::partition(begin, begin + count, [&](uint32_t p) {
+            return std::min(bin_count - 1, uint32_t((axis_of(centroids[p], best_axis) - lo) * scale)) < best_split;
+        });
+    }
+    if (mid == begin || mid == begin + count) { // coincident centroids, split in the middle of the range
+        mid = begin + count / 2;
+    }
+
+    uint32_t left_count = uint32_t(mid - begin);
+    uint32_t left_index = uint32_t(nodes.size());
+    BVHNode children[2]{ { .first = first, .count = left_count }, { .first = first + left_count, .count = count - left_count } };
+    for (auto& child : children) {
+        for (uint32_t i = child.first; i < child.first + child.count; i++) {
+            child.bounds.Grow(tri_bounds[primitives[i]]);
+        }
+    }
+    nodes.push_back(children[0]);
+    nodes.push_back(children[1]);
+    nodes[node_index].first = left_index;
+    nodes[node_index].count = 0;
+
+    Subdivide(left_index, depth + 1, tri_bounds, centroids);
+    Subdivide(left_index + 1, depth + 1, tri_bounds, centroids);
+}
+
+bool w::BVH::Intersect(const Ray& ray, BVHHit& hit, TraceCounters& counters, FaceCull cull) const noexcept
+{
+    if (triangles.empty()) {
+        return false;
+    }
+    const DirectX::XMFLOAT3 inv_dir{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+    auto t_max = [&]() { return std::min(ray.t_max, hit.triangle.t); };
+
+    bool found = false;
+    uint32_t stack[max_depth]; // a far sibling per level above plus both children, never more than the depth
+    uint32_t size = 0;
+
+    counters.nodes++;
+    if (nodes[0].bounds.Intersect(ray.origin, inv_dir, ray.t_min, t_max()) == FLT_MAX) {
+        return false;
+    }
+    stack[size++] = 0;
+    while (size > 0) {
+        const BVHNode& node = nodes[stack[--size]];
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                counters.primitives++;
+                TriangleHit th;
+                auto& tri = triangles[i];
+                if (!IntersectTriangle(ray, tri[0], tri[1], tri[2], th) || th.t >= t_max()) {
+                    continue;
+                }
+                if ((cull == FaceCull::AlongNormal && th.along_normal) || (cull == FaceCull::AgainstNormal && !th.along_normal)) {
+                    continue;
+                }
+                hit = { th, primitives[i] };
+                found = true;
+            }
+            continue;
+        }
+
+        // front to back, the nearer child is popped first
+        counters.nodes += 2;
+        float d0 = nodes[node.first].bounds.Intersect(ray.origin, inv_dir, ray.t_min, t_max());
+        float d1 = nodes[node.first + 1].bounds.Intersect(ray.origin, inv_dir, ray.t_min, t_max());
+        uint32_t near = node.first, far = node.first + 1;
+        if (d1 < d0) {
+            std::swap(d0, d1);
+            std::swap(near, far);
+        }
+        if (d1 != FLT_MAX) {
+            stack[size++] = far;
+        }
+        if (d0 != FLT_MAX) {
+            stack[size++] = near;
+        }
+    }
+    return found;
+}
+
+w::BVHStats w::BVH::Stats() const noexcept
+{
+    BVHStats stats;
+    if (triangles.empty()) { // the root of an empty BVH is a placeholder without children
+        return stats;
+    }
+    float root_area = nodes[0].bounds.Area();
+    uint32_t leaf_triangles = 0;
+
+    struct Entry {
+        uint32_t node;
+        uint32_t depth;
+    };
+    std::vector<Entry> stack{ { 0, 1 } };
+    while (!stack.empty()) {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+        auto& node = nodes[index];
+        float relative_area = root_area > 0.0f ? node.bounds.Area() / root_area : 0.0f;
+        stats.nodes++;
+        stats.max_depth = std::max(stats.max_depth, depth);
+        stats.sah_cost += relative_area;
+        if (node.IsLeaf()) {
+            stats.leaves++;
+            leaf_triangles += node.count;
+            stats.sah_cost += relative_area * float(node.count);
+        } else {
+            stack.push_back({ node.first, depth + 1 });
+            stack.push_back({ node.first + 1, depth + 1 });
+        }
+    }
+    stats.average_leaf_size = stats.leaves ? float(leaf_triangles) / float(stats.leaves) : 0.0f;
+    return stats;
+}
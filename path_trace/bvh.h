@@ -0,0 +1,129 @@
+#pragma once
+#include "intersect.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace w {
+// Per ray (or per pixel, summed over its path) work of the CPU tracer
+struct TraceCounters {
+    uint32_t nodes = 0; // BVH nodes visited, top level instances included
+    uint32_t primitives = 0; // ray/triangle tests
+    uint32_t bounces = 0; // secondary rays traced
+    uint32_t shading = 0; // BRDF evaluations
+
+    TraceCounters& operator+=(const TraceCounters& o) noexcept
+    {
+        nodes += o.nodes;
+        primitives += o.primitives;
+        bounces += o.bounces;
+        shading += o.shading;
+        return *this;
+    }
+};
+
+struct AABB {
+    DirectX::XMFLOAT3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+    DirectX::XMFLOAT3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    void Grow(const DirectX::XMFLOAT3& p) noexcept
+    {
+        min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+        max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+    }
+    void Grow(const AABB& b) noexcept
+    {
+        Grow(b.min);
+        Grow(b.max);
+    }
+    float Area() const noexcept
+    {
+        float x = max.x - min.x, y = max.y - min.y, z = max.z - min.z;
+        return x < 0.0f ? 0.0f : 2.0f * (x * y + y * z + z * x);
+    }
+    // slab test against [t_min, t_max], inv_dir is 1 / direction. Returns the entry distance or FLT_MAX on a miss
+    float Intersect(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& inv_dir, float t_min, float t_max) const noexcept
+    {
+        float tx0 = (min.x - origin.x) * inv_dir.x, tx1 = (max.x - origin.x) * inv_dir.x;
+        float ty0 = (min.y - origin.y) * inv_dir.y, ty1 = (max.y - origin.y) * inv_dir.y;
+        float tz0 = (min.z - origin.z) * inv_dir.z, tz1 = (max.z - origin.z) * inv_dir.z;
+        float t0 = std::max({ t_min, std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1) });
+        float t1 = std::min({ t_max, std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1) });
+        return t0 <= t1 ? t0 : FLT_MAX;
+    }
+};
+
+// 32 byte node, children of an inner node are adjacent at first, leaves own [first, first + count) triangles
+struct BVHNode {
+    AABB bounds;
+    uint32_t first = 0;
+    uint32_t count = 0;
+
+    bool IsLeaf() const noexcept
+    {
+        return count > 0;
+    }
+};
+
+struct BVHStats {
+    uint32_t nodes = 0;
+    uint32_t leaves = 0;
+    uint32_t max_depth = 0;
+    float average_leaf_size = 0.0f;
+    float sah_cost = 0.0f; // expected cost of a random ray, 1 per node + 1 per triangle test
+};
+
+// Rejected side of a triangle, relative to TriangleHit::along_normal
+enum class FaceCull : uint8_t {
+    None,
+    AlongNormal,
+    AgainstNormal,
+};
+
+// Closest hit in the BVH's space, primitive is the original triangle index
+struct BVHHit {
+    TriangleHit triangle{ .t = FLT_MAX };
+    uint32_t primitive = ~0u;
+};
+
+// Binned SAH bounding volume hierarchy over an indexed triangle list
+class BVH
+{
+public:
+    static constexpr uint32_t bin_count = 12;
+    static constexpr uint32_t max_leaf_size = 8;
+    static constexpr uint32_t max_depth = 64; // levels, deeper ranges become leaves. Bounds the traversal stack
+
+public:
+    BVH() = default;
+    BVH(std::span<const DirectX::XMFLOAT3> positions, std::span<const uint32_t> indices);
+
+public:
+    // hits closer than hit.triangle.t replace it, returns whether one did
+    bool Intersect(const Ray& ray, BVHHit& hit, TraceCounters& counters, FaceCull cull = FaceCull::None) const noexcept;
+
+    // empty stats and bounds for a BVH without triangles
+    BVHStats Stats() const noexcept;
+    const AABB& Bounds() const noexcept
+    {
+        static constexpr AABB empty{};
+        return nodes.empty() ? empty : nodes.front().bounds;
+    }
+    std::span<const BVHNode> Nodes() const noexcept
+    {
+        return nodes;
+    }
+
+private:
+    void Subdivide(uint32_t node_index, uint32_t depth, std::span<const AABB> tri_bounds, std::span<const DirectX::XMFLOAT3> centroids);
+
+private:
+    std::vector<BVHNode> nodes;
+    std::vector<std::array<DirectX::XMFLOAT3, 3>> triangles; // in leaf order
+    std::vector<uint32_t> primitives; // leaf order -> original triangle index
+};
+} // namespace w
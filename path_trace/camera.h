@@ -13,6 +13,24 @@ public:
         DirectX::XMFLOAT4X4A view_proj;
         DirectX::XMFLOAT4X4A inv_view;
         DirectX::XMFLOAT4X4A inv_projection;
+
+        // world space primary ray basis, the direction through NDC (x, y) is ray_forward + x * ray_right + y * ray_up
+        // at unit view depth. Equal to inv_view * (inv_projection * (x, y, 1, 1)).xyz up to length.
+        DirectX::XMFLOAT4A ray_origin;
+        DirectX::XMFLOAT4A ray_forward;
+        DirectX::XMFLOAT4A ray_right;
+        DirectX::XMFLOAT4A ray_up;
+    };
+
+    // everything the user controls, the camera orbits the origin
+    struct State {
+        DirectX::XMFLOAT2 orientation; // pitch, yaw
+        float radius;
+
+        bool operator==(const State& o) const noexcept
+        {
+            return orientation.x == o.orientation.x && orientation.y == o.orientation.y && radius == o.radius;
+        }
     };
 
 private:
@@ -70,6 +88,16 @@ public:
         _radius = std::clamp(_radius - amount, 1.0f, 20.0f);
         RecalculatePos();
     }
+    State GetState() const noexcept
+    {
+        return { { _orientation.x, _orientation.y }, _radius };
+    }
+    void SetState(const State& state) noexcept
+    {
+        _orientation = { state.orientation.x, state.orientation.y };
+        _radius = std::clamp(state.radius, 1.0f, 20.0f);
+        SetOrientation();
+    }
     void ResetOrientation() noexcept
     {
         _orientation = { 0.183, -4.68 };
@@ -92,6 +120,9 @@ public:
         XMStoreFloat4x4A(&_cbuf.inv_projection, inv_perspective);
         XMStoreFloat4x4A(&_cbuf.view_proj, view_proj);
         XMStoreFloat4x4A(&_cbuf.proj, perspective);
+        if (!_dirty_view) {
+            RecalculateRayBasis(); // otherwise done with the view
+        }
         _dirty_buffer = true; // no need to recalculate view
     }
 
@@ -120,9 +151,26 @@ private:
             XMStoreFloat4x4A(&_cbuf.view, view);
             XMStoreFloat4x4A(&_cbuf.inv_view, inv_view);
             XMStoreFloat4x4A(&_cbuf.view_proj, view_proj);
+            RecalculateRayBasis();
             _dirty_view = false;
         }
     }
+    void RecalculateRayBasis() const noexcept
+    {
+        using namespace DirectX;
+        // rows of inv_projection are the NDC axes in view space, the view is rigid so they rotate into world space
+        XMMATRIX inv_view = XMLoadFloat4x4A(&_cbuf.inv_view);
+        XMMATRIX inv_proj = XMLoadFloat4x4A(&_cbuf.inv_projection);
+        XMVECTOR right = XMVector3TransformNormal(inv_proj.r[0], inv_view);
+        XMVECTOR up = XMVector3TransformNormal(inv_proj.r[1], inv_view);
+        XMVECTOR forward = XMVector3TransformNormal(inv_proj.r[2] + inv_proj.r[3], inv_view);
+        XMVECTOR depth = XMVector3Dot(forward, XMVector3Normalize(inv_view.r[2]));
+
+        XMStoreFloat4A(&_cbuf.ray_origin, inv_view.r[3]);
+        XMStoreFloat4A(&_cbuf.ray_forward, XMVectorSetW(forward / depth, 0.0f));
+        XMStoreFloat4A(&_cbuf.ray_right, XMVectorSetW(right / depth, 0.0f));
+        XMStoreFloat4A(&_cbuf.ray_up, XMVectorSetW(up / depth, 0.0f));
+    }
     void RecalculatePos() noexcept
     {
         using namespace DirectX;
@@ -0,0 +1,197 @@
+#include "camera_path.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+
+namespace {
+template<typename T>
+void Write(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+template<typename T>
+T Read(std::ifstream& file)
+{
+    T value{};
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+// 40 bytes per keyframe, independent of struct padding
+void WriteKeyframe(std::ofstream& file, const w::CameraKeyframe& k)
+{
+    Write(file, k.time);
+    Write(file, k.camera.orientation.x);
+    Write(file, k.camera.orientation.y);
+    Write(file, k.camera.radius);
+    Write(file, k.settings.sampling_fn);
+    Write(file, k.settings.brdf);
+    Write(file, k.settings.max_depth);
+    Write(file, uint32_t(k.settings.accumulate));
+}
+w::CameraKeyframe ReadKeyframe(std::ifstream& file)
+{
+    w::CameraKeyframe k;
+    k.time = Read<double>(file);
+    k.camera.orientation.x = Read<float>(file);
+    k.camera.orientation.y = Read<float>(file);
+    k.camera.radius = Read<float>(file);
+    k.settings.sampling_fn = Read<int32_t>(file);
+    k.settings.brdf = Read<int32_t>(file);
+    k.settings.max_depth = Read<int32_t>(file);
+    k.settings.accumulate = Read<uint32_t>(file) != 0;
+    return k;
+}
+
+// yaw wraps around at +-pi, interpolate along the shorter arc
+float LerpAngle(float a, float b, float t) noexcept
+{
+    constexpr float pi = std::numbers::pi_v<float>;
+    float d = b - a;
+    if (d > pi) {
+        d -= 2.0f * pi;
+    } else if (d < -pi) {
+        d += 2.0f * pi;
+    }
+    return a + d * t;
+}
+} // namespace
+
+w::CameraPath w::CameraPath::Load(const std::filesystem::path& path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file) {
+        throw w::Exception(wis::format("Camera path not found: {}", path.string()));
+    }
+
+    char file_magic[4]{};
+    file.read(file_magic, sizeof(file_magic));
+    uint32_t file_version = Read<uint32_t>(file);
+    uint32_t count = Read<uint32_t>(file);
+    if (!file || !std::equal(std::begin(magic), std::end(magic), file_magic) || file_version != version) {
+        throw w::Exception(wis::format("Not a version {} camera path: {}", version, path.string()));
+    }
+
+    CameraPath camera_path;
+    camera_path.keyframes.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        camera_path.keyframes.push_back(ReadKeyframe(file));
+    }
+    if (!file) {
+        throw w::Exception(wis::format("Truncated camera path: {}", path.string()));
+    }
+    return camera_path;
+}
+
+void w::CameraPath::Save(const std::filesystem::path& path) const
+{
+    std::ofstream file{ path, std::ios::binary };
+    if (!file) {
+        throw w::Exception(wis::format("Unable to write camera path: {}", path.string()));
+    }
+
+    bool close_hold = hold_time && !keyframes.empty();
+    file.write(magic, sizeof(magic));
+    Write(file, version);
+    Write(file, uint32_t(keyframes.size() + close_hold));
+    for (auto& k : keyframes) {
+        WriteKeyframe(file, k);
+    }
+    if (close_hold) {
+        CameraKeyframe last = keyframes.back();
+        last.time = *hold_time;
+        WriteKeyframe(file, last);
+    }
+}
+
+void w::CameraPath::Record(double time, const Camera::State& camera, const Scene::RenderSettings& settings)
+{
+    if (!keyframes.empty() && keyframes.back().camera == camera && keyframes.back().settings == settings) {
+        hold_time = time;
+        return;
+    }
+    if (hold_time) {
+        CameraKeyframe last = keyframes.back();
+        last.time = *hold_time;
+        keyframes.push_back(last);
+        hold_time.reset();
+    }
+    keyframes.push_back({ time, camera, settings });
+}
+
+w::CameraKeyframe w::CameraPath::Sample(double time) const noexcept
+{
+    if (keyframes.empty()) {
+        return {};
+    }
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](double t, const CameraKeyframe& k) { return t < k.time; });
+    if (next == keyframes.begin()) {
+        return keyframes.front();
+    }
+    if (next == keyframes.end()) {
+        return keyframes.back();
+    }
+
+    auto& a = *(next - 1);
+    auto& b = *next;
+    float t = float((time - a.time) / (b.time - a.time));
+    CameraKeyframe k = a;
+    k.time = time;
+    k.camera.orientation.x = a.camera.orientation.x + (b.camera.orientation.x - a.camera.orientation.x) * t;
+    k.camera.orientation.y = LerpAngle(a.camera.orientation.y, b.camera.orientation.y, t);
+    k.camera.radius = a.camera.radius + (b.camera.radius - a.camera.radius) * t;
+    return k;
+}
+
+double w::CameraPath::FrameTime(uint32_t frame, uint32_t frame_count) const noexcept
+{
+    return frame_count > 1 ? Duration() * double(frame) / double(frame_count - 1) : 0.0;
+}
+
+w::FrameTimeStats w::ComputeFrameTimeStats(std::span<const double> frame_ms)
+{
+    if (frame_ms.empty()) {
+        return {};
+    }
+    std::vector<double> sorted{ frame_ms.begin(), frame_ms.end() };
+    std::sort(sorted.begin(), sorted.end());
+
+    // nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = size_t(std::ceil(p / 100.0 * double(sorted.size())));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    };
+    double sum = 0.0;
+    for (double ms : sorted) {
+        sum += ms;
+    }
+    return {
+        .frames = uint32_t(sorted.size()),
+        .mean = sum / double(sorted.size()),
+        .min = sorted.front(),
+        .p50 = percentile(50.0),
+        .p90 = percentile(90.0),
+        .p95 = percentile(95.0),
+        .p99 = percentile(99.0),
+        .max = sorted.back(),
+    };
+}
+
+std::string w::FormatFrameTimeStats(const FrameTimeStats& s)
+{
+    return wis::format("{} frames, ms: mean {:.3f} min {:.3f} p50 {:.3f} p90 {:.3f} p95 {:.3f} p99 {:.3f} max {:.3f}",
+                       s.frames, s.mean, s.min, s.p50, s.p90, s.p95, s.p99, s.max);
+}
+
+void w::WriteFrameTimes(const std::filesystem::path& path, std::span<const double> frame_ms)
+{
+    std::ofstream file{ path };
+    if (!file) {
+        throw w::Exception(wis::format("Unable to write frame times: {}", path.string()));
+    }
+    file << "frame,ms\n";
+    for (size_t i = 0; i < frame_ms.size(); i++) {
+        file << i << ',' << frame_ms[i] << '\n';
+    }
+}
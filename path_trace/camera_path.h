@@ -0,0 +1,66 @@
+#pragma once
+#include "scene.h"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace w {
+struct CameraKeyframe {
+    double time = 0.0; // seconds since the start of the recording
+    Camera::State camera{};
+    Scene::RenderSettings settings{};
+};
+
+// Timestamped camera states and render settings, stored as a little endian binary log.
+// Playback samples it at fixed steps, so a replay renders the same frames on every run and machine.
+class CameraPath
+{
+public:
+    static constexpr char magic[4] = { 'W', 'C', 'A', 'M' };
+    static constexpr uint32_t version = 1;
+
+public:
+    static CameraPath Load(const std::filesystem::path& path);
+    void Save(const std::filesystem::path& path) const;
+
+public:
+    // Keyframes are only written on changes. A state that was held still is closed with a keyframe
+    // at the last time it was seen, so playback does not drift through pauses.
+    void Record(double time, const Camera::State& camera, const Scene::RenderSettings& settings);
+    // camera interpolated between the surrounding keyframes, settings of the last keyframe at or before time
+    CameraKeyframe Sample(double time) const noexcept;
+    // time of `frame` when `frame_count` frames are spread evenly over the path
+    double FrameTime(uint32_t frame, uint32_t frame_count) const noexcept;
+
+    double Duration() const noexcept
+    {
+        return keyframes.empty() ? 0.0 : Keyframes().back().time;
+    }
+    std::span<const CameraKeyframe> Keyframes() const noexcept
+    {
+        return keyframes;
+    }
+
+private:
+    std::vector<CameraKeyframe> keyframes;
+    std::optional<double> hold_time; // last time the final keyframe's state was recorded unchanged
+};
+
+// in milliseconds
+struct FrameTimeStats {
+    uint32_t frames = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+FrameTimeStats ComputeFrameTimeStats(std::span<const double> frame_ms);
+std::string FormatFrameTimeStats(const FrameTimeStats& stats);
+// CSV with one "frame,ms" row per frame
+void WriteFrameTimes(const std::filesystem::path& path, std::span<const double> frame_ms);
+} // namespace w
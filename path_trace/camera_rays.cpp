@@ -0,0 +1,144 @@
+#include "camera_rays.h"
+#include "shading.h"
+
+namespace {
+using namespace DirectX;
+
+constexpr float t_min = 0.01f; // RayGeneration
+constexpr float t_max = 1000.0f;
+
+// Shirley-Chiu concentric mapping of the unit square to the unit disk
+XMFLOAT2 ConcentricDisk(XMFLOAT2 sigma) noexcept
+{
+    float a = 2.0f * sigma.x - 1.0f;
+    float b = 2.0f * sigma.y - 1.0f;
+    if (a == 0.0f && b == 0.0f) {
+        return { 0.0f, 0.0f };
+    }
+    float r, phi;
+    if (std::abs(a) > std::abs(b)) {
+        r = a;
+        phi = w::shading::pi / 4.0f * (b / a);
+    } else {
+        r = b;
+        phi = w::shading::pi / 2.0f - w::shading::pi / 4.0f * (a / b);
+    }
+    return { r * std::cos(phi), r * std::sin(phi) };
+}
+} // namespace
+
+w::CameraRays::CameraRays(const Camera::CBuffer& camera, uint32_t width, uint32_t height, CameraRayOptions options) noexcept
+    : width(width), height(height), options(options)
+{
+    XMVECTOR forward = XMLoadFloat4A(&camera.ray_forward);
+    XMVECTOR right = XMLoadFloat4A(&camera.ray_right);
+    XMVECTOR up = XMLoadFloat4A(&camera.ray_up);
+
+    // NDC x = (px / width) * 2 - 1
+    XMStoreFloat3(&origin, XMLoadFloat4A(&camera.ray_origin));
+    XMStoreFloat3(&corner, forward - right - up);
+    XMStoreFloat3(&step_x, right * (2.0f / float(width)));
+    XMStoreFloat3(&step_y, up * (2.0f / float(height)));
+    XMStoreFloat3(&lens_u, XMVector3Normalize(right) * options.aperture_radius);
+    XMStoreFloat3(&lens_v, XMVector3Normalize(up) * options.aperture_radius);
+}
+
+w::Ray w::CameraRays::Generate(uint32_t x, uint32_t y, uint32_t& seed) const noexcept
+{
+    XMFLOAT2 jitter = options.jitter ? shading::NextRand2(seed) : XMFLOAT2{ 0.5f, 0.5f };
+    XMVECTOR o = XMLoadFloat3(&origin);
+    XMVECTOR dir = XMLoadFloat3(&corner) + XMLoadFloat3(&step_x) * (float(x) + jitter.x) + XMLoadFloat3(&step_y) * (float(y) + jitter.y);
+
+    if (options.aperture_radius > 0.0f) {
+        // the pinhole ray hits the focus plane at dir * focus_distance, rays through the lens converge there
+        XMFLOAT2 lens = ConcentricDisk(shading::NextRand2(seed));
+        XMVECTOR offset = XMLoadFloat3(&lens_u) * lens.x + XMLoadFloat3(&lens_v) * lens.y;
+        o += offset;
+        dir = dir * options.focus_distance - offset;
+    }
+
+    Ray ray{ .t_min = t_min, .t_max = t_max };
+    XMStoreFloat3(&ray.origin, o);
+    XMStoreFloat3(&ray.direction, XMVector3Normalize(dir));
+    return ray;
+}
+
+void w::CameraRays::GenerateTile(uint32_t x0, uint32_t y0, uint32_t tile_width, uint32_t tile_height, std::span<uint32_t> seeds, std::span<Ray> rays) const noexcept
+{
+    // structure of arrays, lane i is pixel x + i of the row
+    const XMVECTOR corner_x = XMVectorReplicate(corner.x), corner_y = XMVectorReplicate(corner.y), corner_z = XMVectorReplicate(corner.z);
+    const XMVECTOR sx_x = XMVectorReplicate(step_x.x), sx_y = XMVectorReplicate(step_x.y), sx_z = XMVectorReplicate(step_x.z);
+    const XMVECTOR sy_x = XMVectorReplicate(step_y.x), sy_y = XMVectorReplicate(step_y.y), sy_z = XMVectorReplicate(step_y.z);
+    const XMVECTOR lane_offset = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f); // pixel centers
+    const XMVECTOR lane_step = XMVectorReplicate(float(lanes));
+    const bool lens = options.aperture_radius > 0.0f;
+
+    for (uint32_t ty = 0; ty < tile_height; ty++) {
+        const uint32_t row = ty * tile_width;
+        XMVECTOR py = XMVectorReplicate(float(y0 + ty) + 0.5f);
+        XMVECTOR px = XMVectorAdd(XMVectorReplicate(float(x0)), lane_offset);
+
+        for (uint32_t tx = 0; tx < tile_width; tx += lanes, px = XMVectorAdd(px, lane_step)) {
+            const uint32_t count = std::min(lanes, tile_width - tx);
+            uint32_t* lane_seeds = seeds.empty() ? nullptr : seeds.data() + row + tx;
+
+            XMVECTOR jx = px, jy = py;
+            if (options.jitter) {
+                alignas(16) XMFLOAT4A jitter_x, jitter_y;
+                float* jxs = &jitter_x.x;
+                float* jys = &jitter_y.x;
+                for (uint32_t i = 0; i < lanes; i++) {
+                    XMFLOAT2 j = i < count ? shading::NextRand2(lane_seeds[i]) : XMFLOAT2{ 0.5f, 0.5f };
+                    jxs[i] = j.x - 0.5f;
+                    jys[i] = j.y - 0.5f;
+                }
+                jx = XMVectorAdd(jx, XMLoadFloat4A(&jitter_x));
+                jy = XMVectorAdd(jy, XMLoadFloat4A(&jitter_y));
+            }
+
+            XMVECTOR dx = XMVectorMultiplyAdd(jx, sx_x, XMVectorMultiplyAdd(jy, sy_x, corner_x));
+            XMVECTOR dy = XMVectorMultiplyAdd(jx, sx_y, XMVectorMultiplyAdd(jy, sy_y, corner_y));
+            XMVECTOR dz = XMVectorMultiplyAdd(jx, sx_z, XMVectorMultiplyAdd(jy, sy_z, corner_z));
+
+            XMVECTOR ox = XMVectorReplicate(origin.x), oy = XMVectorReplicate(origin.y), oz = XMVectorReplicate(origin.z);
+            if (lens) {
+                alignas(16) XMFLOAT4A lens_a, lens_b;
+                float* la = &lens_a.x;
+                float* lb = &lens_b.x;
+                for (uint32_t i = 0; i < lanes; i++) {
+                    XMFLOAT2 l = i < count ? ConcentricDisk(shading::NextRand2(lane_seeds[i])) : XMFLOAT2{};
+                    la[i] = l.x;
+                    lb[i] = l.y;
+                }
+                XMVECTOR a = XMLoadFloat4A(&lens_a), b = XMLoadFloat4A(&lens_b);
+                XMVECTOR off_x = XMVectorMultiplyAdd(a, XMVectorReplicate(lens_u.x), XMVectorMultiply(b, XMVectorReplicate(lens_v.x)));
+                XMVECTOR off_y = XMVectorMultiplyAdd(a, XMVectorReplicate(lens_u.y), XMVectorMultiply(b, XMVectorReplicate(lens_v.y)));
+                XMVECTOR off_z = XMVectorMultiplyAdd(a, XMVectorReplicate(lens_u.z), XMVectorMultiply(b, XMVectorReplicate(lens_v.z)));
+                XMVECTOR focus = XMVectorReplicate(options.focus_distance);
+                ox = XMVectorAdd(ox, off_x);
+                oy = XMVectorAdd(oy, off_y);
+                oz = XMVectorAdd(oz, off_z);
+                dx = XMVectorSubtract(XMVectorMultiply(dx, focus), off_x);
+                dy = XMVectorSubtract(XMVectorMultiply(dy, focus), off_y);
+                dz = XMVectorSubtract(XMVectorMultiply(dz, focus), off_z);
+            }
+
+            XMVECTOR inv_length = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+            alignas(16) XMFLOAT4A out[6];
+            XMStoreFloat4A(&out[0], ox);
+            XMStoreFloat4A(&out[1], oy);
+            XMStoreFloat4A(&out[2], oz);
+            XMStoreFloat4A(&out[3], XMVectorMultiply(dx, inv_length));
+            XMStoreFloat4A(&out[4], XMVectorMultiply(dy, inv_length));
+            XMStoreFloat4A(&out[5], XMVectorMultiply(dz, inv_length));
+            for (uint32_t i = 0; i < count; i++) {
+                rays[row + tx + i] = {
+                    .origin = { (&out[0].x)[i], (&out[1].x)[i], (&out[2].x)[i] },
+                    .t_min = t_min,
+                    .direction = { (&out[3].x)[i], (&out[4].x)[i], (&out[5].x)[i] },
+                    .t_max = t_max,
+                };
+            }
+        }
+    }
+}
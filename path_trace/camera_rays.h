@@ -0,0 +1,56 @@
+#pragma once
+#include "camera.h"
+#include "intersect.h"
+#include <span>
+
+namespace w {
+struct CameraRayOptions {
+    bool jitter = false; // random sub pixel position instead of the pixel center
+    float aperture_radius = 0.0f; // thin lens, 0 is a pinhole
+    float focus_distance = 10.0f; // view depth of the plane in focus
+};
+
+// Primary rays from the precomputed image plane basis of Camera::CBuffer.
+// Directions advance by a constant per pixel step, so a tile needs no matrix math and is generated 4 rays at a time.
+class CameraRays
+{
+public:
+    static constexpr uint32_t lanes = 4;
+
+public:
+    CameraRays() = default;
+    CameraRays(const Camera::CBuffer& camera, uint32_t width, uint32_t height, CameraRayOptions options = {}) noexcept;
+
+public:
+    // Ray of launch pixel (x, y) like RayGeneration, seed is only advanced by jitter and lens samples
+    Ray Generate(uint32_t x, uint32_t y, uint32_t& seed) const noexcept;
+    // Rays of [x0, x0 + width) x [y0, y0 + height) in row major order.
+    // seeds holds one RNG state per pixel in the same order as for Generate, it may be empty without jitter and lens.
+    void GenerateTile(uint32_t x0, uint32_t y0, uint32_t width, uint32_t height, std::span<uint32_t> seeds, std::span<Ray> rays) const noexcept;
+
+    uint32_t GetWidth() const noexcept
+    {
+        return width;
+    }
+    uint32_t GetHeight() const noexcept
+    {
+        return height;
+    }
+    const CameraRayOptions& GetOptions() const noexcept
+    {
+        return options;
+    }
+
+private:
+    DirectX::XMFLOAT3 origin{};
+    DirectX::XMFLOAT3 corner{}; // unnormalized direction through the corner of pixel (0, 0) at unit view depth
+    DirectX::XMFLOAT3 step_x{}; // per pixel
+    DirectX::XMFLOAT3 step_y{};
+    DirectX::XMFLOAT3 lens_u{}; // lens plane axes scaled by the aperture radius
+    DirectX::XMFLOAT3 lens_v{};
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    CameraRayOptions options;
+};
+} // namespace w
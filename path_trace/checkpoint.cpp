@@ -0,0 +1,294 @@
+#include "checkpoint.h"
+#include "graphics.h"
+#include "hash.h"
+#include "profiler.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+constexpr uint32_t checkpoint_magic = 0x504b4357; // "WCKP"
+constexpr uint32_t checkpoint_version = 2;
+constexpr size_t page_size = 4096; // headers get pages of their own, flushing one never writes another
+
+// file: FileHeader page, then two slots of a SlotHeader page followed by the texels of all textures
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint64_t slot_size;
+};
+struct SlotHeader {
+    uint64_t sequence; // 0 while the slot is being written
+    w::CheckpointState state;
+    uint64_t data_checksum;
+    uint64_t header_checksum; // of everything above
+};
+
+template<typename T>
+uint64_t HashField(const T& field, uint64_t hash) noexcept
+{
+    return w::Hash64(std::as_bytes(std::span{ &field, 1 }), hash);
+}
+// field by field, the padding of the structs is indeterminate
+uint64_t HeaderChecksum(const SlotHeader& header)
+{
+    const auto& state = header.state;
+    uint64_t hash = HashField(header.sequence, 0xcbf29ce484222325ull);
+    for (uint32_t field : { state.width, state.height, state.frame_count }) {
+        hash = HashField(field, hash);
+    }
+    for (float field : { state.camera.orientation.x, state.camera.orientation.y, state.camera.radius }) {
+        hash = HashField(field, hash);
+    }
+    for (int32_t field : { state.settings.sampling_fn, state.settings.brdf, state.settings.max_depth, int32_t(state.settings.accumulate) }) {
+        hash = HashField(field, hash);
+    }
+    return HashField(header.data_checksum, hash);
+}
+
+size_t TextureBytes(uint32_t width, uint32_t height)
+{
+    return size_t(width) * height * w::Checkpointer::texel_size;
+}
+size_t SlotSize(uint32_t width, uint32_t height)
+{
+    size_t data = TextureBytes(width, height) * w::flight_frames;
+    return page_size + (data + page_size - 1) / page_size * page_size;
+}
+size_t SlotOffset(uint32_t slot, size_t slot_size)
+{
+    return page_size + slot * slot_size;
+}
+
+std::optional<FileHeader> ReadFileHeader(std::span<const std::byte> file)
+{
+    FileHeader header;
+    if (file.size() < page_size) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != checkpoint_magic || header.version != checkpoint_version ||
+        header.slot_size != SlotSize(header.width, header.height) || file.size() < SlotOffset(2, header.slot_size)) {
+        return std::nullopt;
+    }
+    return header;
+}
+// header of a completely written slot
+std::optional<SlotHeader> ReadSlot(std::span<const std::byte> file, const FileHeader& file_header, uint32_t slot)
+{
+    auto bytes = file.subspan(SlotOffset(slot, file_header.slot_size), file_header.slot_size);
+    SlotHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.sequence == 0 || header.header_checksum != HeaderChecksum(header) ||
+        header.state.width != file_header.width || header.state.height != file_header.height ||
+        header.data_checksum != w::Hash64(bytes.subspan(page_size, TextureBytes(file_header.width, file_header.height) * w::flight_frames))) {
+        return std::nullopt;
+    }
+    return header;
+}
+} // namespace
+
+w::Checkpointer::Checkpointer(Graphics& gfx, std::filesystem::path path, std::chrono::seconds interval)
+    : gfx(gfx), path(std::move(path)), interval(interval)
+{
+}
+
+w::Checkpointer::~Checkpointer() = default;
+
+std::optional<w::Checkpoint> w::Checkpointer::Load(const std::filesystem::path& path)
+{
+    W_PROFILE_FUNCTION();
+    if (!std::filesystem::exists(path)) {
+        return std::nullopt;
+    }
+    auto file = MappedFile::Open(path);
+    auto file_header = ReadFileHeader(file.Data());
+    if (!file_header) {
+        return std::nullopt;
+    }
+
+    std::optional<SlotHeader> newest;
+    uint32_t newest_slot = 0;
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        auto header = ReadSlot(file.Data(), *file_header, slot);
+        if (header && (!newest || header->sequence > newest->sequence)) {
+            newest = header;
+            newest_slot = slot;
+        }
+    }
+    if (!newest) {
+        return std::nullopt;
+    }
+
+    Checkpoint checkpoint{ newest->state };
+    size_t texture_bytes = TextureBytes(file_header->width, file_header->height);
+    auto texels = file.Data().subspan(SlotOffset(newest_slot, file_header->slot_size) + page_size);
+    for (uint32_t i = 0; i < flight_frames; i++) {
+        auto texture = texels.subspan(i * texture_bytes, texture_bytes);
+        checkpoint.textures[i].assign(texture.begin(), texture.end());
+    }
+    return checkpoint;
+}
+
+std::vector<wis::BufferTextureCopyRegion> w::Checkpointer::CopyRegions(uint32_t width, uint32_t height, uint64_t base)
+{
+    std::vector<wis::BufferTextureCopyRegion> regions(height);
+    for (uint32_t y = 0; y < height; y++) {
+        regions[y] = {
+            .buffer_offset = base + y * RowPitch(width),
+            .texture = {
+                    .offset = { 0, y, 0 },
+                    .size = { width, 1, 1 },
+                    .format = format,
+            },
+        };
+    }
+    return regions;
+}
+
+void w::Checkpointer::Resize(uint32_t width, uint32_t height)
+{
+    W_PROFILE_FUNCTION();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    pending.reset();
+    this->width = width;
+    this->height = height;
+
+    wis::Result result = wis::success;
+    readback = gfx.allocator.CreateReadbackBuffer(result, RowPitch(width) * height * flight_frames);
+    CheckResult(result);
+
+    // checkpoints of the same size stay until they are overwritten, they may be resumed from.
+    // A file of another size is left untouched, Write replaces it once a checkpoint of this size is complete.
+    file = {};
+    sequence = 0;
+    next_slot = 0;
+    if (!std::filesystem::exists(path)) {
+        return;
+    }
+    auto existing_file = MappedFile::Open(path);
+    auto existing = ReadFileHeader(existing_file.Data());
+    if (!existing || existing->width != width || existing->height != height) {
+        return;
+    }
+    file = std::move(existing_file);
+    for (uint32_t slot = 0; slot < 2; slot++) {
+        auto header = ReadSlot(file.Data(), *existing, slot);
+        if (header && header->sequence > sequence) {
+            sequence = header->sequence;
+            next_slot = 1 - slot;
+        }
+    }
+}
+
+void w::Checkpointer::BeginFrame()
+{
+    // the swapchain waited for the frame flight_frames back before this one
+    if (pending && ++frames_since_copy >= flight_frames) {
+        StartWriter();
+    }
+}
+
+bool w::Checkpointer::Due() const noexcept
+{
+    return width > 0 && !pending && !writing && std::chrono::steady_clock::now() - last_copy >= interval;
+}
+
+void w::Checkpointer::Copy(wis::CommandList& cmd, std::span<const wis::Texture* const, flight_frames> textures, const CheckpointState& state)
+{
+    W_PROFILE_FUNCTION();
+    for (uint32_t i = 0; i < flight_frames; i++) {
+        auto regions = CopyRegions(width, height, RowPitch(width) * height * i);
+        cmd.CopyTextureToBuffer(*textures[i], readback, regions.data(), uint32_t(regions.size()));
+    }
+    pending = state;
+    frames_since_copy = 0;
+    last_copy = std::chrono::steady_clock::now();
+}
+
+void w::Checkpointer::Finish()
+{
+    if (pending) {
+        StartWriter();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void w::Checkpointer::StartWriter()
+{
+    if (writer.joinable()) {
+        writer.join(); // finished, Due() held off the copy until it was
+    }
+    writing = true;
+    writer = std::jthread([this, state = *pending]() {
+        W_PROFILE_THREAD("Checkpoint writer");
+        try {
+            Write(state);
+        } catch (const std::exception& e) {
+            std::cerr << wis::format("Checkpoint to {} failed: {}\n", path.string(), e.what());
+        }
+        writing = false;
+    });
+    pending.reset();
+}
+
+void w::Checkpointer::Write(CheckpointState state)
+{
+    W_PROFILE_FUNCTION();
+    size_t slot_size = SlotSize(width, height);
+
+    // no file of this size yet: lay out a new one next to it and rename it over the old one once its first slot is
+    // valid, a crash before that leaves the old checkpoints loadable
+    bool replace = !file;
+    auto replacement = std::filesystem::path(path).concat(".new");
+    if (replace) {
+        std::filesystem::remove(replacement); // left by an interrupted replacement, its slots may look valid
+        file = MappedFile::Open(replacement, SlotOffset(2, slot_size));
+        FileHeader header{ checkpoint_magic, checkpoint_version, width, height, slot_size };
+        std::memcpy(file.Data().data(), &header, sizeof(header));
+        file.Flush(0, sizeof(header));
+        sequence = 0;
+        next_slot = 0;
+    }
+
+    auto data = file.Data();
+    size_t offset = SlotOffset(next_slot, slot_size);
+
+    // the slot is invalid until its header is written again, the other one holds the previous checkpoint
+    SlotHeader header{};
+    std::memcpy(data.data() + offset, &header, sizeof(header));
+    file.Flush(offset, sizeof(header));
+
+    size_t row_bytes = size_t(width) * texel_size;
+    size_t texture_bytes = TextureBytes(width, height);
+    auto texels = data.subspan(offset + page_size, texture_bytes * flight_frames);
+    const auto* rows = readback.Map<const std::byte>();
+    for (uint32_t i = 0; i < flight_frames; i++) {
+        for (uint32_t y = 0; y < height; y++) {
+            std::memcpy(texels.data() + i * texture_bytes + y * row_bytes, rows + (size_t(i) * height + y) * RowPitch(width), row_bytes);
+        }
+    }
+    readback.Unmap();
+    file.Flush(offset + page_size, texels.size());
+
+    header.sequence = sequence + 1;
+    header.state = state;
+    header.data_checksum = w::Hash64(texels);
+    header.header_checksum = HeaderChecksum(header);
+    std::memcpy(data.data() + offset, &header, sizeof(header));
+    file.Flush(offset, sizeof(header));
+
+    sequence++;
+    next_slot = 1 - next_slot;
+
+    if (replace) {
+        file = {};
+        std::filesystem::rename(replacement, path);
+        file = MappedFile::Open(path);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "scene.h"
+#include "mapped_file.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace w {
+class Graphics;
+
+// Everything a progressive render needs to continue bit-identically.
+// The sampler is seeded from the pixel and the frame count alone, so frame_count is its whole state.
+struct CheckpointState {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t frame_count = 0; // of the next frame
+    Camera::State camera{};
+    Scene::RenderSettings settings{};
+
+    bool operator==(const CheckpointState&) const = default;
+};
+
+struct Checkpoint {
+    CheckpointState state;
+    // tightly packed texels of the accumulation textures, rows as in the texture.
+    // [0] is accumulated into by the next frame, [1] by the one after.
+    std::array<std::vector<std::byte>, flight_frames> textures;
+};
+
+// Periodic checkpoints of the accumulation textures in a memory mapped file.
+// The file has two slots, a checkpoint overwrites the older one and becomes valid with a checksummed slot header
+// that is written and flushed last, so a crash at any point leaves the previous checkpoint loadable.
+// A file laid out for another size is only replaced once a complete checkpoint of the new size exists.
+// The textures are copied into a readback buffer within a frame and moved into the file by a writer thread once the
+// frame has completed. Rendering never waits on it; a checkpoint that comes due while one is in flight is skipped.
+class Checkpointer
+{
+public:
+    static constexpr wis::DataFormat format = w::swap_format;
+    static constexpr uint32_t texel_size = 4;
+    static constexpr uint32_t row_alignment = 512; // copy placement alignment, every row is its own copy region
+
+public:
+    Checkpointer(Graphics& gfx, std::filesystem::path path, std::chrono::seconds interval);
+    ~Checkpointer();
+
+public:
+    // latest valid checkpoint in path, nullopt if there is none
+    static std::optional<Checkpoint> Load(const std::filesystem::path& path);
+    // rows of a width x height texture at buffer offset base with row_alignment spaced rows
+    static std::vector<wis::BufferTextureCopyRegion> CopyRegions(uint32_t width, uint32_t height, uint64_t base);
+    static uint64_t RowPitch(uint32_t width) noexcept
+    {
+        return (uint64_t(width) * texel_size + row_alignment - 1) / row_alignment * row_alignment;
+    }
+
+    // Waits for the writer and prepares for textures of a new size.
+    // A file laid out for the same size keeps its checkpoints, otherwise it is kept until the next checkpoint replaces it.
+    void Resize(uint32_t width, uint32_t height);
+    // Call once per frame before recording: a copy whose frame has completed goes to the writer thread.
+    void BeginFrame();
+    // true if a checkpoint is due and nothing is in flight
+    bool Due() const noexcept;
+    // Records the copy of textures (next frame's first) described by state, after the frame's trace.
+    // Called from a render graph pass that uses the textures as copy sources.
+    void Copy(wis::CommandList& cmd, std::span<const wis::Texture* const, flight_frames> textures, const CheckpointState& state);
+    // writes a copy still in flight, the GPU must be idle
+    void Finish();
+
+private:
+    void Write(CheckpointState state);
+    void StartWriter();
+
+private:
+    Graphics& gfx;
+    std::filesystem::path path;
+    std::chrono::seconds interval;
+    std::chrono::steady_clock::time_point last_copy = std::chrono::steady_clock::now();
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    wis::Buffer readback;
+    MappedFile file; // laid out for width x height, closed until the first checkpoint if the file on disk is not
+    uint64_t sequence = 0; // of the newest valid slot
+    uint32_t next_slot = 0;
+
+    std::optional<CheckpointState> pending; // copied, frame not yet complete
+    uint32_t frames_since_copy = 0;
+    std::atomic<bool> writing = false;
+    std::jthread writer;
+};
+} // namespace w
@@ -29,25 +29,4 @@ inline void CheckResult(wis::Result res)
         throw Exception(res.error);
     }
 }
-inline std::string LoadShader(std::filesystem::path p)
-{
-    if constexpr (wis::shader_intermediate == wis::ShaderIntermediate::DXIL) {
-        p += u".cso";
-    } else {
-        p += u".spv";
-    }
-
-    if (!std::filesystem::exists(p)) {
-        throw w::Exception(wis::format("Shader file not found: {}", p.string()));
-    }
-
-    std::ifstream t{ p, std::ios::binary };
-    t.seekg(0, std::ios::end);
-    size_t size = t.tellg();
-    std::string ret;
-    ret.resize(size);
-    t.seekg(0);
-    t.read(ret.data(), size);
-    return ret;
-}
 } // namespace w
\ No newline at end of file
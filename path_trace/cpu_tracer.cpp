@@ -0,0 +1,406 @@
+#include "cpu_tracer.h"
+#include "shading.h"
+#include "uv_sphere.h"
+#include "profiler.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace {
+using namespace DirectX;
+
+// pathtrace.lib.hlsl
+constexpr XMFLOAT3 sky_top{ 0.24f, 0.44f, 0.72f };
+constexpr XMFLOAT3 sky_bottom{ 0.75f, 0.86f, 0.93f };
+// hit.lib.hlsl
+constexpr XMFLOAT3 face_normals_box[] = {
+    { 0, 0, 1 },
+    { 0, 0, -1 },
+    { 1, 0, 0 },
+    { -1, 0, 0 },
+    { 0, -1, 0 },
+    { 0, 1, 0 },
+};
+
+w::Ray XM_CALLCONV TransformRay(const w::Ray& ray, FXMMATRIX m) noexcept
+{
+    w::Ray r = ray;
+    XMStoreFloat3(&r.origin, XMVector3TransformCoord(XMLoadFloat3(&ray.origin), m));
+    XMStoreFloat3(&r.direction, XMVector3TransformNormal(XMLoadFloat3(&ray.direction), m));
+    return r;
+}
+
+XMVECTOR XM_CALLCONV Reflect(FXMVECTOR i, FXMVECTOR n) noexcept
+{
+    return i - n * (2.0f * XMVectorGetX(XMVector3Dot(i, n)));
+}
+
+struct PathState {
+    const w::CpuScene& scene;
+    const w::Scene::RenderSettings& settings;
+    uint32_t seed;
+    w::TraceCounters counters{};
+};
+
+// Kernels are instantiated for every sampling function and BRDF like the hit.lib permutations,
+// `generic` reads them from the settings at every bounce like the shaders without SAMPLING_FN and BRDF_FN.
+constexpr int32_t generic = -1;
+
+template<int32_t sampling_fn>
+XMVECTOR XM_CALLCONV SampleSelect(const w::Scene::RenderSettings& settings, XMFLOAT2 sigma, FXMVECTOR normal, FXMVECTOR direction, float roughness) noexcept
+{
+    switch (sampling_fn == generic ? settings.sampling_fn : sampling_fn) {
+    default:
+    case 0:
+        return w::shading::UniformHemisphereSample(sigma, normal);
+    case 1:
+        return w::shading::CosineWeightedHemisphereSample(sigma, normal);
+    case 2:
+    case 3:
+        return Reflect(direction, w::shading::GetGGXMicrofacet(sigma, normal, roughness));
+    }
+}
+template<int32_t sampling_fn>
+float XM_CALLCONV PDFSelect(const w::Scene::RenderSettings& settings, const w::MaterialCBuffer& mat, FXMVECTOR V, FXMVECTOR L, FXMVECTOR N, float bias) noexcept
+{
+    switch (sampling_fn == generic ? settings.sampling_fn : sampling_fn) {
+    default:
+    case 0:
+        return 1.0f / (2.0f * w::shading::pi);
+    case 1:
+        return XMVectorGetX(XMVector3Dot(L, N)) / w::shading::pi;
+    case 2:
+        return w::shading::EvaluateGGXPDF(N, V, L, mat.roughness);
+    case 3:
+        return mat.roughness < bias ? w::shading::EvaluateGGXPDF(N, V, L, mat.roughness) : XMVectorGetX(XMVector3Dot(L, N)) / w::shading::pi * mat.roughness;
+    }
+}
+template<int32_t brdf>
+XMVECTOR XM_CALLCONV ComputeBRDF(const w::Scene::RenderSettings& settings, const w::MaterialCBuffer& mat, FXMVECTOR V, FXMVECTOR L, FXMVECTOR N, float bias) noexcept
+{
+    XMVECTOR diffuse = XMLoadFloat4A(&mat.diffuse);
+    switch (brdf == generic ? settings.brdf : brdf) {
+    default:
+    case 0:
+        return XMVectorReplicate(1.0f / w::shading::pi);
+    case 1:
+        return diffuse / w::shading::pi;
+    case 2:
+        return diffuse * w::shading::EvaluateCookTorrance(N, V, L, mat.roughness);
+    case 3:
+        return mat.roughness < bias ? XMVectorReplicate(w::shading::EvaluateCookTorrance(N, V, L, mat.roughness)) : diffuse / w::shading::pi * mat.roughness;
+    }
+}
+
+// The recursive closest hit shaders unrolled, radiance is the terminal color times the path throughput
+template<int32_t sampling_fn, int32_t brdf>
+XMVECTOR TracePath(PathState& path, w::Ray ray)
+{
+    auto& settings = path.settings;
+    XMVECTOR throughput = XMVectorReplicate(1.0f);
+    bool primary = true;
+
+    for (int32_t depth = 1;; depth++) {
+        w::CpuHit hit;
+        if (!path.scene.Intersect(ray, primary, hit, path.counters)) { // Miss
+            float slope = XMVectorGetY(XMVector3Normalize(XMLoadFloat3(&ray.direction)));
+            float t = std::clamp(slope * 5.0f + 0.5f, 0.0f, 1.0f);
+            return throughput * XMVectorLerp(XMLoadFloat3(&sky_bottom), XMLoadFloat3(&sky_top), t);
+        }
+
+        auto& instance = path.scene.GetInstance(hit.instance);
+        auto& mat = path.scene.GetMaterial(instance.instance_id);
+        bool emissive = instance.mesh != w::CpuScene::box && !XMVector4Equal(XMLoadFloat4A(&mat.emissive), XMVectorZero());
+        if (emissive || depth >= settings.max_depth) {
+            return throughput * XMLoadFloat4A(&mat.emissive);
+        }
+
+        XMVECTOR normal = path.scene.Normal(hit);
+
+        float bias = std::clamp(w::shading::NextRand(path.seed) + 0.01f, 0.0f, 1.0f);
+        XMVECTOR direction = XMLoadFloat3(&ray.direction);
+        XMVECTOR sample = SampleSelect<sampling_fn>(settings, w::shading::NextRand2(path.seed), normal, direction, mat.roughness);
+
+        XMFLOAT3 hit_point, n;
+        XMStoreFloat3(&hit_point, XMLoadFloat3(&ray.origin) + direction * hit.hit.triangle.t);
+        XMStoreFloat3(&n, normal);
+        XMVECTOR new_dir = XMVector3Normalize(sample);
+        XMVECTOR V = -XMVector3Normalize(direction);
+
+        XMVECTOR f = ComputeBRDF<brdf>(settings, mat, V, new_dir, normal, bias);
+        float cos_theta = std::max(XMVectorGetX(XMVector3Dot(normal, new_dir)), 0.0f);
+        throughput *= f * (cos_theta / PDFSelect<sampling_fn>(settings, mat, V, new_dir, normal, bias));
+        path.counters.shading++;
+        path.counters.bounces++;
+
+        ray = { .origin = w::shading::OffsetRay(hit_point, n), .t_min = 0.0f, .t_max = 1000.0f };
+        XMStoreFloat3(&ray.direction, new_dir);
+        primary = false;
+    }
+}
+
+using PathKernel = XMVECTOR (*)(PathState&, w::Ray);
+
+template<size_t... I>
+constexpr auto MakeKernels(std::index_sequence<I...>) noexcept
+{
+    constexpr size_t brdfs = std::size(w::BRDF_LABELS);
+    return std::array<PathKernel, sizeof...(I)>{ &TracePath<int32_t(I / brdfs), int32_t(I % brdfs)>... };
+}
+// indexed by Scene::PipelineIndex
+constexpr auto kernels = MakeKernels(std::make_index_sequence<w::Scene::pipeline_count>{});
+
+PathKernel SelectKernel(const w::Scene::RenderSettings& settings, bool specialized) noexcept
+{
+    return specialized ? kernels[w::Scene::PipelineIndex(settings)] : &TracePath<generic, generic>;
+}
+
+XMFLOAT3 Turbo(float x) noexcept
+{
+    // polynomial fit of Google's Turbo colormap
+    x = std::clamp(x, 0.0f, 1.0f);
+    return {
+        0.13572138f + x * (4.61539260f + x * (-42.66032258f + x * (132.13108234f + x * (-152.94239396f + x * 59.28637943f)))),
+        0.09140261f + x * (2.19418839f + x * (4.84296658f + x * (-14.18503333f + x * (4.27729857f + x * 2.82956604f)))),
+        0.10667330f + x * (12.64194608f + x * (-60.58204836f + x * (110.36276771f + x * (-89.90310912f + x * 27.34824973f)))),
+    };
+}
+} // namespace
+
+w::Image w::CounterImage::Channel(uint32_t TraceCounters::* counter) const
+{
+    Image image{ width, height };
+    for (size_t i = 0; i < pixels.size(); i++) {
+        float v = float(pixels[i].*counter);
+        image.pixels[i] = { v, v, v };
+    }
+    return image;
+}
+
+w::TraceCounters w::CounterImage::Total() const noexcept
+{
+    TraceCounters total;
+    for (auto& p : pixels) {
+        total += p;
+    }
+    return total;
+}
+
+w::Image w::FalseColor(const Image& values, float max_value)
+{
+    Image image{ values.width, values.height };
+    float scale = max_value > 0.0f ? 1.0f / max_value : 0.0f;
+    for (size_t i = 0; i < values.pixels.size(); i++) {
+        image.pixels[i] = Turbo(values.pixels[i].x * scale);
+    }
+    return image;
+}
+
+w::CpuScene::CpuScene()
+{
+    W_PROFILE_FUNCTION();
+    auto [vertices, normals, indices] = uv_sphere_generator::generate(SphereStatic::segments, SphereStatic::segments);
+    auto sphere_mesh = std::make_shared<CpuMesh>();
+    sphere_mesh->bvh = BVH{ vertices, indices };
+    sphere_mesh->normals = std::move(normals);
+    sphere_mesh->indices = std::move(indices);
+
+    auto box_mesh = std::make_shared<CpuMesh>();
+    box_mesh->indices.assign(std::begin(BoxStatic::indices), std::end(BoxStatic::indices));
+    box_mesh->bvh = BVH{ BoxStatic::vertices, box_mesh->indices };
+    meshes = { std::move(sphere_mesh), std::move(box_mesh) };
+}
+
+w::CpuScene::Instance w::CpuScene::MakeInstance(uint32_t mesh, FXMMATRIX object_to_world, uint32_t instance_id) const noexcept
+{
+    Instance instance{ .mesh = mesh, .instance_id = instance_id };
+    XMStoreFloat4x4(&instance.world_to_object, XMMatrixInverse(nullptr, object_to_world));
+
+    auto& bounds = meshes[mesh]->bvh.Bounds();
+    for (uint32_t c = 0; c < 8; c++) {
+        XMFLOAT3 corner{ (c & 1) ? bounds.max.x : bounds.min.x, (c & 2) ? bounds.max.y : bounds.min.y, (c & 4) ? bounds.max.z : bounds.min.z };
+        XMStoreFloat3(&corner, XMVector3TransformCoord(XMLoadFloat3(&corner), object_to_world));
+        instance.world_bounds.Grow(corner);
+    }
+    return instance;
+}
+
+void w::CpuScene::Update(std::span<const wis::AccelerationInstance> xinstances, std::span<const MaterialCBuffer> xmaterials)
+{
+    // added instances stay behind the TLAS ones, their materials move with the size of the material table
+    instances.erase(instances.begin(), instances.begin() + tlas_instances);
+    materials.erase(materials.begin(), materials.begin() + tlas_materials);
+    for (auto& added : instances) {
+        added.instance_id = added.instance_id - tlas_materials + uint32_t(xmaterials.size());
+    }
+    materials.insert(materials.begin(), xmaterials.begin(), xmaterials.end());
+
+    std::vector<Instance> tlas;
+    tlas.reserve(xinstances.size());
+    for (auto& in : xinstances) {
+        XMFLOAT3X4 transform;
+        std::memcpy(&transform, in.transform, sizeof(transform));
+
+        Instance instance = MakeInstance(in.instance_offset == 1 ? box : sphere, XMLoadFloat3x4(&transform), in.instance_id);
+        instance.cull_disable = (in.flags & uint32_t(wis::ASInstanceFlags::TriangleCullDisable)) != 0;
+        instance.front_ccw = (in.flags & uint32_t(wis::ASInstanceFlags::TriangleFrontCounterClockwise)) != 0;
+        tlas.push_back(instance);
+    }
+    instances.insert(instances.begin(), tlas.begin(), tlas.end());
+    tlas_instances = uint32_t(xinstances.size());
+    tlas_materials = uint32_t(xmaterials.size());
+}
+
+uint32_t w::CpuScene::AddMesh(std::shared_ptr<const CpuMesh> mesh)
+{
+    meshes.push_back(std::move(mesh));
+    return uint32_t(meshes.size() - 1);
+}
+
+void w::CpuScene::AddInstance(uint32_t mesh, const XMFLOAT4X4& object_to_world, const MaterialCBuffer& material)
+{
+    Instance instance = MakeInstance(mesh, XMLoadFloat4x4(&object_to_world), uint32_t(materials.size()));
+    instance.cull_disable = true;
+    instances.push_back(instance);
+    materials.push_back(material);
+}
+
+bool w::CpuScene::Intersect(const Ray& ray, bool cull_back_faces, CpuHit& hit, TraceCounters& counters) const noexcept
+{
+    const XMFLOAT3 inv_dir{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+    bool found = false;
+    for (uint32_t i = 0; i < instances.size(); i++) { // top level is a flat list, each instance box counts as a node
+        auto& instance = instances[i];
+        counters.nodes++;
+        if (instance.world_bounds.Intersect(ray.origin, inv_dir, ray.t_min, std::min(ray.t_max, hit.hit.triangle.t)) == FLT_MAX) {
+            continue;
+        }
+
+        // back faces are the ones that are not front faces, see TriangleHit::along_normal
+        FaceCull cull = FaceCull::None;
+        if (cull_back_faces && !instance.cull_disable) {
+            cull = instance.front_ccw ? FaceCull::AgainstNormal : FaceCull::AlongNormal;
+        }
+        // affine transform keeps t, the object space direction is not renormalized
+        if (meshes[instance.mesh]->bvh.Intersect(TransformRay(ray, XMLoadFloat4x4(&instance.world_to_object)), hit.hit, counters, cull)) {
+            hit.instance = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+XMVECTOR XM_CALLCONV w::CpuScene::Normal(const CpuHit& hit) const noexcept
+{
+    auto& instance = instances[hit.instance];
+    if (instance.mesh == box) {
+        return XMLoadFloat3(&face_normals_box[hit.hit.primitive / 2]);
+    }
+    auto& mesh = *meshes[instance.mesh];
+    const uint32_t* i = &mesh.indices[hit.hit.primitive * 3];
+    XMVECTOR n0 = XMLoadFloat3(&mesh.normals[i[0]]);
+    XMVECTOR n1 = XMLoadFloat3(&mesh.normals[i[1]]);
+    XMVECTOR n2 = XMLoadFloat3(&mesh.normals[i[2]]);
+    return XMVector3Normalize(n0 + hit.hit.triangle.u * (n1 - n0) + hit.hit.triangle.v * (n2 - n0));
+}
+
+w::CpuTracer::CpuTracer(uint32_t thread_count, bool specialized)
+    : thread_count(thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency())), specialized(specialized)
+{
+}
+
+void w::CpuTracer::Render(const CpuScene& scene, const CameraRays& camera, const Scene::RenderSettings& settings, uint32_t frame_count,
+                          Image& target, CounterImage* counters, uint32_t sample_count) const
+{
+    W_PROFILE_FUNCTION();
+    const uint32_t width = target.width, height = target.height;
+    if (counters) {
+        *counters = { width, height, std::vector<TraceCounters>(target.pixels.size()) };
+    }
+
+    const uint32_t tiles_x = (width + tile_size - 1) / tile_size;
+    const uint32_t tile_count = tiles_x * ((height + tile_size - 1) / tile_size);
+    std::atomic<uint32_t> next_tile = 0;
+    const PathKernel trace_path = SelectKernel(settings, specialized);
+
+    auto worker = [&]() {
+        W_PROFILE_THREAD("CPU tracer");
+        std::array<uint32_t, tile_size * tile_size> seeds;
+        std::array<Ray, tile_size * tile_size> rays;
+        for (uint32_t tile = next_tile++; tile < tile_count; tile = next_tile++) {
+            W_PROFILE_SCOPE("Trace tile");
+            uint32_t x0 = (tile % tiles_x) * tile_size, y0 = (tile / tiles_x) * tile_size;
+            uint32_t tile_width = std::min(tile_size, width - x0), tile_height = std::min(tile_size, height - y0);
+            // samples in order per tile, the tile stays in cache between them
+            for (uint32_t sample = frame_count; sample < frame_count + sample_count; sample++) {
+                for (uint32_t ty = 0; ty < tile_height; ty++) {
+                    for (uint32_t tx = 0; tx < tile_width; tx++) {
+                        seeds[ty * tile_width + tx] = shading::InitRand(x0 + tx + (y0 + ty) * width, sample, 16);
+                    }
+                }
+                camera.GenerateTile(x0, y0, tile_width, tile_height, seeds, rays);
+
+                for (uint32_t ty = 0; ty < tile_height; ty++) {
+                    for (uint32_t tx = 0; tx < tile_width; tx++) {
+                        uint32_t i = ty * tile_width + tx;
+                        PathState path{ scene, settings, seeds[i] };
+                        XMVECTOR color = trace_path(path, rays[i]);
+
+                        // the image is stored top down, launch y = 0 is the bottom row
+                        uint32_t x = x0 + tx, row = height - 1 - (y0 + ty);
+                        auto& out = target.At(x, row);
+                        if (settings.accumulate) {
+                            color = (XMLoadFloat3(&out) * float(sample) + color) / float(sample + 1);
+                        }
+                        XMStoreFloat3(&out, color);
+                        if (counters) {
+                            counters->pixels[size_t(row) * width + x] += path.counters;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+}
+
+void w::CpuTracer::RenderTile(const CpuScene& scene, const CameraRays& camera, const Scene::RenderSettings& settings,
+                              uint32_t x0, uint32_t y0, uint32_t width, uint32_t height,
+                              uint32_t sample_begin, uint32_t sample_count, std::span<XMFLOAT3> sums)
+{
+    W_PROFILE_FUNCTION();
+    const uint32_t image_width = camera.GetWidth();
+    std::array<uint32_t, tile_size * tile_size> seeds;
+    std::array<Ray, tile_size * tile_size> rays;
+    const PathKernel trace_path = SelectKernel(settings, true);
+
+    // same seeds and ray batches as Render, so a sample does not depend on who traces it
+    for (uint32_t sy = 0; sy < height; sy += tile_size) {
+        for (uint32_t sx = 0; sx < width; sx += tile_size) {
+            uint32_t tile_width = std::min(tile_size, width - sx), tile_height = std::min(tile_size, height - sy);
+            for (uint32_t sample = sample_begin; sample < sample_begin + sample_count; sample++) {
+                for (uint32_t ty = 0; ty < tile_height; ty++) {
+                    for (uint32_t tx = 0; tx < tile_width; tx++) {
+                        seeds[ty * tile_width + tx] = shading::InitRand(x0 + sx + tx + (y0 + sy + ty) * image_width, sample, 16);
+                    }
+                }
+                camera.GenerateTile(x0 + sx, y0 + sy, tile_width, tile_height, seeds, rays);
+
+                for (uint32_t ty = 0; ty < tile_height; ty++) {
+                    for (uint32_t tx = 0; tx < tile_width; tx++) {
+                        PathState path{ scene, settings, seeds[ty * tile_width + tx] };
+                        XMVECTOR color = trace_path(path, rays[ty * tile_width + tx]);
+                        auto& sum = sums[size_t(sy + ty) * width + sx + tx];
+                        XMStoreFloat3(&sum, XMLoadFloat3(&sum) + color);
+                    }
+                }
+            }
+        }
+    }
+}
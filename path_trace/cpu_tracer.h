@@ -0,0 +1,132 @@
+#pragma once
+#include "bvh.h"
+#include "camera_rays.h"
+#include "image_metrics.h"
+#include "scene.h"
+#include <memory>
+#include <vector>
+
+namespace w {
+// Per pixel TraceCounters of one CPU frame
+struct CounterImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TraceCounters> pixels;
+
+public:
+    // one counter as a grey float image, e.g. Channel(&TraceCounters::nodes)
+    Image Channel(uint32_t TraceCounters::* counter) const;
+    TraceCounters Total() const noexcept;
+};
+
+// Turbo colormap of values / max_value, for heatmap overlays
+Image FalseColor(const Image& values, float max_value);
+
+struct CpuMesh {
+    BVH bvh;
+    std::vector<DirectX::XMFLOAT3> normals; // per vertex, empty for flat shaded meshes
+    std::vector<uint32_t> indices;
+};
+
+// Closest hit in world space
+struct CpuHit {
+    BVHHit hit;
+    uint32_t instance = ~0u;
+};
+
+// CPU copy of the scene geometry, mirrors the BLAS/TLAS pair and the hit groups of hit.lib.hlsl.
+// Hit group 1 (instance_offset) is the box with face normals, hit group 0 the smooth shaded sphere.
+// Meshes added at runtime are shaded like the sphere, their instances are kept across Update.
+class CpuScene
+{
+public:
+    enum Mesh : uint32_t {
+        sphere = 0,
+        box = 1,
+    };
+
+    struct Instance {
+        DirectX::XMFLOAT4X4 world_to_object;
+        AABB world_bounds;
+        uint32_t mesh = sphere;
+        uint32_t instance_id = 0;
+        bool cull_disable = false;
+        bool front_ccw = false;
+    };
+
+public:
+    CpuScene();
+
+public:
+    // takes the transforms and flags of the TLAS instances and the material table
+    void Update(std::span<const wis::AccelerationInstance> instances, std::span<const MaterialCBuffer> materials);
+    // mesh with per vertex normals, returns the index for AddInstance. Meshes are immutable and may be shared between scenes.
+    uint32_t AddMesh(std::shared_ptr<const CpuMesh> mesh);
+    // instance with its own material, two sided
+    void AddInstance(uint32_t mesh, const DirectX::XMFLOAT4X4& object_to_world, const MaterialCBuffer& material);
+    // primary rays cull back faces of instances without TriangleCullDisable, like RAY_FLAG_CULL_BACK_FACING_TRIANGLES
+    bool Intersect(const Ray& ray, bool cull_back_faces, CpuHit& hit, TraceCounters& counters) const noexcept;
+    // shading normal of a hit like the hit groups, face normals of the box, interpolated vertex normals otherwise
+    DirectX::XMVECTOR XM_CALLCONV Normal(const CpuHit& hit) const noexcept;
+
+    const CpuMesh& GetMesh(uint32_t mesh) const noexcept
+    {
+        return *meshes[mesh];
+    }
+    uint32_t MeshCount() const noexcept
+    {
+        return uint32_t(meshes.size());
+    }
+    uint32_t InstanceCount() const noexcept
+    {
+        return uint32_t(instances.size());
+    }
+    const Instance& GetInstance(uint32_t instance) const noexcept
+    {
+        return instances[instance];
+    }
+    const MaterialCBuffer& GetMaterial(uint32_t instance_id) const noexcept
+    {
+        return materials[instance_id];
+    }
+
+private:
+    Instance MakeInstance(uint32_t mesh, DirectX::FXMMATRIX object_to_world, uint32_t instance_id) const noexcept;
+
+private:
+    std::vector<std::shared_ptr<const CpuMesh>> meshes; // indexed by Mesh first
+    std::vector<Instance> instances; // TLAS instances, then added ones
+    std::vector<MaterialCBuffer> materials; // by instance_id, TLAS materials first
+    uint32_t tlas_instances = 0;
+    uint32_t tlas_materials = 0;
+};
+
+// Multithreaded CPU version of pathtrace.lib.hlsl and hit.lib.hlsl, rendered in tiles
+class CpuTracer
+{
+public:
+    static constexpr uint32_t tile_size = 16;
+
+public:
+    // 0 - hardware concurrency. specialized selects the path loop compiled for the sampling function and BRDF once per frame,
+    // otherwise they are switched on at every bounce, which is only kept to measure the difference.
+    explicit CpuTracer(uint32_t thread_count = 0, bool specialized = true);
+
+public:
+    // Traces sample_count samples per pixel into target, accumulated over frame_count previous samples like the raygen
+    // shader and with the same result as that many calls with one sample each, without a thread start per sample.
+    // camera must have the size of target. Counters summed over these samples are written to counters if given.
+    void Render(const CpuScene& scene, const CameraRays& camera, const Scene::RenderSettings& settings, uint32_t frame_count,
+                Image& target, CounterImage* counters = nullptr, uint32_t sample_count = 1) const;
+
+    // Adds samples [sample_begin, sample_begin + sample_count) of a width x height region at launch coordinates (x0, y0) to sums,
+    // row-major and bottom up like the launch. Sample i is traced exactly as Render traces frame i, on the calling thread.
+    static void RenderTile(const CpuScene& scene, const CameraRays& camera, const Scene::RenderSettings& settings,
+                           uint32_t x0, uint32_t y0, uint32_t width, uint32_t height,
+                           uint32_t sample_begin, uint32_t sample_count, std::span<DirectX::XMFLOAT3> sums);
+
+private:
+    uint32_t thread_count = 1;
+    bool specialized = true;
+};
+} // namespace w
@@ -0,0 +1,375 @@
+#include "distributed.h"
+#include "net.h"
+#include "camera_path.h"
+#include "cpu_tracer.h"
+#include "profiler.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace {
+using namespace DirectX;
+
+enum class MessageType : uint32_t {
+    Scene, // coordinator -> worker, SceneHeader, instances, materials
+    Lease, // coordinator -> worker, Lease
+    Result, // worker -> coordinator, lease id, width * height float3 sums
+    Done, // coordinator -> worker, no payload
+};
+
+constexpr uint32_t protocol_magic = 0x4e445257; // "WRDN"
+constexpr uint32_t protocol_version = 1;
+
+struct SceneHeader {
+    uint32_t magic = protocol_magic;
+    uint32_t version = protocol_version;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    w::Camera::CBuffer camera{};
+    w::Scene::RenderSettings settings{};
+    uint32_t object_count = 0;
+};
+
+struct Lease {
+    uint32_t id = 0;
+    uint32_t x0 = 0;
+    uint32_t y0 = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t sample_begin = 0;
+    uint32_t sample_count = 0;
+};
+
+void Send(w::Socket& socket, MessageType type, std::span<const std::byte> payload = {})
+{
+    socket.SendPacket(uint32_t(type), payload);
+}
+std::optional<MessageType> Receive(w::Socket& socket, std::vector<std::byte>& payload)
+{
+    auto type = socket.ReceivePacket(payload);
+    return type ? std::optional{ MessageType(*type) } : std::nullopt;
+}
+
+// Leases in the order they are handed out, states are guarded by the mutex
+class LeaseQueue
+{
+public:
+    enum class State {
+        Pending,
+        Active,
+        Done,
+    };
+
+public:
+    LeaseQueue(uint32_t width, uint32_t height, const w::LaunchOptions& options)
+        : width(width), height(height), sums(size_t(width) * height * 3)
+    {
+        for (uint32_t s = 0; s < options.samples; s += options.lease_samples) {
+            for (uint32_t y = 0; y < height; y += options.lease_tile) {
+                for (uint32_t x = 0; x < width; x += options.lease_tile) {
+                    leases.push_back({ uint32_t(leases.size()), x, y,
+                                       std::min(options.lease_tile, width - x), std::min(options.lease_tile, height - y),
+                                       s, std::min(options.lease_samples, options.samples - s) });
+                }
+            }
+        }
+        states.resize(leases.size(), State::Pending);
+    }
+
+public:
+    // blocks until a lease is pending, nullopt once all are done or the render is aborted
+    std::optional<Lease> Take()
+    {
+        std::unique_lock lock{ mutex };
+        while (true) {
+            if (done_count == leases.size() || aborted) {
+                return std::nullopt;
+            }
+            for (; next < leases.size(); next++) {
+                if (states[next] == State::Pending) {
+                    states[next] = State::Active;
+                    return leases[next++];
+                }
+            }
+            changed.wait(lock);
+        }
+    }
+    // the worker of a lease went away, hand it out again
+    void Return(uint32_t id)
+    {
+        {
+            std::scoped_lock lock{ mutex };
+            if (states[id] != State::Active) {
+                return;
+            }
+            states[id] = State::Pending;
+            next = std::min<size_t>(next, id);
+            released++;
+        }
+        changed.notify_all();
+    }
+    // false for a lease somebody else finished already
+    bool Complete(uint32_t id, std::span<const std::byte> data)
+    {
+        const Lease& lease = leases[id];
+        if (data.size() != size_t(lease.width) * lease.height * sizeof(XMFLOAT3)) {
+            throw w::Exception(wis::format("Result of lease {} has {} bytes", id, data.size()));
+        }
+        {
+            std::scoped_lock lock{ mutex };
+            if (states[id] == State::Done) {
+                return false;
+            }
+            for (uint32_t ty = 0; ty < lease.height; ty++) {
+                // launch y = 0 is the bottom row of the image
+                double* row = &sums[(size_t(height - 1 - (lease.y0 + ty)) * width + lease.x0) * 3];
+                for (uint32_t i = 0; i < lease.width * 3; i++) {
+                    float value;
+                    std::memcpy(&value, &data[(size_t(ty) * lease.width * 3 + i) * sizeof(float)], sizeof(float));
+                    row[i] += value;
+                }
+            }
+            states[id] = State::Done;
+            done_count++;
+        }
+        changed.notify_all();
+        return true;
+    }
+    void Abort()
+    {
+        {
+            std::scoped_lock lock{ mutex };
+            aborted = true;
+        }
+        changed.notify_all();
+    }
+    bool Finished()
+    {
+        std::scoped_lock lock{ mutex };
+        return done_count == leases.size();
+    }
+
+    w::Image Resolve(uint32_t samples) const
+    {
+        w::Image image{ width, height };
+        for (size_t i = 0; i < image.pixels.size(); i++) {
+            image.pixels[i] = { float(sums[i * 3] / samples), float(sums[i * 3 + 1] / samples), float(sums[i * 3 + 2] / samples) };
+        }
+        return image;
+    }
+    size_t Count() const noexcept
+    {
+        return leases.size();
+    }
+    uint32_t Released() const noexcept
+    {
+        return released;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Lease> leases;
+    std::vector<State> states;
+    size_t next = 0; // no pending lease before this
+    size_t done_count = 0;
+    uint32_t released = 0;
+    bool aborted = false;
+
+    uint32_t width;
+    uint32_t height;
+    std::vector<double> sums; // rgb, rows top to bottom
+};
+
+std::vector<std::byte> SerializeScene(const w::LaunchOptions& options)
+{
+    w::Camera camera;
+    w::Scene::RenderSettings settings;
+    if (!options.camera.empty()) {
+        auto path = w::CameraPath::Load(options.camera);
+        if (!path.Keyframes().empty()) {
+            camera.SetState(path.Keyframes().back().camera);
+            settings = path.Keyframes().back().settings;
+        }
+    }
+    camera.SetPerspective(w::Scene::fov, float(options.width) / float(options.height), 0.1f, 1000.0f);
+
+    SceneHeader header;
+    header.width = options.width;
+    header.height = options.height;
+    camera.PutCBuffer(&header.camera);
+    header.settings = settings;
+    header.object_count = w::Scene::objects_count;
+
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+
+    std::vector<std::byte> bytes;
+    w::AppendPod(bytes, header);
+    w::AppendPod(bytes, std::span<const wis::AccelerationInstance>{ instances });
+    w::AppendPod(bytes, std::span<const w::MaterialCBuffer>{ materials });
+    return bytes;
+}
+
+// Feeds leases to one worker until the queue runs dry or the worker fails
+void ServeWorker(w::Socket socket, uint32_t index, std::span<const std::byte> scene, LeaseQueue& queue, uint32_t lease_timeout)
+{
+    W_PROFILE_THREAD("Coordinator connection");
+    std::optional<Lease> lease;
+    try {
+        socket.SetReceiveTimeout(lease_timeout);
+        Send(socket, MessageType::Scene, scene);
+
+        std::vector<std::byte> payload;
+        while ((lease = queue.Take())) {
+            Send(socket, MessageType::Lease, std::as_bytes(std::span{ &*lease, 1 }));
+
+            auto type = Receive(socket, payload);
+            if (!type) {
+                throw w::Exception("Connection closed");
+            }
+            std::span<const std::byte> in = payload;
+            if (*type != MessageType::Result || w::ReadPod<uint32_t>(in) != lease->id) {
+                throw w::Exception("Unexpected message");
+            }
+            queue.Complete(lease->id, in);
+            lease.reset();
+        }
+        Send(socket, MessageType::Done);
+    } catch (const std::exception& e) {
+        if (lease) {
+            std::cerr << wis::format("Worker {} lost lease {}: {}\n", index, lease->id, e.what());
+            queue.Return(lease->id);
+        } else {
+            std::cerr << wis::format("Worker {}: {}\n", index, e.what());
+        }
+    }
+}
+
+std::string WorkerCommand(const w::LaunchOptions& options, uint16_t port, uint32_t index)
+{
+    auto command = wis::format("\"{}\" --worker 127.0.0.1:{}", options.executable.string(), port);
+    if (options.fail_after && index == 0) {
+        command += wis::format(" --fail-after {}", options.fail_after); // one flaky worker exercises re-leasing
+    }
+#if defined(_WIN32)
+    command = '"' + command + '"'; // cmd /c strips the outer quotes
+#endif
+    return command;
+}
+} // namespace
+
+void w::RunCoordinator(const LaunchOptions& options)
+{
+    W_PROFILE_THREAD("Coordinator");
+    auto scene = SerializeScene(options);
+    LeaseQueue queue{ options.width, options.height, options };
+
+    auto listener = Socket::Listen(options.port);
+    uint16_t port = listener.Port();
+    std::cout << wis::format("Coordinator on port {}: {}x{}, {} spp in {} leases\n", port, options.width, options.height, options.samples, queue.Count());
+    if (!options.spawn) {
+        std::cout << wis::format("Start workers with: {} --worker 127.0.0.1:{}\n", options.executable.string(), port);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint32_t> spawned_running = options.spawn;
+    std::atomic<uint32_t> connections = 0;
+    std::vector<std::jthread> processes;
+    for (uint32_t i = 0; i < options.spawn; i++) {
+        processes.emplace_back([&, command = WorkerCommand(options, port, i)]() {
+            std::system(command.c_str());
+            spawned_running--;
+        });
+    }
+
+    std::vector<std::jthread> workers;
+    while (!queue.Finished()) {
+        if (listener.WaitReadable(100)) {
+            connections++;
+            workers.emplace_back([&, socket = listener.Accept(), index = uint32_t(workers.size())]() mutable {
+                ServeWorker(std::move(socket), index, scene, queue, options.lease_timeout);
+                connections--;
+            });
+        } else if (options.spawn && !spawned_running && !connections && !queue.Finished()) {
+            // spawned workers all exited, nobody is left to finish the rest.
+            // Finished() is checked last, a connection completes its final lease before it counts as gone.
+            queue.Abort();
+            throw w::Exception(workers.empty() ? "No worker connected" : "All workers exited before the render was done");
+        }
+    }
+    queue.Abort(); // release connections waiting for a lease
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double samples = double(options.width) * options.height * options.samples;
+    std::cout << wis::format("Rendered in {:.2f} s on {} workers, {:.2f} Msamples/s, {} leases handed out again\n",
+                             seconds, workers.size(), samples / seconds * 1e-6, queue.Released());
+
+    auto output = options.output.empty() ? std::filesystem::path{ "distributed.pfm" } : options.output;
+    WritePFM(output, queue.Resolve(options.samples));
+    std::cout << wis::format("Wrote {}\n", output.string());
+}
+
+void w::RunWorker(const LaunchOptions& options)
+{
+    W_PROFILE_THREAD("Worker");
+    auto socket = Socket::Connect(options.worker);
+
+    std::vector<std::byte> payload;
+    if (Receive(socket, payload) != MessageType::Scene) {
+        throw w::Exception("Expected the scene from the coordinator");
+    }
+    std::span<const std::byte> in = payload;
+    auto header = w::ReadPod<SceneHeader>(in);
+    if (header.magic != protocol_magic || header.version != protocol_version) {
+        throw w::Exception("Coordinator speaks a different protocol");
+    }
+    std::vector<wis::AccelerationInstance> instances(header.object_count);
+    std::vector<MaterialCBuffer> materials(header.object_count);
+    for (auto& instance : instances) {
+        instance = w::ReadPod<wis::AccelerationInstance>(in);
+    }
+    for (auto& material : materials) {
+        material = w::ReadPod<MaterialCBuffer>(in);
+    }
+
+    CpuScene scene;
+    scene.Update(instances, materials);
+    CameraRays camera{ header.camera, header.width, header.height };
+
+    std::vector<XMFLOAT3> sums;
+    std::vector<std::byte> result;
+    for (uint32_t leases = 0;; leases++) {
+        auto type = Receive(socket, payload);
+        if (!type || *type == MessageType::Done) {
+            return;
+        }
+        if (*type != MessageType::Lease) {
+            throw w::Exception("Unexpected message from the coordinator");
+        }
+        if (options.fail_after && leases == options.fail_after) {
+            std::cerr << wis::format("Worker dropping its connection after {} leases\n", leases);
+            return;
+        }
+        in = payload;
+        auto lease = w::ReadPod<Lease>(in);
+        sums.assign(size_t(lease.width) * lease.height, XMFLOAT3{});
+        CpuTracer::RenderTile(scene, camera, header.settings, lease.x0, lease.y0, lease.width, lease.height,
+                              lease.sample_begin, lease.sample_count, sums);
+
+        result.clear();
+        w::AppendPod(result, lease.id);
+        w::AppendPod(result, std::span<const XMFLOAT3>{ sums });
+        Send(socket, MessageType::Result, result);
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "launch_options.h"
+
+namespace w {
+// Distributed offline rendering on the CPU tracer.
+// The coordinator sends the scene to every worker once, then hands out leases of one tile and a range of samples,
+// sample ranges outermost so the image converges evenly. Workers return per pixel sums which the coordinator adds up.
+// A lease whose worker disconnects or stays silent for options.lease_timeout is handed out again; samples are
+// deterministic, so whichever copy finishes first is kept and later duplicates are dropped.
+
+// Renders options.samples per pixel into options.output, returns once every lease is merged
+void RunCoordinator(const LaunchOptions& options);
+// Serves leases of the coordinator at options.worker until it is done
+void RunWorker(const LaunchOptions& options);
+} // namespace w
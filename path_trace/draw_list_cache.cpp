@@ -0,0 +1,67 @@
+#include "draw_list_cache.h"
+#include "hash.h"
+#include <array>
+#include <cstring>
+
+uint64_t w::DrawListCache::Hash(std::span<const std::byte> data, uint64_t seed) noexcept
+{
+    constexpr uint64_t prime = 0x100000001b3ull;
+    std::array<uint64_t, 4> lanes{ Mix64(seed), Mix64(seed + 1), Mix64(seed + 2), Mix64(seed + 3) };
+    size_t i = 0;
+    for (; i + 32 <= data.size(); i += 32) {
+        for (size_t lane = 0; lane < lanes.size(); lane++) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i + lane * 8, 8);
+            // the shift carries changes in the high bits down, plain FNV lets two of them cancel
+            uint64_t x = (lanes[lane] ^ word) * prime;
+            lanes[lane] = x ^ (x >> 29);
+        }
+    }
+    uint64_t hash = data.size();
+    for (uint64_t lane : lanes) {
+        hash = Mix64(hash ^ lane);
+    }
+    return Hash64(data.subspan(i), hash);
+}
+
+void w::DrawListCache::Begin(size_t list_count)
+{
+    entries.resize(list_count);
+    stats = {};
+}
+
+bool w::DrawListCache::Update(size_t list, std::span<const std::byte> vertices, std::span<const std::byte> indices, size_t vertex_offset, size_t index_offset)
+{
+    if (list >= entries.size()) {
+        entries.resize(list + 1);
+    }
+    Entry next{
+        .hash = Hash(indices, Hash(vertices)),
+        .vertex_offset = vertex_offset,
+        .index_offset = index_offset,
+        .vertex_bytes = vertices.size(),
+        .index_bytes = indices.size(),
+        .valid = true,
+    };
+    Entry& entry = entries[list];
+    bool same = entry.valid && entry.hash == next.hash && entry.vertex_offset == next.vertex_offset && entry.index_offset == next.index_offset &&
+            entry.vertex_bytes == next.vertex_bytes && entry.index_bytes == next.index_bytes;
+    entry = next;
+
+    size_t bytes = vertices.size() + indices.size();
+    if (same) {
+        stats.bytes_skipped += bytes;
+        stats.lists_skipped++;
+    } else {
+        stats.bytes_uploaded += bytes;
+        stats.lists_uploaded++;
+    }
+    return !same;
+}
+
+void w::DrawListCache::Invalidate() noexcept
+{
+    for (auto& entry : entries) {
+        entry.valid = false;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace w {
+// Capacity for a buffer that has to hold required elements. Grows to at least twice the current capacity,
+// so a UI that keeps growing reallocates a logarithmic number of times. Never shrinks.
+constexpr size_t GrowCapacity(size_t capacity, size_t required, size_t minimum) noexcept
+{
+    return required <= capacity ? capacity : std::max({ required, capacity * 2, minimum });
+}
+
+// Remembers what each ImGui draw list last wrote into one set of persistently mapped vertex and index buffers.
+// A list with the same content at the same offsets is still in place, its copy is skipped.
+// One cache per frame in flight, since each frame writes its own buffers.
+class DrawListCache
+{
+public:
+    struct Stats {
+        uint64_t bytes_uploaded = 0;
+        uint64_t bytes_skipped = 0;
+        uint32_t lists_uploaded = 0;
+        uint32_t lists_skipped = 0;
+    };
+
+public:
+    // Four interleaved FNV-1a style lanes, mixed at the end.
+    // A single lane is bound by multiply latency and hashes slower than the copy it is meant to save.
+    static uint64_t Hash(std::span<const std::byte> data, uint64_t seed = 0xcbf29ce484222325ull) noexcept;
+
+    // starts a frame of list_count draw lists, lists past the count are forgotten
+    void Begin(size_t list_count);
+    // Offsets are in bytes from the start of the buffers. Returns true if the list has to be copied,
+    // the buffers are assumed to hold it from then on.
+    bool Update(size_t list, std::span<const std::byte> vertices, std::span<const std::byte> indices, size_t vertex_offset, size_t index_offset);
+    // the buffers were recreated or lost their content
+    void Invalidate() noexcept;
+
+    // since Begin
+    const Stats& GetStats() const noexcept
+    {
+        return stats;
+    }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        size_t vertex_offset = 0;
+        size_t index_offset = 0;
+        size_t vertex_bytes = 0;
+        size_t index_bytes = 0;
+        bool valid = false;
+    };
+
+private:
+    std::vector<Entry> entries;
+    Stats stats;
+};
+} // namespace w
@@ -0,0 +1,57 @@
+#include "dynamic_resolution.h"
+#include "image_metrics.h"
+#include <cmath>
+
+void w::DynamicResolution::Reset() noexcept
+{
+    scale = 1.0f;
+    input = false;
+    measure = false;
+}
+
+float w::DynamicResolution::BeginFrame() noexcept
+{
+    measure = false;
+    if (options.target_ms <= 0.0f) {
+        Reset();
+    } else if (input) {
+        input = false;
+        measure = true;
+        scale = preview_scale;
+        ramp_step = std::max((1.0f - scale) / float(std::max(options.ramp_frames, 1u)), 1.0f / 64.0f);
+    } else if (scale < 1.0f) {
+        scale = std::min(1.0f, scale + ramp_step);
+    }
+    return scale;
+}
+
+void w::DynamicResolution::EndFrame(double frame_ms) noexcept
+{
+    if (!measure || frame_ms <= 0.0) {
+        return;
+    }
+    measure = false;
+    // trace time goes with the pixel count, the square of the scale. Halfway steps keep one slow frame from
+    // dropping the scale to the minimum, frame times that include fixed costs still settle within a few frames.
+    float fit = scale * std::sqrt(options.target_ms / float(frame_ms));
+    preview_scale = std::clamp(0.5f * (preview_scale + fit), options.min_scale, 1.0f);
+}
+
+void w::Upsample(const Image& source, Image& target)
+{
+    using namespace DirectX;
+    float sx = float(source.width) / float(target.width), sy = float(source.height) / float(target.height);
+    for (uint32_t y = 0; y < target.height; y++) {
+        float py = std::clamp((float(y) + 0.5f) * sy - 0.5f, 0.0f, float(source.height - 1));
+        uint32_t y0 = uint32_t(py), y1 = std::min(y0 + 1, source.height - 1);
+        float fy = py - float(y0);
+        for (uint32_t x = 0; x < target.width; x++) {
+            float px = std::clamp((float(x) + 0.5f) * sx - 0.5f, 0.0f, float(source.width - 1));
+            uint32_t x0 = uint32_t(px), x1 = std::min(x0 + 1, source.width - 1);
+            float fx = px - float(x0);
+            XMVECTOR top = XMVectorLerp(XMLoadFloat3(&source.At(x0, y0)), XMLoadFloat3(&source.At(x1, y0)), fx);
+            XMVECTOR bottom = XMVectorLerp(XMLoadFloat3(&source.At(x0, y1)), XMLoadFloat3(&source.At(x1, y1)), fx);
+            XMStoreFloat3(&target.At(x, y), XMVectorLerp(top, bottom, fy));
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+namespace w {
+struct Image;
+
+// Resolution scale of the interactive preview.
+// While input keeps restarting accumulation, frames are traced at a reduced size chosen so the frame time stays near
+// a target, and upsampled to the display. Once input stops the scale ramps back to full resolution over a few frames.
+// Accumulation has to restart whenever the scale changes, samples of different sizes do not mix.
+class DynamicResolution
+{
+public:
+    struct Options {
+        float target_ms = 0.0f; // frame time while interacting, 0 - always full resolution
+        float min_scale = 0.25f; // of width and height
+        uint32_t ramp_frames = 4; // from the preview scale back to full resolution
+    };
+
+public:
+    DynamicResolution() = default;
+    explicit DynamicResolution(const Options& options) noexcept
+        : options(options)
+    {
+    }
+
+public:
+    void SetTarget(float target_ms) noexcept
+    {
+        options.target_ms = target_ms;
+    }
+    // input that restarted accumulation, the next frame is a preview
+    void Interact() noexcept
+    {
+        input = true;
+    }
+    // full resolution from the next frame on without a ramp, e.g. for accumulation restored from a checkpoint
+    void Reset() noexcept;
+
+    // scale of width and height for the next frame, in [min_scale, 1]
+    float BeginFrame() noexcept;
+    // time the frame started last took, adapts the preview scale if it was traced while interacting
+    void EndFrame(double frame_ms) noexcept;
+
+    float Scale() const noexcept
+    {
+        return scale;
+    }
+    // the frame started last was full resolution and no preview or ramp frame follows
+    bool FullResolution() const noexcept
+    {
+        return scale >= 1.0f && (!input || options.target_ms <= 0.0f);
+    }
+    static uint32_t Scaled(uint32_t size, float scale) noexcept
+    {
+        return std::max(1u, uint32_t(float(size) * scale + 0.5f));
+    }
+
+private:
+    Options options;
+    float scale = 1.0f; // of the frame started last
+    float preview_scale = 0.5f; // learned from frame times while interacting
+    float ramp_step = 0.0f;
+    bool input = false;
+    bool measure = false; // the frame started last is an interactive preview
+};
+
+// bilinear, for previews traced at a reduced size. Pixel centers of both images cover the same area.
+void Upsample(const Image& source, Image& target);
+} // namespace w
@@ -1,4 +1,7 @@
 #include "App.h"
+#include "distributed.h"
+#include "render_server.h"
+#include <iostream>
 
 int main(int argc, char* argv[])
 {
@@ -14,9 +17,31 @@ int main(int argc, char* argv[])
 
 int entry_main(std::span<std::string_view> args)
 try {
-    return w::App{}.run();
+    auto options = w::LaunchOptions::Parse(args);
+    if (options.coordinator) {
+        w::RunCoordinator(options);
+        return 0;
+    }
+    if (!options.worker.empty()) {
+        w::RunWorker(options);
+        return 0;
+    }
+    if (options.serve) {
+        w::RunRenderServer(options);
+        return 0;
+    }
+    if (!options.client.empty()) {
+        w::RunRenderClient(options);
+        return 0;
+    }
+    if (options.cpu) {
+        w::RunCpuReplay(options);
+        return 0;
+    }
+    return w::App{ std::move(options) }.run();
 } catch (const std::exception& e) {
     // Handle exceptions
+    std::cerr << e.what() << "\n";
     return 1;
 } catch (...) {
     // Handle unknown exceptions
@@ -0,0 +1,34 @@
+#include "frame_allocator.h"
+#include "graphics.h"
+#include <tuple>
+
+w::FrameAllocator::FrameAllocator(w::Graphics& gfx, uint64_t frame_capacity)
+    : gfx(gfx)
+{
+    wis::Result result = wis::success;
+    buffer = gfx.GetAllocator().CreateUploadBuffer(result, frame_capacity * w::flight_frames);
+    CheckResult(result);
+    fence = gfx.GetDevice().CreateFence(result, 0);
+    CheckResult(result);
+
+    static_cast<BasicFrameAllocator&>(*this) = BasicFrameAllocator{ buffer.Map<uint8_t>(), frame_capacity };
+}
+
+w::FrameAllocator::~FrameAllocator()
+{
+    std::ignore = fence.Wait(fence_value);
+    buffer.Unmap();
+}
+
+void w::FrameAllocator::BeginFrame(uint32_t frame_index)
+{
+    // usually already signaled, the swapchain throttles on the same frames
+    CheckResult(fence.Wait(frame_fence_values[frame_index % w::flight_frames]));
+    BasicFrameAllocator::BeginFrame(frame_index);
+}
+
+void w::FrameAllocator::EndFrame()
+{
+    CheckResult(gfx.GetMainQueue().SignalQueue(fence, ++fence_value));
+    frame_fence_values[CurrentFrame()] = fence_value;
+}
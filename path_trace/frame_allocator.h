@@ -0,0 +1,152 @@
+#pragma once
+#include "consts.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+namespace w {
+class Graphics;
+
+static constexpr uint64_t constant_buffer_alignment = 256; // D3D12 CBV placement, also covers Vulkan minUniformBufferOffsetAlignment
+
+// Bump allocator over [base, base + capacity), no individual frees
+class LinearAllocator
+{
+public:
+    LinearAllocator() = default;
+    LinearAllocator(uint64_t base, uint64_t capacity) noexcept
+        : base(base), capacity(capacity), head(base)
+    {
+    }
+
+public:
+    std::optional<uint64_t> Allocate(uint64_t size, uint64_t alignment = constant_buffer_alignment) noexcept
+    {
+        uint64_t offset = (head + alignment - 1) / alignment * alignment;
+        if (offset + size > base + capacity) {
+            return std::nullopt;
+        }
+        head = offset + size;
+        return offset;
+    }
+    void Reset() noexcept
+    {
+        head = base;
+    }
+    uint64_t Used() const noexcept
+    {
+        return head - base;
+    }
+    uint64_t Capacity() const noexcept
+    {
+        return capacity;
+    }
+
+private:
+    uint64_t base = 0;
+    uint64_t capacity = 0;
+    uint64_t head = 0;
+};
+
+struct FrameAllocation {
+    uint8_t* data = nullptr;
+    uint64_t offset = 0; // from the start of the frame buffer
+    uint64_t size = 0;
+
+    template<typename T>
+    T* As() const noexcept
+    {
+        return reinterpret_cast<T*>(data);
+    }
+};
+
+// One linear region per flight frame of a single mapped buffer. A region is only reset
+// once the GPU finished the frame that last used it, so constants never change under the GPU.
+// Fencing is left to the owner, which makes the core usable against plain memory.
+template<uint32_t frames>
+class BasicFrameAllocator
+{
+public:
+    BasicFrameAllocator() = default;
+    BasicFrameAllocator(uint8_t* mapped, uint64_t frame_capacity) noexcept
+        : mapped(mapped)
+    {
+        for (uint32_t i = 0; i < frames; i++) {
+            regions[i] = LinearAllocator{ frame_capacity * i, frame_capacity };
+        }
+    }
+
+public:
+    void BeginFrame(uint32_t frame_index) noexcept
+    {
+        current = frame_index % frames;
+        regions[current].Reset();
+    }
+
+    FrameAllocation Allocate(uint64_t size, uint64_t alignment = constant_buffer_alignment)
+    {
+        auto offset = regions[current].Allocate(size, alignment);
+        if (!offset) {
+            throw w::Exception(wis::format("Frame allocator is out of memory: requested {} bytes, {} of {} used",
+                                           size, regions[current].Used(), regions[current].Capacity()));
+        }
+        return { mapped + *offset, *offset, size };
+    }
+
+    template<typename T>
+    FrameAllocation Push(const T& value, uint64_t alignment = constant_buffer_alignment)
+    {
+        auto allocation = Allocate(sizeof(T), alignment);
+        std::memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+
+    uint32_t CurrentFrame() const noexcept
+    {
+        return current;
+    }
+    const LinearAllocator& Region(uint32_t frame_index) const noexcept
+    {
+        return regions[frame_index % frames];
+    }
+
+private:
+    uint8_t* mapped = nullptr;
+    std::array<LinearAllocator, frames> regions{};
+    uint32_t current = 0;
+};
+
+// Per-frame constant and upload data for the graphics queue
+class FrameAllocator : public BasicFrameAllocator<w::flight_frames>
+{
+public:
+    static constexpr uint64_t default_frame_capacity = 64ull << 10;
+
+public:
+    FrameAllocator(w::Graphics& gfx, uint64_t frame_capacity = default_frame_capacity);
+    ~FrameAllocator();
+
+public:
+    // waits until the GPU is done with the region of frame_index, then resets it
+    void BeginFrame(uint32_t frame_index);
+    // call after the frame's command lists were submitted
+    void EndFrame();
+
+    const wis::Buffer& GetBuffer() const noexcept
+    {
+        return buffer;
+    }
+    uint64_t GetGPUAddress(const FrameAllocation& allocation) const noexcept
+    {
+        return buffer.GetGPUAddress() + allocation.offset;
+    }
+
+private:
+    w::Graphics& gfx;
+    wis::Buffer buffer;
+    wis::Fence fence;
+    uint64_t fence_value = 0;
+    std::array<uint64_t, w::flight_frames> frame_fence_values{};
+};
+} // namespace w
@@ -0,0 +1,128 @@
+#include "frame_codec.h"
+#include "consts.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+w::DisplayImage w::ToDisplay(const Image& image)
+{
+    DisplayImage out{ image.width, image.height };
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        const float rgb[3]{ image.pixels[i].x, image.pixels[i].y, image.pixels[i].z };
+        for (uint32_t c = 0; c < 3; c++) {
+            float value = std::pow(std::clamp(rgb[c], 0.0f, 1.0f), 1.0f / 2.2f);
+            out.pixels[i * 3 + c] = uint8_t(value * 255.0f + 0.5f);
+        }
+    }
+    return out;
+}
+
+w::Image w::FromDisplay(const DisplayImage& image)
+{
+    Image out{ image.width, image.height };
+    for (size_t i = 0; i < out.pixels.size(); i++) {
+        auto channel = [&](uint32_t c) { return std::pow(image.pixels[i * 3 + c] / 255.0f, 2.2f); };
+        out.pixels[i] = { channel(0), channel(1), channel(2) };
+    }
+    return out;
+}
+
+uint32_t w::TileCodec::Encode(const DisplayImage& image, const DisplayImage& previous, std::vector<std::byte>& out) const
+{
+    std::vector<uint8_t> delta(size_t(tile_size) * tile_size * 3);
+    const uint32_t tiles_x = TilesX(image.width);
+    const uint32_t tile_count = TileCount(image.width, image.height);
+    uint32_t changed = 0;
+    for (uint32_t tile = 0; tile < tile_count; tile++) {
+        uint32_t x0 = (tile % tiles_x) * tile_size, y0 = (tile / tiles_x) * tile_size;
+        size_t row_bytes = size_t(std::min(tile_size, image.width - x0)) * 3;
+        uint32_t rows = std::min(tile_size, image.height - y0);
+
+        bool any = false;
+        for (uint32_t y = 0; y < rows; y++) {
+            size_t offset = (size_t(y0 + y) * image.width + x0) * 3;
+            for (size_t i = 0; i < row_bytes; i++) {
+                uint8_t d = image.pixels[offset + i] ^ previous.pixels[offset + i];
+                delta[y * row_bytes + i] = d;
+                any |= d != 0;
+            }
+        }
+        if (!any) {
+            continue;
+        }
+
+        size_t header = out.size();
+        out.resize(header + 2 * sizeof(uint32_t));
+        size_t size = size_t(rows) * row_bytes;
+        for (size_t i = 0; i < size;) {
+            uint16_t zeros = 0, literals = 0;
+            while (i + zeros < size && delta[i + zeros] == 0 && zeros < UINT16_MAX) {
+                zeros++;
+            }
+            size_t begin = i + zeros;
+            if (begin == size) {
+                break; // the rest is unchanged
+            }
+            // a literal run ends at two zeros, a single zero is cheaper to keep inline
+            while (begin + literals < size && literals < UINT16_MAX &&
+                   (delta[begin + literals] != 0 || (begin + literals + 1 < size && delta[begin + literals + 1] != 0))) {
+                literals++;
+            }
+            uint16_t run[2]{ zeros, literals };
+            auto bytes = std::as_bytes(std::span{ run });
+            out.insert(out.end(), bytes.begin(), bytes.end());
+            auto data = std::as_bytes(std::span{ delta }.subspan(begin, literals));
+            out.insert(out.end(), data.begin(), data.end());
+            i = begin + literals;
+        }
+        uint32_t tile_header[2]{ tile, uint32_t(out.size() - header - sizeof(tile_header)) };
+        std::memcpy(out.data() + header, tile_header, sizeof(tile_header));
+        changed++;
+    }
+    return changed;
+}
+
+void w::TileCodec::Decode(std::span<const std::byte> data, uint32_t tile_count, DisplayImage& image) const
+{
+    const uint32_t tiles_x = TilesX(image.width);
+    auto read = [&](size_t bytes) {
+        if (data.size() < bytes) {
+            throw w::Exception("Truncated tile data");
+        }
+        auto front = data.first(bytes);
+        data = data.subspan(bytes);
+        return front;
+    };
+
+    for (uint32_t t = 0; t < tile_count; t++) {
+        uint32_t tile_header[2];
+        std::memcpy(tile_header, read(sizeof(tile_header)).data(), sizeof(tile_header));
+        auto [tile, size] = tile_header;
+        if (tile >= TileCount(image.width, image.height)) {
+            throw w::Exception(wis::format("Tile {} out of range", tile));
+        }
+        auto runs = read(size);
+
+        uint32_t x0 = (tile % tiles_x) * tile_size, y0 = (tile / tiles_x) * tile_size;
+        size_t row_bytes = size_t(std::min(tile_size, image.width - x0)) * 3;
+        size_t tile_bytes = std::min(tile_size, image.height - y0) * row_bytes;
+        size_t i = 0;
+        while (!runs.empty()) {
+            if (runs.size() < 2 * sizeof(uint16_t)) {
+                throw w::Exception("Truncated tile run");
+            }
+            uint16_t run[2];
+            std::memcpy(run, runs.data(), sizeof(run));
+            runs = runs.subspan(sizeof(run));
+            i += run[0];
+            if (runs.size() < run[1] || i + run[1] > tile_bytes) {
+                throw w::Exception("Tile run out of range");
+            }
+            for (uint32_t l = 0; l < run[1]; l++, i++) {
+                size_t y = i / row_bytes, x = i % row_bytes;
+                image.pixels[(size_t(y0 + y) * image.width + x0) * 3 + x] ^= uint8_t(runs[l]);
+            }
+            runs = runs.subspan(run[1]);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "image_metrics.h"
+#include <cstddef>
+#include <span>
+
+namespace w {
+// 8 bit RGB as shown on screen, rows in the order of Image
+struct DisplayImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels; // rgb
+
+public:
+    DisplayImage() = default;
+    DisplayImage(uint32_t width, uint32_t height)
+        : width(width), height(height), pixels(size_t(width) * height * 3)
+    {
+    }
+};
+
+// gamma 2.2 like filter.ps.hlsl
+DisplayImage ToDisplay(const Image& image);
+Image FromDisplay(const DisplayImage& image);
+
+// Delta compression of frames in square tiles.
+// Only tiles that differ from the previous frame are sent, XORed with their previous contents. Progressive refinement
+// changes few bits per sample, so the XOR is mostly zero bytes and is sent as runs of zeros and literal bytes.
+// A changed tile is its uint32_t index, uint32_t encoded size and the runs as uint16_t zeros, uint16_t literals, literals.
+struct TileCodec {
+    uint32_t tile_size = 16;
+
+public:
+    uint32_t TilesX(uint32_t width) const noexcept
+    {
+        return (width + tile_size - 1) / tile_size;
+    }
+    uint32_t TileCount(uint32_t width, uint32_t height) const noexcept
+    {
+        return TilesX(width) * ((height + tile_size - 1) / tile_size);
+    }
+
+    // appends the tiles of image that differ from previous to out, returns their count
+    uint32_t Encode(const DisplayImage& image, const DisplayImage& previous, std::vector<std::byte>& out) const;
+    // applies tile_count encoded tiles to image, which holds the frame they were encoded against
+    void Decode(std::span<const std::byte> data, uint32_t tile_count, DisplayImage& image) const;
+};
+} // namespace w
@@ -0,0 +1,207 @@
+// Golden image regression tests of the GPU path tracer.
+// Every case renders the default scene headlessly and compares it against a stored high sample count
+// reference with RMSE, relMSE and FLIP. Time-to-target-error is recorded alongside, so a faster
+// kernel that converges to a worse image shows up as a regression in golden.json as well.
+//
+//   PathTracerGolden [--references dir] [--out dir] [--filter substring] [--update] [--reference-samples n]
+//
+// --update renders the references of the selected cases instead of testing them.
+#include "headless.h"
+#include <iostream>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace {
+constexpr uint32_t width = 320;
+constexpr uint32_t height = 180;
+
+struct Tolerance {
+    float rmse = 0.05f;
+    float relmse = 0.05f;
+    float flip = 0.12f;
+};
+
+struct GoldenCase {
+    std::string name;
+    w::Scene::RenderSettings settings;
+    uint32_t samples = 256; // samples of the tested image, checkpoints are the powers of 2 below
+    Tolerance tolerance{};
+    float target_flip = 0.15f; // error level at which time-to-target is recorded
+};
+
+struct CaseResult {
+    float rmse = 0.0f;
+    float relmse = 0.0f;
+    float flip = 0.0f;
+    double total_seconds = 0.0;
+    std::optional<double> target_seconds; // not reached within the sample budget
+    uint32_t target_samples = 0;
+    bool passed = false;
+};
+
+std::vector<GoldenCase> Cases()
+{
+    std::vector<GoldenCase> cases;
+    cases.push_back({ .name = "default", .settings = {} });
+
+    for (int32_t s = 0; s < int32_t(std::size(w::SAMPLING_LABELS)); s++) {
+        for (int32_t b = 0; b < int32_t(std::size(w::BRDF_LABELS)); b++) {
+            GoldenCase c{
+                .name = wis::format("{}_{}", w::SAMPLING_LABELS[s], w::BRDF_LABELS[b]),
+                .settings = { .sampling_fn = s, .brdf = b },
+            };
+            // GGX lobes of rough materials are noisy, mostly so for the unbiased mix
+            if (s >= 2) {
+                c.samples = 1024;
+                c.tolerance = { .rmse = 0.08f, .relmse = 0.1f, .flip = 0.18f };
+                c.target_flip = 0.2f;
+            }
+            cases.push_back(std::move(c));
+        }
+    }
+
+    for (int32_t depth : { 1, 2, 8, 24 }) {
+        cases.push_back({
+                .name = wis::format("Cosine_LambertWithAlbedo_depth{}", depth),
+                .settings = { .sampling_fn = 1, .brdf = 1, .max_depth = depth },
+        });
+    }
+    return cases;
+}
+
+void Update(w::HeadlessRenderer& renderer, const GoldenCase& c, const std::filesystem::path& references, uint32_t samples)
+{
+    renderer.Reset(c.settings);
+    double seconds = renderer.Render(samples);
+    w::WritePFM(references / (c.name + ".pfm"), renderer.Readback());
+    std::cout << wis::format("{:<40} reference {} spp in {:.2f}s\n", c.name, samples, seconds);
+}
+
+CaseResult Test(w::HeadlessRenderer& renderer, const GoldenCase& c, const w::Image& reference, const std::filesystem::path& out)
+{
+    CaseResult r;
+    renderer.Reset(c.settings);
+
+    w::Image image;
+    for (uint32_t checkpoint = 1;; checkpoint = std::min(checkpoint * 2, c.samples)) {
+        r.total_seconds += renderer.Render(checkpoint - renderer.SampleCount()); // readback and metrics are not timed
+        image = renderer.Readback();
+        r.flip = w::FLIP(image, reference);
+        if (!r.target_seconds && r.flip <= c.target_flip) {
+            r.target_seconds = r.total_seconds;
+            r.target_samples = checkpoint;
+        }
+        if (checkpoint == c.samples) {
+            break;
+        }
+    }
+
+    w::Image flip_map;
+    r.flip = w::FLIP(image, reference, 67.0f, &flip_map);
+    r.rmse = w::RMSE(image, reference);
+    r.relmse = w::RelMSE(image, reference);
+    r.passed = r.rmse <= c.tolerance.rmse && r.relmse <= c.tolerance.relmse && r.flip <= c.tolerance.flip && r.target_seconds;
+
+    if (!r.passed) {
+        w::WritePFM(out / (c.name + ".pfm"), image);
+        w::WritePFM(out / (c.name + ".flip.pfm"), flip_map);
+    }
+    return r;
+}
+
+void WriteReport(const std::filesystem::path& path, std::span<const GoldenCase> cases, std::span<const CaseResult> results)
+{
+    std::ofstream file{ path };
+    file << "{\n  \"width\": " << width << ",\n  \"height\": " << height << ",\n  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& c = cases[i];
+        auto& r = results[i];
+        file << wis::format("    {{ \"name\": \"{}\", \"sampling\": \"{}\", \"brdf\": \"{}\", \"max_depth\": {}, \"samples\": {}, "
+                            "\"rmse\": {}, \"relmse\": {}, \"flip\": {}, \"target_flip\": {}, "
+                            "\"time_to_target\": {}, \"samples_to_target\": {}, \"total_time\": {}, \"passed\": {} }}{}\n",
+                            c.name, w::SAMPLING_LABELS[c.settings.sampling_fn], w::BRDF_LABELS[c.settings.brdf], c.settings.max_depth, c.samples,
+                            r.rmse, r.relmse, r.flip, c.target_flip,
+                            r.target_seconds ? wis::format("{}", *r.target_seconds) : "null", r.target_samples, r.total_seconds, r.passed,
+                            i + 1 < results.size() ? "," : "");
+    }
+    file << "  ]\n}\n";
+}
+} // namespace
+
+int main(int argc, char* argv[])
+try {
+    std::filesystem::path references = "golden/references";
+    std::filesystem::path out = "golden_out";
+    std::string_view filter;
+    bool update = false;
+    uint32_t reference_samples = 16384;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                throw w::Exception(wis::format("Missing value for {}", arg));
+            }
+            return argv[++i];
+        };
+        if (arg == "--references") {
+            references = value();
+        } else if (arg == "--out") {
+            out = value();
+        } else if (arg == "--filter") {
+            filter = value();
+        } else if (arg == "--update") {
+            update = true;
+        } else if (arg == "--reference-samples") {
+            reference_samples = uint32_t(std::stoul(std::string(value())));
+        } else {
+            throw w::Exception(wis::format("Unknown argument: {}", arg));
+        }
+    }
+
+    std::vector<GoldenCase> cases;
+    for (auto& c : Cases()) {
+        if (c.name.find(filter) != std::string::npos) {
+            cases.push_back(std::move(c));
+        }
+    }
+
+    w::HeadlessRenderer renderer{ width, height };
+    if (update) {
+        std::filesystem::create_directories(references);
+        for (auto& c : cases) {
+            Update(renderer, c, references, reference_samples);
+        }
+        return 0;
+    }
+
+    std::filesystem::create_directories(out);
+    std::vector<CaseResult> results;
+    uint32_t failed = 0;
+    for (auto& c : cases) {
+        auto reference_path = references / (c.name + ".pfm");
+        if (!std::filesystem::exists(reference_path)) {
+            std::cout << wis::format("{:<40} FAIL missing reference {}, render it with --update\n", c.name, reference_path.string());
+            results.push_back({});
+            failed++;
+            continue;
+        }
+
+        auto& r = results.emplace_back(Test(renderer, c, w::ReadPFM(reference_path), out));
+        failed += !r.passed;
+        std::cout << wis::format("{:<40} {} rmse {:.4f}/{:.4f} relmse {:.4f}/{:.4f} flip {:.4f}/{:.4f} to target {}\n",
+                                 c.name, r.passed ? "ok  " : "FAIL",
+                                 r.rmse, c.tolerance.rmse, r.relmse, c.tolerance.relmse, r.flip, c.tolerance.flip,
+                                 r.target_seconds ? wis::format("{:.3f}s ({} spp)", *r.target_seconds, r.target_samples) : "not reached");
+    }
+    WriteReport(out / "golden.json", cases, results);
+
+    std::cout << wis::format("{} of {} golden cases passed\n", cases.size() - failed, cases.size());
+    return failed ? 1 : 0;
+} catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 2;
+}
@@ -109,7 +109,9 @@ wis::Factory w::Graphics::DefaultFactory(wis::FactoryExtension* platform_ext)
 #endif // !NDEBUG
         platform_ext
     };
-    wis::Factory factory = wis::CreateFactory(res, true, xfactory_exts, std::size(xfactory_exts));
+    // headless rendering has no platform extension, it is always the last one
+    uint32_t ext_count = uint32_t(std::size(xfactory_exts)) - (platform_ext ? 0 : 1);
+    wis::Factory factory = wis::CreateFactory(res, true, xfactory_exts, ext_count);
 #ifndef NDEBUG
     info = debug_ext.CreateDebugMessenger(res, &DebugCallback, &std::cout);
 #endif // !NDEBUG
@@ -122,4 +124,8 @@ void w::Graphics::InitMainQueue(wis::Device& device)
     main_queue = device.CreateCommandQueue(result, wis::QueueType::Graphics);
     fence = device.CreateFence(result, 0);
     allocator = device.CreateAllocator(result);
+
+    using namespace wis; // for flag operators
+    geometry_pool = w::BufferPool{ allocator, { .usage = BufferUsage::VertexBuffer | BufferUsage::IndexBuffer | BufferUsage::StorageBuffer | BufferUsage::CopyDst | BufferUsage::AccelerationStructureInput, .block_size = 16ull << 20 } };
+    as_pool = w::BufferPool{ allocator, { .usage = BufferUsage::AccelerationStructureBuffer, .block_size = 32ull << 20 } };
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "consts.h"
+#include "buffer_pool.h"
+#include "shader_store.h"
 #include <wisdom/wisdom_raytracing.hpp>
 
 namespace w {
@@ -75,6 +77,7 @@ class Graphics
     static void DebugCallback(wis::Severity severity, const char* message, void* user_data);
 
 public:
+    // platform_ext may be null for headless use without a swapchain
     Graphics(wis::FactoryExtension* platform_ext)
         : device(InitDevice(platform_ext))
     {
@@ -106,6 +109,11 @@ public:
     {
         return raytracing;
     }
+    // path without extension, see ShaderStore
+    const wis::Shader& LoadShader(const std::filesystem::path& path)
+    {
+        return shaders.Load(device, path).shader;
+    }
 
     void ExecuteCommandLists(std::span<const wis::CommandListView> lists) const noexcept
     {
@@ -136,5 +144,11 @@ public:
 
     wis::Fence fence; // for wait for gpu
     uint64_t fence_value = 1;
+
+    // suballocated buffers, geometry streams and AS scratch share one heap, AS results another
+    w::BufferPool geometry_pool;
+    w::BufferPool as_pool;
+
+    w::ShaderStore shaders;
 };
 } // namespace w
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace w {
+// murmur3 finalizer, every input bit reaches every output bit
+constexpr uint64_t Mix64(uint64_t x) noexcept
+{
+    x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+    x = (x ^ (x >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+// FNV-1a over 8 byte words, the tail is zero padded. The size is mixed into the result,
+// so inputs that differ only in trailing zeros or in length hash differently
+inline uint64_t Hash64(std::span<const std::byte> data, uint64_t hash = 0xcbf29ce484222325ull) noexcept
+{
+    constexpr uint64_t prime = 0x100000001b3ull;
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    if (i < data.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, data.data() + i, data.size() - i);
+        hash = (hash ^ word) * prime;
+    }
+    return Mix64(hash ^ data.size());
+}
+} // namespace w
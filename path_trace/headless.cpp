@@ -0,0 +1,116 @@
+#include "headless.h"
+#include "profiler.h"
+#include <chrono>
+
+w::HeadlessRenderer::HeadlessRenderer(uint32_t width, uint32_t height)
+    : width(width)
+    , height(height)
+    , gfx(nullptr)
+    , uploads(gfx)
+    , frame_constants(gfx)
+    , graph(gfx)
+    , scene(gfx, uploads)
+{
+    using namespace wis; // for flag operators
+    wis::Result result = wis::success;
+    if (width == 0 || height == 0 || width % 16 != 0) {
+        throw w::Exception(wis::format("Headless output must be a non-empty multiple of 16 pixels wide, got {}x{}", width, height));
+    }
+
+    auto bindings = w::Scene::DescriptorBindings();
+    desc_storage = gfx.device.CreateDescriptorStorage(result, bindings.data(), uint32_t(bindings.size()));
+    CheckResult(result);
+    command_list = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
+    CheckResult(result);
+    scene.CreatePipeline(gfx, bindings);
+
+    wis::TextureDesc desc{
+        .format = output_format,
+        .size = { width, height, 1 },
+        .usage = wis::TextureUsage::CopySrc | wis::TextureUsage::UnorderedAccess,
+    };
+    wis::UnorderedAccessDesc uav_desc{
+        .format = output_format,
+        .view_type = wis::TextureViewType::Texture2D,
+        .subresource_range = { 0, 1, 0, 1 },
+    };
+    output = gfx.allocator.CreateTexture(result, desc);
+    CheckResult(result);
+    output_uav = gfx.device.CreateUnorderedAccessTexture(result, output, uav_desc);
+    CheckResult(result);
+    desc_storage.WriteRWTexture(2, 0, output_uav);
+
+    readback = gfx.allocator.CreateReadbackBuffer(result, uint64_t(width) * height * sizeof(DirectX::XMFLOAT4));
+    CheckResult(result);
+
+    scene.UpdateDispatch(int(width), int(height));
+    scene.Bind(gfx, desc_storage);
+    uploads.WaitIdle();
+}
+
+w::HeadlessRenderer::~HeadlessRenderer()
+{
+    gfx.WaitForGpu();
+}
+
+void w::HeadlessRenderer::Reset(const Scene::RenderSettings& settings)
+{
+    scene.SetRenderSettings(settings);
+}
+
+double w::HeadlessRenderer::Render(uint32_t samples)
+{
+    W_PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    while (samples > 0) {
+        uint32_t batch = std::min(samples, max_batch);
+        samples -= batch;
+
+        frame_constants.BeginFrame(0);
+        CheckResult(command_list.Reset());
+
+        graph.Reset();
+        auto target = graph.ImportTexture(output, output_state);
+        scene.AddPasses(graph, gfx, frame_constants, desc_storage, 0, target, batch);
+        graph.Compile();
+        graph.Execute(command_list);
+        command_list.Close();
+
+        gfx.ExecuteCommandLists({ command_list });
+        frame_constants.EndFrame();
+        gfx.WaitForGpu(); // the command list and constants region are reused by the next batch
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+w::Image w::HeadlessRenderer::Readback()
+{
+    W_PROFILE_FUNCTION();
+    CheckResult(command_list.Reset());
+    graph.Reset();
+    auto source = graph.ImportTexture(output, output_state);
+    graph.AddPass("Readback", { { source, w::RGUsage::CopySource } },
+                  [this](wis::CommandList& cmd) {
+                      wis::BufferTextureCopyRegion region{
+                          .buffer_offset = 0,
+                          .texture = {
+                                  .size = { width, height, 1 },
+                                  .format = output_format,
+                          },
+                      };
+                      cmd.CopyTextureToBuffer(output, readback, &region, 1);
+                  });
+    graph.Compile();
+    graph.Execute(command_list);
+    command_list.Close();
+    gfx.ExecuteCommandLists({ command_list });
+    gfx.WaitForGpu();
+
+    Image image{ width, height };
+    auto* texels = readback.Map<const DirectX::XMFLOAT4>();
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        image.pixels[i] = { texels[i].x, texels[i].y, texels[i].z };
+    }
+    readback.Unmap();
+    return image;
+}
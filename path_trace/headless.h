@@ -0,0 +1,62 @@
+#pragma once
+#include "scene.h"
+#include "graphics.h"
+#include "upload.h"
+#include "frame_allocator.h"
+#include "render_graph.h"
+#include "image_metrics.h"
+
+namespace w {
+// Renders the default Scene without a window into a float target, used by the golden image tests.
+// Samples always accumulate into frame 0's descriptors, so the running mean is exact.
+class HeadlessRenderer
+{
+public:
+    static constexpr wis::DataFormat output_format = wis::DataFormat::RGBA32Float;
+    static constexpr uint32_t max_batch = 64; // trace passes per submission, bounded by the frame allocator region
+
+public:
+    // width must be a multiple of 16 so readback rows stay 256 byte aligned
+    HeadlessRenderer(uint32_t width, uint32_t height);
+    ~HeadlessRenderer();
+
+public:
+    // restarts accumulation with new settings
+    void Reset(const Scene::RenderSettings& settings);
+    // traces `samples` more samples per pixel, returns the wall time until the GPU finished in seconds
+    double Render(uint32_t samples);
+    Image Readback();
+
+    uint32_t SampleCount() const noexcept
+    {
+        return scene.FrameCount();
+    }
+    uint32_t GetWidth() const noexcept
+    {
+        return width;
+    }
+    uint32_t GetHeight() const noexcept
+    {
+        return height;
+    }
+
+private:
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    w::Graphics gfx;
+    w::UploadManager uploads;
+    w::FrameAllocator frame_constants;
+    w::RenderGraph graph;
+
+    wis::DescriptorStorage desc_storage;
+    wis::CommandList command_list;
+
+    wis::Texture output;
+    wis::UnorderedAccessTexture output_uav;
+    w::RGState output_state;
+    wis::Buffer readback;
+
+    w::Scene scene;
+};
+} // namespace w
@@ -0,0 +1,305 @@
+#include "image_metrics.h"
+#include "consts.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <span>
+
+namespace {
+using Plane = std::vector<float>;
+constexpr float pi = std::numbers::pi_v<float>;
+
+// D65 white of linear sRGB (1, 1, 1)
+constexpr std::array<float, 3> white_xyz{ 0.950489f, 1.0f, 1.088840f };
+
+std::array<float, 3> LinearRGBToXYZ(std::array<float, 3> c) noexcept
+{
+    return { 0.4124564f * c[0] + 0.3575761f * c[1] + 0.1804375f * c[2],
+             0.2126729f * c[0] + 0.7151522f * c[1] + 0.0721750f * c[2],
+             0.0193339f * c[0] + 0.1191920f * c[1] + 0.9503041f * c[2] };
+}
+std::array<float, 3> XYZToLinearRGB(std::array<float, 3> c) noexcept
+{
+    return { 3.2404542f * c[0] - 1.5371385f * c[1] - 0.4985314f * c[2],
+             -0.9692660f * c[0] + 1.8760108f * c[1] + 0.0415560f * c[2],
+             0.0556434f * c[0] - 0.2040259f * c[1] + 1.0572252f * c[2] };
+}
+std::array<float, 3> XYZToYCxCz(std::array<float, 3> c) noexcept
+{
+    float x = c[0] / white_xyz[0], y = c[1] / white_xyz[1], z = c[2] / white_xyz[2];
+    return { 116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z) };
+}
+std::array<float, 3> YCxCzToXYZ(std::array<float, 3> c) noexcept
+{
+    float y = (c[0] + 16.0f) / 116.0f;
+    return { (y + c[1] / 500.0f) * white_xyz[0], y * white_xyz[1], (y - c[2] / 200.0f) * white_xyz[2] };
+}
+std::array<float, 3> XYZToLab(std::array<float, 3> c) noexcept
+{
+    auto f = [](float t) {
+        constexpr float delta = 6.0f / 29.0f;
+        return t > delta * delta * delta ? std::cbrt(t) : t / (3.0f * delta * delta) + 4.0f / 29.0f;
+    };
+    float x = f(c[0] / white_xyz[0]), y = f(c[1] / white_xyz[1]), z = f(c[2] / white_xyz[2]);
+    return { 116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z) };
+}
+
+// Hunt adjusted L*a*b* of a linear color
+std::array<float, 3> HuntLab(std::array<float, 3> rgb) noexcept
+{
+    auto lab = XYZToLab(LinearRGBToXYZ(rgb));
+    return { lab[0], 0.01f * lab[0] * lab[1], 0.01f * lab[0] * lab[2] };
+}
+float HyAB(const std::array<float, 3>& a, const std::array<float, 3>& b) noexcept
+{
+    float da = a[1] - b[1], db = a[2] - b[2];
+    return std::abs(a[0] - b[0]) + std::sqrt(da * da + db * db);
+}
+
+// Separable convolution with clamped borders
+void Convolve(const Plane& in, Plane& out, uint32_t width, uint32_t height, std::span<const float> kx, std::span<const float> ky)
+{
+    int rx = int(kx.size() / 2), ry = int(ky.size() / 2);
+    Plane tmp(in.size());
+    for (int y = 0; y < int(height); y++) {
+        for (int x = 0; x < int(width); x++) {
+            float sum = 0.0f;
+            for (int k = -rx; k <= rx; k++) {
+                sum += kx[k + rx] * in[size_t(y) * width + std::clamp(x + k, 0, int(width) - 1)];
+            }
+            tmp[size_t(y) * width + x] = sum;
+        }
+    }
+    out.resize(in.size());
+    for (int y = 0; y < int(height); y++) {
+        for (int x = 0; x < int(width); x++) {
+            float sum = 0.0f;
+            for (int k = -ry; k <= ry; k++) {
+                sum += ky[k + ry] * tmp[size_t(std::clamp(y + k, 0, int(height) - 1)) * width + x];
+            }
+            out[size_t(y) * width + x] = sum;
+        }
+    }
+}
+
+// Contrast sensitivity of one opponent channel as a sum of two gaussians, parameters from the FLIP paper
+struct CSF {
+    float a1, b1, a2, b2;
+};
+constexpr CSF csf_y{ 1.0f, 0.0047f, 0.0f, 1e-5f };
+constexpr CSF csf_cx{ 1.0f, 0.0053f, 0.0f, 1e-5f };
+constexpr CSF csf_cz{ 34.1f, 0.04f, 13.5f, 0.025f };
+
+void FilterCSF(const Plane& in, Plane& out, uint32_t width, uint32_t height, CSF csf, float ppd)
+{
+    int radius = int(std::ceil(3.0f * std::sqrt(std::max(csf.b1, csf.b2) / (2.0f * pi * pi)) * ppd));
+    std::vector<float> k1(2 * radius + 1), k2(2 * radius + 1);
+    float s1 = 0.0f, s2 = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        float x = float(i) / ppd; // degrees
+        k1[i + radius] = std::exp(-pi * pi * x * x / csf.b1);
+        k2[i + radius] = std::exp(-pi * pi * x * x / csf.b2);
+        s1 += k1[i + radius];
+        s2 += k2[i + radius];
+    }
+    // 2D weights a * pi / b of both gaussians, normalized so the whole kernel sums to 1
+    float w1 = csf.a1 * pi / csf.b1 * s1 * s1;
+    float w2 = csf.a2 * pi / csf.b2 * s2 * s2;
+    for (auto& k : k1) {
+        k /= s1;
+    }
+    for (auto& k : k2) {
+        k /= s2;
+    }
+
+    Convolve(in, out, width, height, k1, k1);
+    if (w2 == 0.0f) {
+        return;
+    }
+    Plane second;
+    Convolve(in, second, width, height, k2, k2);
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = (w1 * out[i] + w2 * second[i]) / (w1 + w2);
+    }
+}
+
+// Magnitudes of the edge (first derivative) and point (second derivative) responses of a gaussian
+void Features(const Plane& luma, Plane& edges, Plane& points, uint32_t width, uint32_t height, float ppd)
+{
+    constexpr float feature_width = 0.082f; // degrees
+    float sigma = 0.5f * feature_width * ppd;
+    int radius = int(std::ceil(3.0f * sigma));
+
+    std::vector<float> g(2 * radius + 1), dg(2 * radius + 1), ddg(2 * radius + 1);
+    float sg = 0.0f, sdg_pos = 0.0f, sddg_pos = 0.0f, sddg_neg = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        float x = float(i);
+        float gauss = std::exp(-(x * x) / (2.0f * sigma * sigma));
+        g[i + radius] = gauss;
+        dg[i + radius] = -x * gauss;
+        ddg[i + radius] = (x * x / (sigma * sigma) - 1.0f) * gauss;
+        sg += gauss;
+        sdg_pos += std::max(0.0f, dg[i + radius]);
+        (ddg[i + radius] > 0 ? sddg_pos : sddg_neg) += ddg[i + radius];
+    }
+    // positive and negative lobes each sum to +-1
+    for (int i = 0; i <= 2 * radius; i++) {
+        g[i] /= sg;
+        dg[i] /= sdg_pos;
+        ddg[i] /= ddg[i] > 0 ? sddg_pos : -sddg_neg;
+    }
+
+    Plane x, y;
+    Convolve(luma, x, width, height, dg, g);
+    Convolve(luma, y, width, height, g, dg);
+    edges.resize(luma.size());
+    for (size_t i = 0; i < luma.size(); i++) {
+        edges[i] = std::hypot(x[i], y[i]);
+    }
+    Convolve(luma, x, width, height, ddg, g);
+    Convolve(luma, y, width, height, g, ddg);
+    points.resize(luma.size());
+    for (size_t i = 0; i < luma.size(); i++) {
+        points[i] = std::hypot(x[i], y[i]);
+    }
+}
+
+struct Opponent {
+    std::array<Plane, 3> ycxcz; // CSF filtered
+    Plane luma; // normalized luminance of the unfiltered input
+};
+Opponent ToOpponent(const w::Image& image, float ppd)
+{
+    size_t n = image.pixels.size();
+    Opponent o;
+    std::array<Plane, 3> raw{ Plane(n), Plane(n), Plane(n) };
+    o.luma.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        auto& p = image.pixels[i];
+        auto c = XYZToYCxCz(LinearRGBToXYZ({ std::clamp(p.x, 0.0f, 1.0f), std::clamp(p.y, 0.0f, 1.0f), std::clamp(p.z, 0.0f, 1.0f) }));
+        raw[0][i] = c[0];
+        raw[1][i] = c[1];
+        raw[2][i] = c[2];
+        o.luma[i] = (c[0] + 16.0f) / 116.0f;
+    }
+    FilterCSF(raw[0], o.ycxcz[0], image.width, image.height, csf_y, ppd);
+    FilterCSF(raw[1], o.ycxcz[1], image.width, image.height, csf_cx, ppd);
+    FilterCSF(raw[2], o.ycxcz[2], image.width, image.height, csf_cz, ppd);
+    return o;
+}
+
+void CheckSizes(const w::Image& test, const w::Image& reference)
+{
+    if (!test.SameSize(reference) || test.pixels.empty()) {
+        throw w::Exception(wis::format("Image size mismatch: {}x{} vs reference {}x{}", test.width, test.height, reference.width, reference.height));
+    }
+}
+} // namespace
+
+w::Image w::ReadPFM(const std::filesystem::path& path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    if (!file) {
+        throw w::Exception(wis::format("Image file not found: {}", path.string()));
+    }
+
+    std::string magic;
+    uint32_t width = 0, height = 0;
+    float scale = 0.0f;
+    file >> magic >> width >> height >> scale;
+    file.get(); // single whitespace before the raster
+    if (magic != "PF" || width == 0 || height == 0 || scale >= 0.0f) {
+        throw w::Exception(wis::format("Unsupported PFM (expected little endian RGB): {}", path.string()));
+    }
+
+    Image image{ width, height };
+    for (uint32_t y = 0; y < height; y++) { // PFM rows are bottom to top
+        file.read(reinterpret_cast<char*>(&image.At(0, height - 1 - y)), std::streamsize(width) * sizeof(DirectX::XMFLOAT3));
+    }
+    if (!file) {
+        throw w::Exception(wis::format("Truncated PFM: {}", path.string()));
+    }
+    return image;
+}
+
+void w::WritePFM(const std::filesystem::path& path, const Image& image)
+{
+    std::ofstream file{ path, std::ios::binary };
+    if (!file) {
+        throw w::Exception(wis::format("Unable to write image: {}", path.string()));
+    }
+    file << "PF\n"
+         << image.width << " " << image.height << "\n-1.0\n";
+    for (uint32_t y = 0; y < image.height; y++) {
+        file.write(reinterpret_cast<const char*>(&image.At(0, image.height - 1 - y)), std::streamsize(image.width) * sizeof(DirectX::XMFLOAT3));
+    }
+}
+
+float w::RMSE(const Image& test, const Image& reference)
+{
+    CheckSizes(test, reference);
+    double sum = 0.0;
+    for (size_t i = 0; i < test.pixels.size(); i++) {
+        auto &t = test.pixels[i], &r = reference.pixels[i];
+        sum += double(t.x - r.x) * (t.x - r.x) + double(t.y - r.y) * (t.y - r.y) + double(t.z - r.z) * (t.z - r.z);
+    }
+    return float(std::sqrt(sum / (test.pixels.size() * 3)));
+}
+
+float w::RelMSE(const Image& test, const Image& reference, float epsilon)
+{
+    CheckSizes(test, reference);
+    auto rel = [epsilon](float t, float r) {
+        return double(t - r) * (t - r) / (double(r) * r + epsilon);
+    };
+    double sum = 0.0;
+    for (size_t i = 0; i < test.pixels.size(); i++) {
+        auto &t = test.pixels[i], &r = reference.pixels[i];
+        sum += rel(t.x, r.x) + rel(t.y, r.y) + rel(t.z, r.z);
+    }
+    return float(sum / (test.pixels.size() * 3));
+}
+
+float w::FLIP(const Image& test, const Image& reference, float ppd, Image* error_map)
+{
+    CheckSizes(test, reference);
+    constexpr float qc = 0.7f, pc = 0.4f, pt = 0.95f, qf = 0.5f;
+    const float cmax = std::pow(HyAB(HuntLab({ 0, 1, 0 }), HuntLab({ 0, 0, 1 })), qc);
+
+    Opponent t = ToOpponent(test, ppd);
+    Opponent r = ToOpponent(reference, ppd);
+    Plane t_edges, t_points, r_edges, r_points;
+    Features(t.luma, t_edges, t_points, test.width, test.height, ppd);
+    Features(r.luma, r_edges, r_points, test.width, test.height, ppd);
+
+    if (error_map) {
+        *error_map = Image{ test.width, test.height };
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < test.pixels.size(); i++) {
+        auto filtered_lab = [i](const Opponent& o) {
+            auto rgb = XYZToLinearRGB(YCxCzToXYZ({ o.ycxcz[0][i], o.ycxcz[1][i], o.ycxcz[2][i] }));
+            for (auto& c : rgb) {
+                c = std::clamp(c, 0.0f, 1.0f);
+            }
+            return HuntLab(rgb);
+        };
+        float color = std::pow(HyAB(filtered_lab(t), filtered_lab(r)), qc);
+        color = color < pc * cmax
+                ? pt / (pc * cmax) * color
+                : pt + (color - pc * cmax) / (cmax - pc * cmax) * (1.0f - pt);
+
+        float feature = std::max(std::abs(t_edges[i] - r_edges[i]), std::abs(t_points[i] - r_points[i]));
+        feature = std::pow(feature / std::numbers::sqrt2_v<float>, qf);
+
+        float e = std::pow(color, 1.0f - feature);
+        sum += e;
+        if (error_map) {
+            error_map->pixels[i] = { e, e, e };
+        }
+    }
+    return float(sum / test.pixels.size());
+}
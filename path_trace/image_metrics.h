@@ -0,0 +1,49 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace w {
+// Linear RGB float image, rows top to bottom
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<DirectX::XMFLOAT3> pixels;
+
+public:
+    Image() = default;
+    Image(uint32_t width, uint32_t height)
+        : width(width), height(height), pixels(size_t(width) * height)
+    {
+    }
+
+public:
+    DirectX::XMFLOAT3& At(uint32_t x, uint32_t y) noexcept
+    {
+        return pixels[size_t(y) * width + x];
+    }
+    const DirectX::XMFLOAT3& At(uint32_t x, uint32_t y) const noexcept
+    {
+        return pixels[size_t(y) * width + x];
+    }
+    bool SameSize(const Image& other) const noexcept
+    {
+        return width == other.width && height == other.height;
+    }
+};
+
+// Portable float map (little endian "PF"), the reference format of the golden tests
+Image ReadPFM(const std::filesystem::path& path);
+void WritePFM(const std::filesystem::path& path, const Image& image);
+
+// Error metrics of test against reference, images must be the same size
+float RMSE(const Image& test, const Image& reference);
+// Squared error relative to the reference value, epsilon keeps dark pixels from dominating
+float RelMSE(const Image& test, const Image& reference, float epsilon = 0.01f);
+
+// Mean LDR-FLIP (Andersson et al. 2020), inputs are clamped to [0, 1].
+// pixels_per_degree of 67 corresponds to a 0.7m wide 4K monitor viewed from 0.7m.
+// Optionally returns the per pixel error in all three channels of error_map.
+float FLIP(const Image& test, const Image& reference, float pixels_per_degree = 67.0f, Image* error_map = nullptr);
+} // namespace w
@@ -47,6 +47,8 @@
 
 #ifndef IMGUI_DISABLE
 #include "imgui_impl_wisdom.h"
+#include "../draw_list_cache.h"
+#include <new>
 
 #if __has_include(<wisdom/wisdom_extended_allocation.hpp>)
 #include <wisdom/wisdom_extended_allocation.hpp>
@@ -98,11 +100,15 @@
 //  return output;\
 //}";
 
+// Mapped for their whole lifetime, draw lists that did not change since this frame resource was last used stay in place
 struct ImGui_ImplWisdom_RenderBuffers {
     wis::Buffer vertex_buffer;
     wis::Buffer index_buffer;
-    uint32_t vertex_count;
-    uint32_t index_count;
+    ImDrawVert* vertices = nullptr;
+    ImDrawIdx* indices = nullptr;
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    w::DrawListCache cache;
 };
 
 struct ImGui_ImplWisdom_ConstantBuffer {
@@ -136,6 +142,7 @@ struct ImGui_ImplWisdom_Data {
     uint32_t sampler_descriptor_offset;
     uint32_t sampler_descriptor_binding;
     wis::QueueType queue_type;
+    ImGui_ImplWisdom_UploadStats upload_stats;
 
     // ImGui_ImplDX12_Texture FontTexture;
     // bool LegacySingleDescriptorUsed;
@@ -155,24 +162,49 @@ static ImGui_ImplWisdom_Data* ImGui_ImplWisdom_GetBackendData()
             : nullptr;
 }
 
-static wis::Result ImGui_ImplWisdom_ResizeRenderBuffers(ImGui_ImplWisdom_RenderBuffers* buffers, const wis::ResourceAllocator& allocator, uint32_t vertex_count, uint32_t index_count)
+// Buffers at least double when they grow, everything in them has to be uploaded again afterwards
+static wis::Result ImGui_ImplWisdom_ResizeRenderBuffers(ImGui_ImplWisdom_RenderBuffers* buffers, const wis::ResourceAllocator& allocator, uint32_t vertex_count, uint32_t index_count, uint32_t* growths = nullptr)
 {
     wis::Result result = wis::success;
     if (buffers->vertex_count < vertex_count) {
-        buffers->vertex_buffer = allocator.CreateBuffer(result,
-                                                        (vertex_count + 5000) * sizeof(ImDrawVert),
-                                                        wis::BufferUsage::VertexBuffer,
-                                                        wis::MemoryType::Upload,
-                                                        wis::MemoryFlags::Mapped);
-        buffers->vertex_count = vertex_count + 5000;
+        uint32_t capacity = uint32_t(w::GrowCapacity(buffers->vertex_count, vertex_count, 5000));
+        wis::Buffer buffer = allocator.CreateBuffer(result,
+                                                    capacity * sizeof(ImDrawVert),
+                                                    wis::BufferUsage::VertexBuffer,
+                                                    wis::MemoryType::Upload,
+                                                    wis::MemoryFlags::Mapped);
+        if (result.status != wis::Status::Ok) {
+            return result;
+        }
+        if (buffers->vertices) {
+            buffers->vertex_buffer.Unmap();
+        }
+        buffers->vertex_buffer = std::move(buffer);
+        buffers->vertices = buffers->vertex_buffer.Map<ImDrawVert>();
+        buffers->vertex_count = buffers->vertices ? capacity : 0;
+        buffers->cache.Invalidate();
+        if (growths)
+            (*growths)++;
     }
     if (buffers->index_count < index_count) {
-        buffers->index_buffer = allocator.CreateBuffer(result,
-                                                       (index_count + 10000) * sizeof(ImDrawIdx),
-                                                       wis::BufferUsage::IndexBuffer,
-                                                       wis::MemoryType::Upload,
-                                                       wis::MemoryFlags::Mapped);
-        buffers->index_count = index_count + 10000;
+        uint32_t capacity = uint32_t(w::GrowCapacity(buffers->index_count, index_count, 10000));
+        wis::Buffer buffer = allocator.CreateBuffer(result,
+                                                    capacity * sizeof(ImDrawIdx),
+                                                    wis::BufferUsage::IndexBuffer,
+                                                    wis::MemoryType::Upload,
+                                                    wis::MemoryFlags::Mapped);
+        if (result.status != wis::Status::Ok) {
+            return result;
+        }
+        if (buffers->indices) {
+            buffers->index_buffer.Unmap();
+        }
+        buffers->index_buffer = std::move(buffer);
+        buffers->indices = buffers->index_buffer.Map<ImDrawIdx>();
+        buffers->index_count = buffers->indices ? capacity : 0;
+        buffers->cache.Invalidate();
+        if (growths)
+            (*growths)++;
     }
     return result;
 }
@@ -520,10 +552,20 @@ void ImGui_ImplWisdom_InvalidateDeviceObjects()
     // We only need to release the buffers, the rest of the resources will be released by the allocator
     for (UINT i = 0; i < bd->frames_in_flight_count; i++) {
         ImGui_ImplWisdom_RenderBuffers* fr = &bd->frame_resources[i];
+        if (fr->vertices) {
+            fr->vertex_buffer.Unmap();
+        }
+        if (fr->indices) {
+            fr->index_buffer.Unmap();
+        }
         fr->index_buffer = {};
         fr->vertex_buffer = {};
+        fr->vertices = nullptr;
+        fr->indices = nullptr;
+        fr->vertex_count = 0;
+        fr->index_count = 0;
+        fr->cache.Invalidate();
     }
-    memset(bd->frame_resources, 0, sizeof(ImGui_ImplWisdom_RenderBuffers) * bd->frames_in_flight_count);
 }
 
 bool ImGui_ImplWisdom_Init(ImGui_ImplWisdom_InitInfo* init_info)
@@ -551,6 +593,9 @@ bool ImGui_ImplWisdom_Init(ImGui_ImplWisdom_InitInfo* init_info)
     bd->sampler_descriptor_offset = init_info->sampler_descriptor_offset;
     bd->sampler_descriptor_binding = init_info->sampler_descriptor_binding;
     bd->queue_type = init_info->queue_type;
+    for (uint32_t i = 0; i < bd->frames_in_flight_count; i++) {
+        new (&bd->frame_resources[i]) ImGui_ImplWisdom_RenderBuffers{};
+    }
 
     io.BackendRendererUserData = static_cast<void*>(bd);
     io.BackendRendererName = "imgui_impl_wisdom";
@@ -587,6 +632,9 @@ void ImGui_ImplWisdom_Shutdown()
     ImGuiIO& io = ImGui::GetIO();
 
     ImGui_ImplWisdom_InvalidateDeviceObjects();
+    for (uint32_t i = 0; i < bd->frames_in_flight_count; i++) {
+        bd->frame_resources[i].~ImGui_ImplWisdom_RenderBuffers();
+    }
 
     io.BackendRendererName = nullptr;
     io.BackendRendererUserData = nullptr;
@@ -604,6 +652,12 @@ void ImGui_ImplWisdom_NewFrame()
     bd->frame_index++;
 }
 
+ImGui_ImplWisdom_UploadStats ImGui_ImplWisdom_GetUploadStats()
+{
+    ImGui_ImplWisdom_Data* bd = ImGui_ImplWisdom_GetBackendData();
+    return bd ? bd->upload_stats : ImGui_ImplWisdom_UploadStats{};
+}
+
 ImGui_ImplWisdom_DescriptorRequirement* ImGui_ImplWisdom_GetDescriptorRequirements(uint32_t* requirements_count)
 {
     *requirements_count = sizeof(requirements) / sizeof(ImGui_ImplWisdom_DescriptorRequirement);
@@ -620,27 +674,32 @@ void ImGui_ImplWisdom_RenderDrawData(ImDrawData* draw_data, wis::CommandList& co
     ImGui_ImplWisdom_RenderBuffers* fr = &bd->frame_resources[bd->frame_index % bd->frames_in_flight_count];
 
     // Create and grow vertex/index buffers if needed
-    ImGui_ImplWisdom_ResizeRenderBuffers(fr, *bd->allocator, draw_data->TotalVtxCount, draw_data->TotalIdxCount);
-
-    // Upload vertex/index data into a single contiguous GPU buffer
-    ImDrawVert* vtx_resource = fr->vertex_buffer.Map<ImDrawVert>();
-    if (!vtx_resource)
-        return;
-
-    ImDrawIdx* idx_resource = fr->index_buffer.Map<ImDrawIdx>();
-    if (!idx_resource)
+    ImGui_ImplWisdom_UploadStats& stats = bd->upload_stats;
+    stats = {};
+    ImGui_ImplWisdom_ResizeRenderBuffers(fr, *bd->allocator, draw_data->TotalVtxCount, draw_data->TotalIdxCount, &stats.buffer_growths);
+    if (!fr->vertices || !fr->indices || fr->vertex_count < uint32_t(draw_data->TotalVtxCount) || fr->index_count < uint32_t(draw_data->TotalIdxCount))
         return;
 
+    // Upload vertex/index data into a single contiguous GPU buffer, skipping lists that are already in place
+    fr->cache.Begin(draw_data->CmdListsCount);
+    size_t vtx_offset = 0;
+    size_t idx_offset = 0;
     for (int n = 0; n < draw_data->CmdListsCount; n++) {
         const ImDrawList* draw_list = draw_data->CmdLists[n];
-        memcpy(vtx_resource, draw_list->VtxBuffer.Data, draw_list->VtxBuffer.Size * sizeof(ImDrawVert));
-        memcpy(idx_resource, draw_list->IdxBuffer.Data, draw_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-        vtx_resource += draw_list->VtxBuffer.Size;
-        idx_resource += draw_list->IdxBuffer.Size;
+        auto vertices = std::as_bytes(std::span{ draw_list->VtxBuffer.Data, size_t(draw_list->VtxBuffer.Size) });
+        auto indices = std::as_bytes(std::span{ draw_list->IdxBuffer.Data, size_t(draw_list->IdxBuffer.Size) });
+        if (fr->cache.Update(n, vertices, indices, vtx_offset * sizeof(ImDrawVert), idx_offset * sizeof(ImDrawIdx))) {
+            memcpy(fr->vertices + vtx_offset, vertices.data(), vertices.size());
+            memcpy(fr->indices + idx_offset, indices.data(), indices.size());
+        }
+        vtx_offset += draw_list->VtxBuffer.Size;
+        idx_offset += draw_list->IdxBuffer.Size;
     }
-
-    fr->vertex_buffer.Unmap();
-    fr->index_buffer.Unmap();
+    const w::DrawListCache::Stats& cache_stats = fr->cache.GetStats();
+    stats.bytes_uploaded = cache_stats.bytes_uploaded;
+    stats.bytes_skipped = cache_stats.bytes_skipped;
+    stats.lists_uploaded = cache_stats.lists_uploaded;
+    stats.lists_skipped = cache_stats.lists_skipped;
 
     // Setup desired DX state
     ImGui_ImplWisdom_SetupRenderState(draw_data, command_list, fr);
@@ -48,6 +48,15 @@ struct ImGui_ImplWisdom_DescriptorRequirement {
     uint32_t count;
 };
 
+// Vertex and index data of the last ImGui_ImplWisdom_RenderDrawData
+struct ImGui_ImplWisdom_UploadStats {
+    uint64_t bytes_uploaded;
+    uint64_t bytes_skipped; // draw lists unchanged since the frame resource was last written
+    uint32_t lists_uploaded;
+    uint32_t lists_skipped;
+    uint32_t buffer_growths;
+};
+
 bool ImGui_ImplWisdom_Init(ImGui_ImplWisdom_InitInfo* init_info);
 void ImGui_ImplWisdom_Shutdown();
 void ImGui_ImplWisdom_NewFrame();
@@ -55,4 +64,5 @@ void ImGui_ImplWisdom_NewFrame();
 ImGui_ImplWisdom_DescriptorRequirement* ImGui_ImplWisdom_GetDescriptorRequirements(uint32_t* requirements_count);
 
 void ImGui_ImplWisdom_RenderDrawData(ImDrawData* draw_data, wis::CommandList& command_list);
+ImGui_ImplWisdom_UploadStats ImGui_ImplWisdom_GetUploadStats();
 #endif // #ifndef IMGUI_DISABLE
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace w {
+struct Ray {
+    DirectX::XMFLOAT3 origin;
+    float t_min = 0.0f;
+    DirectX::XMFLOAT3 direction;
+    float t_max = 1000.0f;
+};
+
+// Barycentrics follow BuiltInTriangleIntersectionAttributes: u weights v1, v weights v2
+struct TriangleHit {
+    float t = 0.0f;
+    float u = 0.0f;
+    float v = 0.0f;
+    bool along_normal = false; // ray travels along the geometric normal cross(v1 - v0, v2 - v0), used for face culling
+};
+
+// Moller-Trumbore, two sided. Accepts hits in [t_min, t_max].
+inline bool IntersectTriangle(const Ray& ray, const DirectX::XMFLOAT3& v0, const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2, TriangleHit& hit) noexcept
+{
+    constexpr float epsilon = 1e-8f;
+    const float e1[3] = { v1.x - v0.x, v1.y - v0.y, v1.z - v0.z };
+    const float e2[3] = { v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
+    const float d[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+
+    const float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+    float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (std::abs(det) < epsilon) {
+        return false; // parallel to the triangle plane
+    }
+    float inv_det = 1.0f / det;
+
+    const float s[3] = { ray.origin.x - v0.x, ray.origin.y - v0.y, ray.origin.z - v0.z };
+    float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    const float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+    float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+
+    float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+    if (t < ray.t_min || t > ray.t_max) {
+        return false;
+    }
+    hit = { t, u, v, det < 0.0f };
+    return true;
+}
+} // namespace w
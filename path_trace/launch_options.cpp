@@ -0,0 +1,110 @@
+#include "launch_options.h"
+#include "consts.h"
+#include <algorithm>
+#include <charconv>
+
+w::LaunchOptions w::LaunchOptions::Parse(std::span<const std::string_view> args)
+{
+    LaunchOptions options;
+    if (!args.empty()) {
+        options.executable = args[0];
+    }
+    auto number = [](std::string_view arg, std::string_view value) {
+        uint32_t n = 0;
+        auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), n);
+        if (ec != std::errc{} || end != value.data() + value.size()) {
+            throw w::Exception(wis::format("Invalid value for {}: {}", arg, value));
+        }
+        return n;
+    };
+
+    for (size_t i = 1; i < args.size(); i++) {
+        std::string_view arg = args[i];
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= args.size()) {
+                throw w::Exception(wis::format("Missing value for {}", arg));
+            }
+            return args[++i];
+        };
+        if (arg == "--record") {
+            options.record = value();
+        } else if (arg == "--replay") {
+            options.replay = value();
+        } else if (arg == "--report") {
+            options.report = value();
+        } else if (arg == "--frames") {
+            options.frames = std::max(1u, number(arg, value()));
+        } else if (arg == "--warmup") {
+            options.warmup = number(arg, value());
+        } else if (arg == "--cpu") {
+            options.cpu = true;
+        } else if (arg == "--coordinator") {
+            options.coordinator = true;
+        } else if (arg == "--worker") {
+            options.worker = value();
+        } else if (arg == "--port") {
+            options.port = uint16_t(std::min(number(arg, value()), 0xffffu));
+        } else if (arg == "--spawn") {
+            options.spawn = number(arg, value());
+        } else if (arg == "--samples") {
+            options.samples = std::max(1u, number(arg, value()));
+        } else if (arg == "--lease-tile") {
+            options.lease_tile = std::max(1u, number(arg, value()));
+        } else if (arg == "--lease-samples") {
+            options.lease_samples = std::max(1u, number(arg, value()));
+        } else if (arg == "--lease-timeout") {
+            options.lease_timeout = number(arg, value());
+        } else if (arg == "--fail-after") {
+            options.fail_after = number(arg, value());
+        } else if (arg == "--camera") {
+            options.camera = value();
+        } else if (arg == "--out") {
+            options.output = value();
+        } else if (arg == "--serve") {
+            options.serve = true;
+        } else if (arg == "--client") {
+            options.client = value();
+        } else if (arg == "--updates") {
+            options.updates = std::max(1u, number(arg, value()));
+        } else if (arg == "--client-delay") {
+            options.client_delay = number(arg, value());
+        } else if (arg == "--ingest") {
+            options.ingest = number(arg, value());
+        } else if (arg == "--temporal") {
+            options.temporal = true;
+        } else if (arg == "--preview-ms") {
+            options.preview_ms = number(arg, value());
+        } else if (arg == "--budget-ms") {
+            options.budget_ms = number(arg, value());
+        } else if (arg == "--checkpoint") {
+            options.checkpoint = value();
+        } else if (arg == "--checkpoint-interval") {
+            options.checkpoint_interval = std::max(1u, number(arg, value()));
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--size") {
+            auto size = value();
+            auto x = size.find('x');
+            if (x == std::string_view::npos) {
+                throw w::Exception(wis::format("Expected WxH for --size: {}", size));
+            }
+            options.width = std::max(1u, number(arg, size.substr(0, x)));
+            options.height = std::max(1u, number(arg, size.substr(x + 1)));
+        } else {
+            throw w::Exception(wis::format("Unknown argument: {}", arg));
+        }
+    }
+    if (options.cpu && options.replay.empty()) {
+        throw w::Exception("--cpu needs a camera path to --replay");
+    }
+    if (options.resume && options.checkpoint.empty()) {
+        throw w::Exception("--resume needs a --checkpoint file");
+    }
+    if (options.coordinator && !options.worker.empty()) {
+        throw w::Exception("--coordinator and --worker are exclusive");
+    }
+    if (options.spawn && !options.coordinator) {
+        throw w::Exception("--spawn needs --coordinator");
+    }
+    return options;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace w {
+// Command line of the path tracer
+//
+//   PathTracer [--record path] [--replay path [--frames n] [--warmup n] [--report csv] [--cpu]]
+//   PathTracer [--checkpoint path [--checkpoint-interval s] [--resume]] [--preview-ms ms] [--budget-ms ms]
+//   PathTracer --coordinator [--port p] [--spawn n] [--samples n] [--camera path] [--out pfm]
+//   PathTracer --worker host:port
+//   PathTracer --serve [--port p] [--samples n] [--ingest n] [--temporal] [--preview-ms ms] [--budget-ms ms]
+//   PathTracer --client host:port [--updates n] [--client-delay ms] [--out pfm]
+//
+// --record writes the camera path on exit. --replay plays one back over a fixed number of frames,
+// prints frame time percentiles and exits; --cpu replays on the CPU tracer without a window.
+// --checkpoint periodically saves the accumulation so a render can be continued with --resume.
+// --coordinator renders one image on CPU workers, --spawn starts that many local worker processes.
+// --serve renders on the CPU for clients that send camera and settings changes and receive progressive frames,
+// --client is a scripted test client that reports the latency of each change. --ingest makes the server
+// add that many meshes while it renders, built in the background and published between samples. --temporal keeps
+// the accumulation through camera changes by reprojecting it, see TemporalAccumulator, instead of a preview.
+// --size WxH sets the resolution of everything that runs without a window.
+// --preview-ms is the frame time the window and the server aim for while the view changes, by tracing at a reduced
+// resolution until it settles. 0 always traces at full resolution.
+// --budget-ms is the frame time once the view settled, filled with as many samples per pixel as fit. 0 traces one
+// sample per frame.
+struct LaunchOptions {
+    // replay
+    std::filesystem::path record;
+    std::filesystem::path replay;
+    std::filesystem::path report; // per frame times as CSV
+    uint32_t frames = 600;
+    uint32_t warmup = 10; // leading frames left out of the statistics
+    bool cpu = false;
+
+    // distributed rendering
+    bool coordinator = false;
+    std::string worker; // host:port of the coordinator
+    uint16_t port = 0; // 0 picks a free port
+    uint32_t spawn = 0;
+    uint32_t samples = 64; // per pixel
+    uint32_t lease_tile = 32; // pixels per side of a lease
+    uint32_t lease_samples = 16;
+    uint32_t lease_timeout = 60; // seconds until a silent worker's lease is handed out again
+    uint32_t fail_after = 0; // worker drops its connection after this many leases, for testing re-leasing
+    std::filesystem::path camera; // last keyframe of this camera path sets the view and settings
+    std::filesystem::path output; // final image, distributed.pfm for the coordinator if empty
+
+    // render server
+    bool serve = false;
+    std::string client; // host:port of the server
+    uint32_t updates = 5; // camera changes sent by the client
+    uint32_t client_delay = 0; // ms the client sleeps per frame, to exercise frame dropping
+    uint32_t ingest = 0; // meshes the server adds at runtime
+    bool temporal = false; // reproject the accumulation on camera changes
+
+    uint32_t preview_ms = 16; // frame time target while the view changes
+    uint32_t budget_ms = 16; // frame time target while accumulating
+
+    uint32_t width = 640; // without a window
+    uint32_t height = 360;
+
+    // checkpoints of the accumulation
+    std::filesystem::path checkpoint;
+    uint32_t checkpoint_interval = 60; // seconds
+    bool resume = false; // continue from the checkpoint file
+
+    std::filesystem::path executable; // argv[0]
+
+    static LaunchOptions Parse(std::span<const std::string_view> args);
+};
+} // namespace w
@@ -0,0 +1,208 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include "consts.h"
+#include <utility>
+
+namespace {
+std::string LastError()
+{
+#if defined(_WIN32)
+    return wis::format("error {}", GetLastError());
+#else
+    return std::strerror(errno);
+#endif
+}
+} // namespace
+
+w::MappedFile::MappedFile(MappedFile&& o) noexcept
+    : data(std::exchange(o.data, nullptr))
+    , size(std::exchange(o.size, 0))
+#if defined(_WIN32)
+    , file(std::exchange(o.file, nullptr))
+    , mapping(std::exchange(o.mapping, nullptr))
+#else
+    , file(std::exchange(o.file, -1))
+#endif
+{
+}
+
+w::MappedFile& w::MappedFile::operator=(MappedFile&& o) noexcept
+{
+    if (this != &o) {
+        Close();
+        data = std::exchange(o.data, nullptr);
+        size = std::exchange(o.size, 0);
+#if defined(_WIN32)
+        file = std::exchange(o.file, nullptr);
+        mapping = std::exchange(o.mapping, nullptr);
+#else
+        file = std::exchange(o.file, -1);
+#endif
+    }
+    return *this;
+}
+
+w::MappedFile w::MappedFile::Open(const std::filesystem::path& path, size_t size)
+{
+    MappedFile f;
+    auto fail = [&](std::string_view what) {
+        throw w::Exception(wis::format("{} {}: {}", what, path.string(), LastError()));
+    };
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        fail("Unable to open");
+    }
+    f.file = file;
+    LARGE_INTEGER file_size{};
+    if (size) {
+        file_size.QuadPart = LONGLONG(size);
+        if (!SetFilePointerEx(file, file_size, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            fail("Unable to resize");
+        }
+    } else if (!GetFileSizeEx(file, &file_size)) {
+        fail("Unable to stat");
+    }
+    f.size = size_t(file_size.QuadPart);
+    if (!f.size) {
+        return f;
+    }
+    f.mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!f.mapping) {
+        fail("Unable to map");
+    }
+    f.data = static_cast<std::byte*>(MapViewOfFile(f.mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+#else
+    f.file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (f.file < 0) {
+        fail("Unable to open");
+    }
+    if (size) {
+        if (::ftruncate(f.file, off_t(size)) != 0) {
+            fail("Unable to resize");
+        }
+    } else {
+        struct stat st {};
+        if (::fstat(f.file, &st) != 0) {
+            fail("Unable to stat");
+        }
+        size = size_t(st.st_size);
+    }
+    f.size = size;
+    if (!f.size) {
+        return f;
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.file, 0);
+    f.data = data == MAP_FAILED ? nullptr : static_cast<std::byte*>(data);
+#endif
+    if (!f.data) {
+        fail("Unable to map");
+    }
+    return f;
+}
+
+w::MappedFile w::MappedFile::OpenRead(const std::filesystem::path& path)
+{
+    MappedFile f;
+    auto fail = [&](std::string_view what) {
+        throw w::Exception(wis::format("{} {}: {}", what, path.string(), LastError()));
+    };
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        fail("Unable to open");
+    }
+    f.file = file;
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size)) {
+        fail("Unable to stat");
+    }
+    f.size = size_t(file_size.QuadPart);
+    if (!f.size) {
+        return f;
+    }
+    f.mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!f.mapping) {
+        fail("Unable to map");
+    }
+    f.data = static_cast<std::byte*>(MapViewOfFile(f.mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    f.file = ::open(path.c_str(), O_RDONLY);
+    if (f.file < 0) {
+        fail("Unable to open");
+    }
+    struct stat st {};
+    if (::fstat(f.file, &st) != 0) {
+        fail("Unable to stat");
+    }
+    f.size = size_t(st.st_size);
+    if (!f.size) {
+        return f;
+    }
+    void* data = ::mmap(nullptr, f.size, PROT_READ, MAP_SHARED, f.file, 0);
+    f.data = data == MAP_FAILED ? nullptr : static_cast<std::byte*>(data);
+#endif
+    if (!f.data) {
+        fail("Unable to map");
+    }
+    return f;
+}
+
+void w::MappedFile::Flush(size_t offset, size_t bytes) const
+{
+    if (!data || !bytes) {
+        return;
+    }
+#if defined(_WIN32)
+    if (!FlushViewOfFile(data + offset, bytes) || !FlushFileBuffers(file)) {
+        throw w::Exception(wis::format("Unable to flush mapped file: {}", LastError()));
+    }
+#else
+    // msync wants a page aligned start
+    size_t page = size_t(::sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page * page;
+    if (::msync(data + begin, offset + bytes - begin, MS_SYNC) != 0) {
+        throw w::Exception(wis::format("Unable to flush mapped file: {}", LastError()));
+    }
+#endif
+}
+
+void w::MappedFile::Close() noexcept
+{
+#if defined(_WIN32)
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (file) {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data) {
+        ::munmap(data, size);
+    }
+    if (file >= 0) {
+        ::close(file);
+    }
+    file = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace w {
+// Shared mapping of a whole file, read-write unless opened with OpenRead. Errors throw w::Exception
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+public:
+    // Creates path if needed and resizes it to size bytes, 0 keeps the current size.
+    // Bytes past the old end read as zero.
+    static MappedFile Open(const std::filesystem::path& path, size_t size = 0);
+    // Maps an existing file for reading only, writing to Data() faults
+    static MappedFile OpenRead(const std::filesystem::path& path);
+
+    std::span<std::byte> Data() const noexcept
+    {
+        return { data, size };
+    }
+    // writes the pages of [offset, offset + size) through to the file and returns once they are on disk
+    void Flush(size_t offset, size_t size) const;
+
+    void Close() noexcept;
+    explicit operator bool() const noexcept
+    {
+        return data != nullptr;
+    }
+
+private:
+    std::byte* data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+} // namespace w
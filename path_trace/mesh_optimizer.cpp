@@ -0,0 +1,324 @@
+#include "mesh_optimizer.h"
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+namespace {
+uint32_t Part1By2(uint32_t x) noexcept
+{
+    x &= 0x000003FF;
+    x = (x ^ (x << 16)) & 0xFF0000FF;
+    x = (x ^ (x << 8)) & 0x0300F00F;
+    x = (x ^ (x << 4)) & 0x030C30C3;
+    x = (x ^ (x << 2)) & 0x09249249;
+    return x;
+}
+
+uint32_t Morton3D(float x, float y, float z) noexcept
+{
+    auto quantize = [](float v) { return uint32_t(std::clamp(v, 0.0f, 1.0f) * 1023.0f); };
+    return (Part1By2(quantize(z)) << 2) | (Part1By2(quantize(y)) << 1) | Part1By2(quantize(x));
+}
+
+// Vertex -> triangle adjacency in CSR form
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency(std::span<const uint32_t> indices, uint32_t vertex_count)
+        : offsets(vertex_count + 1, 0), triangles(indices.size())
+    {
+        for (uint32_t i : indices) {
+            offsets[i + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); i++) {
+            triangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+    std::span<const uint32_t> Of(uint32_t v) const noexcept
+    {
+        return { triangles.data() + offsets[v], offsets[v + 1] - offsets[v] };
+    }
+};
+
+// Tipsify on a self-contained index range, vertices are local [0, vertex_count)
+void Tipsify(std::span<uint32_t> indices, uint32_t vertex_count, uint32_t cache_size)
+{
+    const uint32_t triangle_count = uint32_t(indices.size() / 3);
+    Adjacency adjacency(indices, vertex_count);
+
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (uint32_t i : indices) {
+        live[i]++;
+    }
+
+    std::vector<uint32_t> cache_time(vertex_count, 0);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    dead_end.reserve(indices.size());
+    candidates.reserve(64);
+
+    uint32_t time = cache_size + 1;
+    uint32_t cursor = 0; // next vertex in input order for dead end recovery
+    int64_t fanning = indices.empty() ? -1 : 0;
+
+    auto skip_dead_end = [&]() -> int64_t {
+        while (!dead_end.empty()) {
+            uint32_t d = dead_end.back();
+            dead_end.pop_back();
+            if (live[d] > 0) {
+                return d;
+            }
+        }
+        while (cursor < vertex_count) {
+            if (live[cursor] > 0) {
+                return cursor;
+            }
+            cursor++;
+        }
+        return -1;
+    };
+
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t t : adjacency.Of(uint32_t(fanning))) {
+            if (emitted[t]) {
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // pick the candidate that stays in cache the longest while still having live triangles
+        int64_t best = -1;
+        int64_t best_priority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+                priority = time - cache_time[v];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+        fanning = best >= 0 ? best : skip_dead_end();
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+// Tipsify on a cluster of the global index buffer, remaps to local vertex ids first to keep memory per cluster small
+void TipsifyCluster(std::span<uint32_t> indices, uint32_t cache_size)
+{
+    std::vector<uint32_t> global(indices.begin(), indices.end());
+    std::sort(global.begin(), global.end());
+    global.erase(std::unique(global.begin(), global.end()), global.end());
+
+    for (uint32_t& i : indices) {
+        i = uint32_t(std::lower_bound(global.begin(), global.end(), i) - global.begin());
+    }
+    Tipsify(indices, uint32_t(global.size()), cache_size);
+    for (uint32_t& i : indices) {
+        i = global[i];
+    }
+}
+
+template<typename F>
+void ParallelFor(uint32_t count, uint32_t thread_count, F&& func)
+{
+    if (thread_count <= 1 || count <= 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic_uint32_t next{ 0 };
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count);
+    for (uint32_t t = 0; t < std::min(thread_count, count); t++) {
+        threads.emplace_back([&]() {
+            W_PROFILE_THREAD("Mesh optimizer worker");
+            for (uint32_t i = next++; i < count; i = next++) {
+                func(i);
+            }
+        });
+    }
+}
+} // namespace
+
+w::MeshCacheStats w::AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size)
+{
+    MeshCacheStats stats;
+    if (indices.empty() || vertex_count == 0) {
+        return stats;
+    }
+
+    // FIFO cache, a vertex is resident if it was inserted less than cache_size insertions ago
+    std::vector<uint32_t> inserted(vertex_count, 0);
+    uint32_t time = cache_size + 1;
+    for (uint32_t i : indices) {
+        if (time - inserted[i] > cache_size) {
+            inserted[i] = time++;
+            stats.cache_misses++;
+        }
+    }
+
+    stats.acmr = float(stats.cache_misses) / float(indices.size() / 3);
+    stats.atvr = float(stats.cache_misses) / float(vertex_count);
+    return stats;
+}
+
+float w::AnalyzeVertexFetch(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t vertex_size)
+{
+    if (indices.empty() || vertex_count == 0) {
+        return 0.0f;
+    }
+
+    // small LRU of 64 byte lines, roughly a texture/L1 cache slice
+    constexpr uint32_t line_size = 64;
+    constexpr uint32_t line_capacity = 64;
+    std::vector<uint64_t> lines;
+    lines.reserve(line_capacity);
+
+    uint64_t fetched = 0;
+    for (uint32_t i : indices) {
+        uint64_t first = uint64_t(i) * vertex_size / line_size;
+        uint64_t last = (uint64_t(i) * vertex_size + vertex_size - 1) / line_size;
+        for (uint64_t line = first; line <= last; line++) {
+            auto it = std::find(lines.begin(), lines.end(), line);
+            if (it != lines.end()) {
+                lines.erase(it);
+            } else {
+                fetched += line_size;
+                if (lines.size() == line_capacity) {
+                    lines.erase(lines.begin());
+                }
+            }
+            lines.push_back(line);
+        }
+    }
+    return float(fetched) / float(uint64_t(vertex_count) * vertex_size);
+}
+
+void w::SpatialSortTriangles(std::span<uint32_t> indices, std::span<const DirectX::XMFLOAT3> positions)
+{
+    const uint32_t triangle_count = uint32_t(indices.size() / 3);
+    if (triangle_count < 2) {
+        return;
+    }
+
+    DirectX::XMFLOAT3 lo{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    DirectX::XMFLOAT3 hi{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (uint32_t i : indices) {
+        auto& p = positions[i];
+        lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+        hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+    }
+    // uniform scale keeps the curve isotropic for elongated meshes
+    float extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z });
+    float inv_extent = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+    std::vector<std::pair<uint32_t, uint32_t>> keys(triangle_count);
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        auto& a = positions[indices[t * 3 + 0]];
+        auto& b = positions[indices[t * 3 + 1]];
+        auto& c = positions[indices[t * 3 + 2]];
+        float x = ((a.x + b.x + c.x) / 3.0f - lo.x) * inv_extent;
+        float y = ((a.y + b.y + c.y) / 3.0f - lo.y) * inv_extent;
+        float z = ((a.z + b.z + c.z) / 3.0f - lo.z) * inv_extent;
+        keys[t] = { Morton3D(x, y, z), t };
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint32_t> sorted(indices.size());
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        std::copy_n(indices.begin() + keys[t].second * 3, 3, sorted.begin() + t * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices.begin());
+}
+
+void w::OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertex_count, uint32_t cache_size)
+{
+    Tipsify(indices, vertex_count, cache_size);
+}
+
+std::vector<uint32_t> w::OptimizeVertexFetchRemap(std::span<uint32_t> indices, uint32_t vertex_count, uint32_t& out_vertex_count)
+{
+    std::vector<uint32_t> remap(vertex_count, ~0u);
+    uint32_t next = 0;
+    for (uint32_t& i : indices) {
+        if (remap[i] == ~0u) {
+            remap[i] = next++;
+        }
+        i = remap[i];
+    }
+    out_vertex_count = next;
+    return remap;
+}
+
+w::MeshOptimizeReport w::OptimizeMesh(std::vector<DirectX::XMFLOAT3>& positions,
+                                      std::vector<DirectX::XMFLOAT3>& normals,
+                                      std::vector<uint32_t>& indices,
+                                      const MeshOptimizeDesc& desc)
+{
+    W_PROFILE_FUNCTION();
+    auto start = std::chrono::high_resolution_clock::now();
+    constexpr uint32_t vertex_size = sizeof(DirectX::XMFLOAT3);
+
+    MeshOptimizeReport report;
+    report.vertex_count_before = uint32_t(positions.size());
+    report.before = AnalyzeVertexCache(indices, report.vertex_count_before, desc.cache_size);
+    report.before.overfetch = AnalyzeVertexFetch(indices, report.vertex_count_before, vertex_size);
+
+    SpatialSortTriangles(indices, positions);
+
+    // clusters are independent, their boundaries only cost a few extra misses
+    const uint32_t triangle_count = uint32_t(indices.size() / 3);
+    const uint32_t cluster_triangles = std::max(desc.cluster_triangles, 1u);
+    const uint32_t cluster_count = (triangle_count + cluster_triangles - 1) / cluster_triangles;
+    const uint32_t thread_count = triangle_count < desc.parallel_threshold
+            ? 1u
+            : (desc.thread_count ? desc.thread_count : std::max(std::thread::hardware_concurrency(), 1u));
+
+    ParallelFor(cluster_count, thread_count, [&](uint32_t c) {
+        W_PROFILE_SCOPE("Optimize cluster");
+        uint32_t first = c * cluster_triangles;
+        uint32_t count = std::min(cluster_triangles, triangle_count - first);
+        TipsifyCluster({ indices.data() + first * 3, count * 3 }, desc.cache_size);
+    });
+
+    uint32_t new_vertex_count = 0;
+    auto remap = OptimizeVertexFetchRemap(indices, uint32_t(positions.size()), new_vertex_count);
+    positions = RemapVertexBuffer<DirectX::XMFLOAT3>(positions, remap, new_vertex_count);
+    normals = RemapVertexBuffer<DirectX::XMFLOAT3>(normals, remap, new_vertex_count);
+
+    report.vertex_count_after = new_vertex_count;
+    report.after = AnalyzeVertexCache(indices, new_vertex_count, desc.cache_size);
+    report.after.overfetch = AnalyzeVertexFetch(indices, new_vertex_count, vertex_size);
+    report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return report;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace w {
+// Vertex cache / vertex fetch efficiency of an index buffer
+struct MeshCacheStats {
+    float acmr = 0.0f; // average cache miss ratio, misses per triangle (0.5 is ideal for regular grids)
+    float atvr = 0.0f; // average transformed vertex ratio, misses per vertex (1.0 is ideal)
+    uint32_t cache_misses = 0;
+    float overfetch = 0.0f; // bytes fetched through 64 byte lines / vertex buffer size (1.0 is ideal)
+};
+
+struct MeshOptimizeDesc {
+    uint32_t cache_size = 16; // FIFO entries, post transform cache model
+    uint32_t cluster_triangles = 4096; // spatially sorted triangles reordered together
+    uint32_t parallel_threshold = 65536; // triangles, below that everything runs on the calling thread
+    uint32_t thread_count = 0; // 0 - hardware concurrency
+};
+
+struct MeshOptimizeReport {
+    MeshCacheStats before;
+    MeshCacheStats after;
+    uint32_t vertex_count_before = 0;
+    uint32_t vertex_count_after = 0; // unreferenced vertices are dropped
+    double milliseconds = 0.0;
+};
+
+MeshCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t cache_size = 16);
+float AnalyzeVertexFetch(std::span<const uint32_t> indices, uint32_t vertex_count, uint32_t vertex_size);
+
+// Morton order of triangle centroids, keeps BVH leaves compact
+void SpatialSortTriangles(std::span<uint32_t> indices, std::span<const DirectX::XMFLOAT3> positions);
+// Tipsify (Sander et al. 2007), linear time vertex cache reordering
+void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertex_count, uint32_t cache_size = 16);
+// Renumbers vertices in first use order, returns old -> new remap (~0u for unused), new vertex count in out_vertex_count
+std::vector<uint32_t> OptimizeVertexFetchRemap(std::span<uint32_t> indices, uint32_t vertex_count, uint32_t& out_vertex_count);
+
+template<typename T>
+std::vector<T> RemapVertexBuffer(std::span<const T> vertices, std::span<const uint32_t> remap, uint32_t new_vertex_count)
+{
+    std::vector<T> out(new_vertex_count);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (remap[i] != ~0u) {
+            out[remap[i]] = vertices[i];
+        }
+    }
+    return out;
+}
+
+// Full pass run before BLAS construction: spatial sort, cache reorder per cluster, fetch remap
+MeshOptimizeReport OptimizeMesh(std::vector<DirectX::XMFLOAT3>& positions,
+                                std::vector<DirectX::XMFLOAT3>& normals,
+                                std::vector<uint32_t>& indices,
+                                const MeshOptimizeDesc& desc = {});
+} // namespace w
@@ -0,0 +1,230 @@
+// winsock2 must come before anything that pulls in windows.h, net.h does through consts.h
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include "net.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+#if defined(_WIN32)
+struct WinsockInit {
+    WinsockInit()
+    {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+    }
+    ~WinsockInit()
+    {
+        WSACleanup();
+    }
+};
+void EnsureInit()
+{
+    static WinsockInit init;
+}
+std::string LastError()
+{
+    return wis::format("WSA error {}", WSAGetLastError());
+}
+using socklen_t = int;
+constexpr int send_flags = 0;
+#else
+void EnsureInit()
+{
+}
+std::string LastError()
+{
+    return std::strerror(errno);
+}
+constexpr int send_flags = MSG_NOSIGNAL; // a dead peer is an exception, not SIGPIPE
+#endif
+
+bool Valid(w::Socket::Handle h)
+{
+#if defined(_WIN32)
+    return h != INVALID_SOCKET;
+#else
+    return h >= 0;
+#endif
+}
+} // namespace
+
+w::Socket w::Socket::Listen(uint16_t port, bool loopback_only)
+{
+    EnsureInit();
+    Socket s{ Handle(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) };
+    if (!Valid(s.handle)) {
+        throw w::Exception(wis::format("socket: {}", LastError()));
+    }
+    int yes = 1;
+    setsockopt(s.handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+    if (::bind(s.handle, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s.handle, SOMAXCONN) != 0) {
+        throw w::Exception(wis::format("Unable to listen on port {}: {}", port, LastError()));
+    }
+    return s;
+}
+
+w::Socket w::Socket::Connect(const std::string& host, uint16_t port)
+{
+    EnsureInit();
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        throw w::Exception(wis::format("Unable to resolve {}", host));
+    }
+
+    Socket s{ Handle(::socket(result->ai_family, result->ai_socktype, result->ai_protocol)) };
+    bool connected = Valid(s.handle) && ::connect(s.handle, result->ai_addr, socklen_t(result->ai_addrlen)) == 0;
+    ::freeaddrinfo(result);
+    if (!connected) {
+        throw w::Exception(wis::format("Unable to connect to {}:{}: {}", host, port, LastError()));
+    }
+    int yes = 1; // leases and results are single messages, do not hold them back
+    setsockopt(s.handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    return s;
+}
+
+w::Socket w::Socket::Connect(std::string_view address)
+{
+    auto colon = address.rfind(':');
+    uint32_t port = 0;
+    auto port_text = address.substr(colon == std::string_view::npos ? address.size() : colon + 1);
+    auto [end, ec] = std::from_chars(port_text.data(), port_text.data() + port_text.size(), port);
+    if (colon == std::string_view::npos || ec != std::errc{} || end != port_text.data() + port_text.size() || port > 0xffff) {
+        throw w::Exception(wis::format("Expected host:port, got {}", address));
+    }
+    return Connect(std::string(address.substr(0, colon)), uint16_t(port));
+}
+
+w::Socket w::Socket::Accept()
+{
+    Socket s{ Handle(::accept(handle, nullptr, nullptr)) };
+    if (!Valid(s.handle)) {
+        throw w::Exception(wis::format("accept: {}", LastError()));
+    }
+    int yes = 1;
+    setsockopt(s.handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+    return s;
+}
+
+uint16_t w::Socket::Port() const
+{
+    sockaddr_in addr{};
+    socklen_t size = sizeof(addr);
+    if (::getsockname(handle, reinterpret_cast<sockaddr*>(&addr), &size) != 0) {
+        throw w::Exception(wis::format("getsockname: {}", LastError()));
+    }
+    return ntohs(addr.sin_port);
+}
+
+bool w::Socket::WaitReadable(uint32_t timeout_ms) const
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(handle, &set);
+    timeval timeout{ long(timeout_ms / 1000), long(timeout_ms % 1000) * 1000 };
+    return ::select(int(handle + 1), &set, nullptr, nullptr, &timeout) > 0;
+}
+
+void w::Socket::SetReceiveTimeout(uint32_t seconds)
+{
+#if defined(_WIN32)
+    DWORD timeout = seconds * 1000;
+#else
+    timeval timeout{ long(seconds), 0 };
+#endif
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+void w::Socket::SendAll(std::span<const std::byte> data)
+{
+    while (!data.empty()) {
+        auto sent = ::send(handle, reinterpret_cast<const char*>(data.data()), int(std::min<size_t>(data.size(), 1 << 20)), send_flags);
+        if (sent <= 0) {
+            throw w::Exception(wis::format("send: {}", LastError()));
+        }
+        data = data.subspan(size_t(sent));
+    }
+}
+
+bool w::Socket::ReceiveAll(std::span<std::byte> data)
+{
+    bool first = true;
+    while (!data.empty()) {
+        auto received = ::recv(handle, reinterpret_cast<char*>(data.data()), int(std::min<size_t>(data.size(), 1 << 20)), 0);
+        if (received == 0 && first) {
+            return false;
+        }
+        if (received <= 0) {
+            throw w::Exception(received == 0 ? std::string("Connection closed mid message") : wis::format("recv: {}", LastError()));
+        }
+        data = data.subspan(size_t(received));
+        first = false;
+    }
+    return true;
+}
+
+void w::Socket::SendPacket(uint32_t type, std::span<const std::byte> payload)
+{
+    uint32_t header[2]{ type, uint32_t(payload.size()) };
+    SendAll(std::as_bytes(std::span{ header }));
+    SendAll(payload);
+}
+
+std::optional<uint32_t> w::Socket::ReceivePacket(std::vector<std::byte>& payload)
+{
+    uint32_t header[2];
+    if (!ReceiveAll(std::as_writable_bytes(std::span{ header }))) {
+        return std::nullopt;
+    }
+    payload.resize(header[1]);
+    if (!ReceiveAll(payload)) {
+        throw w::Exception("Connection closed mid message");
+    }
+    return header[0];
+}
+
+void w::Socket::Shutdown() noexcept
+{
+    if (handle == invalid) {
+        return;
+    }
+#if defined(_WIN32)
+    ::shutdown(handle, SD_BOTH);
+#else
+    ::shutdown(handle, SHUT_RDWR);
+#endif
+}
+
+void w::Socket::Close() noexcept
+{
+    if (handle == invalid) {
+        return;
+    }
+#if defined(_WIN32)
+    ::closesocket(handle);
+#else
+    ::close(handle);
+#endif
+    handle = invalid;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "consts.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace w {
+// Blocking TCP socket, errors throw w::Exception
+class Socket
+{
+public:
+#if defined(_WIN32)
+    using Handle = uintptr_t;
+#else
+    using Handle = int;
+#endif
+
+public:
+    Socket() = default;
+    explicit Socket(Handle handle) noexcept
+        : handle(handle)
+    {
+    }
+    Socket(Socket&& o) noexcept
+        : handle(std::exchange(o.handle, invalid))
+    {
+    }
+    Socket& operator=(Socket&& o) noexcept
+    {
+        if (this != &o) {
+            Close();
+            handle = std::exchange(o.handle, invalid);
+        }
+        return *this;
+    }
+    ~Socket()
+    {
+        Close();
+    }
+
+public:
+    // port 0 picks a free one, see Port()
+    static Socket Listen(uint16_t port, bool loopback_only = true);
+    static Socket Connect(const std::string& host, uint16_t port);
+    // address is host:port
+    static Socket Connect(std::string_view address);
+
+    Socket Accept();
+    uint16_t Port() const;
+    // true if a read (or an Accept) would not block
+    bool WaitReadable(uint32_t timeout_ms) const;
+    // recv fails after this many seconds without data, 0 waits forever
+    void SetReceiveTimeout(uint32_t seconds);
+
+    void SendAll(std::span<const std::byte> data);
+    // false if the peer closed the connection before the first byte
+    bool ReceiveAll(std::span<std::byte> data);
+
+    // a packet is a header of type and payload size followed by the payload
+    void SendPacket(uint32_t type, std::span<const std::byte> payload = {});
+    // nullopt if the peer closed the connection between messages
+    std::optional<uint32_t> ReceivePacket(std::vector<std::byte>& payload);
+
+    // wakes up a receive blocked on another thread, the socket stays open until Close()
+    void Shutdown() noexcept;
+    void Close() noexcept;
+    explicit operator bool() const noexcept
+    {
+        return handle != invalid;
+    }
+
+private:
+#if defined(_WIN32)
+    static constexpr Handle invalid = ~Handle(0);
+#else
+    static constexpr Handle invalid = -1;
+#endif
+    Handle handle = invalid;
+};
+
+// Packet payloads are raw trivially copyable structs, both ends are the same build
+template<typename T>
+void AppendPod(std::vector<std::byte>& out, std::span<const T> data)
+{
+    auto bytes = std::as_bytes(data);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+template<typename T>
+void AppendPod(std::vector<std::byte>& out, const T& data)
+{
+    AppendPod(out, std::span{ &data, 1 });
+}
+// reads a T from the front of in and advances it
+template<typename T>
+T ReadPod(std::span<const std::byte>& in)
+{
+    if (in.size() < sizeof(T)) {
+        throw w::Exception("Truncated packet");
+    }
+    T value;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in = in.subspan(sizeof(T));
+    return value;
+}
+} // namespace w
@@ -0,0 +1,317 @@
+#include "offset_allocator.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+constexpr uint32_t mantissa_bits = 3;
+constexpr uint32_t mantissa_value = 1 << mantissa_bits;
+constexpr uint32_t mantissa_mask = mantissa_value - 1;
+
+// Bin sizes follow a floating point distribution
+uint32_t UintToFloatRoundUp(uint32_t size) noexcept
+{
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+
+    if (size < mantissa_value) {
+        mantissa = size; // denorm: 0..7
+    } else {
+        uint32_t highest_set_bit = 31 - std::countl_zero(size);
+        uint32_t mantissa_start_bit = highest_set_bit - mantissa_bits;
+        exp = mantissa_start_bit + 1;
+        mantissa = (size >> mantissa_start_bit) & mantissa_mask;
+
+        uint32_t low_bits_mask = (1u << mantissa_start_bit) - 1;
+        if ((size & low_bits_mask) != 0) {
+            mantissa++; // overflow carries to exponent
+        }
+    }
+    return (exp << mantissa_bits) + mantissa;
+}
+
+uint32_t UintToFloatRoundDown(uint32_t size) noexcept
+{
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+
+    if (size < mantissa_value) {
+        mantissa = size;
+    } else {
+        uint32_t highest_set_bit = 31 - std::countl_zero(size);
+        uint32_t mantissa_start_bit = highest_set_bit - mantissa_bits;
+        exp = mantissa_start_bit + 1;
+        mantissa = (size >> mantissa_start_bit) & mantissa_mask;
+    }
+    return (exp << mantissa_bits) | mantissa;
+}
+
+uint32_t FloatToUint(uint32_t float_value) noexcept
+{
+    uint32_t exponent = float_value >> mantissa_bits;
+    uint32_t mantissa = float_value & mantissa_mask;
+    return exponent == 0
+            ? mantissa
+            : (mantissa | mantissa_value) << (exponent - 1);
+}
+
+uint32_t FindLowestSetBitAfter(uint32_t bit_mask, uint32_t start_bit_index) noexcept
+{
+    if (start_bit_index >= 32) {
+        return 0xFFFFFFFF;
+    }
+    uint32_t mask_before_start = (1u << start_bit_index) - 1;
+    uint32_t bits_after = bit_mask & ~mask_before_start;
+    return bits_after == 0 ? 0xFFFFFFFF : uint32_t(std::countr_zero(bits_after));
+}
+} // namespace
+
+w::OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t max_allocations)
+    : size(size), max_allocations(max_allocations)
+{
+    Reset();
+}
+
+void w::OffsetAllocator::Reset()
+{
+    free_storage = 0;
+    used_bins_top = 0;
+    free_offset = max_allocations - 1;
+
+    for (auto& bin : used_bins) {
+        bin = 0;
+    }
+    for (auto& index : bin_indices) {
+        index = unused;
+    }
+
+    nodes.assign(max_allocations, Node{});
+    free_nodes.resize(max_allocations);
+
+    // freelist is a stack, nodes in inverse order so that the first pop gives node 0
+    for (uint32_t i = 0; i < max_allocations; i++) {
+        free_nodes[i] = max_allocations - i - 1;
+    }
+
+    // start state: whole storage as one big node
+    InsertNodeIntoBin(size, 0);
+}
+
+w::OffsetAllocator::Allocation w::OffsetAllocator::Allocate(uint32_t alloc_size) noexcept
+{
+    // out of nodes, a split needs one more
+    if (free_offset == 0 || alloc_size == 0) {
+        return {};
+    }
+
+    // round up to bin index to ensure that the allocation is at least as big as the bin
+    uint32_t min_bin_index = UintToFloatRoundUp(alloc_size);
+    uint32_t min_top_bin_index = min_bin_index >> mantissa_bits;
+    uint32_t min_leaf_bin_index = min_bin_index & mantissa_mask;
+
+    uint32_t top_bin_index = min_top_bin_index;
+    uint32_t leaf_bin_index = no_space;
+
+    // if top bin exists, scan its leaf bin, this can fail
+    if (min_top_bin_index < top_bins && (used_bins_top & (1u << top_bin_index))) {
+        leaf_bin_index = FindLowestSetBitAfter(used_bins[top_bin_index], min_leaf_bin_index);
+    }
+
+    // otherwise take the first leaf of the next non-empty top bin, always a fit
+    if (leaf_bin_index == no_space) {
+        top_bin_index = FindLowestSetBitAfter(used_bins_top, min_top_bin_index + 1);
+        if (top_bin_index == no_space) {
+            return {};
+        }
+        leaf_bin_index = uint32_t(std::countr_zero(uint32_t(used_bins[top_bin_index])));
+    }
+
+    uint32_t bin_index = (top_bin_index << mantissa_bits) | leaf_bin_index;
+
+    // pop the top node of the bin, bin top = node.next
+    uint32_t node_index = bin_indices[bin_index];
+    Node& node = nodes[node_index];
+    uint32_t node_total_size = node.data_size;
+    node.data_size = alloc_size;
+    node.used = true;
+    bin_indices[bin_index] = node.bin_list_next;
+    if (node.bin_list_next != unused) {
+        nodes[node.bin_list_next].bin_list_prev = unused;
+    }
+    free_storage -= node_total_size;
+
+    // bin empty?
+    if (bin_indices[bin_index] == unused) {
+        used_bins[top_bin_index] &= ~(1u << leaf_bin_index);
+        if (used_bins[top_bin_index] == 0) {
+            used_bins_top &= ~(1u << top_bin_index);
+        }
+    }
+
+    // push back the remainder into a bin
+    uint32_t remainder_size = node_total_size - alloc_size;
+    if (remainder_size > 0) {
+        uint32_t new_node_index = InsertNodeIntoBin(remainder_size, node.data_offset + alloc_size);
+
+        // link nodes next to each other so that we can merge them later if both are free
+        Node& allocated = nodes[node_index];
+        if (allocated.neighbor_next != unused) {
+            nodes[allocated.neighbor_next].neighbor_prev = new_node_index;
+        }
+        nodes[new_node_index].neighbor_prev = node_index;
+        nodes[new_node_index].neighbor_next = allocated.neighbor_next;
+        allocated.neighbor_next = new_node_index;
+    }
+
+    return { nodes[node_index].data_offset, node_index };
+}
+
+void w::OffsetAllocator::Free(Allocation allocation) noexcept
+{
+    if (allocation.metadata == no_space) {
+        return;
+    }
+
+    uint32_t node_index = allocation.metadata;
+    Node& node = nodes[node_index];
+
+    // merge with free neighbors
+    uint32_t offset = node.data_offset;
+    uint32_t node_size = node.data_size;
+
+    if (node.neighbor_prev != unused && !nodes[node.neighbor_prev].used) {
+        Node& prev = nodes[node.neighbor_prev];
+        offset = prev.data_offset;
+        node_size += prev.data_size;
+
+        RemoveNodeFromBin(node.neighbor_prev);
+        node.neighbor_prev = prev.neighbor_prev;
+    }
+
+    if (node.neighbor_next != unused && !nodes[node.neighbor_next].used) {
+        Node& next = nodes[node.neighbor_next];
+        node_size += next.data_size;
+
+        RemoveNodeFromBin(node.neighbor_next);
+        node.neighbor_next = next.neighbor_next;
+    }
+
+    uint32_t neighbor_next = node.neighbor_next;
+    uint32_t neighbor_prev = node.neighbor_prev;
+
+    // insert the removed node to freelist
+    free_nodes[++free_offset] = node_index;
+
+    // insert the (combined) free node to bin
+    uint32_t combined_node_index = InsertNodeIntoBin(node_size, offset);
+
+    // connect neighbors with the new combined node
+    if (neighbor_next != unused) {
+        nodes[combined_node_index].neighbor_next = neighbor_next;
+        nodes[neighbor_next].neighbor_prev = combined_node_index;
+    }
+    if (neighbor_prev != unused) {
+        nodes[combined_node_index].neighbor_prev = neighbor_prev;
+        nodes[neighbor_prev].neighbor_next = combined_node_index;
+    }
+}
+
+uint32_t w::OffsetAllocator::InsertNodeIntoBin(uint32_t node_size, uint32_t data_offset) noexcept
+{
+    // round down to bin index to ensure that bin >= alloc
+    uint32_t bin_index = UintToFloatRoundDown(node_size);
+    uint32_t top_bin_index = bin_index >> mantissa_bits;
+    uint32_t leaf_bin_index = bin_index & mantissa_mask;
+
+    // bin was empty before?
+    if (bin_indices[bin_index] == unused) {
+        used_bins[top_bin_index] |= 1u << leaf_bin_index;
+        used_bins_top |= 1u << top_bin_index;
+    }
+
+    // take a freelist node and insert on top of the bin linked list (next = old top)
+    uint32_t top_node_index = bin_indices[bin_index];
+    uint32_t node_index = free_nodes[free_offset--];
+    nodes[node_index] = { .data_offset = data_offset, .data_size = node_size, .bin_list_next = top_node_index };
+    if (top_node_index != unused) {
+        nodes[top_node_index].bin_list_prev = node_index;
+    }
+    bin_indices[bin_index] = node_index;
+
+    free_storage += node_size;
+    return node_index;
+}
+
+void w::OffsetAllocator::RemoveNodeFromBin(uint32_t node_index) noexcept
+{
+    Node& node = nodes[node_index];
+
+    if (node.bin_list_prev != unused) {
+        // easy case: we have previous node, just remove this node from the middle of the list
+        nodes[node.bin_list_prev].bin_list_next = node.bin_list_next;
+        if (node.bin_list_next != unused) {
+            nodes[node.bin_list_next].bin_list_prev = node.bin_list_prev;
+        }
+    } else {
+        // hard case: we are the first node in a bin, find the bin
+        uint32_t bin_index = UintToFloatRoundDown(node.data_size);
+        uint32_t top_bin_index = bin_index >> mantissa_bits;
+        uint32_t leaf_bin_index = bin_index & mantissa_mask;
+
+        bin_indices[bin_index] = node.bin_list_next;
+        if (node.bin_list_next != unused) {
+            nodes[node.bin_list_next].bin_list_prev = unused;
+        }
+
+        // bin empty?
+        if (bin_indices[bin_index] == unused) {
+            used_bins[top_bin_index] &= ~(1u << leaf_bin_index);
+            if (used_bins[top_bin_index] == 0) {
+                used_bins_top &= ~(1u << top_bin_index);
+            }
+        }
+    }
+
+    // insert the node to freelist
+    free_nodes[++free_offset] = node_index;
+    free_storage -= node.data_size;
+}
+
+uint32_t w::OffsetAllocator::AllocationSize(Allocation allocation) const noexcept
+{
+    return allocation.metadata == no_space ? 0 : nodes[allocation.metadata].data_size;
+}
+
+w::OffsetAllocator::StorageReport w::OffsetAllocator::Report() const noexcept
+{
+    StorageReport report{ .total_free = free_storage };
+    if (free_offset == 0) { // out of nodes, nothing can be allocated
+        report.total_free = 0;
+        return report;
+    }
+
+    // exact largest region: walk the highest non-empty bin, it holds sizes in [bin, next bin)
+    if (used_bins_top) {
+        uint32_t top_bin_index = 31 - std::countl_zero(used_bins_top);
+        uint32_t leaf_bin_index = 31 - std::countl_zero(uint32_t(used_bins[top_bin_index]));
+        uint32_t bin_index = (top_bin_index << mantissa_bits) | leaf_bin_index;
+        for (uint32_t n = bin_indices[bin_index]; n != unused; n = nodes[n].bin_list_next) {
+            report.largest_free = std::max(report.largest_free, nodes[n].data_size);
+        }
+        if (report.largest_free == 0) {
+            report.largest_free = FloatToUint(bin_index);
+        }
+    }
+
+    for (uint32_t bin = 0; bin < leaf_bins; bin++) {
+        for (uint32_t n = bin_indices[bin]; n != unused; n = nodes[n].bin_list_next) {
+            report.free_regions++;
+        }
+    }
+    return report;
+}
+
+float w::OffsetAllocator::Fragmentation() const noexcept
+{
+    auto report = Report();
+    return report.total_free == 0 ? 0.0f : 1.0f - float(report.largest_free) / float(report.total_free);
+}
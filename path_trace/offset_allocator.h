@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace w {
+// O(1) two level segregated fit allocator over an abstract range of units.
+// Keeps no memory of its own, offsets are mapped onto GPU heaps by the caller.
+// Bins follow a small float (5 bit exponent, 3 bit mantissa), 256 bins cover the full uint32 range
+// with <12.5% rounding waste. Free neighbors are coalesced on Free.
+class OffsetAllocator
+{
+public:
+    static constexpr uint32_t no_space = 0xFFFFFFFF;
+    static constexpr uint32_t top_bins = 32;
+    static constexpr uint32_t bins_per_leaf = 8;
+    static constexpr uint32_t leaf_bins = top_bins * bins_per_leaf;
+
+    struct Allocation {
+        uint32_t offset = no_space;
+        uint32_t metadata = no_space; // node index
+
+        bool Valid() const noexcept
+        {
+            return offset != no_space;
+        }
+    };
+
+    struct StorageReport {
+        uint32_t total_free = 0;
+        uint32_t largest_free = 0;
+        uint32_t free_regions = 0;
+    };
+
+public:
+    OffsetAllocator() = default;
+    OffsetAllocator(uint32_t size, uint32_t max_allocations = 128 * 1024);
+
+public:
+    Allocation Allocate(uint32_t size) noexcept;
+    void Free(Allocation allocation) noexcept;
+    void Reset();
+
+    uint32_t AllocationSize(Allocation allocation) const noexcept;
+    StorageReport Report() const noexcept;
+    // 0 - all free space is one region, close to 1 - free space is scattered in small holes
+    float Fragmentation() const noexcept;
+
+    uint32_t Size() const noexcept
+    {
+        return size;
+    }
+    uint32_t FreeStorage() const noexcept
+    {
+        return free_storage;
+    }
+
+private:
+    uint32_t InsertNodeIntoBin(uint32_t size, uint32_t offset) noexcept;
+    void RemoveNodeFromBin(uint32_t node_index) noexcept;
+
+private:
+    static constexpr uint32_t unused = 0xFFFFFFFF;
+
+    struct Node {
+        uint32_t data_offset = 0;
+        uint32_t data_size = 0;
+        uint32_t bin_list_prev = unused;
+        uint32_t bin_list_next = unused;
+        uint32_t neighbor_prev = unused;
+        uint32_t neighbor_next = unused;
+        bool used = false;
+    };
+
+    uint32_t size = 0;
+    uint32_t max_allocations = 0;
+    uint32_t free_storage = 0;
+
+    uint32_t used_bins_top = 0;
+    uint8_t used_bins[top_bins]{};
+    uint32_t bin_indices[leaf_bins]{};
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t free_offset = 0;
+};
+} // namespace w
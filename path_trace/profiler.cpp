@@ -0,0 +1,249 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <imgui.h>
+#include <string_view>
+#include <thread>
+
+namespace {
+// returns the ring to the profiler when its thread exits, worker pools reuse it
+struct LocalBuffer {
+    w::prof::ThreadBuffer* buffer = nullptr;
+    ~LocalBuffer()
+    {
+        if (buffer) {
+            w::prof::Profiler::Get().Release(*buffer);
+        }
+    }
+};
+thread_local LocalBuffer local;
+
+void WriteEscaped(std::ostream& out, const char* str)
+{
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            out << '\\';
+        }
+        out << *str;
+    }
+}
+
+ImU32 NameColor(const char* name)
+{
+    // stable color per scope name, muted so the labels stay readable
+    size_t hash = std::hash<std::string_view>{}(name);
+    return IM_COL32(90 + hash % 120, 90 + (hash >> 8) % 120, 90 + (hash >> 16) % 120, 255);
+}
+} // namespace
+
+void w::prof::ThreadBuffer::Collect(uint64_t begin, uint64_t end, std::vector<Event>& out) const
+{
+    uint64_t count = written.load(std::memory_order_acquire);
+    uint64_t first = count > capacity ? count - capacity : 0;
+    for (uint64_t i = first; i < count; i++) {
+        const Slot& slot = slots[i & (capacity - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * i + 2) { // being rewritten, or already by a later lap
+            continue;
+        }
+        Event event{
+            .name = slot.name.load(std::memory_order_relaxed),
+            .begin = slot.begin.load(std::memory_order_relaxed),
+            .end = slot.end.load(std::memory_order_relaxed),
+            .depth = slot.depth.load(std::memory_order_relaxed),
+        };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        if (event.end > begin && event.begin < end) {
+            out.push_back(event);
+        }
+    }
+}
+
+w::prof::Profiler& w::prof::Profiler::Get() noexcept
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+w::prof::Profiler::Profiler()
+{
+    // calibrate the timestamp counter against the steady clock
+    using namespace std::chrono;
+    auto wall_begin = steady_clock::now();
+    uint64_t ticks_begin = Ticks();
+    std::this_thread::sleep_for(milliseconds(10));
+    uint64_t ticks_end = Ticks();
+    auto wall_end = steady_clock::now();
+
+    ms_per_tick = duration<double, std::milli>(wall_end - wall_begin).count() / double(ticks_end - ticks_begin);
+    epoch = ticks_begin;
+}
+
+w::prof::ThreadBuffer& w::prof::Profiler::Local()
+{
+    if (!local.buffer) {
+        std::scoped_lock lock{ threads_mutex };
+        if (free_threads.empty()) {
+            threads.push_back(std::make_unique<ThreadBuffer>(uint32_t(threads.size())));
+            local.buffer = threads.back().get();
+        } else {
+            local.buffer = threads[free_threads.back()].get();
+            free_threads.pop_back();
+        }
+    }
+    return *local.buffer;
+}
+
+void w::prof::Profiler::Release(ThreadBuffer& buffer)
+{
+    std::scoped_lock lock{ threads_mutex };
+    buffer.depth = 0;
+    free_threads.push_back(buffer.thread_id);
+}
+
+void w::prof::Profiler::SetThreadName(std::string name)
+{
+    auto& buffer = Local();
+    std::scoped_lock lock{ threads_mutex };
+    buffer.name = std::move(name);
+}
+
+const char* w::prof::Profiler::Intern(std::string_view name)
+{
+    std::scoped_lock lock{ names_mutex };
+    return names.emplace(name).first->c_str();
+}
+
+void w::prof::Profiler::MarkFrame() noexcept
+{
+    uint64_t index = frame_count.load(std::memory_order_relaxed);
+    frames[index % frame_history] = Ticks();
+    frame_count.store(index + 1, std::memory_order_release);
+}
+
+std::pair<uint64_t, uint64_t> w::prof::Profiler::LastFrame() const noexcept
+{
+    uint64_t count = frame_count.load(std::memory_order_acquire);
+    if (count < 2) {
+        return {};
+    }
+    return { frames[(count - 2) % frame_history], frames[(count - 1) % frame_history] };
+}
+
+std::vector<w::prof::ThreadEvents> w::prof::Profiler::Collect(uint64_t begin, uint64_t end) const
+{
+    std::vector<ThreadEvents> result;
+    std::scoped_lock lock{ threads_mutex };
+    for (auto& thread : threads) {
+        ThreadEvents thread_events{ thread->thread_id, thread->name };
+        thread->Collect(begin, end, thread_events.events);
+        if (!thread_events.events.empty()) {
+            std::ranges::sort(thread_events.events, {}, &Event::begin);
+            result.push_back(std::move(thread_events));
+        }
+    }
+    return result;
+}
+
+bool w::prof::Profiler::WriteChromeTrace(const std::filesystem::path& path) const
+{
+    std::ofstream out{ path };
+    if (!out) {
+        return false;
+    }
+
+    auto us = [this](uint64_t ticks) { return TicksToMilliseconds(ticks) * 1000.0; };
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"traceEvents\":[";
+    for (auto& thread : Collect(0, ~0ull)) {
+        if (!thread.name.empty()) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.thread_id << ",\"args\":{\"name\":\"";
+            WriteEscaped(out, thread.name.c_str());
+            out << "\"}}";
+        }
+        for (auto& event : thread.events) {
+            separator();
+            out << "{\"name\":\"";
+            WriteEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.thread_id
+                << ",\"ts\":" << us(event.begin - epoch)
+                << ",\"dur\":" << us(event.end - event.begin) << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return bool(out);
+}
+
+void w::prof::Profiler::RenderUI()
+{
+    ImGui::Begin("Profiler", nullptr);
+
+    bool on = enabled.load(std::memory_order_relaxed);
+    if (ImGui::Checkbox("Enabled", &on)) {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        WriteChromeTrace("trace.json");
+    }
+
+    if (!paused) {
+        shown_frame = LastFrame();
+    }
+    auto [frame_begin, frame_end] = shown_frame;
+    if (frame_end <= frame_begin) {
+        ImGui::End();
+        return;
+    }
+
+    double frame_ms = TicksToMilliseconds(frame_end - frame_begin);
+    ImGui::Text("Frame: %.3f ms", frame_ms);
+
+    // flame view: one lane per thread, one row per nesting depth
+    constexpr float row_height = 18.0f;
+    ImDrawList* draw = ImGui::GetWindowDrawList();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    float scale = width / float(frame_end - frame_begin);
+
+    for (auto& thread : Collect(frame_begin, frame_end)) {
+        ImGui::TextUnformatted(thread.name.empty() ? "thread" : thread.name.c_str());
+
+        uint32_t max_depth = 0;
+        for (auto& event : thread.events) {
+            max_depth = std::max(max_depth, event.depth);
+        }
+
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        for (auto& event : thread.events) {
+            uint64_t begin = std::max(event.begin, frame_begin);
+            uint64_t end = std::min(event.end, frame_end);
+            ImVec2 min{ origin.x + float(begin - frame_begin) * scale, origin.y + float(event.depth) * row_height };
+            ImVec2 max{ std::max(origin.x + float(end - frame_begin) * scale, min.x + 1.0f), min.y + row_height - 1.0f };
+
+            draw->AddRectFilled(min, max, NameColor(event.name));
+            if (max.x - min.x > 30.0f) {
+                draw->PushClipRect(min, max, true);
+                draw->AddText({ min.x + 2.0f, min.y + 1.0f }, IM_COL32_WHITE, event.name);
+                draw->PopClipRect();
+            }
+            if (ImGui::IsMouseHoveringRect(min, max)) {
+                ImGui::SetTooltip("%s: %.3f ms", event.name, TicksToMilliseconds(event.end - event.begin));
+            }
+        }
+        ImGui::Dummy({ width, float(max_depth + 1) * row_height });
+    }
+    ImGui::End();
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Scoped CPU timers, compiled out unless W_PROFILE is defined (PATH_TRACER_PROFILE option)
+#if defined(W_PROFILE)
+#define W_PROFILE_CONCAT_IMPL(a, b) a##b
+#define W_PROFILE_CONCAT(a, b) W_PROFILE_CONCAT_IMPL(a, b)
+#define W_PROFILE_SCOPE(name) ::w::prof::Scope W_PROFILE_CONCAT(profile_scope_, __LINE__){ name }
+#define W_PROFILE_SCOPE_STRING(name) W_PROFILE_SCOPE(::w::prof::Profiler::Get().Intern(name)) // for names that are not literals
+#define W_PROFILE_FUNCTION() W_PROFILE_SCOPE(__func__)
+#define W_PROFILE_THREAD(name) ::w::prof::Profiler::Get().SetThreadName(name)
+#define W_PROFILE_FRAME() ::w::prof::Profiler::Get().MarkFrame()
+#else
+#define W_PROFILE_SCOPE(name) ((void)0)
+#define W_PROFILE_SCOPE_STRING(name) ((void)0)
+#define W_PROFILE_FUNCTION() ((void)0)
+#define W_PROFILE_THREAD(name) ((void)0)
+#define W_PROFILE_FRAME() ((void)0)
+#endif
+
+namespace w::prof {
+inline uint64_t Ticks() noexcept
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Completed scope, names are string literals or interned with Profiler::Intern, they outlive every event
+struct Event {
+    const char* name = nullptr;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    uint32_t depth = 0;
+};
+
+// Single producer ring owned by one thread, old events are overwritten.
+// Every slot is a seqlock, so readers on other threads skip a slot the owner is rewriting instead of tearing it.
+class ThreadBuffer
+{
+public:
+    static constexpr uint32_t capacity = 1 << 15;
+
+public:
+    ThreadBuffer(uint32_t thread_id)
+        : slots(std::make_unique<Slot[]>(capacity)), thread_id(thread_id)
+    {
+    }
+
+public:
+    void Push(const Event& event) noexcept
+    {
+        uint64_t index = written.load(std::memory_order_relaxed);
+        Slot& slot = slots[index & (capacity - 1)];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(event.name, std::memory_order_relaxed);
+        slot.begin.store(event.begin, std::memory_order_relaxed);
+        slot.end.store(event.end, std::memory_order_relaxed);
+        slot.depth.store(event.depth, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        written.store(index + 1, std::memory_order_release);
+    }
+    // copies events that ended within [begin, end), slots the owner is rewriting are skipped
+    void Collect(uint64_t begin, uint64_t end, std::vector<Event>& out) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence = 0; // 2 * (index + 1) once event index is complete, odd while it is written
+        std::atomic<const char*> name = nullptr;
+        std::atomic<uint64_t> begin = 0;
+        std::atomic<uint64_t> end = 0;
+        std::atomic<uint32_t> depth = 0;
+    };
+    std::unique_ptr<Slot[]> slots;
+
+public:
+    std::atomic<uint64_t> written = 0;
+    uint32_t thread_id = 0;
+    uint32_t depth = 0; // owner thread only
+    std::string name;
+};
+
+struct ThreadEvents {
+    uint32_t thread_id = 0;
+    std::string name;
+    std::vector<Event> events;
+};
+
+class Profiler
+{
+public:
+    static constexpr uint32_t frame_history = 256;
+
+public:
+    static Profiler& Get() noexcept;
+
+public:
+    ThreadBuffer& Local();
+    void Release(ThreadBuffer& buffer);
+    void SetThreadName(std::string name);
+    // stable copy of name for the lifetime of the profiler, equal names share one
+    const char* Intern(std::string_view name);
+
+    void MarkFrame() noexcept;
+    // bounds of the last completed frame in ticks
+    std::pair<uint64_t, uint64_t> LastFrame() const noexcept;
+    std::vector<ThreadEvents> Collect(uint64_t begin, uint64_t end) const;
+
+    double TicksToMilliseconds(uint64_t ticks) const noexcept
+    {
+        return double(ticks) * ms_per_tick;
+    }
+
+    // Chrome trace / Perfetto JSON of everything still held in the rings
+    bool WriteChromeTrace(const std::filesystem::path& path) const;
+    void RenderUI();
+
+public:
+    std::atomic<bool> enabled = true;
+
+private:
+    Profiler();
+
+private:
+    double ms_per_tick = 0.0;
+    uint64_t epoch = 0;
+
+    mutable std::mutex threads_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    std::vector<uint32_t> free_threads;
+
+    std::mutex names_mutex;
+    std::unordered_set<std::string> names; // nodes never move
+
+    uint64_t frames[frame_history]{};
+    std::atomic<uint64_t> frame_count = 0;
+
+    bool paused = false;
+    std::pair<uint64_t, uint64_t> shown_frame{};
+};
+
+class Scope
+{
+public:
+    Scope(const char* name) noexcept
+    {
+        auto& profiler = Profiler::Get();
+        if (profiler.enabled.load(std::memory_order_relaxed)) {
+            buffer = &profiler.Local();
+            event = { name, Ticks(), 0, buffer->depth++ };
+        }
+    }
+    ~Scope()
+    {
+        if (buffer) {
+            event.end = Ticks();
+            buffer->depth--;
+            buffer->Push(event);
+        }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    ThreadBuffer* buffer = nullptr;
+    Event event;
+};
+} // namespace w::prof
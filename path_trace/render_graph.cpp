@@ -0,0 +1,79 @@
+#include "render_graph.h"
+#include "graphics.h"
+
+void w::GpuGraphBackend::Barriers(CommandList& cmd_list, std::span<const RGResolvedBarrier<Texture>> textures, std::span<const RGResolvedBarrier<Buffer>> buffers)
+{
+    constexpr size_t max_batch = 16;
+    wis::TextureBarrier2 texture_barriers[max_batch]{};
+    wis::BufferBarrier2 buffer_barriers[max_batch]{};
+
+    for (size_t first = 0; first < textures.size(); first += max_batch) {
+        size_t count = std::min(max_batch, textures.size() - first);
+        for (size_t i = 0; i < count; i++) {
+            auto& b = textures[first + i];
+            texture_barriers[i] = { .barrier = { .sync_before = b.before.sync,
+                                                 .sync_after = b.after.sync,
+                                                 .access_before = b.before.access,
+                                                 .access_after = b.after.access,
+                                                 .state_before = b.before.layout,
+                                                 .state_after = b.after.layout },
+                                    .texture = *b.resource };
+        }
+        cmd_list.TextureBarriers(texture_barriers, uint32_t(count));
+    }
+    for (size_t first = 0; first < buffers.size(); first += max_batch) {
+        size_t count = std::min(max_batch, buffers.size() - first);
+        for (size_t i = 0; i < count; i++) {
+            auto& b = buffers[first + i];
+            buffer_barriers[i] = { .barrier = { .sync_before = b.before.sync,
+                                                .sync_after = b.after.sync,
+                                                .access_before = b.before.access,
+                                                .access_after = b.after.access },
+                                   .buffer = *b.resource };
+        }
+        cmd_list.BufferBarriers(buffer_barriers, uint32_t(count));
+    }
+}
+
+w::RGMemoryInfo w::GpuGraphBackend::TextureMemory(const RGTextureDesc& desc) const
+{
+    auto info = gfx.GetAllocator().GetTextureAllocationInfo({
+            .format = desc.format,
+            .size = { desc.width, desc.height, 1 },
+            .usage = desc.usage,
+    });
+    return { info.size_bytes, info.alignment_bytes };
+}
+
+void w::GpuGraphBackend::Realize(uint64_t heap_size, std::span<const RGTransient> transients)
+{
+    if (std::ranges::equal(transients, realized) && heap_size <= heap_capacity) {
+        return;
+    }
+
+    // placement changes with resolution or graph shape, frames in flight may still use the old heap
+    using namespace wis; // for flag operators
+    wis::Result result = wis::success;
+    gfx.WaitForGpu();
+    textures.clear();
+
+    if (heap_size > heap_capacity) {
+        wis::TextureUsage usage = wis::TextureUsage::None;
+        for (auto& t : transients) {
+            usage = usage | t.desc.usage;
+        }
+        heap = gfx.GetAllocator().AllocateTextureMemory(result, heap_size, usage);
+        CheckResult(result);
+        heap_capacity = heap_size;
+    }
+
+    for (auto& t : transients) {
+        textures.push_back(gfx.GetAllocator().PlaceTexture(result, heap, t.offset, {
+                                                                                         .format = t.desc.format,
+                                                                                         .size = { t.desc.width, t.desc.height, 1 },
+                                                                                         .usage = t.desc.usage,
+                                                                                 }));
+        CheckResult(result);
+    }
+    realized.assign(transients.begin(), transients.end());
+}
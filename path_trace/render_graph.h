@@ -0,0 +1,468 @@
+#pragma once
+#include "consts.h"
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace w {
+class Graphics;
+
+// How a pass touches a resource, one usage per resource per pass
+enum class RGUsage : uint8_t {
+    RaytracingStorage, // RWTexture written by DispatchRays
+    PixelStorageRead, // RWTexture read by a pixel shader
+    CopySource,
+    CopyDest,
+    RenderTarget,
+    Present,
+    BuildAccelerationStructure,
+    ReadAccelerationStructure,
+};
+
+// Tracked state of a resource between passes, layout is ignored for buffers
+struct RGState {
+    wis::BarrierSync sync = wis::BarrierSync::None;
+    wis::ResourceAccess access = wis::ResourceAccess::NoAccess;
+    wis::TextureState layout = wis::TextureState::Undefined;
+
+    bool operator==(const RGState&) const = default;
+};
+
+constexpr bool IsWrite(RGUsage usage) noexcept
+{
+    switch (usage) {
+    case RGUsage::RaytracingStorage:
+    case RGUsage::CopyDest:
+    case RGUsage::RenderTarget:
+    case RGUsage::BuildAccelerationStructure:
+        return true;
+    default:
+        return false;
+    }
+}
+
+constexpr RGState StateOf(RGUsage usage) noexcept
+{
+    using enum wis::BarrierSync;
+    switch (usage) {
+    case RGUsage::RaytracingStorage:
+        return { Raytracing, wis::ResourceAccess::UnorderedAccess, wis::TextureState::UnorderedAccess };
+    case RGUsage::PixelStorageRead:
+        return { PixelShading, wis::ResourceAccess::UnorderedAccess, wis::TextureState::UnorderedAccess };
+    case RGUsage::CopySource:
+        return { Copy, wis::ResourceAccess::CopySource, wis::TextureState::CopySource };
+    case RGUsage::CopyDest:
+        return { Copy, wis::ResourceAccess::CopyDest, wis::TextureState::CopyDest };
+    case RGUsage::RenderTarget:
+        return { RenderTarget, wis::ResourceAccess::RenderTarget, wis::TextureState::RenderTarget };
+    case RGUsage::Present:
+        return { None, wis::ResourceAccess::NoAccess, wis::TextureState::Present };
+    case RGUsage::BuildAccelerationStructure:
+        return { BuildRTAS, wis::ResourceAccess::AccelerationStructureWrite, wis::TextureState::Undefined };
+    case RGUsage::ReadAccelerationStructure:
+        return { Raytracing, wis::ResourceAccess::AccelerationStructureRead, wis::TextureState::Undefined };
+    }
+    return {};
+}
+
+struct RGResource {
+    static constexpr uint32_t invalid = 0xFFFFFFFF;
+    uint32_t id = invalid;
+
+    bool Valid() const noexcept
+    {
+        return id != invalid;
+    }
+};
+
+struct RGTextureDesc {
+    wis::DataFormat format = w::swap_format;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    wis::TextureUsage usage = wis::TextureUsage::None;
+
+    bool operator==(const RGTextureDesc&) const = default;
+};
+
+struct RGMemoryInfo {
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+};
+
+// Transient texture placed in the shared heap, alive for passes [first_pass, last_pass]
+struct RGTransient {
+    RGTextureDesc desc;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t first_pass = 0;
+    uint32_t last_pass = 0;
+
+    bool operator==(const RGTransient&) const = default;
+};
+
+struct RGBarrier {
+    RGResource resource;
+    RGState before;
+    RGState after;
+};
+
+template<typename Resource>
+struct RGResolvedBarrier {
+    const Resource* resource = nullptr;
+    RGState before;
+    RGState after;
+};
+
+// Frame graph of passes with declared reads and writes. Compile culls passes whose results are unused,
+// derives one merged barrier batch per pass from the tracked resource states and packs transient
+// textures with disjoint lifetimes into the same memory.
+// Backend provides the GPU side, so the scheduling can run against a mock:
+//   using CommandList, Texture, Buffer;
+//   void Barriers(CommandList&, std::span<const RGResolvedBarrier<Texture>>, std::span<const RGResolvedBarrier<Buffer>>);
+//   RGMemoryInfo TextureMemory(const RGTextureDesc&);
+//   void Realize(uint64_t heap_size, std::span<const RGTransient>);        (re)creates placed transients
+//   const Texture& Transient(uint32_t index) const;
+template<typename Backend>
+class BasicRenderGraph
+{
+public:
+    using CommandList = typename Backend::CommandList;
+    using Texture = typename Backend::Texture;
+    using Buffer = typename Backend::Buffer;
+    using ExecuteFn = std::function<void(CommandList&)>;
+
+    struct Use {
+        RGResource resource;
+        RGUsage usage;
+    };
+
+public:
+    template<typename... Args>
+    explicit BasicRenderGraph(Args&&... args)
+        : backend(std::forward<Args>(args)...)
+    {
+    }
+
+public:
+    // clears the declared frame, storage is kept for the next one
+    void Reset() noexcept
+    {
+        resources.clear();
+        passes.clear();
+        uses.clear();
+        barriers.clear();
+        final_barriers.clear();
+        transients.clear();
+        heap_size = 0;
+    }
+
+    // state is read at compile and receives the final state after Execute.
+    // Resources with a final usage are transitioned to it at the end of the graph.
+    RGResource ImportTexture(const Texture& texture, RGState& state, std::optional<RGUsage> final_usage = std::nullopt)
+    {
+        return AddResource({ .texture = &texture, .state = &state, .final_usage = final_usage });
+    }
+    RGResource ImportBuffer(const Buffer& buffer, RGState& state)
+    {
+        return AddResource({ .buffer = &buffer, .state = &state });
+    }
+    // memory is owned by the graph and may alias other transients, contents start undefined
+    RGResource CreateTexture(const RGTextureDesc& desc)
+    {
+        return AddResource({ .desc = desc, .transient = true });
+    }
+
+    void AddPass(std::string_view name, std::initializer_list<Use> pass_uses, ExecuteFn execute)
+    {
+        passes.push_back({ .name = std::string(name),
+                           .execute = std::move(execute),
+                           .first_use = uint32_t(uses.size()),
+                           .use_count = uint32_t(pass_uses.size()) });
+        uses.insert(uses.end(), pass_uses.begin(), pass_uses.end());
+    }
+
+    void Compile()
+    {
+        Cull();
+        DeriveBarriers();
+        PlaceTransients();
+    }
+
+    void Execute(CommandList& cmd_list)
+    {
+        if (!transients.empty()) {
+            backend.Realize(heap_size, transients);
+        }
+        for (auto& pass : passes) {
+            if (pass.culled) {
+                continue;
+            }
+            RecordBarriers(cmd_list, std::span{ barriers }.subspan(pass.first_barrier, pass.barrier_count));
+            pass.execute(cmd_list);
+        }
+        RecordBarriers(cmd_list, final_barriers);
+
+        for (auto& resource : resources) {
+            if (resource.state) {
+                *resource.state = resource.current;
+            }
+        }
+    }
+
+    // resolves a graph texture inside a pass body
+    const Texture& GetTexture(RGResource handle) const
+    {
+        auto& resource = resources[handle.id];
+        return resource.transient ? backend.Transient(resource.transient_index) : *resource.texture;
+    }
+
+public:
+    uint32_t PassCount() const noexcept
+    {
+        return uint32_t(passes.size());
+    }
+    std::string_view PassName(uint32_t pass) const noexcept
+    {
+        return passes[pass].name;
+    }
+    bool Culled(uint32_t pass) const noexcept
+    {
+        return passes[pass].culled;
+    }
+    std::span<const RGBarrier> BarriersBefore(uint32_t pass) const noexcept
+    {
+        return std::span{ barriers }.subspan(passes[pass].first_barrier, passes[pass].barrier_count);
+    }
+    std::span<const RGBarrier> FinalBarriers() const noexcept
+    {
+        return final_barriers;
+    }
+    std::span<const RGTransient> Transients() const noexcept
+    {
+        return transients;
+    }
+    uint64_t TransientHeapSize() const noexcept
+    {
+        return heap_size;
+    }
+    Backend& GetBackend() noexcept
+    {
+        return backend;
+    }
+
+private:
+    struct Resource {
+        const Texture* texture = nullptr;
+        const Buffer* buffer = nullptr;
+        RGState* state = nullptr;
+        std::optional<RGUsage> final_usage;
+        RGTextureDesc desc;
+        bool transient = false;
+
+        RGState current;
+        uint32_t transient_index = 0;
+        uint32_t first_pass = RGResource::invalid;
+        uint32_t last_pass = 0;
+    };
+    struct Pass {
+        std::string name;
+        ExecuteFn execute;
+        uint32_t first_use = 0;
+        uint32_t use_count = 0;
+        uint32_t first_barrier = 0;
+        uint32_t barrier_count = 0;
+        bool culled = false;
+    };
+
+    RGResource AddResource(Resource resource)
+    {
+        resources.push_back(std::move(resource));
+        return { uint32_t(resources.size() - 1) };
+    }
+    std::span<const Use> UsesOf(const Pass& pass) const noexcept
+    {
+        return std::span{ uses }.subspan(pass.first_use, pass.use_count);
+    }
+
+    // a pass survives if it writes an imported resource or something a surviving later pass reads
+    void Cull()
+    {
+        std::vector<bool> needed(resources.size());
+        for (auto it = passes.rbegin(); it != passes.rend(); ++it) {
+            bool writes = false;
+            bool alive = false;
+            for (auto& use : UsesOf(*it)) {
+                if (IsWrite(use.usage)) {
+                    writes = true;
+                    alive |= !resources[use.resource.id].transient || needed[use.resource.id];
+                }
+            }
+            it->culled = writes && !alive;
+            if (it->culled) {
+                continue;
+            }
+            for (auto& use : UsesOf(*it)) {
+                needed[use.resource.id] = needed[use.resource.id] || !IsWrite(use.usage);
+            }
+        }
+    }
+
+    void DeriveBarriers()
+    {
+        for (auto& resource : resources) {
+            resource.current = resource.state ? *resource.state : RGState{};
+        }
+
+        for (uint32_t p = 0; p < passes.size(); p++) {
+            auto& pass = passes[p];
+            pass.first_barrier = uint32_t(barriers.size());
+            if (pass.culled) {
+                continue;
+            }
+            for (auto& use : UsesOf(pass)) {
+                auto& resource = resources[use.resource.id];
+                resource.first_pass = std::min(resource.first_pass, p);
+                resource.last_pass = std::max(resource.last_pass, p);
+
+                // same state reads need nothing, repeated writes still need an execution dependency
+                // except render targets, which the rasterizer keeps in order
+                RGState after = StateOf(use.usage);
+                if (resource.current == after && (!IsWrite(use.usage) || use.usage == RGUsage::RenderTarget)) {
+                    continue;
+                }
+                barriers.push_back({ use.resource, resource.current, after });
+                resource.current = after;
+            }
+            pass.barrier_count = uint32_t(barriers.size()) - pass.first_barrier;
+        }
+
+        for (uint32_t i = 0; i < resources.size(); i++) {
+            auto& resource = resources[i];
+            if (!resource.final_usage) {
+                continue;
+            }
+            RGState after = StateOf(*resource.final_usage);
+            if (resource.current != after) {
+                final_barriers.push_back({ { i }, resource.current, after });
+                resource.current = after;
+            }
+        }
+    }
+
+    // greedy interval packing, largest first, lowest offset that does not overlap a live neighbor
+    void PlaceTransients()
+    {
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < resources.size(); i++) {
+            auto& resource = resources[i];
+            if (resource.transient && resource.first_pass != RGResource::invalid) {
+                resource.transient_index = uint32_t(transients.size());
+                auto memory = backend.TextureMemory(resource.desc);
+                transients.push_back({ .desc = resource.desc,
+                                       .size = memory.size,
+                                       .first_pass = resource.first_pass,
+                                       .last_pass = resource.last_pass });
+                order.push_back(uint32_t(transients.size() - 1));
+                alignments.push_back(memory.alignment);
+            }
+        }
+        std::ranges::stable_sort(order, [this](uint32_t a, uint32_t b) { return transients[a].size > transients[b].size; });
+
+        std::vector<uint32_t> placed;
+        for (uint32_t index : order) {
+            auto& t = transients[index];
+            auto overlaps = [&](const RGTransient& o) {
+                return t.first_pass <= o.last_pass && o.first_pass <= t.last_pass;
+            };
+
+            uint64_t offset = 0;
+            for (bool moved = true; moved;) {
+                moved = false;
+                for (uint32_t other : placed) {
+                    auto& o = transients[other];
+                    if (overlaps(o) && offset < o.offset + o.size && o.offset < offset + t.size) {
+                        offset = (o.offset + o.size + alignments[index] - 1) / alignments[index] * alignments[index];
+                        moved = true;
+                    }
+                }
+            }
+            t.offset = offset;
+            heap_size = std::max(heap_size, offset + t.size);
+            placed.push_back(index);
+        }
+        alignments.clear();
+    }
+
+    void RecordBarriers(CommandList& cmd_list, std::span<const RGBarrier> batch)
+    {
+        if (batch.empty()) {
+            return;
+        }
+        texture_batch.clear();
+        buffer_batch.clear();
+        for (auto& barrier : batch) {
+            auto& resource = resources[barrier.resource.id];
+            if (resource.buffer) {
+                buffer_batch.push_back({ resource.buffer, barrier.before, barrier.after });
+            } else {
+                texture_batch.push_back({ &GetTexture(barrier.resource), barrier.before, barrier.after });
+            }
+        }
+        backend.Barriers(cmd_list, texture_batch, buffer_batch);
+    }
+
+private:
+    Backend backend;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Use> uses;
+    std::vector<RGBarrier> barriers;
+    std::vector<RGBarrier> final_barriers;
+    std::vector<RGTransient> transients;
+    std::vector<uint64_t> alignments;
+    uint64_t heap_size = 0;
+
+    std::vector<RGResolvedBarrier<Texture>> texture_batch;
+    std::vector<RGResolvedBarrier<Buffer>> buffer_batch;
+};
+
+// Wisdom implementation of the render graph backend, transients are placed in one heap
+class GpuGraphBackend
+{
+public:
+    using CommandList = wis::CommandList;
+    using Texture = wis::Texture;
+    using Buffer = wis::Buffer;
+
+public:
+    explicit GpuGraphBackend(w::Graphics& gfx) noexcept
+        : gfx(gfx)
+    {
+    }
+
+public:
+    void Barriers(CommandList& cmd_list, std::span<const RGResolvedBarrier<Texture>> textures, std::span<const RGResolvedBarrier<Buffer>> buffers);
+    RGMemoryInfo TextureMemory(const RGTextureDesc& desc) const;
+    void Realize(uint64_t heap_size, std::span<const RGTransient> transients);
+    const Texture& Transient(uint32_t index) const noexcept
+    {
+        return textures[index];
+    }
+
+private:
+    w::Graphics& gfx;
+    wis::Memory heap;
+    uint64_t heap_capacity = 0;
+    std::vector<RGTransient> realized;
+    std::vector<wis::Texture> textures;
+};
+
+using RenderGraph = BasicRenderGraph<GpuGraphBackend>;
+} // namespace w
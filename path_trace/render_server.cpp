@@ -0,0 +1,531 @@
+#include "render_server.h"
+#include "net.h"
+#include "asset_loader.h"
+#include "cpu_tracer.h"
+#include "dynamic_resolution.h"
+#include "frame_codec.h"
+#include "profiler.h"
+#include "sample_scheduler.h"
+#include "temporal_reprojection.h"
+#include "uv_sphere.h"
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
+namespace {
+using steady_clock = std::chrono::steady_clock;
+
+enum class PacketType : uint32_t {
+    Hello, // server -> client on connect, Hello
+    Camera, // client -> server, update id, Camera::State
+    Settings, // client -> server, update id, Scene::RenderSettings
+    Frame, // server -> client, FrameHeader, changed tiles
+    Ack, // client -> server once a frame is shown, the server sends one frame at a time
+};
+
+struct Hello {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t samples; // the server stops refining at
+    w::Camera::State camera;
+    w::Scene::RenderSettings settings;
+};
+
+struct FrameHeader {
+    uint32_t frame; // rendered since the server started
+    uint32_t update; // id of the newest change of this client the frame shows
+    uint32_t samples; // per pixel
+    uint32_t dropped; // frames this client skipped since its previous one
+    uint32_t tile_count;
+    float latency_ms; // from receiving `update` to the first frame showing it, 0 on later frames
+};
+
+// a rendered frame, shared by all connections
+struct Frame {
+    w::DisplayImage image;
+    FrameHeader header{};
+};
+
+// changes received since the last frame started, latest values win
+struct PendingUpdate {
+    uint32_t id = 0;
+    std::optional<w::Camera::State> camera;
+    std::optional<w::Scene::RenderSettings> settings;
+    steady_clock::time_point received; // of the first change since the last frame
+};
+
+class RenderServer;
+
+class Connection
+{
+public:
+    Connection(w::Socket socket)
+        : socket(std::move(socket))
+    {
+    }
+
+public:
+    void Start(RenderServer& server, const Hello& hello, const w::TileCodec& codec);
+    // replaces a frame the client has not taken yet
+    void Publish(std::shared_ptr<const Frame> frame)
+    {
+        {
+            std::scoped_lock lock{ mutex };
+            dropped += latest != nullptr;
+            latest = std::move(frame);
+        }
+        ready.notify_one();
+    }
+    void Close() noexcept
+    {
+        {
+            std::scoped_lock lock{ mutex };
+            closed = true;
+        }
+        ready.notify_one();
+        socket.Shutdown();
+    }
+    bool Closed()
+    {
+        std::scoped_lock lock{ mutex };
+        return closed;
+    }
+
+private:
+    void Receive(RenderServer& server);
+    void Send(Hello hello, w::TileCodec codec);
+
+private:
+    w::Socket socket;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::shared_ptr<const Frame> latest;
+    uint32_t dropped = 0;
+    bool in_flight = false; // sent and not acknowledged
+    bool closed = false;
+    std::vector<std::pair<uint32_t, uint32_t>> updates; // server and client id of changes not shown yet
+
+    // sender is joined first, it exits once the receiver closed the connection
+    std::jthread receiver;
+    std::jthread sender;
+};
+
+// Spheres of increasing detail, a few instances of each resting on the floor of the box
+void ScatterSpheres(w::AssetLoader& loader, uint32_t count)
+{
+    using namespace DirectX;
+    std::mt19937 rng{ 7 };
+    std::uniform_real_distribution<float> x{ -11.0f, 11.0f }, z{ -24.0f, 10.0f }, unit{ 0.0f, 1.0f };
+    for (uint32_t i = 0; i < count; i++) {
+        std::vector<w::AssetLoader::Placement> placements(3);
+        for (auto& placement : placements) {
+            float radius = 0.2f + 0.5f * unit(rng);
+            XMStoreFloat4x4(&placement.object_to_world, XMMatrixScaling(radius, radius, radius) * XMMatrixTranslation(x(rng), radius - 1.5f, z(rng)));
+            placement.material = {
+                .diffuse = { unit(rng), unit(rng), unit(rng), 1.0f },
+                .emissive = {},
+                .roughness = unit(rng),
+            };
+        }
+        uint32_t segments = 16 + (i * 16) % 240;
+        loader.Add(wis::format("Sphere {}", i), [segments]() {
+            auto [positions, normals, indices] = uv_sphere_generator::generate(segments, segments);
+            return w::AssetLoader::MeshData{ std::move(positions), std::move(normals), std::move(indices) };
+        }, std::move(placements));
+    }
+}
+
+class RenderServer
+{
+public:
+    RenderServer(const w::LaunchOptions& options)
+        : options(options), listener(w::Socket::Listen(options.port))
+    {
+        auto views = w::Scene::DefaultObjects();
+        std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+        std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+        for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+            instances[i] = w::Scene::MakeInstance(i, views[i]);
+            materials[i] = views[i].material;
+        }
+        scene.Update(instances, materials);
+        camera.SetPerspective(w::Scene::fov, float(options.width) / float(options.height), 0.1f, 1000.0f);
+
+        if (options.ingest) {
+            loader = std::make_unique<w::AssetLoader>();
+            loader->OnReady([this]() {
+                { std::scoped_lock lock{ mutex }; } // the render loop is waiting or sees Ready before it waits
+                changed.notify_all();
+            });
+            ScatterSpheres(*loader, options.ingest);
+        }
+    }
+
+public:
+    void Run()
+    {
+        std::cout << wis::format("Render server on port {}: {}x{}, up to {} spp\n", listener.Port(), options.width, options.height, options.samples);
+        std::jthread acceptor([this](std::stop_token stop) { Accept(stop); });
+
+        W_PROFILE_THREAD("Render server");
+        w::CpuTracer tracer;
+        w::Image target{ options.width, options.height };
+        // changes are first shown at a reduced resolution that keeps up with the client, see DynamicResolution
+        w::DynamicResolution resolution{ { .target_ms = float(options.preview_ms) } };
+        // once it settles, as many samples per frame as fit the frame budget, see SampleScheduler
+        w::SampleScheduler scheduler{ { .target_ms = float(options.budget_ms) } };
+        // with --temporal camera changes keep the accumulation where it still shows the same surface
+        w::TemporalAccumulator history;
+        w::Image preview;
+        float traced_scale = 1.0f;
+        uint32_t frame_count = 0;
+        uint32_t frame = 0;
+        std::optional<steady_clock::time_point> update_received;
+        while (true) {
+            W_PROFILE_FRAME();
+            std::vector<std::shared_ptr<Connection>> receivers;
+            std::vector<std::shared_ptr<Connection>> gone;
+            {
+                std::unique_lock lock{ mutex };
+                // a converged image is left alone until something changes, a preview is always refined to full resolution
+                changed.wait(lock, [&]() {
+                    return pending.id != update || frame_count < options.samples || resolution.Scale() < 1.0f || (loader && loader->Ready());
+                });
+                if (pending.id != update) {
+                    bool restart = !options.temporal;
+                    if (pending.camera) {
+                        camera.SetState(*pending.camera);
+                    }
+                    if (pending.settings) {
+                        settings = *pending.settings;
+                        restart = true;
+                    }
+                    update = pending.id;
+                    update_received = pending.received;
+                    pending.camera.reset();
+                    pending.settings.reset();
+                    frame_count = 0;
+                    if (restart) {
+                        history.Reset();
+                        resolution.Interact();
+                    }
+                }
+                // destroyed outside the lock, their receivers may be waiting for it
+                auto closed = std::ranges::partition(connections, [](auto& c) { return !c->Closed(); });
+                gone.assign(closed.begin(), closed.end());
+                connections.erase(closed.begin(), closed.end());
+                receivers = connections;
+            }
+            gone.clear();
+
+            // the scene is only traced by this thread, new meshes go in between samples
+            if (loader) {
+                auto publish_start = steady_clock::now();
+                if (uint32_t published = loader->Publish(scene)) {
+                    frame_count = 0;
+                    history.Reset();
+                    publish_ms = std::max(publish_ms, std::chrono::duration<double, std::milli>(steady_clock::now() - publish_start).count());
+                    if (!loader->Pending()) {
+                        auto stats = loader->GetStats();
+                        std::cout << wis::format("Ingested {} meshes ({} triangles, {:.1f} ms of builds), longest publish {:.3f} ms\n",
+                                                 stats.published, stats.triangles, stats.build_ms, publish_ms);
+                    }
+                }
+            }
+
+            w::Camera::CBuffer cbuffer;
+            camera.PutCBuffer(&cbuffer);
+            float scale = resolution.BeginFrame();
+            if (scale != traced_scale) {
+                traced_scale = scale;
+                frame_count = 0;
+                history.Reset();
+            }
+            const bool temporal = options.temporal && scale == 1.0f;
+            // the first frame after a change is not held up by a full frame budget of samples
+            const bool scheduled = scale == 1.0f && !update_received;
+            uint32_t samples = scheduled && frame_count < options.samples ? std::min(scheduler.Next(), options.samples - frame_count) : 1;
+            auto trace_start = steady_clock::now();
+            if (scale < 1.0f) {
+                uint32_t width = w::DynamicResolution::Scaled(options.width, scale), height = w::DynamicResolution::Scaled(options.height, scale);
+                if (preview.width != width || preview.height != height) {
+                    preview = w::Image{ width, height };
+                }
+                tracer.Render(scene, w::CameraRays{ cbuffer, width, height }, settings, frame_count, preview);
+                w::Upsample(preview, target);
+            } else if (temporal) {
+                history.SetCamera(scene, cbuffer, options.width, options.height);
+                if (update_received) {
+                    history.FillHoles(scene, settings);
+                } else {
+                    history.Accumulate(scene, settings, samples);
+                }
+            } else {
+                tracer.Render(scene, w::CameraRays{ cbuffer, options.width, options.height }, settings, frame_count, target, nullptr, samples);
+            }
+            resolution.EndFrame(std::chrono::duration<double, std::milli>(steady_clock::now() - trace_start).count());
+            // pixels reprojected into the view have more samples than the others, the image converged when all did
+            frame_count = temporal ? history.MinSamples() : frame_count + samples;
+
+            auto result = std::make_shared<Frame>(Frame{ w::ToDisplay(temporal ? history.GetImage() : target), { frame++, update, frame_count } });
+            // the conversion is part of the fixed cost of a frame that more samples per frame amortize
+            scheduler.EndFrame(scheduled ? samples : 0, std::chrono::duration<double, std::milli>(steady_clock::now() - trace_start).count());
+            if (update_received) {
+                result->header.latency_ms = std::chrono::duration<float, std::milli>(steady_clock::now() - *update_received).count();
+                if (temporal) {
+                    auto stats = history.GetStats();
+                    std::cout << wis::format("Update {}: first frame after {:.1f} ms, {:.1f}% of pixels kept over {} reprojections ({:.1f} ms)\n", update,
+                                             result->header.latency_ms, stats.KeptFraction() * 100.0, stats.reprojections, stats.reproject_ms);
+                } else {
+                    std::cout << wis::format("Update {}: first frame after {:.1f} ms\n", update, result->header.latency_ms);
+                }
+                update_received.reset();
+            }
+            for (auto& c : receivers) {
+                c->Publish(result);
+            }
+            std::scoped_lock lock{ mutex };
+            last_frame = std::move(result);
+        }
+    }
+
+    // called by connections, returns the server id of the change
+    uint32_t Apply(std::optional<w::Camera::State> camera, std::optional<w::Scene::RenderSettings> settings)
+    {
+        uint32_t id;
+        {
+            std::scoped_lock lock{ mutex };
+            if (pending.id == update) {
+                pending.received = steady_clock::now();
+            }
+            id = ++pending.id;
+            if (camera) {
+                pending.camera = camera;
+            }
+            if (settings) {
+                pending.settings = settings;
+            }
+        }
+        changed.notify_all();
+        return id;
+    }
+
+private:
+    void Accept(std::stop_token stop)
+    {
+        W_PROFILE_THREAD("Render server accept");
+        while (!stop.stop_requested()) {
+            if (!listener.WaitReadable(100)) {
+                continue;
+            }
+            try {
+                auto connection = std::make_shared<Connection>(listener.Accept());
+                std::scoped_lock lock{ mutex };
+                Hello hello{ options.width, options.height, codec.tile_size, options.samples, camera.GetState(), settings };
+                if (pending.camera) {
+                    hello.camera = *pending.camera;
+                }
+                connection->Start(*this, hello, codec);
+                if (last_frame) {
+                    connection->Publish(last_frame); // something to show before the next sample
+                }
+                connections.push_back(std::move(connection));
+            } catch (const std::exception& e) {
+                std::cerr << wis::format("Accept: {}\n", e.what());
+            }
+        }
+    }
+
+private:
+    const w::LaunchOptions& options;
+    w::Socket listener;
+    w::TileCodec codec;
+    w::CpuScene scene;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::shared_ptr<const Frame> last_frame;
+    PendingUpdate pending;
+    uint32_t update = 0; // id of the pending update the render loop took last
+    // written by the render loop under the mutex
+    w::Camera camera;
+    w::Scene::RenderSettings settings;
+
+    // with --ingest, after the mutex its workers notify through
+    std::unique_ptr<w::AssetLoader> loader;
+    double publish_ms = 0.0; // longest Publish
+};
+
+void Connection::Start(RenderServer& server, const Hello& hello, const w::TileCodec& codec)
+{
+    receiver = std::jthread([this, &server]() { Receive(server); });
+    sender = std::jthread([this, hello, codec]() { Send(hello, codec); });
+}
+
+void Connection::Receive(RenderServer& server)
+{
+    W_PROFILE_THREAD("Render server receive");
+    try {
+        std::vector<std::byte> payload;
+        while (auto type = socket.ReceivePacket(payload)) {
+            std::span<const std::byte> in = payload;
+            if (PacketType(*type) == PacketType::Ack) {
+                {
+                    std::scoped_lock lock{ mutex };
+                    in_flight = false;
+                }
+                ready.notify_one();
+                continue;
+            }
+
+            auto id = w::ReadPod<uint32_t>(in);
+            uint32_t server_id;
+            switch (PacketType(*type)) {
+            case PacketType::Camera:
+                server_id = server.Apply(w::ReadPod<w::Camera::State>(in), std::nullopt);
+                break;
+            case PacketType::Settings:
+                server_id = server.Apply(std::nullopt, w::ReadPod<w::Scene::RenderSettings>(in));
+                break;
+            default:
+                throw w::Exception(wis::format("Unexpected packet {}", *type));
+            }
+            std::scoped_lock lock{ mutex };
+            updates.emplace_back(server_id, id);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << wis::format("Client: {}\n", e.what());
+    }
+    Close();
+}
+
+void Connection::Send(Hello hello, w::TileCodec codec)
+{
+    W_PROFILE_THREAD("Render server send");
+    try {
+        socket.SendPacket(uint32_t(PacketType::Hello), std::as_bytes(std::span{ &hello, 1 }));
+
+        w::DisplayImage previous{ hello.width, hello.height }; // what the client shows
+        std::vector<std::byte> packet;
+        uint32_t client_update = 0;
+        while (true) {
+            std::shared_ptr<const Frame> frame;
+            FrameHeader header;
+            {
+                std::unique_lock lock{ mutex };
+                ready.wait(lock, [this]() { return (latest && !in_flight) || closed; });
+                if (closed) {
+                    return;
+                }
+                frame = std::move(latest);
+                in_flight = true;
+                header = frame->header;
+                header.dropped = std::exchange(dropped, 0);
+
+                // updates arrive in order of their server ids
+                auto shown = std::ranges::find_if(updates, [&](auto& u) { return u.first > header.update; });
+                if (shown != updates.begin()) {
+                    client_update = std::prev(shown)->second;
+                    updates.erase(updates.begin(), shown);
+                }
+                header.update = client_update;
+            }
+
+            W_PROFILE_SCOPE("Encode frame");
+            packet.assign(sizeof(FrameHeader), {});
+            header.tile_count = codec.Encode(frame->image, previous, packet);
+            std::memcpy(packet.data(), &header, sizeof(header));
+            socket.SendPacket(uint32_t(PacketType::Frame), packet);
+            previous = frame->image;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << wis::format("Client: {}\n", e.what());
+        Close();
+    }
+}
+} // namespace
+
+void w::RunRenderServer(const LaunchOptions& options)
+{
+    RenderServer server{ options };
+    server.Run();
+}
+
+void w::RunRenderClient(const LaunchOptions& options)
+{
+    auto socket = Socket::Connect(options.client);
+    std::vector<std::byte> payload;
+    if (socket.ReceivePacket(payload) != uint32_t(PacketType::Hello)) {
+        throw w::Exception("Expected the server hello");
+    }
+    std::span<const std::byte> in = payload;
+    auto hello = ReadPod<Hello>(in);
+    DisplayImage image{ hello.width, hello.height };
+    TileCodec codec{ hello.tile_size };
+
+    uint64_t frames = 0, bytes = 0, dropped = 0;
+    auto receive_frame = [&]() {
+        while (true) {
+            auto type = socket.ReceivePacket(payload);
+            if (!type) {
+                throw w::Exception("Server closed the connection");
+            }
+            if (*type != uint32_t(PacketType::Frame)) {
+                continue;
+            }
+            std::span<const std::byte> in = payload;
+            auto header = ReadPod<FrameHeader>(in);
+            codec.Decode(in, header.tile_count, image);
+            frames++;
+            bytes += payload.size();
+            dropped += header.dropped;
+            if (options.client_delay) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.client_delay));
+            }
+            socket.SendPacket(uint32_t(PacketType::Ack));
+            return header;
+        }
+    };
+
+    receive_frame(); // the current state, before any change
+    auto camera = hello.camera;
+    std::vector<double> latencies;
+    for (uint32_t update = 1; update <= options.updates; update++) {
+        camera.orientation.y += 0.2f;
+        std::vector<std::byte> packet;
+        AppendPod(packet, update);
+        AppendPod(packet, camera);
+        auto sent = steady_clock::now();
+        socket.SendPacket(uint32_t(PacketType::Camera), packet);
+
+        FrameHeader header;
+        uint32_t stale = 0;
+        while ((header = receive_frame()).update < update) {
+            stale++;
+        }
+        double latency = std::chrono::duration<double, std::milli>(steady_clock::now() - sent).count();
+        latencies.push_back(latency);
+        std::cout << wis::format("Update {}: first frame after {:.1f} ms (server {:.1f} ms), {} stale frames before it\n",
+                                 update, latency, header.latency_ms, stale);
+
+        // a few refinement passes, their deltas are what most frames look like
+        for (uint32_t i = 0; i < 3 && header.samples < hello.samples; i++) {
+            header = receive_frame();
+        }
+    }
+
+    std::ranges::sort(latencies);
+    double raw = double(image.pixels.size());
+    std::cout << wis::format("{} frames, {:.1f} KiB per frame ({:.1f}% of raw RGB8), {} dropped by the server, latency median {:.1f} ms, max {:.1f} ms\n",
+                             frames, bytes / 1024.0 / frames, 100.0 * bytes / frames / raw, dropped,
+                             latencies[latencies.size() / 2], latencies.back());
+    if (!options.output.empty()) {
+        WritePFM(options.output, FromDisplay(image));
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "launch_options.h"
+
+namespace w {
+// Progressive rendering for remote clients over a local socket.
+// The server renders the default scene on the CPU tracer, accumulating while nothing changes, and applies camera and
+// settings changes from any client before the next sample. Every client has a mailbox of one frame: a frame the client
+// has not taken yet is replaced by the newer one, so a slow client drops frames instead of stalling the renderer.
+// Frames are sent as the tiles that changed since the frame that client saw last, see TileCodec.
+
+// Serves until the process is stopped
+void RunRenderServer(const LaunchOptions& options);
+// Sends options.updates camera changes to options.client and reports the latency until the first frame showing each
+void RunRenderClient(const LaunchOptions& options);
+} // namespace w
@@ -0,0 +1,56 @@
+#include "replay.h"
+#include "camera_path.h"
+#include "cpu_tracer.h"
+#include "profiler.h"
+#include <chrono>
+#include <iostream>
+#include <optional>
+
+void w::RunCpuReplay(const LaunchOptions& options)
+{
+    W_PROFILE_THREAD("Main");
+    auto path = CameraPath::Load(options.replay);
+
+    auto views = Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, Scene::objects_count> instances;
+    std::array<MaterialCBuffer, Scene::objects_count> materials;
+    for (uint32_t i = 0; i < Scene::objects_count; i++) {
+        instances[i] = Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    CpuScene scene;
+    scene.Update(instances, materials);
+
+    Camera camera;
+    camera.SetPerspective(Scene::fov, float(options.width) / float(options.height), 0.1f, 1000.0f);
+    CpuTracer tracer;
+    Image target{ options.width, options.height };
+
+    std::vector<double> frame_ms;
+    std::optional<CameraKeyframe> last;
+    uint32_t frame_count = 0;
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        W_PROFILE_FRAME();
+        auto start = std::chrono::steady_clock::now();
+
+        auto k = path.Sample(path.FrameTime(frame, options.frames));
+        if (!last || !(k.camera == last->camera) || k.settings != last->settings) {
+            frame_count = 0; // Scene::ResetFrames
+            camera.SetState(k.camera);
+        }
+        last = k;
+
+        Camera::CBuffer cbuffer;
+        camera.PutCBuffer(&cbuffer);
+        tracer.Render(scene, CameraRays{ cbuffer, options.width, options.height }, k.settings, frame_count, target);
+        frame_count++;
+
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    auto measured = std::span{ frame_ms }.subspan(std::min<size_t>(options.warmup, frame_ms.size()));
+    std::cout << wis::format("CPU replay {}x{}: {}\n", options.width, options.height, FormatFrameTimeStats(ComputeFrameTimeStats(measured)));
+    if (!options.report.empty()) {
+        WriteFrameTimes(options.report, frame_ms);
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "launch_options.h"
+
+namespace w {
+// Replays options.replay on the CPU tracer, accumulating like the GPU while the camera holds still
+void RunCpuReplay(const LaunchOptions& options);
+} // namespace w
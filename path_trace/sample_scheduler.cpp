@@ -0,0 +1,34 @@
+#include "sample_scheduler.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t w::SampleScheduler::Next() const noexcept
+{
+    if (options.target_ms <= 0.0f) {
+        return 1;
+    }
+    return std::clamp(uint32_t(samples), 1u, std::max(options.max_samples, 1u));
+}
+
+void w::SampleScheduler::EndFrame(uint32_t traced, double frame_ms) noexcept
+{
+    if (!traced || frame_ms <= 0.0) {
+        return;
+    }
+    if (traced == 1) {
+        stats.single_samples++;
+        stats.single_seconds += frame_ms / 1000.0;
+    } else {
+        stats.samples += traced;
+        stats.seconds += frame_ms / 1000.0;
+    }
+    if (options.target_ms <= 0.0f) {
+        return;
+    }
+    // The count that would have fit assumes all of the frame scales with the samples, which overestimates the cost
+    // of a sample and approaches the target from below. Steps of at most 2x and the geometric mean with the
+    // current count damp the oscillation of frame times measured a few frames late.
+    double fit = double(traced) * options.target_ms / frame_ms;
+    fit = std::clamp(fit, samples * 0.5, samples * 2.0);
+    samples = std::clamp(std::sqrt(samples * fit), 1.0, double(std::max(options.max_samples, 1u)));
+}
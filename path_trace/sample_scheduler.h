@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+namespace w {
+// Samples per pixel traced per frame, chosen from measured frame times so a frame takes about target_ms.
+// A frame costs a fixed overhead (recording, present, UI, encoding) plus the time of its samples. When one sample
+// is cheap the overhead dominates, tracing several per frame moves more samples per second at the same frame rate.
+class SampleScheduler
+{
+public:
+    struct Options {
+        float target_ms = 0.0f; // e.g. 16 interactive, 250 batch. 0 - one sample per frame
+        uint32_t max_samples = 64;
+    };
+    struct Stats {
+        uint64_t samples = 0; // per pixel, over frames that traced more than one
+        double seconds = 0.0;
+        uint64_t single_samples = 0; // frames that traced one, the loop without a schedule
+        double single_seconds = 0.0;
+
+        double SamplesPerSecond() const noexcept
+        {
+            return seconds > 0.0 ? double(samples) / seconds : 0.0;
+        }
+        double SingleSamplesPerSecond() const noexcept
+        {
+            return single_seconds > 0.0 ? double(single_samples) / single_seconds : 0.0;
+        }
+    };
+
+public:
+    SampleScheduler() = default;
+    explicit SampleScheduler(const Options& options) noexcept
+        : options(options)
+    {
+    }
+
+public:
+    void SetTarget(float target_ms) noexcept
+    {
+        options.target_ms = target_ms;
+    }
+    // samples for the next frame, at least 1
+    uint32_t Next() const noexcept;
+    // frame_ms of a frame that traced `traced` samples per pixel. Frames that traced none, e.g. after convergence,
+    // or that were not representative, e.g. previews, pass 0 and are ignored.
+    void EndFrame(uint32_t traced, double frame_ms) noexcept;
+
+    const Stats& GetStats() const noexcept
+    {
+        return stats;
+    }
+
+private:
+    Options options;
+    double samples = 1.0; // fractional, so small changes of the frame time are not lost to rounding
+    Stats stats;
+};
+} // namespace w
@@ -1,23 +1,44 @@
 #include "scene.h"
 #include "graphics.h"
+#include "upload.h"
+#include "frame_allocator.h"
+#include "profiler.h"
+#include "cpu_tracer.h"
+#include "hash.h"
+#include "vertex_format.h"
 #include <imgui.h>
+#include <algorithm>
+#include <iostream>
 
-static constexpr const char* SAMPLING_LABELS[4] = { "Uniform", "Cosine", "GGX", "Mix" };
-static constexpr const char* BRDF_LABELS[4] = { "Lambert", "LambertWithAlbedo", "GGX", "Mix" };
+w::Scene::Scene(Graphics& gfx, UploadManager& uploads)
+    : Scene(gfx, uploads, SphereStatic::Generate())
+{
+}
+
+w::Scene::Scene(Graphics& gfx, UploadManager& uploads, const CompressedMesh& sphere_mesh, wis::Result result)
+    : instance_buffer(gfx.allocator.CreateUploadBuffer(result, sizeof(wis::AccelerationInstance) * objects_count))
+    , sphere_static(gfx, uploads, sphere_mesh)
+    , box_static(gfx, uploads)
+{
+    constants.wide_indices = sphere_static.list.index_type == wis::IndexType::UInt32;
 
-static constexpr uint32_t render_constants_offset = wis::detail::aligned_size(sizeof(w::Camera::CBuffer), 256ull);
+    object_views = DefaultObjects();
+    for (uint32_t i = 0; i < objects_count; ++i) {
+        ui.instances[i] = MakeInstance(i, object_views[i]);
+        ui.materials[i] = object_views[i].material;
+    }
+
+    CreateAccelerationStructures(gfx, uploads);
+    Publish();
+    ApplyParameters();
+}
 
-w::Scene::Scene(Graphics& gfx, wis::Result result)
-    : object_cbuffer(gfx.allocator.CreateUploadBuffer(result, sizeof(MaterialCBuffer) * objects_count))
-    , instance_buffer(gfx.allocator.CreateUploadBuffer(result, sizeof(wis::AccelerationInstance) * objects_count))
-    , camera_buffer(gfx.allocator.CreateUploadBuffer(result, render_constants_offset))
-    , sphere_static(gfx)
-    , box_static(gfx)
-    , mapped_cbuffer(object_cbuffer.Map<MaterialCBuffer>(), objects_count)
-    , mapped_camera(camera_buffer.Map<w::Camera::CBuffer>(), 1)
+std::array<w::ObjectView, w::Scene::objects_count> w::Scene::DefaultObjects()
 {
+    std::array<ObjectView, objects_count> views;
+
     // Box
-    object_views[0] = {
+    views[0] = {
         .material = {
                 .diffuse = { 0.8f, 0.8f, 0.8f, 1.0f },
                 .emissive = {},
@@ -39,7 +60,7 @@ w::Scene::Scene(Graphics& gfx, wis::Result result)
     };
 
     // Light
-    object_views[1] = {
+    views[1] = {
         .material = {
                 .diffuse = { 1, 1, 1, 1 },
                 .emissive = { 1, 1, 1, 1 },
@@ -50,7 +71,7 @@ w::Scene::Scene(Graphics& gfx, wis::Result result)
     };
 
     for (int i = 2; i < objects_count; ++i) {
-        object_views[i] = {
+        views[i] = {
             .material = {
                     .diffuse = sphere_colors[i - 2],
                     .emissive = {},
@@ -60,42 +81,25 @@ w::Scene::Scene(Graphics& gfx, wis::Result result)
             .name = wis::format("Sphere {}", i),
         };
     }
+    return views;
+}
 
-    // create mapped instances
-    mapped_instances = { instance_buffer.Map<wis::AccelerationInstance>(), objects_count };
-    mapped_instances[0] = {
-        .instance_id = 0,
+wis::AccelerationInstance w::Scene::MakeInstance(uint32_t index, const ObjectView& view)
+{
+    // the box is hit group 1 with face normals and front face culling on primary rays, spheres are two sided
+    wis::AccelerationInstance instance{
+        .instance_id = index,
         .mask = 0xFF,
-        .instance_offset = 1,
-        .flags = uint32_t(wis::ASInstanceFlags::TriangleFrontCounterClockwise),
+        .instance_offset = index == 0 ? 1u : 0u,
+        .flags = uint32_t(index == 0 ? wis::ASInstanceFlags::TriangleFrontCounterClockwise : wis::ASInstanceFlags::TriangleCullDisable),
         .acceleration_structure_handle = 0,
     };
-    object_views[0].GatherInstanceTransform(mapped_instances[0]);
-
-    for (uint32_t i = 1; i < objects_count; ++i) {
-        mapped_instances[i] = {
-            .instance_id = i,
-            .mask = 0xFF,
-            .instance_offset = 0,
-            .flags = uint32_t(wis::ASInstanceFlags::TriangleCullDisable),
-            .acceleration_structure_handle = 0,
-        };
-        object_views[i].GatherInstanceTransform(mapped_instances[i]);
-    }
-
-    // set material cbuffer
-    for (uint32_t i = 0; i < objects_count; ++i) {
-        mapped_cbuffer[i] = object_views[i].material;
-    }
-
-    CreateAccelerationStructures(gfx);
+    view.GatherInstanceTransform(instance);
+    return instance;
 }
 
 w::Scene::~Scene()
 {
-    object_cbuffer.Unmap();
-    instance_buffer.Unmap();
-    camera_buffer.Unmap();
 }
 
 void w::Scene::RenderUI()
@@ -103,7 +107,8 @@ void w::Scene::RenderUI()
     ImGui::Begin("Settings", nullptr);
     ImGui::PushItemWidth(150);
     ImGui::Text(wis::format("FPS (CPU): {}", ImGui::GetIO().Framerate).c_str());
-    ImGui::Text(wis::format("Iterations: {}", constants.accumulate? constants.limit_iterations ? std::min(int(constants.frame_count), constants.max_iterations) : constants.frame_count : 0).c_str());
+    uint32_t frame_count = frames_shown.load(std::memory_order_relaxed);
+    ImGui::Text(wis::format("Iterations: {}", ui.settings.accumulate ? ui.limit_iterations ? std::min(frame_count, uint32_t(ui.max_iterations)) : frame_count : 0).c_str());
 
     ImGui::Checkbox("Show Material Box", &show_material_window[0]);
     ImGui::Checkbox("Show Material Sph#1", &show_material_window[1]);
@@ -112,110 +117,235 @@ void w::Scene::RenderUI()
     ImGui::Checkbox("Show Material Sph#4", &show_material_window[4]);
 
     bool reset = false;
-    reset |= ImGui::Checkbox("Accumulate", &(bool&)constants.accumulate);
-    ImGui::Checkbox("Gama Correction", &gamma_correction);
-    reset |= ImGui::Checkbox("Limit Iterations", &(bool&)constants.limit_iterations);
-    reset |= ImGui::SliderInt("Max Iterations", &constants.max_iterations, 1, 1000);
-
-    reset |= ImGui::Combo("Sampling", &constants.sampling_fn, SAMPLING_LABELS, IM_ARRAYSIZE(SAMPLING_LABELS));
-    reset |= ImGui::Combo("BRDF", &constants.brdf, BRDF_LABELS, IM_ARRAYSIZE(BRDF_LABELS));
-    reset |= ImGui::SliderInt("Bounces", &constants.max_depth, 1, 24);
+    reset |= ImGui::Checkbox("Accumulate", &ui.settings.accumulate);
+    bool changed = ImGui::Checkbox("Gama Correction", &ui.gamma_correction);
+    reset |= ImGui::Checkbox("Limit Iterations", &ui.limit_iterations);
+    reset |= ImGui::SliderInt("Max Iterations", &ui.max_iterations, 1, 1000);
+
+    reset |= ImGui::Combo("Sampling", &ui.settings.sampling_fn, SAMPLING_LABELS, IM_ARRAYSIZE(SAMPLING_LABELS));
+    reset |= ImGui::Combo("BRDF", &ui.settings.brdf, BRDF_LABELS, IM_ARRAYSIZE(BRDF_LABELS));
+    reset |= ImGui::SliderInt("Bounces", &ui.settings.max_depth, 1, 24);
+
+    reset |= ImGui::Combo("Heatmap", &ui.heatmap, HEATMAP_LABELS, IM_ARRAYSIZE(HEATMAP_LABELS));
+    if (ui.heatmap) {
+        reset |= ImGui::SliderFloat("Heatmap Opacity", &ui.heatmap_opacity, 0.0f, 1.0f);
+    }
+    changed |= ImGui::SliderFloat("Preview Target (ms)", &ui.preview_ms, 0.0f, 100.0f, ui.preview_ms > 0.0f ? "%.1f" : "Off");
+    changed |= ImGui::SliderFloat("Frame Budget (ms)", &ui.budget_ms, 0.0f, 250.0f, ui.budget_ms > 0.0f ? "%.1f" : "1 spp");
+    if (ImGui::Button("Reload Shaders")) {
+        ReloadShaders();
+    }
+    if (ImGui::Button("Export CPU Heatmap")) {
+        try {
+            ExportHeatmap("heatmap");
+        } catch (const std::exception& e) {
+            std::cout << e.what() << "\n";
+        }
+    }
     ImGui::End();
 
     bool updated_tlas = false;
     for (int m = 0; m < objects_count; ++m) {
         if (show_material_window[m]) {
-            updated_tlas |= object_views[m].RenderObjectUI(mapped_cbuffer[m], mapped_instances[m]);
+            updated_tlas |= object_views[m].RenderObjectUI(ui.materials[m], ui.instances[m]);
         }
     }
     if (updated_tlas) {
-        ResetFrames();
-        for (int i = 0; i < w::flight_frames; ++i) {
-            update_tlas[i] = true;
-        }
+        ui.moves++;
+        reset = true;
     }
     if (reset) {
-        ResetFrames();
+        ui.resets++;
+    }
+    if (reset || changed) {
+        Publish();
+    }
+}
+
+void w::Scene::Publish()
+{
+    parameters.Publish(ui);
+}
+
+void w::Scene::ApplyParameters()
+{
+    auto latest = parameters.Read();
+    if (latest.Version() == frame_version) {
+        return;
+    }
+    frame_version = latest.Version();
+    if (latest->resets != frame.resets) {
+        RestartAccumulation();
+        resolution.Interact();
+    }
+    if (latest->moves != frame.moves) {
+        update_tlas.fill(true);
+    }
+    if (latest->reloads != frame.reloads) {
+        reload_shaders = true;
+    }
+    frame = *latest;
+
+    constants.sampling_fn = frame.settings.sampling_fn;
+    constants.brdf = frame.settings.brdf;
+    constants.max_depth = frame.settings.max_depth;
+    constants.accumulate = frame.settings.accumulate;
+    constants.limit_iterations = frame.limit_iterations;
+    constants.max_iterations = frame.max_iterations;
+    constants.heatmap = frame.heatmap;
+    constants.heatmap_opacity = frame.heatmap_opacity;
+    constants.gamma_correction = frame.gamma_correction;
+    resolution.SetTarget(frame.preview_ms);
+    scheduler.SetTarget(frame.budget_ms);
+}
+
+void w::Scene::AddPasses(RenderGraph& graph, Graphics& gfx, FrameAllocator& frame_alloc, wis::DescriptorStorageView dstorage, uint32_t current_frame, RGResource output, uint32_t samples)
+{
+    ApplyParameters();
+    float scale = resolution.BeginFrame();
+    if (scale != trace_scale) {
+        trace_scale = scale;
+        RestartAccumulation(); // samples traced at different sizes do not mix
+    }
+    constants.trace_width = DynamicResolution::Scaled(dispatch_desc.width, scale);
+    constants.trace_height = DynamicResolution::Scaled(dispatch_desc.height, scale);
+
+    auto as = graph.ImportBuffer(*gfx.as_pool.View(as_buffer).buffer, as_state);
+    if (update_tlas[current_frame]) {
+        graph.AddPass("TLAS update", { { as, RGUsage::BuildAccelerationStructure } },
+                      [this, &gfx, &frame_alloc, current_frame](wis::CommandList& cmd_list) {
+                          UpdateTopLevelAS(gfx, cmd_list, frame_alloc, current_frame);
+                      });
+    }
+    if (!samples) {
+        // a preview restarts every frame and without accumulation only the last sample shows, one is enough
+        samples = frame.settings.accumulate && !Previewing() ? scheduler.Next() : 1;
+    }
+    frame_samples = 0;
+    for (uint32_t i = 0; i < samples; i += max_dispatch_samples) {
+        uint32_t batch = std::min(samples - i, max_dispatch_samples);
+        graph.AddPass("Trace", { { as, RGUsage::ReadAccelerationStructure }, { output, RGUsage::RaytracingStorage } },
+                      [this, &gfx, &frame_alloc, dstorage, current_frame, batch](wis::CommandList& cmd_list) {
+                          RenderScene(gfx, cmd_list, frame_alloc, dstorage, current_frame, batch);
+                      });
     }
 }
 
-void w::Scene::RenderScene(Graphics& gfx, wis::CommandList& cmd_list, wis::DescriptorStorageView dstorage, uint32_t current_frame)
+void w::Scene::UpdateTopLevelAS(Graphics& gfx, wis::CommandList& cmd_list, FrameAllocator& frame_alloc, uint32_t current_frame)
 {
+    W_PROFILE_FUNCTION();
     using namespace wis;
-    camera.PutCBuffer(mapped_camera.data() + current_frame);
     auto& rt = gfx.GetRaytracing();
+    auto instance_data = frame_alloc.Push(frame.instances, 16);
+    wis::TopLevelASBuildDesc tlas_desc{
+        .flags = wis::AccelerationStructureFlags::PreferFastTrace | wis::AccelerationStructureFlags::AllowUpdate,
+        .instance_count = objects_count,
+        .gpu_address = frame_alloc.GetGPUAddress(instance_data),
+        .update = true,
+    };
 
-    if (update_tlas[current_frame]) {
-        wis::TopLevelASBuildDesc tlas_desc{
-            .flags = wis::AccelerationStructureFlags::PreferFastTrace | wis::AccelerationStructureFlags::AllowUpdate,
-            .instance_count = objects_count,
-            .gpu_address = instance_buffer.GetGPUAddress(),
-            .update = true,
-        };
+    uint32_t offset_scratch = tlas_update_size * current_frame;
+    auto scratch = gfx.geometry_pool.View(scratch_buffer);
+    rt.BuildTopLevelAS(cmd_list, tlas_desc, tlas[current_frame], scratch.GetGPUAddress() + offset_scratch, tlas[current_frame]);
+    update_tlas[current_frame] = false;
+}
 
-        uint32_t offset_scratch = tlas_update_size * current_frame;
-        rt.BuildTopLevelAS(cmd_list, tlas_desc, tlas[current_frame], scratch_buffer.GetGPUAddress() + offset_scratch, tlas[current_frame]);
-        update_tlas[current_frame] = false;
+void w::Scene::RenderScene(Graphics& gfx, wis::CommandList& cmd_list, FrameAllocator& frame_alloc, wis::DescriptorStorageView dstorage, uint32_t current_frame, uint32_t samples)
+{
+    W_PROFILE_FUNCTION();
+    using namespace wis;
+    auto& rt = gfx.GetRaytracing();
 
-        // insert barrier
-        wis::BufferBarrier barrier{
-            .sync_before = wis::BarrierSync::BuildRTAS,
-            .sync_after = wis::BarrierSync::Raytracing,
-            .access_before = wis::ResourceAccess::Common,
-            .access_after = wis::ResourceAccess::UnorderedAccess,
-        };
-        cmd_list.BufferBarrier(barrier, as_buffer);
+    // constants live in the frame's region until the GPU is done with this frame
+    auto camera_data = frame_alloc.Allocate(sizeof(w::Camera::CBuffer));
+    frame.camera.PutCBuffer(camera_data.data);
+    auto material_data = frame_alloc.Push(frame.materials);
+
+    if (reload_shaders) {
+        // files that did not change keep their hashes and with them their pipelines
+        const TracePipeline* previous = pipelines[PipelineIndex(frame.settings)];
+        gfx.shaders.Revalidate();
+        pipelines = {};
+        if (&GetPipeline(gfx) != previous) {
+            RestartAccumulation();
+        }
+        DropStalePipelines(gfx);
+        reload_shaders = false;
     }
     if (update_buffers[current_frame]) {
         constants.frame_count = 0;
         update_buffers[current_frame] = false;
     }
+    if (constants.limit_iterations) {
+        samples = std::min(samples, uint32_t(std::max(constants.max_iterations - int32_t(constants.frame_count), 0)));
+    }
+    if (!samples) {
+        return; // converged, the raygen shader would return right away
+    }
 
-    rt.SetPipelineState(cmd_list, pipeline);
+    // switching settings swaps pipelines, the previous one stays alive for the frames still using it
+    auto& variant = GetPipeline(gfx);
+    rt.SetPipelineState(cmd_list, variant.pipeline);
     cmd_list.SetComputeRootSignature(root);
 
     constants.frame = current_frame;
+    constants.samples = samples;
     cmd_list.SetComputePushConstants(&constants, sizeof(constants) / 4, 0);
-    rt.PushDescriptor(cmd_list, wis::DescriptorType::ConstantBuffer, 0, camera_buffer, 0);
-    rt.PushDescriptor(cmd_list, wis::DescriptorType::ConstantBuffer, 1, object_cbuffer, 0);
+    rt.PushDescriptor(cmd_list, wis::DescriptorType::ConstantBuffer, 0, frame_alloc.GetBuffer(), uint32_t(camera_data.offset));
+    rt.PushDescriptor(cmd_list, wis::DescriptorType::ConstantBuffer, 1, frame_alloc.GetBuffer(), uint32_t(material_data.offset));
     rt.SetDescriptorStorage(cmd_list, dstorage);
 
-    rt.DispatchRays(cmd_list, dispatch_desc);
+    auto dispatch = variant.tables;
+    dispatch.width = constants.trace_width;
+    dispatch.height = constants.trace_height;
+    dispatch.depth = dispatch_desc.depth;
+    rt.DispatchRays(cmd_list, dispatch);
+
+    constants.frame_count += samples;
+    frame_samples += samples;
+    frames_shown.store(constants.frame_count, std::memory_order_relaxed);
+}
 
-    constants.frame_count++;
+void w::Scene::PushFilterConstants(wis::CommandList& cmd_list, uint32_t current_frame) const
+{
+    RenderingConstants filter = constants;
+    filter.frame = current_frame;
+    cmd_list.SetPushConstants(&filter, sizeof(filter) / 4, 0, wis::ShaderStages::All);
 }
 
-void w::Scene::CreateAccelerationStructures(Graphics& gfx)
+void w::Scene::CreateAccelerationStructures(Graphics& gfx, UploadManager& uploads)
 {
+    W_PROFILE_FUNCTION();
     using namespace wis;
     wis::Result result = wis::success;
     auto& device = gfx.GetDevice();
     auto& rt = gfx.GetRaytracing();
+    auto& pool = gfx.geometry_pool;
 
     wis::AcceleratedGeometryInput inputs[2]{
         {
                 .geometry_type = wis::ASGeometryType::Triangles,
                 .flags = wis::ASGeometryFlags::Opaque,
-                .vertex_or_aabb_buffer_address = box_static.list.vertex_buffer.GetGPUAddress(),
+                .vertex_or_aabb_buffer_address = pool.View(box_static.list.vertex_buffer).GetGPUAddress(),
                 .vertex_or_aabb_buffer_stride = sizeof(DirectX::XMFLOAT3),
-                .index_buffer_address = box_static.list.index_buffer.GetGPUAddress(),
+                .index_buffer_address = pool.View(box_static.list.index_buffer).GetGPUAddress(),
                 .transform_matrix_address = 0,
                 .vertex_count = box_static.list.vertex_count,
                 .triangle_or_aabb_count = box_static.list.index_count / 3,
                 .vertex_format = wis::DataFormat::RGB32Float,
-                .index_format = wis::IndexType::UInt16,
+                .index_format = box_static.list.index_type,
         },
         {
                 .geometry_type = wis::ASGeometryType::Triangles,
                 .flags = wis::ASGeometryFlags::Opaque,
-                .vertex_or_aabb_buffer_address = sphere_static.list.vertex_buffer.GetGPUAddress(),
+                .vertex_or_aabb_buffer_address = pool.View(sphere_static.list.vertex_buffer).GetGPUAddress(),
                 .vertex_or_aabb_buffer_stride = sizeof(DirectX::XMFLOAT3),
-                .index_buffer_address = sphere_static.list.index_buffer.GetGPUAddress(),
+                .index_buffer_address = pool.View(sphere_static.list.index_buffer).GetGPUAddress(),
                 .transform_matrix_address = 0,
                 .vertex_count = sphere_static.list.vertex_count,
                 .triangle_or_aabb_count = sphere_static.list.index_count / 3,
                 .vertex_format = wis::DataFormat::RGB32Float,
-                .index_format = wis::IndexType::UInt32,
+                .index_format = sphere_static.list.index_type,
         }
     };
     wis::AcceleratedGeometryDesc accelerated_geometry_descs[2]{};
@@ -246,51 +376,66 @@ void w::Scene::CreateAccelerationStructures(Graphics& gfx)
 
     // allocate buffers
     uint64_t full_size = infos[0].result_size + infos[1].result_size + infos[2].result_size * w::flight_frames;
-    as_buffer = gfx.allocator.CreateBuffer(result, full_size, wis::BufferUsage::AccelerationStructureBuffer);
-    scratch_buffer = gfx.allocator.CreateBuffer(result, infos[0].scratch_size + infos[1].scratch_size + infos[2].scratch_size * w::flight_frames, wis::BufferUsage::StorageBuffer);
+    as_buffer = gfx.as_pool.Allocate(full_size);
+    scratch_buffer = pool.Allocate(infos[0].scratch_size + infos[1].scratch_size + infos[2].scratch_size * w::flight_frames);
     tlas_update_size = infos[2].update_size;
+    auto as_view = gfx.as_pool.View(as_buffer);
+    auto scratch_address = pool.View(scratch_buffer).GetGPUAddress();
+
+    // create acceleration structures, recorded after the geometry copies of the same upload batch
+    wis::CommandList& cmd_list = uploads.CommandList();
+    // suballocations share blocks, one barrier per block
+    std::vector<const wis::Buffer*> geometry{
+        pool.View(box_static.list.vertex_buffer).buffer,
+        pool.View(box_static.list.index_buffer).buffer,
+        pool.View(sphere_static.list.vertex_buffer).buffer,
+        pool.View(sphere_static.list.index_buffer).buffer,
+    };
+    std::ranges::sort(geometry);
+    geometry.erase(std::unique(geometry.begin(), geometry.end()), geometry.end());
+    for (auto* buffer : geometry) {
+        cmd_list.BufferBarrier({ .sync_before = wis::BarrierSync::Copy,
+                                 .sync_after = wis::BarrierSync::BuildRTAS,
+                                 .access_before = wis::ResourceAccess::CopyDest,
+                                 .access_after = wis::ResourceAccess::ShaderResource },
+                               *buffer);
+    }
 
-    // create acceleration structures
-    wis::CommandList cmd_list = gfx.device.CreateCommandList(result, wis::QueueType::Graphics);
     uint64_t offset_scratch = 0;
     uint64_t offset_result = 0;
     for (int i = 0; i < 2; ++i) {
-        blas[i] = rt.CreateAccelerationStructure(result, as_buffer, offset_result, infos[i].result_size, wis::ASLevel::Bottom);
-        rt.BuildBottomLevelAS(cmd_list, blas_descs[i], blas[i], scratch_buffer.GetGPUAddress() + offset_scratch);
+        blas[i] = rt.CreateAccelerationStructure(result, *as_view.buffer, as_view.offset + offset_result, infos[i].result_size, wis::ASLevel::Bottom);
+        rt.BuildBottomLevelAS(cmd_list, blas_descs[i], blas[i], scratch_address + offset_scratch);
         offset_scratch += infos[i].scratch_size;
         offset_result += infos[i].result_size;
     }
 
     for (int i = 0; i < objects_count; ++i) {
-        mapped_instances[i].acceleration_structure_handle = blas[i != 0];
+        ui.instances[i].acceleration_structure_handle = blas[i != 0];
     }
+    std::memcpy(instance_buffer.Map<wis::AccelerationInstance>(), ui.instances.data(), sizeof(ui.instances));
+    instance_buffer.Unmap();
 
     // insert barrier
     cmd_list.BufferBarrier({ .sync_before = wis::BarrierSync::BuildRTAS,
                              .sync_after = wis::BarrierSync::BuildRTAS,
                              .access_before = wis::ResourceAccess::AccelerationStructureWrite,
                              .access_after = wis::ResourceAccess::AccelerationStructureRead | wis::ResourceAccess::AccelerationStructureWrite },
-                           as_buffer);
+                           *as_view.buffer);
 
     // build top level acceleration structure
     for (int i = 0; i < w::flight_frames; ++i) {
-        tlas[i] = rt.CreateAccelerationStructure(result, as_buffer, offset_result, infos[2].result_size, wis::ASLevel::Top);
-        rt.BuildTopLevelAS(cmd_list, tlas_desc, tlas[i], scratch_buffer.GetGPUAddress() + offset_scratch);
+        tlas[i] = rt.CreateAccelerationStructure(result, *as_view.buffer, as_view.offset + offset_result, infos[2].result_size, wis::ASLevel::Top);
+        rt.BuildTopLevelAS(cmd_list, tlas_desc, tlas[i], scratch_address + offset_scratch);
         offset_result += infos[2].result_size;
         offset_scratch += infos[2].scratch_size;
     }
-
-    cmd_list.Close();
-    gfx.ExecuteCommandLists({ cmd_list });
-    gfx.WaitForGpu();
 }
 
 void w::Scene::CreatePipeline(Graphics& gfx, std::span<wis::DescriptorBindingDesc> bindings)
 {
     wis::Result result = wis::success;
     auto& device = gfx.GetDevice();
-    auto& rt = gfx.GetRaytracing();
-    auto& allocator = gfx.GetAllocator();
 
     wis::PushConstant constants[] = {
         { .stage = wis::ShaderStages::All, .size_bytes = sizeof(RenderingConstants), .bind_register = 4 },
@@ -300,18 +445,41 @@ void w::Scene::CreatePipeline(Graphics& gfx, std::span<wis::DescriptorBindingDes
         { .stage = wis::ShaderStages::All, .type = wis::DescriptorType::ConstantBuffer },
     };
 
-    root = device.CreateRootSignature(result, constants, std::size(constants), push_desc, std::size(push_desc), bindings.data(), std::size(bindings));
+    uint64_t key = Hash64(std::as_bytes(bindings), sizeof(RenderingConstants));
+    if (key != root_key) {
+        root = device.CreateRootSignature(result, constants, std::size(constants), push_desc, std::size(push_desc), bindings.data(), std::size(bindings));
+        root_key = key;
+        pipeline_cache.clear();
+        pipelines = {};
+    }
+    GetPipeline(gfx);
+}
+
+const w::Scene::TracePipeline& w::Scene::GetPipeline(Graphics& gfx)
+{
+    uint32_t index = PipelineIndex(frame.settings);
+    if (pipelines[index]) {
+        return *pipelines[index];
+    }
 
-    // Load shaders
-    auto raygen_code = w::LoadShader("shaders/pathtrace.lib");
-    wis::Shader raygen_shader = device.CreateShader(result, raygen_code.data(), raygen_code.size());
+    uint64_t key = PipelineKey(gfx, index);
+    if (auto cached = pipeline_cache.find(key); cached != pipeline_cache.end()) {
+        return *(pipelines[index] = &cached->second);
+    }
+    // checked by PipelineKey, the store returns them without touching the files
+    auto& device = gfx.GetDevice();
+    auto& raygen = gfx.shaders.Load(device, "shaders/pathtrace.lib");
+    auto& hit = gfx.shaders.Load(device, wis::format("shaders/hit_{}_{}.lib", index / std::size(BRDF_LABELS), index % std::size(BRDF_LABELS)));
 
-    auto hit_code = w::LoadShader("shaders/hit.lib");
-    wis::Shader hit_shader = device.CreateShader(result, hit_code.data(), hit_code.size());
+    W_PROFILE_SCOPE("Create trace pipeline");
+    wis::Result result = wis::success;
+    auto& rt = gfx.GetRaytracing();
+    auto& allocator = gfx.GetAllocator();
+    TracePipeline variant{ .variant = index };
 
     // Create pipeline
     wis::ShaderView shaders[]{
-        raygen_shader, hit_shader
+        raygen.shader, hit.shader
     };
     wis::ShaderExport exports[]{
         { .entry_point = "RayGeneration", .shader_type = wis::RaytracingShaderType::Raygen },
@@ -332,19 +500,19 @@ void w::Scene::CreatePipeline(Graphics& gfx, std::span<wis::DescriptorBindingDes
         .hit_groups = hit_groups,
         .hit_group_count = std::size(hit_groups),
         .max_recursion_depth = 24,
-        .max_payload_size = 24,
+        .max_payload_size = 28,
         .max_attribute_size = 16,
     };
-    pipeline = rt.CreateRaytracingPipeline(result, rt_pipeline_desc);
+    variant.pipeline = rt.CreateRaytracingPipeline(result, rt_pipeline_desc);
 
     // Create shader binding table
     wis::ShaderBindingTableInfo sbt_info = rt.GetShaderBindingTableInfo();
 
-    const uint8_t* shader_ident = pipeline.GetShaderIdentifiers();
+    const uint8_t* shader_ident = variant.pipeline.GetShaderIdentifiers();
 
     // 1 raygen, 1 miss, 1 hit group
-    sbt_buffer = allocator.CreateBuffer(result, sbt_info.table_start_alignment * 4, wis::BufferUsage::ShaderBindingTable, wis::MemoryType::Upload, wis::MemoryFlags::Mapped);
-    auto memory = sbt_buffer.Map<uint8_t>();
+    variant.sbt_buffer = allocator.CreateBuffer(result, sbt_info.table_start_alignment * 4, wis::BufferUsage::ShaderBindingTable, wis::MemoryType::Upload, wis::MemoryFlags::Mapped);
+    auto memory = variant.sbt_buffer.Map<uint8_t>();
 
     // raygen
     uint32_t table_increment = wis::detail::aligned_size(sbt_info.entry_size, sbt_info.table_start_alignment); // not real, just for demonstration
@@ -360,21 +528,49 @@ void w::Scene::CreatePipeline(Graphics& gfx, std::span<wis::DescriptorBindingDes
     // hit group
     std::memcpy(memory, shader_ident + sbt_info.entry_size * 2, sbt_info.entry_size * std::size(hit_groups));
     memory += table_increment;
-    sbt_buffer.Unmap();
+    variant.sbt_buffer.Unmap();
+
+    auto gpu_address = variant.sbt_buffer.GetGPUAddress();
+
+    auto& tables = variant.tables;
+    tables.ray_gen_shader_table_address = gpu_address;
+    tables.miss_shader_table_address = gpu_address + table_increment;
+    tables.hit_group_table_address = gpu_address + table_increment * 2;
+    tables.callable_shader_table_address = 0;
+    tables.ray_gen_shader_table_size = sbt_info.entry_size;
+    tables.miss_shader_table_size = sbt_info.entry_size;
+    tables.hit_group_table_size = sbt_info.entry_size * std::size(hit_groups);
+    tables.callable_shader_table_size = 0;
+    tables.miss_shader_table_stride = sbt_info.entry_size;
+    tables.hit_group_table_stride = sbt_info.entry_size;
+    tables.callable_shader_table_stride = 0;
+    return *(pipelines[index] = &pipeline_cache.emplace(key, std::move(variant)).first->second);
+}
 
-    auto gpu_address = sbt_buffer.GetGPUAddress();
+uint64_t w::Scene::PipelineKey(Graphics& gfx, uint32_t index)
+{
+    auto& device = gfx.GetDevice();
+    auto& raygen = gfx.shaders.Load(device, "shaders/pathtrace.lib");
+    auto& hit = gfx.shaders.Load(device, wis::format("shaders/hit_{}_{}.lib", index / std::size(BRDF_LABELS), index % std::size(BRDF_LABELS)));
+    const uint64_t keys[]{ raygen.hash, hit.hash };
+    return Hash64(std::as_bytes(std::span{ keys }), root_key);
+}
 
-    dispatch_desc.ray_gen_shader_table_address = gpu_address;
-    dispatch_desc.miss_shader_table_address = gpu_address + table_increment;
-    dispatch_desc.hit_group_table_address = gpu_address + table_increment * 2;
-    dispatch_desc.callable_shader_table_address = 0;
-    dispatch_desc.ray_gen_shader_table_size = sbt_info.entry_size;
-    dispatch_desc.miss_shader_table_size = sbt_info.entry_size;
-    dispatch_desc.hit_group_table_size = sbt_info.entry_size * std::size(hit_groups);
-    dispatch_desc.callable_shader_table_size = 0;
-    dispatch_desc.miss_shader_table_stride = sbt_info.entry_size;
-    dispatch_desc.hit_group_table_stride = sbt_info.entry_size;
-    dispatch_desc.callable_shader_table_stride = 0;
+void w::Scene::DropStalePipelines(Graphics& gfx)
+{
+    std::vector<uint64_t> stale;
+    for (auto& [key, pipeline] : pipeline_cache) {
+        if (PipelineKey(gfx, pipeline.variant) != key) {
+            stale.push_back(key);
+        }
+    }
+    if (stale.empty()) {
+        return;
+    }
+    gfx.WaitForGpu(); // frames in flight may still trace with them
+    for (uint64_t key : stale) {
+        pipeline_cache.erase(key);
+    }
 }
 
 void w::Scene::Bind(Graphics& gfx, wis::DescriptorStorage& storage)
@@ -384,34 +580,146 @@ void w::Scene::Bind(Graphics& gfx, wis::DescriptorStorage& storage)
         rt.WriteAccelerationStructure(storage, 3, i, tlas[i]);
     }
 
-    sphere_static.Bind(storage);
+    sphere_static.Bind(gfx, storage);
 }
 
 void w::Scene::UpdateDispatch(int width, int height)
 {
-    ResetFrames();
     dispatch_desc.width = width;
     dispatch_desc.height = height;
     dispatch_desc.depth = 1;
 
-    camera.SetPerspective(std::numbers::pi_v<float> / 3.0f, float(width) / float(height), 0.1f, 1000.0f);
+    ui.camera.SetPerspective(fov, float(width) / float(height), 0.1f, 1000.0f);
+    ResetFrames();
 }
 
 void w::Scene::RotateCamera(float dx, float dy)
 {
+    ui.camera.Rotate(dx * 0.05f, dy * 0.05f);
     ResetFrames();
-    camera.Rotate(dx * 0.05f, dy * 0.05f);
 }
 
 void w::Scene::ZoomCamera(float dz)
 {
+    ui.camera.Zoom(dz);
+    ResetFrames();
+}
+
+void w::Scene::SetCameraState(const Camera::State& state)
+{
+    if (state == ui.camera.GetState()) {
+        return;
+    }
+    ui.camera.SetState(state);
     ResetFrames();
-    camera.Zoom(dz);
 }
 
 void w::Scene::ResetFrames()
 {
-    for (int i = 0; i < w::flight_frames; ++i) {
-        update_buffers[i] = true;
+    ui.resets++;
+    Publish();
+}
+
+void w::Scene::SetPreviewTarget(float ms)
+{
+    ui.preview_ms = std::max(ms, 0.0f);
+    Publish();
+}
+
+void w::Scene::SetFrameBudget(float ms)
+{
+    ui.budget_ms = std::max(ms, 0.0f);
+    Publish();
+}
+
+void w::Scene::ReloadShaders()
+{
+    ui.reloads++;
+    Publish();
+}
+
+void w::Scene::RestartAccumulation() noexcept
+{
+    update_buffers.fill(true);
+}
+
+bool w::Scene::ResetPending() const noexcept
+{
+    return std::ranges::any_of(update_buffers, [](bool b) { return b; });
+}
+
+bool w::Scene::Converged() const noexcept
+{
+    return frame.settings.accumulate && frame.limit_iterations && constants.frame_count >= uint32_t(frame.max_iterations) &&
+            !Previewing() && resolution.FullResolution() && !ResetPending() && !reload_shaders &&
+            std::ranges::none_of(update_tlas, [](bool b) { return b; }) && parameters.Version() == frame_version;
+}
+
+void w::Scene::RestoreFrames(uint32_t frame_count)
+{
+    ApplyParameters(); // a restart published before the restore must not drop it
+    update_buffers.fill(false);
+    resolution.Reset(); // the restored textures are full resolution
+    trace_scale = 1.0f;
+    constants.frame_count = frame_count;
+    frames_shown.store(frame_count, std::memory_order_relaxed);
+}
+
+void w::Scene::SetRenderSettings(const RenderSettings& settings)
+{
+    ui.settings = settings;
+    ResetFrames();
+}
+
+void w::Scene::SetCpuScene(std::unique_ptr<CpuScene> scene)
+{
+    cpu_scene = std::move(scene);
+}
+
+void w::Scene::ExportHeatmap(const std::filesystem::path& dir, uint32_t samples)
+{
+    W_PROFILE_FUNCTION();
+    if (!cpu_scene) {
+        cpu_scene = std::make_unique<CpuScene>();
     }
+    cpu_scene->Update(ui.instances, ui.materials);
+
+    w::Camera::CBuffer camera_data;
+    ui.camera.PutCBuffer(&camera_data);
+    w::CameraRays camera_rays{ camera_data, dispatch_desc.width, dispatch_desc.height };
+
+    // counters are summed over all samples
+    w::Image color{ dispatch_desc.width, dispatch_desc.height };
+    w::CounterImage counters;
+    w::CpuTracer tracer;
+    auto settings = GetRenderSettings();
+    settings.accumulate = true;
+    tracer.Render(*cpu_scene, camera_rays, settings, 0, color, &counters, samples);
+
+    std::filesystem::create_directories(dir);
+    w::WritePFM(dir / "color.pfm", color);
+
+    constexpr std::pair<const char*, uint32_t TraceCounters::*> channels[] = {
+        { "nodes", &TraceCounters::nodes },
+        { "primitives", &TraceCounters::primitives },
+        { "bounces", &TraceCounters::bounces },
+        { "shading", &TraceCounters::shading },
+    };
+    for (auto [name, member] : channels) {
+        auto channel = counters.Channel(member);
+        float max_value = 0.0f;
+        for (auto& p : channel.pixels) {
+            max_value = std::max(max_value, p.x);
+        }
+        w::WritePFM(dir / wis::format("{}.pfm", name), channel);
+        w::WritePFM(dir / wis::format("{}_false_color.pfm", name), w::FalseColor(channel, max_value));
+    }
+
+    auto total = counters.Total();
+    float pixels = float(counters.pixels.size()) * float(samples);
+    auto sphere = cpu_scene->GetMesh(CpuScene::sphere).bvh.Stats();
+    std::cout << wis::format("Heatmap {}x{} {} spp: {:.1f} nodes, {:.1f} triangles, {:.2f} bounces, {:.2f} shading evaluations per sample\n",
+                             color.width, color.height, samples, total.nodes / pixels, total.primitives / pixels, total.bounces / pixels, total.shading / pixels);
+    std::cout << wis::format("Sphere BVH: {} nodes, {} leaves, depth {}, {:.2f} triangles per leaf, SAH cost {:.2f}\n",
+                             sphere.nodes, sphere.leaves, sphere.max_depth, sphere.average_leaf_size, sphere.sah_cost);
 }
@@ -2,16 +2,44 @@
 #include "sphere.h"
 #include "consts.h"
 #include "camera.h"
+#include "dynamic_resolution.h"
+#include "render_graph.h"
+#include "sample_scheduler.h"
+#include "snapshot.h"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
 
 // lg 32ud99 w
 
 namespace w {
+inline constexpr const char* SAMPLING_LABELS[4] = { "Uniform", "Cosine", "GGX", "Mix" };
+inline constexpr const char* BRDF_LABELS[4] = { "Lambert", "LambertWithAlbedo", "GGX", "Mix" };
+inline constexpr const char* HEATMAP_LABELS[3] = { "Off", "Bounces", "Shading" };
+
 class Graphics;
+class UploadManager;
+class FrameAllocator;
+class CpuScene;
 class Scene
 {
+    // hit.lib permutation of one sampling function and BRDF with its shader tables
+    struct TracePipeline {
+        wis::RaytracingPipeline pipeline;
+        wis::Buffer sbt_buffer;
+        wis::RaytracingDispatchDesc tables{}; // size is taken from dispatch_desc
+        uint32_t variant = 0; // PipelineIndex it was created for
+    };
+
+public:
     static inline constexpr uint32_t spheres_count = 4;
+    static inline constexpr uint32_t pipeline_count = std::size(SAMPLING_LABELS) * std::size(BRDF_LABELS);
     static inline constexpr uint32_t objects_count = spheres_count + 1;
+    static inline constexpr float fov = std::numbers::pi_v<float> / 3.0f; // vertical
+    static inline constexpr uint32_t max_dispatch_samples = 16; // per pixel, keeps a single dispatch short
 
+private:
     struct RenderingConstants {
         uint32_t frame;
         uint32_t frame_count;
@@ -22,49 +50,196 @@ class Scene
         uint32_t accumulate;
         int32_t max_iterations = 500;
         uint32_t limit_iterations;
+        uint32_t wide_indices; // sphere index buffer is 32 bit
+        int32_t heatmap; // index into HEATMAP_LABELS, false color overlay of the per pixel cost
+        float heatmap_opacity = 0.75f;
+        uint32_t trace_width; // dispatch size, smaller than the textures while previewing
+        uint32_t trace_height;
+        uint32_t gamma_correction; // read by the filter pass
+        uint32_t samples; // per pixel in this dispatch
     } constants{};
 
 public:
-    Scene(Graphics& gfx, wis::Result result = wis::success);
+    // indices into SAMPLING_LABELS and BRDF_LABELS
+    struct RenderSettings {
+        int32_t sampling_fn = 0;
+        int32_t brdf = 0;
+        int32_t max_depth = 3;
+        bool accumulate = true;
+
+        bool operator==(const RenderSettings&) const = default;
+    };
+
+    // Everything the UI edits, handed to the renderer as immutable versions through a SnapshotChannel.
+    // The renderer takes the latest version at the start of a frame, the counters tell it what to redo.
+    struct Parameters {
+        RenderSettings settings{ .accumulate = false };
+        bool limit_iterations = false;
+        int32_t max_iterations = 500;
+        int32_t heatmap = 0;
+        float heatmap_opacity = 0.75f;
+        bool gamma_correction = true;
+        float preview_ms = 0.0f; // frame time target of the reduced resolution preview while input is active, 0 - off
+        float budget_ms = 0.0f; // frame time the samples per frame are scheduled for, 0 - one sample per frame
+        std::array<MaterialCBuffer, objects_count> materials{};
+        std::array<wis::AccelerationInstance, objects_count> instances{};
+        w::Camera camera;
+
+        uint32_t resets = 0; // accumulation restarts
+        uint32_t moves = 0; // instance changes, the TLAS is updated
+        uint32_t reloads = 0; // shader reloads
+    };
+
+public:
+    Scene(Graphics& gfx, UploadManager& uploads);
+    // sphere_mesh from SphereStatic::Generate
+    Scene(Graphics& gfx, UploadManager& uploads, const CompressedMesh& sphere_mesh, wis::Result result = wis::success);
     ~Scene();
 
+public:
+    // box, light and spheres of the default scene, usable without a device
+    static std::array<ObjectView, objects_count> DefaultObjects();
+    static wis::AccelerationInstance MakeInstance(uint32_t index, const ObjectView& view);
+
+public:
+    // layout expected by the shaders, RWTexture is binding 2, AS binding 3, sphere buffers binding 4
+    static std::array<wis::DescriptorBindingDesc, 5> DescriptorBindings() noexcept
+    {
+        return { {
+                { wis::DescriptorType::Texture, 1, 1, 0 },
+                { wis::DescriptorType::Sampler, 2, 1, 0 },
+                { wis::DescriptorType::RWTexture, 3, 1, 2 },
+                { wis::DescriptorType::AccelerationStructure, 4, 1, 2 },
+                { wis::DescriptorType::Buffer, 5, 2, 2 },
+        } };
+    }
+
 public:
     void RenderUI();
-    void RenderScene(Graphics& gfx, wis::CommandList& cmd_list, wis::DescriptorStorageView dstorage, uint32_t current_frame);
-    void CreateAccelerationStructures(Graphics& gfx);
+    // TLAS update and trace passes, output is the frame's accumulation texture.
+    // Accumulates `samples` more samples per pixel, 0 - as many as fit the frame budget, see SampleScheduler.
+    // Each trace pass is one dispatch of up to max_dispatch_samples.
+    void AddPasses(RenderGraph& graph, Graphics& gfx, FrameAllocator& frame_alloc, wis::DescriptorStorageView dstorage, uint32_t current_frame, RGResource output, uint32_t samples = 1);
+    void UpdateTopLevelAS(Graphics& gfx, wis::CommandList& cmd_list, FrameAllocator& frame_alloc, uint32_t current_frame);
+    void RenderScene(Graphics& gfx, wis::CommandList& cmd_list, FrameAllocator& frame_alloc, wis::DescriptorStorageView dstorage, uint32_t current_frame, uint32_t samples = 1);
+    // constants of the filter pass, which upsamples the frame's accumulation texture while previewing
+    void PushFilterConstants(wis::CommandList& cmd_list, uint32_t current_frame) const;
+    void CreateAccelerationStructures(Graphics& gfx, UploadManager& uploads);
+    // creates the root signature and the pipeline of the current settings, the others are created when selected.
+    // Bindings with the layout of the previous call keep the root signature and every pipeline created for it.
     void CreatePipeline(Graphics& gfx, std::span<wis::DescriptorBindingDesc> descs);
+    // checks the shader files again before the next frame, pipelines are rebuilt for the shaders that changed
+    void ReloadShaders();
+    // index of the hit.lib permutation, out of range settings use the default case of the shader switches
+    static constexpr uint32_t PipelineIndex(const RenderSettings& settings) noexcept
+    {
+        auto index = [](int32_t value, size_t count) { return uint32_t(value) < count ? uint32_t(value) : 0u; };
+        return index(settings.sampling_fn, std::size(SAMPLING_LABELS)) * uint32_t(std::size(BRDF_LABELS)) + index(settings.brdf, std::size(BRDF_LABELS));
+    }
     void Bind(Graphics& gfx, wis::DescriptorStorage& storage);
     void UpdateDispatch(int width, int height);
 
     void RotateCamera(float dx, float dy);
 
     void ZoomCamera(float dz);
+    // as last set, the renderer may not have picked it up yet
+    Camera::State GetCameraState() const noexcept
+    {
+        return ui.camera.GetState();
+    }
+    // restarts accumulation if the state differs
+    void SetCameraState(const Camera::State& state);
     void ResetFrames();
-    bool GammaCorrection() const { return gamma_correction; }
+    // frame time target of the preview while the camera or settings change, 0 - trace at full resolution
+    void SetPreviewTarget(float ms);
+    // frame time AddPasses schedules samples for, 0 - one sample per frame
+    void SetFrameBudget(float ms);
+    void SetRenderSettings(const RenderSettings& settings);
+    RenderSettings GetRenderSettings() const noexcept
+    {
+        return ui.settings;
+    }
+
+    // Render side: the version the current frame renders, taken by AddPasses
+    const Parameters& Rendered() const noexcept
+    {
+        return frame;
+    }
+    // true until every frame in flight has restarted accumulation after ResetFrames
+    bool ResetPending() const noexcept;
+    // Accumulation reached Max Iterations at full resolution, with no preview ramp frames left and no newer parameters
+    // published.
+    // The raygen shader returns early from then on, so further frames would show the same image.
+    bool Converged() const noexcept;
+    // continues accumulation at frame_count, for textures restored from a checkpoint
+    void RestoreFrames(uint32_t frame_count);
+    // Traces the current view on the CPU and writes radiance, the per pixel TraceCounters and their
+    // false color maps as PFM into dir. The GPU overlay only has bounces and shading, nodes and primitives are CPU only.
+    void ExportHeatmap(const std::filesystem::path& dir, uint32_t samples = 1);
+    // CPU copy of the geometry built ahead of time, so the first export does not build the BVHs
+    void SetCpuScene(std::unique_ptr<CpuScene> scene);
+    uint32_t FrameCount() const { return constants.frame_count; }
+    bool GammaCorrection() const { return frame.gamma_correction; }
+    // Render side: the current frame is traced below full resolution
+    bool Previewing() const noexcept
+    {
+        return trace_scale < 1.0f;
+    }
+    // Render side: time of the last frame, drives the preview resolution and the samples per frame
+    void EndFrame(double frame_ms) noexcept
+    {
+        resolution.EndFrame(frame_ms);
+        scheduler.EndFrame(Previewing() ? 0 : frame_samples, frame_ms); // previews are not representative
+    }
+    // Render side: samples per second with and without several samples per frame
+    const SampleScheduler::Stats& GetSampleStats() const noexcept
+    {
+        return scheduler.GetStats();
+    }
 
 private:
-    // UI Data
+    // permutation of the rendered settings, created on first use
+    const TracePipeline& GetPipeline(Graphics& gfx);
+    // pipeline_cache key of a permutation, from the current contents of its shaders
+    uint64_t PipelineKey(Graphics& gfx, uint32_t index);
+    // after a shader reload, releases the cached pipelines of shader versions no longer on disk
+    void DropStalePipelines(Graphics& gfx);
+    // UI side, makes the edits visible to the renderer
+    void Publish();
+    // render side, takes the latest version of the parameters
+    void ApplyParameters();
+    void RestartAccumulation() noexcept;
+
+private:
+    // UI side
     std::array<bool, 5> show_material_window{};
+    Parameters ui;
+    SnapshotChannel<Parameters> parameters;
+    std::atomic<uint32_t> frames_shown = 0; // constants.frame_count for the UI
+
+    // render side
+    Parameters frame;
+    uint64_t frame_version = 0;
     std::array<bool, w::flight_frames> update_tlas{};
     std::array<bool, w::flight_frames> update_buffers{};
-    bool gamma_correction = true;
-    bool limit_max_iterations = false;
-    bool accumulate = true;
-
-    int max_iterations = 100;
-    int iterations = 0;
+    bool reload_shaders = false;
+    DynamicResolution resolution;
+    float trace_scale = 1.0f; // of the current frame
+    SampleScheduler scheduler;
+    uint32_t frame_samples = 0; // per pixel, traced by the current frame
 
 public:
     wis::RootSignature root;
-    wis::RaytracingPipeline pipeline;
-    wis::Buffer sbt_buffer;
+    uint64_t root_key = 0; // hash of the root signature layout
+    // keyed by the content hashes of the shaders and root_key, pipelines[PipelineIndex] points into it
+    std::unordered_map<uint64_t, TracePipeline> pipeline_cache;
+    std::array<const TracePipeline*, pipeline_count> pipelines{};
 
     // Objects
-    wis::Buffer object_cbuffer; // push descriptor 0
-    wis::Buffer as_buffer; // blas+tlas buffer
-    wis::Buffer scratch_buffer; // blas+tlas buffer
-    wis::Buffer instance_buffer; // tlas instance buffer
-    wis::Buffer camera_buffer; // cam buffer
+    w::BufferHandle as_buffer; // blas+tlas, in Graphics::as_pool
+    w::BufferHandle scratch_buffer; // blas+tlas, in Graphics::geometry_pool
+    w::RGState as_state; // tracked by the render graph between frames
+    wis::Buffer instance_buffer; // tlas instance buffer for the initial build, updates use the frame allocator
 
     SphereStatic sphere_static; // shared geometry
     BoxStatic box_static; // shared geometry
@@ -74,14 +249,9 @@ public:
     std::array<wis::AccelerationStructure, 2> blas{}; // shall never be updated
     std::array<ObjectView, objects_count> object_views;
 
-    std::span<MaterialCBuffer> mapped_cbuffer;
-    std::span<wis::AccelerationInstance> mapped_instances;
-
     // misc
     wis::RaytracingDispatchDesc dispatch_desc{};
 
-    w::Camera camera;
-    std::span<w::Camera::CBuffer> mapped_camera;
-    std::span<RenderingConstants> mapped_rendering_constants;
+    std::unique_ptr<CpuScene> cpu_scene; // built on the first heatmap export unless given by SetCpuScene
 };
 } // namespace w
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "shader_store.h"
+#include "mapped_file.h"
+#include "hash.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+
+const w::ShaderStore::Entry& w::ShaderStore::Load(const wis::Device& device, std::filesystem::path path)
+{
+    if constexpr (wis::shader_intermediate == wis::ShaderIntermediate::DXIL) {
+        path += u".cso";
+    } else {
+        path += u".spv";
+    }
+    auto& file = files[path.string()];
+    if (file.checked) {
+        return shaders.at(file.hash);
+    }
+
+    W_PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    std::error_code time_error, size_error;
+    auto write_time = std::filesystem::last_write_time(path, time_error);
+    auto size = std::filesystem::file_size(path, size_error);
+    if (time_error || size_error) {
+        throw w::Exception(wis::format("Shader file not found: {}", path.string()));
+    }
+
+    if (file.hash == 0 || file.write_time != write_time || file.size != size) {
+        auto mapping = MappedFile::OpenRead(path);
+        auto code = mapping.Data();
+        uint64_t old_hash = file.hash;
+        file = { write_time, size, Hash64(code) };
+        stats.files++;
+        stats.bytes += code.size();
+
+        // pipelines keep nothing of their shaders, the old contents can go once no path has them
+        if (old_hash != 0 && old_hash != file.hash &&
+            std::ranges::none_of(files, [old_hash](const auto& f) { return f.second.hash == old_hash; })) {
+            shaders.erase(old_hash);
+        }
+
+        if (!shaders.contains(file.hash)) {
+            wis::Result result = wis::success;
+            wis::Shader shader = device.CreateShader(result, code.data(), uint32_t(code.size()));
+            CheckResult(result);
+            shaders.emplace(file.hash, Entry{ std::move(shader), file.hash });
+            stats.shaders++;
+        }
+    }
+    file.checked = true;
+    stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return shaders.at(file.hash);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "consts.h"
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace w {
+// Compiled shaders addressed by the hash of their contents.
+// A file is mapped and handed to CreateShader without a copy, then unmapped, the device keeps its own copy.
+// Files with equal contents share one wis::Shader. A file is hashed again only when its size or write time changed,
+// so pipelines keyed by the hashes of their shaders are rebuilt exactly when a shader changed on disk.
+// The shader of contents no file has any more is destroyed.
+class ShaderStore
+{
+public:
+    struct Entry {
+        wis::Shader shader;
+        uint64_t hash = 0;
+    };
+    struct Stats {
+        uint32_t files = 0; // mapped and hashed
+        uint32_t shaders = 0; // created, less than files when contents repeat
+        uint64_t bytes = 0; // mapped
+        double milliseconds = 0.0; // spent loading
+    };
+
+public:
+    // path without the .cso/.spv extension, the entry lives until the file changes or the store goes away
+    const Entry& Load(const wis::Device& device, std::filesystem::path path);
+    // the next Load of each path checks the file again, for shaders replaced while running
+    void Revalidate() noexcept
+    {
+        for (auto& [path, file] : files) {
+            file.checked = false;
+        }
+    }
+    const Stats& GetStats() const noexcept
+    {
+        return stats;
+    }
+
+private:
+    struct File {
+        std::filesystem::file_time_type write_time;
+        uintmax_t size = 0;
+        uint64_t hash = 0;
+        bool checked = false; // write time and size are current
+    };
+
+private:
+    std::unordered_map<std::string, File> files; // by path
+    std::unordered_map<uint64_t, Entry> shaders; // by content hash
+    Stats stats;
+};
+} // namespace w
@@ -12,8 +12,21 @@ float4 main(PS_INPUT input) : SV_TARGET
     uint width, height;
     texture_rt[pushConstants.frameIndex].GetDimensions(width, height);
 
-    // Convert UV coordinates to integer texel coordinates
-    int2 texelCoords = int2(input.uv * float2(width, height));
-    float4 out_col = texture_rt[pushConstants.frameIndex].Load(texelCoords);
-    return pow(out_col, 1.0 / 2.2);
-}
\ No newline at end of file
+    float4 out_col;
+    if (pushConstants.traceWidth < width || pushConstants.traceHeight < height) {
+        // preview traced into the top left corner, launch rows land on texture rows 1..traceHeight (see RayGeneration)
+        int2 size = int2(pushConstants.traceWidth, pushConstants.traceHeight);
+        float2 p = clamp(input.uv * float2(size) - 0.5, 0.0, float2(size - 1));
+        int2 p0 = int2(p);
+        int2 p1 = min(p0 + 1, size - 1);
+        float2 f = p - float2(p0);
+        float4 top = lerp(texture_rt[pushConstants.frameIndex].Load(int2(p0.x, p0.y + 1)), texture_rt[pushConstants.frameIndex].Load(int2(p1.x, p0.y + 1)), f.x);
+        float4 bottom = lerp(texture_rt[pushConstants.frameIndex].Load(int2(p0.x, p1.y + 1)), texture_rt[pushConstants.frameIndex].Load(int2(p1.x, p1.y + 1)), f.x);
+        out_col = lerp(top, bottom, f.y);
+    } else {
+        // Convert UV coordinates to integer texel coordinates
+        int2 texelCoords = int2(input.uv * float2(width, height));
+        out_col = texture_rt[pushConstants.frameIndex].Load(texelCoords);
+    }
+    return pushConstants.gammaCorrection ? pow(out_col, 1.0 / 2.2) : out_col;
+}
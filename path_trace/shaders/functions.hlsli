@@ -49,6 +49,17 @@ float int_scale()
     return 256.0f;
 }
 
+// Octahedral normal, 2x snorm16 (x low, y high), mirrors w::DecodeOctahedral
+float3 DecodeOctahedral(uint e)
+{
+    float2 f = max(float2(int2(asint(e << 16), asint(e)) >> 16) / 32767.0f, -1.0f);
+    float3 n = float3(f.x, f.y, 1.0f - abs(f.x) - abs(f.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 // Normal points outward for rays exiting the surface, else is flipped.
 float3 offset_ray(const float3 p, const float3 n)
 {
@@ -198,4 +209,22 @@ float EvaluateMixBRDF(float3 N, float3 V, float3 L, Material mat)
 float EvaluateMixPDF(float3 N, float3 V, float3 L, Material mat)
 {
     return EvaluateGGXPDF(N, V, L, mat.roughness) + (dot(L, N) / PI) * mat.roughness;
-}
\ No newline at end of file
+}
+// Polynomial fit of the Turbo colormap, x in [0..1]
+float3 FalseColor(float x)
+{
+    const float4 red4 = float4(0.13572138, 4.61539260, -42.66032258, 132.13108234);
+    const float4 green4 = float4(0.09140261, 2.19418839, 4.84296658, -14.18503333);
+    const float4 blue4 = float4(0.10667330, 12.64194608, -60.58204836, 110.36276771);
+    const float2 red2 = float2(-152.94239396, 59.28637943);
+    const float2 green2 = float2(4.27729857, 2.82956604);
+    const float2 blue2 = float2(-89.90310912, 27.34824973);
+
+    x = saturate(x);
+    float4 v4 = float4(1.0, x, x * x, x * x * x);
+    float2 v2 = v4.zw * v4.z;
+    return float3(
+            dot(v4, red4) + dot(v2, red2),
+            dot(v4, green4) + dot(v2, green2),
+            dot(v4, blue4) + dot(v2, blue2));
+}
@@ -7,9 +7,18 @@
 [[vk::binding(0, 3)]] RWTexture2D<float4> image[] : register(u0, space3);
 [[vk::binding(0, 4)]] RaytracingAccelerationStructure scene[] : register(t0, space4);
 
-[[vk::binding(0, 5)]] StructuredBuffer<float3> sphere_nrm[] : register(t0, space5); // bindings 0 is vn
+[[vk::binding(0, 5)]] StructuredBuffer<uint> sphere_nrm[] : register(t0, space5); // bindings 0 is vn, octahedral encoded
 [[vk::binding(0, 5)]] StructuredBuffer<uint> indices[] : register(t0, space6); // overloading binding 5 for indices, 1 is indices
 
+// Permutations are compiled with SAMPLING_FN and BRDF_FN defined, which folds the switches below to a single case.
+// Without them the functions are selected by the push constants at every bounce.
+#ifndef SAMPLING_FN
+#define SAMPLING_FN frameIndex.samplingFn
+#endif
+#ifndef BRDF_FN
+#define BRDF_FN frameIndex.BRDF
+#endif
+
 static const float3 faceNormalsBox[] = {
     float3(0, 0, 1),
     float3(0, 0, -1),
@@ -19,9 +28,24 @@ static const float3 faceNormalsBox[] = {
     float3(0, 1, 0),
 };
 
+// 16 bit indices are packed in pairs
+uint3 LoadSphereIndices(uint faceID)
+{
+    uint base = faceID * 3;
+    if (frameIndex.wideIndices) {
+        return uint3(indices[1][base + 0], indices[1][base + 1], indices[1][base + 2]);
+    }
+
+    uint3 i = uint3(base, base + 1, base + 2);
+    return uint3(
+            (indices[1][i.x >> 1] >> ((i.x & 1) * 16)) & 0xFFFF,
+            (indices[1][i.y >> 1] >> ((i.y & 1) * 16)) & 0xFFFF,
+            (indices[1][i.z >> 1] >> ((i.z & 1) * 16)) & 0xFFFF);
+}
+
 float3 SampleSelect(float2 sigma, float3 normal, float roughness, float bias)
 {
-    switch (frameIndex.samplingFn) {
+    switch (SAMPLING_FN) {
     default:
     case 0:
         return UniformHemisphereSample(sigma, normal);
@@ -37,7 +61,7 @@ float3 SampleSelect(float2 sigma, float3 normal, float roughness, float bias)
 }
 float PDFSelect(Material mat, float3 V, float3 L, float3 N, float bias)
 {
-    switch (frameIndex.samplingFn) {
+    switch (SAMPLING_FN) {
     default:
     case 0:
         return 1.0 / (2.0 * PI);
@@ -52,7 +76,7 @@ float PDFSelect(Material mat, float3 V, float3 L, float3 N, float bias)
 
 float3 ComputeBRDF(Material mat, float3 V, float3 L, float3 N, float bias)
 {
-    switch (frameIndex.BRDF) {
+    switch (BRDF_FN) {
     default:
     case 0:
         return float3(1.0 / PI, 1.0 / PI, 1.0 / PI);
@@ -95,6 +119,7 @@ float3 ComputeBRDF(Material mat, float3 V, float3 L, float3 N, float bias)
     payload.depth++;
     TraceRay(scene[frameIndex.frameIndex], RAY_FLAG_NONE, 0xff, 0, 0, 0, rayDesc, payload);
 
+    payload.shadeCount++;
     float3 brdf = ComputeBRDF(mat, V, newDir, normal, bias);
     float cosTheta = max(dot(normal, newDir), 0.0);
     payload.color = payload.color * brdf * cosTheta / PDFSelect(mat, V, newDir, normal, bias);
@@ -114,15 +139,12 @@ float3 ComputeBRDF(Material mat, float3 V, float3 L, float3 N, float bias)
     uint2 launchDim = DispatchRaysDimensions().xy;
     uint faceID = PrimitiveIndex();
 
-    const uint3 aindices = uint3(
-            indices[1][faceID * 3 + 0],
-            indices[1][faceID * 3 + 1],
-            indices[1][faceID * 3 + 2]);
+    const uint3 aindices = LoadSphereIndices(faceID);
 
     const float3 vn[3] = {
-        sphere_nrm[0][aindices.x],
-        sphere_nrm[0][aindices.y],
-        sphere_nrm[0][aindices.z],
+        DecodeOctahedral(sphere_nrm[0][aindices.x]),
+        DecodeOctahedral(sphere_nrm[0][aindices.y]),
+        DecodeOctahedral(sphere_nrm[0][aindices.z]),
     };
 
     float bias = saturate(NextRand(payload.randSeed) + 0.01);
@@ -141,6 +163,7 @@ float3 ComputeBRDF(Material mat, float3 V, float3 L, float3 N, float bias)
     payload.depth++;
     TraceRay(scene[frameIndex.frameIndex], RAY_FLAG_NONE, 0xff, 0, 0, 0, rayDesc, payload);
 
+    payload.shadeCount++;
     float3 brdf = ComputeBRDF(mat, V, newDir, normal, bias);
     float cosTheta = max(dot(normal, newDir), 0.0);
     payload.color = payload.color * brdf * cosTheta / PDFSelect(mat, V, newDir, normal, bias);
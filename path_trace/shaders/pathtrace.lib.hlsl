@@ -11,38 +11,49 @@ static const float3 skyTop = float3(0.24, 0.44, 0.72);
 static const float3 skyBottom = float3(0.75, 0.86, 0.93);
 
 [shader("raygeneration")] void RayGeneration() {
-    if (frameIndex.limitIterations && frameIndex.maxIterations <= frameIndex.frameCount) {
-        return;
-    }
-
     uint3 LaunchID = DispatchRaysIndex();
     uint3 LaunchSize = DispatchRaysDimensions();
 
     const float2 pixelCenter = float2(LaunchID.xy) + float2(0.5, 0.5);
     const float2 inUV = pixelCenter / float2(LaunchSize.xy);
     float2 d = inUV * 2.0 - 1.0;
-    float4 target = mul(camera.invProjection, float4(d.x, d.y, 1, 1));
 
     RayDesc rayDesc;
-    rayDesc.Origin = mul(camera.invView, float4(0, 0, 0, 1)).xyz;
-    rayDesc.Direction = mul(camera.invView, float4(normalize(target.xyz), 0)).xyz;
+    rayDesc.Origin = camera.rayOrigin.xyz;
+    rayDesc.Direction = normalize(camera.rayForward.xyz + d.x * camera.rayRight.xyz + d.y * camera.rayUp.xyz);
     rayDesc.TMin = 0.01;
     rayDesc.TMax = 1000.0;
 
-    Payload payload = (Payload)0;
-    payload.depth++;
-    payload.randSeed = InitRand(LaunchID.x + LaunchID.y * LaunchSize.x, frameIndex.frameCount, 16);
-    TraceRay(scene[frameIndex.frameIndex], RAY_FLAG_CULL_BACK_FACING_TRIANGLES, 0xff, 0, 0, 0, rayDesc, payload);
-
     // transform y = 1.0 - y
 
     int2 pixel = int2(LaunchID.x, LaunchSize.y - LaunchID.y);
-    if (frameIndex.accumulate) {
-        float4 color = image[frameIndex.frameIndex][pixel];
-        color = (frameIndex.frameCount * color + float4(payload.color, 1.0f)) / (frameIndex.frameCount + 1);
+    // the running average stays in registers between the samples of a dispatch
+    float4 color = frameIndex.accumulate ? image[frameIndex.frameIndex][pixel] : float4(0, 0, 0, 1);
+    uint frameCount = frameIndex.frameCount;
+    for (uint s = 0; s < frameIndex.samples; s++, frameCount++) {
+        if (frameIndex.limitIterations && frameIndex.maxIterations <= frameCount) {
+            break;
+        }
+
+        Payload payload = (Payload)0;
+        payload.depth++;
+        payload.randSeed = InitRand(LaunchID.x + LaunchID.y * LaunchSize.x, frameCount, 16);
+        TraceRay(scene[frameIndex.frameIndex], RAY_FLAG_CULL_BACK_FACING_TRIANGLES, 0xff, 0, 0, 0, rayDesc, payload);
+
+        // Hardware traversal does not expose node or triangle counts, those are in the CPU heatmap export
+        if (frameIndex.heatmap) {
+            float cost = frameIndex.heatmap == 1 ? payload.depth - 1 : payload.shadeCount;
+            payload.color = lerp(payload.color, FalseColor(saturate(cost / max(frameIndex.maxDepth - 1, 1))), frameIndex.heatmapOpacity);
+        }
+
+        if (frameIndex.accumulate) {
+            color = (frameCount * color + float4(payload.color, 1.0f)) / (frameCount + 1);
+        } else {
+            color = float4(payload.color, 1.0f);
+        }
+    }
+    if (frameCount != frameIndex.frameCount) {
         image[frameIndex.frameIndex][pixel] = color;
-    } else {
-        image[frameIndex.frameIndex][pixel] = float4(payload.color, 1.0f);
     }
 }
 
@@ -6,6 +6,7 @@ struct Payload
     
     uint randSeed;
     bool allowReflection;
+    uint shadeCount; // BRDF evaluations along the path, for the heatmap
 };
 struct FrameIndex
 {
@@ -18,6 +19,13 @@ struct FrameIndex
     bool accumulate;
     int maxIterations;
     bool limitIterations;
+    bool wideIndices;
+    int heatmap; // 0 - off, 1 - bounces, 2 - shading evaluations
+    float heatmapOpacity;
+    uint traceWidth; // DispatchRaysDimensions, smaller than the textures while previewing
+    uint traceHeight;
+    bool gammaCorrection;
+    uint samples; // per pixel in this dispatch, accumulated in order as if traced by that many frames
 };
 struct FrameCBuffer
 {
@@ -26,6 +34,12 @@ struct FrameCBuffer
     matrix viewProjection;
     matrix invView;
     matrix invProjection;
+
+    // primary ray basis, see Camera::CBuffer
+    float4 rayOrigin;
+    float4 rayForward;
+    float4 rayRight;
+    float4 rayUp;
 };
 
 struct Material {
@@ -0,0 +1,167 @@
+#pragma once
+#include <DirectXMath.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+// CPU ports of shaders/functions.hlsli, kept line for line so both sides can be checked against each other
+namespace w::shading {
+inline constexpr float pi = std::numbers::pi_v<float>;
+
+// Generates a seed for a random number generator from 2 inputs plus a backoff
+constexpr uint32_t InitRand(uint32_t val0, uint32_t val1, uint32_t backoff = 16) noexcept
+{
+    uint32_t v0 = val0, v1 = val1, s0 = 0;
+    for (uint32_t n = 0; n < backoff; n++) {
+        s0 += 0x9e3779b9;
+        v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+        v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+    }
+    return v0;
+}
+
+// Takes our seed, updates it, and returns a pseudorandom float in [0..1]
+constexpr float NextRand(uint32_t& s) noexcept
+{
+    s = (1664525u * s + 1013904223u);
+    return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+constexpr DirectX::XMFLOAT2 NextRand2(uint32_t& s) noexcept
+{
+    float x = NextRand(s);
+    return { x, NextRand(s) };
+}
+
+// Mirrors offset_ray: normal points outward for rays exiting the surface, else is flipped
+inline DirectX::XMFLOAT3 OffsetRay(const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT3& n) noexcept
+{
+    constexpr float origin = 1.0f / 32.0f;
+    constexpr float float_scale = 1.0f / 65536.0f;
+    constexpr float int_scale = 256.0f;
+
+    auto offset = [&](float p, float n) {
+        int32_t of_i = int32_t(int_scale * n);
+        float p_i = std::bit_cast<float>(std::bit_cast<int32_t>(p) + (p < 0 ? -of_i : of_i));
+        return std::abs(p) < origin ? p + float_scale * n : p_i;
+    };
+    return { offset(p.x, n.x), offset(p.y, n.y), offset(p.z, n.z) };
+}
+
+// Utility function to get a vector perpendicular to an input vector
+//    (from "Efficient Construction of Perpendicular Vectors Without Branching")
+inline DirectX::XMVECTOR XM_CALLCONV GetPerpendicularVector(DirectX::FXMVECTOR u) noexcept
+{
+    using namespace DirectX;
+    XMFLOAT3 a;
+    XMStoreFloat3(&a, XMVectorAbs(u));
+    uint32_t xm = ((a.x - a.y) < 0 && (a.x - a.z) < 0) ? 1 : 0;
+    uint32_t ym = (a.y - a.z) < 0 ? (1 ^ xm) : 0;
+    uint32_t zm = 1 ^ (xm | ym);
+    return XMVector3Cross(u, XMVectorSet(float(xm), float(ym), float(zm), 0.0f));
+}
+
+// Uniform sphere sampling function, y = 1 is the top of the sphere
+inline DirectX::XMVECTOR XM_CALLCONV UniformHemisphereSample(DirectX::XMFLOAT2 sigma, DirectX::FXMVECTOR normal) noexcept
+{
+    using namespace DirectX;
+    XMVECTOR bitangent = GetPerpendicularVector(normal);
+    XMVECTOR tangent = XMVector3Cross(bitangent, normal);
+    float r = std::sqrt(std::max(0.0f, 1.0f - sigma.x * sigma.x));
+    float phi = 2.0f * pi * sigma.y;
+
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * sigma.x;
+}
+
+inline DirectX::XMVECTOR XM_CALLCONV CosineWeightedHemisphereSample(DirectX::XMFLOAT2 sigma, DirectX::FXMVECTOR normal) noexcept
+{
+    using namespace DirectX;
+    XMVECTOR bitangent = GetPerpendicularVector(normal);
+    XMVECTOR tangent = XMVector3Cross(bitangent, normal);
+    float r = std::sqrt(sigma.x);
+    float phi = 2.0f * pi * sigma.y;
+
+    // Get our cosine-weighted hemisphere lobe sample direction
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * std::sqrt(std::max(0.0f, 1.0f - sigma.x));
+}
+
+// Schlick's approximation for Fresnel reflection, scalar since every caller passes a grey F0
+inline float SchlickFresnel(float R0, float U) noexcept
+{
+    return R0 + (1.0f - R0) * std::pow(1.0f - U, 5.0f);
+}
+inline float LagardeFresnel(float F0, float U) noexcept
+{
+    return F0 + (1.0f - F0) * std::exp2((-5.55473f * U - 6.983146f) * U);
+}
+
+inline float SmithGGX(float NdotV, float NdotL, float roughness) noexcept
+{
+    float k = roughness + 1.0f;
+    k = (k * k) / 8.0f;
+
+    float G1 = NdotV / (NdotV * (1.0f - k) + k);
+    float G2 = NdotL / (NdotL * (1.0f - k) + k);
+    return G1 * G2;
+}
+
+inline float ThrowbridgeReitzGGX(float NdotH, float roughness) noexcept
+{
+    float alpha2 = roughness * roughness * roughness * roughness;
+    float ndh2 = NdotH * NdotH;
+
+    float tail = ndh2 * (alpha2 - 1.0f) + 1.0f;
+    float denom = pi * tail * tail;
+
+    return alpha2 / denom;
+}
+
+inline float CookTorrance(float NdotV, float NdotL, float NdotH, float VdotH, float LdotH, float roughness, float F0) noexcept
+{
+    float D = ThrowbridgeReitzGGX(NdotH, roughness);
+    float G = SmithGGX(NdotV, NdotL, roughness);
+    float F = LagardeFresnel(F0, LdotH);
+
+    return D * G * F / (4.0f * NdotV * NdotL);
+}
+inline float XM_CALLCONV EvaluateCookTorrance(DirectX::FXMVECTOR N, DirectX::FXMVECTOR V, DirectX::FXMVECTOR L, float roughness) noexcept
+{
+    using namespace DirectX;
+    XMVECTOR H = XMVector3Normalize(V + L);
+    float NdotV = XMVectorGetX(XMVector3Dot(N, V));
+    float NdotL = XMVectorGetX(XMVector3Dot(N, L));
+    float NdotH = XMVectorGetX(XMVector3Dot(N, H));
+    float VdotH = XMVectorGetX(XMVector3Dot(V, H));
+    float LdotH = XMVectorGetX(XMVector3Dot(L, H));
+
+    return CookTorrance(NdotV, NdotL, NdotH, VdotH, LdotH, roughness, 1);
+}
+
+// GGX microfacet distribution function
+// returns a microfacet normal in the hemisphere around the normal
+inline DirectX::XMVECTOR XM_CALLCONV GetGGXMicrofacet(DirectX::XMFLOAT2 sigma, DirectX::FXMVECTOR normal, float roughness) noexcept
+{
+    using namespace DirectX;
+    XMVECTOR B = GetPerpendicularVector(normal);
+    XMVECTOR T = XMVector3Cross(B, normal);
+
+    float a2 = roughness * roughness * roughness * roughness;
+    float cosThetaH = std::sqrt(std::max(0.0f, (1.0f - sigma.x) / ((a2 - 1.0f) * sigma.x + 1)));
+    float sinThetaH = std::sqrt(std::max(0.0f, 1.0f - cosThetaH * cosThetaH));
+    float phiH = sigma.y * pi * 2.0f;
+
+    return T * (sinThetaH * std::cos(phiH)) + B * (sinThetaH * std::sin(phiH)) + normal * cosThetaH;
+}
+
+inline float XM_CALLCONV EvaluateGGXPDF(DirectX::FXMVECTOR N, DirectX::FXMVECTOR V, DirectX::FXMVECTOR L, float roughness) noexcept
+{
+    using namespace DirectX;
+    XMVECTOR H = XMVector3Normalize(V + L);
+    float NdotH = XMVectorGetX(XMVector3Dot(N, H));
+    float VdotH = XMVectorGetX(XMVector3Dot(V, H));
+
+    float D = ThrowbridgeReitzGGX(NdotH, roughness);
+    return D * NdotH / (4.0f * VdotH);
+}
+} // namespace w::shading
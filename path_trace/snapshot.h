@@ -0,0 +1,147 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+namespace w {
+// Latest version of a value, written by one thread and read by any number of threads without locks.
+// Each slot holds one version. Publish fills a slot that is neither the latest nor held by a reader, so readers never
+// wait for the writer. With at most max_readers views alive at once there always is such a slot, and the writer
+// does not wait for readers either. A reader that loses a race with Publish retries on the newer version.
+template<typename T, uint32_t max_readers = 2>
+class SnapshotChannel
+{
+    static constexpr uint32_t slot_count = max_readers + 2;
+    static constexpr uint64_t slot_bits = 8;
+    static_assert(slot_count < (1u << slot_bits));
+
+    struct alignas(64) Slot {
+        T value{};
+        std::atomic<uint32_t> readers = 0;
+    };
+
+public:
+    // pins the version it reads until destroyed
+    class View
+    {
+    public:
+        View() = default;
+        View(View&& o) noexcept
+            : slot(std::exchange(o.slot, nullptr)), version(o.version)
+        {
+        }
+        View& operator=(View&& o) noexcept
+        {
+            if (this != &o) {
+                Release();
+                slot = std::exchange(o.slot, nullptr);
+                version = o.version;
+            }
+            return *this;
+        }
+        ~View()
+        {
+            Release();
+        }
+
+    public:
+        const T& operator*() const noexcept
+        {
+            return slot->value;
+        }
+        const T* operator->() const noexcept
+        {
+            return &slot->value;
+        }
+        explicit operator bool() const noexcept
+        {
+            return slot;
+        }
+        // increases with every Publish, 0 for an empty view
+        uint64_t Version() const noexcept
+        {
+            return version;
+        }
+
+    private:
+        friend class SnapshotChannel;
+        View(Slot* slot, uint64_t version) noexcept
+            : slot(slot), version(version)
+        {
+        }
+        void Release() noexcept
+        {
+            if (slot) {
+                slot->readers.fetch_sub(1, std::memory_order_release);
+                slot = nullptr;
+            }
+        }
+
+    private:
+        Slot* slot = nullptr;
+        uint64_t version = 0;
+    };
+
+public:
+    explicit SnapshotChannel(const T& initial = {})
+    {
+        slots[0].value = initial;
+        latest.store(Pack(1, 0), std::memory_order_release);
+    }
+    SnapshotChannel(const SnapshotChannel&) = delete;
+    SnapshotChannel& operator=(const SnapshotChannel&) = delete;
+
+public:
+    // writer thread only, returns the version readers will see
+    uint64_t Publish(const T& value)
+    {
+        uint64_t current = latest.load(std::memory_order_relaxed);
+        uint32_t current_slot = uint32_t(current & slot_mask);
+        for (uint32_t i = 1;; i++) {
+            uint32_t s = (current_slot + i) % slot_count;
+            // pairs with the increment in Read: either this sees the reader, or the reader sees the newer version
+            if (s != current_slot && slots[s].readers.load(std::memory_order_seq_cst) == 0) {
+                slots[s].value = value;
+                uint64_t version = (current >> slot_bits) + 1;
+                latest.store(Pack(version, s), std::memory_order_seq_cst);
+                return version;
+            }
+            if (i % slot_count == 0) {
+                std::this_thread::yield(); // more readers than max_readers hold views
+            }
+        }
+    }
+
+    // any thread, never blocks
+    View Read() const noexcept
+    {
+        while (true) {
+            uint64_t packed = latest.load(std::memory_order_seq_cst);
+            Slot& slot = slots[packed & slot_mask];
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            // the writer may have moved on and started filling the slot before it saw this reader
+            if (latest.load(std::memory_order_seq_cst) == packed) {
+                return View{ &slot, packed >> slot_bits };
+            }
+            slot.readers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    uint64_t Version() const noexcept
+    {
+        return latest.load(std::memory_order_acquire) >> slot_bits;
+    }
+
+private:
+    static constexpr uint64_t slot_mask = (1u << slot_bits) - 1;
+    static constexpr uint64_t Pack(uint64_t version, uint32_t slot) noexcept
+    {
+        return version << slot_bits | slot;
+    }
+
+private:
+    mutable std::array<Slot, slot_count> slots;
+    std::atomic<uint64_t> latest;
+};
+} // namespace w
@@ -1,204 +1,95 @@
 #include "sphere.h"
 #include "graphics.h"
+#include "upload.h"
+#include "vertex_format.h"
+#include "mesh_optimizer.h"
+#include "profiler.h"
+#include "uv_sphere.h"
 #include <numbers>
 #include <algorithm>
+#include <cstring>
+#include <iostream>
 #include <imgui.h>
 
-struct uv_sphere_generator {
-    // https://gist.github.com/Pikachuxxxx/5c4c490a7d7679824e0e18af42918efc
-    static std::tuple<std::vector<DirectX::XMFLOAT3>, std::vector<DirectX::XMFLOAT3>, std::vector<uint32_t>> generate(uint32_t latitudes, uint32_t longitudes) noexcept
-    {
-        const float radius = 1.0f;
-        std::vector<DirectX::XMFLOAT3> vertices;
-        std::vector<DirectX::XMFLOAT3> normals;
-        std::vector<DirectX::XMFLOAT2> uv;
-        std::vector<uint32_t> indices;
-
-        float nx, ny, nz, lengthInv = 1.0f / radius; // normal
-        // Temporary vertex
-        struct Vertex {
-            float x, y, z, s, t; // Postion and Texcoords
-        };
-
-        float deltaLatitude = std::numbers::pi_v<float> / latitudes;
-        float deltaLongitude = 2 * std::numbers::pi_v<float> / longitudes;
-        float latitudeAngle;
-        float longitudeAngle;
-
-        // Compute all vertices first except normals
-        for (int i = 0; i <= latitudes; ++i) {
-            latitudeAngle = std::numbers::pi_v<float> / 2 - i * deltaLatitude; /* Starting -pi/2 to pi/2 */
-            float xy = radius * cosf(latitudeAngle); /* r * cos(phi) */
-            float z = radius * sinf(latitudeAngle); /* r * sin(phi )*/
-
-            /*
-             * We add (latitudes + 1) vertices per longitude because of equator,
-             * the North pole and South pole are not counted here, as they overlap.
-             * The first and last vertices have same position and normal, but
-             * different tex coords.
-             */
-            for (int j = 0; j <= longitudes; ++j) {
-                longitudeAngle = j * deltaLongitude;
-
-                Vertex vertex;
-                vertex.x = xy * cosf(longitudeAngle); /* x = r * cos(phi) * cos(theta)  */
-                vertex.y = xy * sinf(longitudeAngle); /* y = r * cos(phi) * sin(theta) */
-                vertex.z = z; /* z = r * sin(phi) */
-                vertex.s = (float)j / longitudes; /* s */
-                vertex.t = (float)i / latitudes; /* t */
-                vertices.push_back(DirectX::XMFLOAT3(vertex.x, vertex.y, vertex.z));
-                uv.push_back(DirectX::XMFLOAT2(vertex.s, vertex.t));
-
-                // normalized vertex normal
-                nx = vertex.x * lengthInv;
-                ny = vertex.y * lengthInv;
-                nz = vertex.z * lengthInv;
-                normals.push_back(DirectX::XMFLOAT3(nx, ny, nz));
-            }
-        }
-
-        /*
-         *  Indices
-         *  k1--k1+1
-         *  |  / |
-         *  | /  |
-         *  k2--k2+1
-         */
-        unsigned int k1, k2;
-        for (int i = 0; i < latitudes; ++i) {
-            k1 = i * (longitudes + 1);
-            k2 = k1 + longitudes + 1;
-            // 2 Triangles per latitude block excluding the first and last longitudes blocks
-            for (int j = 0; j < longitudes; ++j, ++k1, ++k2) {
-                if (i != 0) {
-                    indices.push_back(k1);
-                    indices.push_back(k2);
-                    indices.push_back(k1 + 1);
-                }
-
-                if (i != (latitudes - 1)) {
-                    indices.push_back(k1 + 1);
-                    indices.push_back(k2);
-                    indices.push_back(k2 + 1);
-                }
-            }
-        }
-        return { vertices, normals, indices };
-    }
-};
-
-w::SphereStatic::SphereStatic(w::Graphics& gfx)
+w::SphereStatic::SphereStatic(w::Graphics& gfx, w::UploadManager& uploads)
+    : SphereStatic(gfx, uploads, Generate())
 {
-    using namespace wis;
-    auto& device = gfx.GetDevice();
-    auto& alloc = gfx.GetAllocator();
-    auto& rt = gfx.GetRaytracing();
-    wis::Result result = wis::success;
-
-    auto [vertices, normals, indices] = uv_sphere_generator::generate(32, 32);
-    list.vertex_count = (uint32_t)vertices.size();
-    list.index_count = (uint32_t)indices.size();
-
-    list.vertex_buffer = alloc.CreateBuffer(result, list.vertex_count * sizeof(DirectX::XMFLOAT3), BufferUsage::VertexBuffer | BufferUsage::CopyDst | BufferUsage::AccelerationStructureInput);
-    list.index_buffer = alloc.CreateBuffer(result, list.index_count * sizeof(uint32_t), BufferUsage::IndexBuffer | BufferUsage::CopyDst | BufferUsage::AccelerationStructureInput);
-    normal_buffer = alloc.CreateBuffer(result, list.vertex_count * sizeof(DirectX::XMFLOAT3), BufferUsage::StorageBuffer | BufferUsage::CopyDst);
-
-    // create staging buffer
-    auto staging = alloc.CreateUploadBuffer(result, list.vertex_count * sizeof(DirectX::XMFLOAT3) * 2 + list.index_count * sizeof(uint32_t));
-
-    DirectX::XMFLOAT3* vertex_data = staging.Map<DirectX::XMFLOAT3>();
-    std::copy(vertices.begin(), vertices.end(), vertex_data);
-
-    DirectX::XMFLOAT3* normal_data = vertex_data + list.vertex_count;
-    std::copy(normals.begin(), normals.end(), normal_data);
-
-    uint32_t* index_data = (uint32_t*)(normal_data + list.vertex_count);
-    std::copy(indices.begin(), indices.end(), index_data);
-    staging.Unmap();
+}
 
-    // upload data
-    auto cmd_list = device.CreateCommandList(result, wis::QueueType::Graphics);
-    cmd_list.CopyBuffer(staging, list.vertex_buffer, { .size_bytes = list.vertex_count * sizeof(DirectX::XMFLOAT3) });
-    cmd_list.CopyBuffer(staging, normal_buffer, { .src_offset = list.vertex_count * sizeof(DirectX::XMFLOAT3), .size_bytes = list.vertex_count * sizeof(DirectX::XMFLOAT3) });
-    cmd_list.CopyBuffer(staging, list.index_buffer, { .src_offset = list.vertex_count * sizeof(DirectX::XMFLOAT3) * 2, .size_bytes = list.index_count * sizeof(uint32_t) });
-    cmd_list.Close();
+w::CompressedMesh w::SphereStatic::Generate()
+{
+    W_PROFILE_FUNCTION();
+    auto [vertices, normals, indices] = uv_sphere_generator::generate(segments, segments);
+    auto report = w::OptimizeMesh(vertices, normals, indices);
+#if defined(W_PROFILE) // profiling builds only, every Scene and headless renderer generates the sphere
+    std::cout << wis::format("Sphere mesh: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overfetch {:.3f} -> {:.3f} ({:.2f} ms)\n",
+                             report.before.acmr, report.after.acmr,
+                             report.before.atvr, report.after.atvr,
+                             report.before.overfetch, report.after.overfetch,
+                             report.milliseconds);
+#else
+    (void)report;
+#endif
+
+    return w::CompressMesh(vertices, normals, indices);
+}
 
-    gfx.ExecuteCommandLists({ cmd_list });
-    gfx.WaitForGpu();
+w::SphereStatic::SphereStatic(w::Graphics& gfx, w::UploadManager& uploads, const w::CompressedMesh& mesh)
+{
+    W_PROFILE_SCOPE("SphereStatic");
+    list.vertex_count = mesh.vertex_count;
+    list.index_count = mesh.index_count;
+    list.index_type = mesh.wide_indices ? wis::IndexType::UInt32 : wis::IndexType::UInt16;
+
+    const uint64_t vertex_bytes = mesh.positions.size() * sizeof(DirectX::XMFLOAT3);
+    const uint64_t normal_bytes = mesh.normals.size() * sizeof(uint32_t);
+    const uint64_t index_bytes = mesh.indices.size();
+
+    auto& pool = gfx.geometry_pool;
+    list.vertex_buffer = pool.Allocate(vertex_bytes);
+    list.index_buffer = pool.Allocate(index_bytes);
+    normal_buffer = pool.Allocate(normal_bytes);
+
+    // copies are batched, resolved by the upload manager flush
+    auto upload = [&](w::BufferHandle handle, const void* data, uint64_t size) {
+        auto slice = pool.View(handle);
+        uploads.Upload(*slice.buffer, data, size, slice.offset);
+    };
+    upload(list.vertex_buffer, mesh.positions.data(), vertex_bytes);
+    upload(normal_buffer, mesh.normals.data(), normal_bytes);
+    upload(list.index_buffer, mesh.indices.data(), index_bytes);
 }
 
-void w::SphereStatic::Bind(wis::DescriptorStorage& desc)
+void w::SphereStatic::Bind(const w::Graphics& gfx, wis::DescriptorStorage& desc)
 {
-    desc.WriteStructuredBuffer(4, 0, normal_buffer, sizeof(DirectX::XMFLOAT3), list.vertex_count, 0);
-    desc.WriteStructuredBuffer(4, 1, list.index_buffer, sizeof(uint32_t), list.index_count, 0);
+    // normals are octahedral uint, 16 bit indices are read as packed uint pairs
+    uint32_t index_words = list.index_type == wis::IndexType::UInt16 ? (list.index_count + 1) / 2 : list.index_count;
+    auto normals = gfx.geometry_pool.View(normal_buffer);
+    auto indices = gfx.geometry_pool.View(list.index_buffer);
+    desc.WriteStructuredBuffer(4, 0, *normals.buffer, sizeof(uint32_t), list.vertex_count, uint32_t(normals.offset / sizeof(uint32_t)));
+    desc.WriteStructuredBuffer(4, 1, *indices.buffer, sizeof(uint32_t), index_words, uint32_t(indices.offset / sizeof(uint32_t)));
 }
 
 
-w::BoxStatic::BoxStatic(w::Graphics& gfx)
+w::BoxStatic::BoxStatic(w::Graphics& gfx, w::UploadManager& uploads)
 {
     using namespace wis;
     auto& device = gfx.GetDevice();
-    auto& alloc = gfx.GetAllocator();
     auto& rt = gfx.GetRaytracing();
     wis::Result result = wis::success;
 
-    constexpr DirectX::XMFLOAT3 vertices[] = {
-        { -0.5f, -0.5f, -0.5f }, // 0
-        { -0.5f, 0.5f, -0.5f }, // 1
-        { 0.5f, 0.5f, -0.5f }, // 2
-        { 0.5f, -0.5f, -0.5f }, // 3
-        { -0.5f, -0.5f, 0.5f }, // 4
-        { -0.5f, 0.5f, 0.5f }, // 5
-        { 0.5f, 0.5f, 0.5f }, // 6
-        { 0.5f, -0.5f, 0.5f } // 7
-    };
-
-    // Define the indices for the box faces (counter-clockwise with inverted normals)
-    constexpr uint16_t indices[] = {
-        // Front face
-        2, 0, 1,
-        3, 0, 2,
-        // Back face
-        5, 4, 6,
-        6, 4, 7,
-        // Left face
-        1, 0, 5,
-        5, 0, 4,
-        // Right face
-        7, 3, 6,
-        6, 3, 2,
-        // Top face
-        2, 1, 6,
-        6, 1, 5,
-        // Bottom face
-        4, 0, 7,
-        7, 0, 3
-    };
-
     list.vertex_count = (uint32_t)std::size(vertices);
     list.index_count = (uint32_t)std::size(indices);
+    list.index_type = wis::IndexType::UInt16;
 
-    list.vertex_buffer = alloc.CreateBuffer(result, list.vertex_count * sizeof(DirectX::XMFLOAT3), BufferUsage::VertexBuffer | BufferUsage::CopyDst | BufferUsage::AccelerationStructureInput);
-    list.index_buffer = alloc.CreateBuffer(result, list.index_count * sizeof(uint16_t), BufferUsage::IndexBuffer | BufferUsage::CopyDst | BufferUsage::AccelerationStructureInput);
-
-    // create staging buffer
-    auto staging = alloc.CreateUploadBuffer(result, list.vertex_count * sizeof(DirectX::XMFLOAT3) + list.index_count * sizeof(uint16_t));
+    auto& pool = gfx.geometry_pool;
+    list.vertex_buffer = pool.Allocate(sizeof(vertices));
+    list.index_buffer = pool.Allocate(sizeof(indices));
 
-    DirectX::XMFLOAT3* vertex_data = staging.Map<DirectX::XMFLOAT3>();
-    std::copy(std::begin(vertices), std::end(vertices), vertex_data);
-
-    uint16_t* index_data = (uint16_t*)(vertex_data + list.vertex_count);
-    std::copy(std::begin(indices), std::end(indices), index_data);
-    staging.Unmap();
-
-    // upload data
-    auto cmd_list = device.CreateCommandList(result, wis::QueueType::Graphics);
-    cmd_list.CopyBuffer(staging, list.vertex_buffer, { .size_bytes = list.vertex_count * sizeof(DirectX::XMFLOAT3) });
-    cmd_list.CopyBuffer(staging, list.index_buffer, { .src_offset = list.vertex_count * sizeof(DirectX::XMFLOAT3), .size_bytes = list.index_count * sizeof(uint16_t) });
-    cmd_list.Close();
-
-    gfx.ExecuteCommandLists({ cmd_list });
-    gfx.WaitForGpu();
+    auto vertex_slice = pool.View(list.vertex_buffer);
+    auto index_slice = pool.View(list.index_buffer);
+    uploads.Upload(*vertex_slice.buffer, vertices, sizeof(vertices), vertex_slice.offset);
+    uploads.Upload(*index_slice.buffer, indices, sizeof(indices), index_slice.offset);
 }
 
 bool w::ObjectView::RenderObjectUI(MaterialCBuffer& out_data, wis::AccelerationInstance& instance_data)
@@ -227,10 +118,3 @@ bool w::ObjectView::RenderObjectUI(MaterialCBuffer& out_data, wis::AccelerationI
 
     return updated || updated_instance;
 }
-
-void w::ObjectView::GatherInstanceTransform(wis::AccelerationInstance& instance) const
-{
-    using namespace DirectX;
-    XMMATRIX transform = XMMatrixScaling(data.scale.x, data.scale.y, data.scale.z) * XMMatrixTranslation(data.pos.x, data.pos.y, data.pos.z);
-    XMStoreFloat3x4((DirectX::XMFLOAT3X4*)&instance.transform, transform);
-}
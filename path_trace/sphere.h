@@ -1,4 +1,5 @@
 #pragma once
+#include "buffer_pool.h"
 #include <wisdom/wisdom_raytracing.hpp>
 #include <DirectXMath.h>
 #include <string>
@@ -6,6 +7,8 @@
 
 namespace w {
 class Graphics;
+class UploadManager;
+struct CompressedMesh;
 
 // cbuffer for sphere
 struct alignas(alignof(DirectX::XMFLOAT4A)) MaterialCBuffer {
@@ -19,29 +22,72 @@ struct alignas(alignof(DirectX::XMFLOAT4A)) ObjectData {
 };
 
 struct IndexedTriangleList {
-    wis::Buffer vertex_buffer;
-    wis::Buffer index_buffer;
+    w::BufferHandle vertex_buffer; // in Graphics::geometry_pool
+    w::BufferHandle index_buffer;
 
     uint32_t vertex_count;
     uint32_t index_count;
+    wis::IndexType index_type = wis::IndexType::UInt32;
 };
 
 class SphereStatic
 {
 public:
-    SphereStatic(w::Graphics& gfx);
+    static constexpr uint32_t segments = 32; // latitudes and longitudes of the uv sphere
 
-    void Bind(wis::DescriptorStorage& desc);
+public:
+    SphereStatic(w::Graphics& gfx, w::UploadManager& uploads);
+    // mesh made by Generate, so generation can run on another thread
+    SphereStatic(w::Graphics& gfx, w::UploadManager& uploads, const w::CompressedMesh& mesh);
+
+    // optimized and compressed uv sphere, needs no device
+    static w::CompressedMesh Generate();
+
+    void Bind(const w::Graphics& gfx, wis::DescriptorStorage& desc);
 
 public:
     IndexedTriangleList list;
-    wis::Buffer normal_buffer;
+    w::BufferHandle normal_buffer;
 };
 
 class BoxStatic
 {
 public:
-    BoxStatic(w::Graphics& gfx);
+    static constexpr DirectX::XMFLOAT3 vertices[] = {
+        { -0.5f, -0.5f, -0.5f }, // 0
+        { -0.5f, 0.5f, -0.5f }, // 1
+        { 0.5f, 0.5f, -0.5f }, // 2
+        { 0.5f, -0.5f, -0.5f }, // 3
+        { -0.5f, -0.5f, 0.5f }, // 4
+        { -0.5f, 0.5f, 0.5f }, // 5
+        { 0.5f, 0.5f, 0.5f }, // 6
+        { 0.5f, -0.5f, 0.5f } // 7
+    };
+
+    // Define the indices for the box faces (counter-clockwise with inverted normals)
+    static constexpr uint16_t indices[] = {
+        // Front face
+        2, 0, 1,
+        3, 0, 2,
+        // Back face
+        5, 4, 6,
+        6, 4, 7,
+        // Left face
+        1, 0, 5,
+        5, 0, 4,
+        // Right face
+        7, 3, 6,
+        6, 3, 2,
+        // Top face
+        2, 1, 6,
+        6, 1, 5,
+        // Bottom face
+        4, 0, 7,
+        7, 0, 3
+    };
+
+public:
+    BoxStatic(w::Graphics& gfx, w::UploadManager& uploads);
 
 public:
     IndexedTriangleList list;
@@ -51,7 +97,12 @@ struct ObjectView {
 public:
     bool RenderObjectUI(MaterialCBuffer& out_data, wis::AccelerationInstance& instance_data);
 
-    void GatherInstanceTransform(wis::AccelerationInstance& instance) const;
+    void GatherInstanceTransform(wis::AccelerationInstance& instance) const
+    {
+        using namespace DirectX;
+        XMMATRIX transform = XMMatrixScaling(data.scale.x, data.scale.y, data.scale.z) * XMMatrixTranslation(data.pos.x, data.pos.y, data.pos.z);
+        XMStoreFloat3x4((DirectX::XMFLOAT3X4*)&instance.transform, transform);
+    }
 
 public:
     MaterialCBuffer material{};
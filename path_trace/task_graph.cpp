@@ -0,0 +1,150 @@
+#include "task_graph.h"
+#include "consts.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+w::TaskGraph::TaskId w::TaskGraph::Add(std::string name, std::function<void()> work, std::initializer_list<TaskId> dependencies, bool main_thread)
+{
+    TaskId id = TaskId(tasks.size());
+    for (TaskId dependency : dependencies) {
+        if (dependency >= id) {
+            throw w::Exception(wis::format("Task {} depends on a task added after it", name));
+        }
+        tasks[dependency].dependents.push_back(id);
+    }
+    tasks.push_back({ std::move(work), {}, uint32_t(dependencies.size()), main_thread });
+    records.push_back({ .name = std::move(name) });
+    return id;
+}
+
+void w::TaskGraph::Run(uint32_t thread_count)
+{
+    using clock = std::chrono::steady_clock;
+    thread_count = thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+    const auto start = clock::now();
+    auto elapsed = [&]() { return std::chrono::duration<double, std::milli>(clock::now() - start).count(); };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<TaskId> ready_pool, ready_main;
+    std::vector<uint32_t> waiting(tasks.size());
+    std::vector<bool> blocked(tasks.size()); // a dependency failed or was skipped
+    size_t remaining = tasks.size();
+    std::exception_ptr error;
+
+    // under the lock, a failed task skips everything that depends on it
+    auto finish = [&](TaskId id, bool ok) {
+        std::vector<TaskId> done{ id };
+        while (!done.empty()) {
+            TaskId task = done.back();
+            done.pop_back();
+            remaining--;
+            for (TaskId dependent : tasks[task].dependents) {
+                blocked[dependent] = blocked[dependent] || !ok;
+                if (--waiting[dependent] == 0) {
+                    if (blocked[dependent]) {
+                        done.push_back(dependent);
+                    } else {
+                        (tasks[dependent].main_thread ? ready_main : ready_pool).push_back(dependent);
+                    }
+                }
+            }
+            ok = false; // everything after the first was skipped
+        }
+    };
+
+    for (TaskId id = 0; id < tasks.size(); id++) {
+        waiting[id] = tasks[id].dependencies;
+        records[id].ran = false;
+        if (!waiting[id]) {
+            (tasks[id].main_thread ? ready_main : ready_pool).push_back(id);
+        }
+    }
+
+    auto worker = [&](uint32_t thread) {
+        if (thread) {
+            W_PROFILE_THREAD(wis::format("Task graph {}", thread));
+        }
+        std::unique_lock lock{ mutex };
+        while (true) {
+            changed.wait(lock, [&]() { return !remaining || !ready_pool.empty() || (thread == 0 && !ready_main.empty()); });
+            if (!remaining) {
+                return;
+            }
+            auto& queue = thread == 0 && !ready_main.empty() ? ready_main : ready_pool;
+            TaskId id = queue.front();
+            queue.pop_front();
+
+            lock.unlock();
+            auto& record = records[id];
+            record.thread = thread;
+            record.start_ms = elapsed();
+            bool ok = true;
+            try {
+                W_PROFILE_SCOPE_STRING(record.name); // the graph and its names may be gone before the profiler is read
+                tasks[id].work();
+            } catch (...) {
+                ok = false;
+                std::scoped_lock error_lock{ mutex };
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            record.end_ms = elapsed();
+            record.ran = true;
+            lock.lock();
+
+            finish(id, ok);
+            changed.notify_all();
+        }
+    };
+
+    {
+        std::vector<std::jthread> pool;
+        for (uint32_t i = 1; i < thread_count; i++) {
+            pool.emplace_back(worker, i);
+        }
+        worker(0);
+    }
+    threads_used = thread_count;
+    total_ms = elapsed();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::string w::TaskGraph::FormatTimeline() const
+{
+    constexpr size_t width = 40;
+    std::vector<TaskId> order(records.size());
+    std::iota(order.begin(), order.end(), TaskId(0));
+    std::ranges::stable_sort(order, {}, [&](TaskId id) { return records[id].ran ? records[id].start_ms : total_ms; });
+
+    size_t name_width = 0;
+    for (auto& record : records) {
+        name_width = std::max(name_width, record.name.size());
+    }
+
+    std::string out = wis::format("{} tasks on {} threads in {:.1f} ms\n", records.size(), threads_used, total_ms);
+    double scale = total_ms > 0.0 ? width / total_ms : 0.0;
+    for (TaskId id : order) {
+        auto& record = records[id];
+        if (!record.ran) {
+            out += wis::format("  {:<{}}  skipped\n", record.name, name_width);
+            continue;
+        }
+        size_t begin = std::min(width - 1, size_t(record.start_ms * scale));
+        size_t end = std::clamp(size_t(record.end_ms * scale + 0.5), begin + 1, width);
+        std::string bar(width, ' ');
+        std::fill(bar.begin() + begin, bar.begin() + end, '#');
+        out += wis::format("  {:<{}}  |{}| [{}] {:7.1f} - {:7.1f} ms\n", record.name, name_width, bar, record.thread, record.start_ms, record.end_ms);
+    }
+    return out;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace w {
+// Tasks with dependencies, run once on a pool of threads.
+// A task starts as soon as every task it depends on has finished, dependencies are added first so the graph is acyclic.
+// Main thread tasks run only on the thread that called Run, for work that needs it such as queue submission.
+class TaskGraph
+{
+public:
+    using TaskId = uint32_t;
+
+    struct Record {
+        std::string name;
+        uint32_t thread = 0; // 0 is the thread that called Run
+        double start_ms = 0.0; // since Run
+        double end_ms = 0.0;
+        bool ran = false; // false if a dependency failed
+    };
+
+public:
+    TaskId Add(std::string name, std::function<void()> work, std::initializer_list<TaskId> dependencies = {}, bool main_thread = false);
+
+    // Runs every task on thread_count threads, 0 - hardware concurrency.
+    // Tasks that depend on a failed task are skipped, the first exception is rethrown once all threads are done.
+    void Run(uint32_t thread_count = 0);
+
+    // one record per task, in order of TaskId, filled by Run
+    std::span<const Record> Timeline() const noexcept
+    {
+        return records;
+    }
+    // a line per task ordered by start with a bar over the whole run
+    std::string FormatTimeline() const;
+
+private:
+    struct Task {
+        std::function<void()> work;
+        std::vector<TaskId> dependents;
+        uint32_t dependencies = 0;
+        bool main_thread = false;
+    };
+
+private:
+    std::vector<Task> tasks;
+    std::vector<Record> records;
+    uint32_t threads_used = 0;
+    double total_ms = 0.0;
+};
+} // namespace w
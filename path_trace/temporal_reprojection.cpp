@@ -0,0 +1,270 @@
+#include "temporal_reprojection.h"
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace {
+using namespace DirectX;
+constexpr uint32_t tile_size = w::CpuTracer::tile_size;
+constexpr uint32_t lanes = w::CameraRays::lanes;
+
+// fn(x0, y0, width, height) for every tile of the launch, handed out to threads like CpuTracer::Render does
+template<typename F>
+void ForEachTile(uint32_t thread_count, uint32_t width, uint32_t height, const F& fn)
+{
+    const uint32_t tiles_x = (width + tile_size - 1) / tile_size;
+    const uint32_t tile_count = tiles_x * ((height + tile_size - 1) / tile_size);
+    std::atomic<uint32_t> next_tile = 0;
+
+    auto worker = [&]() {
+        W_PROFILE_THREAD("Temporal accumulation");
+        for (uint32_t tile = next_tile++; tile < tile_count; tile = next_tile++) {
+            uint32_t x0 = (tile % tiles_x) * tile_size, y0 = (tile / tiles_x) * tile_size;
+            fn(x0, y0, std::min(tile_size, width - x0), std::min(tile_size, height - y0));
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+}
+} // namespace
+
+w::TemporalAccumulator::TemporalAccumulator()
+    : TemporalAccumulator(Options{})
+{
+}
+
+w::TemporalAccumulator::TemporalAccumulator(const Options& options)
+    : options(options)
+{
+    if (!this->options.thread_count) {
+        this->options.thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void w::TemporalAccumulator::Reset() noexcept
+{
+    valid = false;
+}
+
+void w::TemporalAccumulator::SetCamera(const CpuScene& scene, const Camera::CBuffer& new_camera, uint32_t width, uint32_t height)
+{
+    W_PROFILE_FUNCTION();
+    if (valid && color.width == width && color.height == height) {
+        if (std::memcmp(&camera, &new_camera, sizeof(camera)) == 0) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        Camera::CBuffer previous = camera;
+        camera = new_camera;
+        rays = CameraRays{ camera, width, height };
+        std::swap(color, history_color);
+        std::swap(samples, history_samples);
+        std::swap(hits, history_hits);
+        // the buffers of the view before last, same size after the first move
+        const size_t pixels = size_t(width) * height;
+        color.width = hits.width = width;
+        color.height = hits.height = height;
+        color.pixels.resize(pixels);
+        samples.resize(pixels);
+        hits.depth.resize(pixels);
+        hits.normal.resize(pixels);
+        std::ranges::fill(color.pixels, XMFLOAT3{});
+        std::ranges::fill(samples, 0u);
+        std::ranges::fill(hits.depth, 0.0f);
+        std::ranges::fill(hits.normal, XMFLOAT3{});
+        UpdateView(scene, &previous);
+        stats.reproject_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+
+    camera = new_camera;
+    rays = CameraRays{ camera, width, height };
+    color = Image{ width, height };
+    samples.assign(color.pixels.size(), 0);
+    hits = { width, height, std::vector<float>(color.pixels.size()), std::vector<XMFLOAT3>(color.pixels.size()) };
+    UpdateView(scene, nullptr);
+    min_samples = 0;
+    sample_index = 0; // the same samples as CpuTracer::Render until the camera moves
+    valid = true;
+}
+
+void w::TemporalAccumulator::UpdateView(const CpuScene& scene, const Camera::CBuffer* previous)
+{
+    const uint32_t width = color.width, height = color.height;
+    const float fwidth = float(width), fheight = float(height);
+    XMFLOAT4X4 view_proj{};
+    XMFLOAT3 previous_origin{};
+    if (previous) {
+        // view_proj of the buffer is not refreshed by SetPerspective alone, the product of view and proj always is
+        XMStoreFloat4x4(&view_proj, XMLoadFloat4x4A(&previous->view) * XMLoadFloat4x4A(&previous->proj));
+        XMStoreFloat3(&previous_origin, XMLoadFloat4A(&previous->ray_origin));
+    }
+    std::atomic<uint64_t> kept = 0;
+
+    ForEachTile(options.thread_count, width, height, [&](uint32_t x0, uint32_t y0, uint32_t tile_width, uint32_t tile_height) {
+        std::array<Ray, tile_size * tile_size> tile_rays;
+        rays.GenerateTile(x0, y0, tile_width, tile_height, {}, tile_rays);
+        TraceCounters counters;
+        for (uint32_t ty = 0; ty < tile_height; ty++) {
+            for (uint32_t tx = 0; tx < tile_width; tx++) {
+                size_t p = size_t(height - 1 - (y0 + ty)) * width + x0 + tx;
+                CpuHit hit;
+                if (scene.Intersect(tile_rays[ty * tile_width + tx], true, hit, counters)) {
+                    hits.depth[p] = hit.hit.triangle.t;
+                    XMStoreFloat3(&hits.normal[p], scene.Normal(hit));
+                } else {
+                    hits.depth[p] = std::numeric_limits<float>::infinity();
+                    hits.normal[p] = {};
+                }
+            }
+        }
+        if (!previous) {
+            return;
+        }
+
+        // Hit points of 4 pixels of a row go through the previous view projection at once, structure of arrays like
+        // CameraRays::GenerateTile. Taps are then validated per pixel.
+        const auto& m = view_proj.m;
+        uint64_t tile_kept = 0;
+        for (uint32_t ty = 0; ty < tile_height; ty++) {
+            for (uint32_t tx = 0; tx < tile_width; tx += lanes) {
+                XMFLOAT4A px, py, pz;
+                for (uint32_t l = 0; l < lanes; l++) {
+                    uint32_t x = std::min(tx + l, tile_width - 1); // repeats the last pixel past the tile
+                    const Ray& ray = tile_rays[ty * tile_width + x];
+                    float depth = hits.depth[size_t(height - 1 - (y0 + ty)) * width + x0 + x];
+                    depth = std::isinf(depth) ? 0.0f : depth;
+                    (&px.x)[l] = ray.origin.x + ray.direction.x * depth;
+                    (&py.x)[l] = ray.origin.y + ray.direction.y * depth;
+                    (&pz.x)[l] = ray.origin.z + ray.direction.z * depth;
+                }
+                XMVECTOR X = XMLoadFloat4A(&px), Y = XMLoadFloat4A(&py), Z = XMLoadFloat4A(&pz);
+                XMVECTOR clip_x = XMVectorMultiplyAdd(X, XMVectorReplicate(m[0][0]), XMVectorMultiplyAdd(Y, XMVectorReplicate(m[1][0]), XMVectorMultiplyAdd(Z, XMVectorReplicate(m[2][0]), XMVectorReplicate(m[3][0]))));
+                XMVECTOR clip_y = XMVectorMultiplyAdd(X, XMVectorReplicate(m[0][1]), XMVectorMultiplyAdd(Y, XMVectorReplicate(m[1][1]), XMVectorMultiplyAdd(Z, XMVectorReplicate(m[2][1]), XMVectorReplicate(m[3][1]))));
+                XMVECTOR clip_w = XMVectorMultiplyAdd(X, XMVectorReplicate(m[0][3]), XMVectorMultiplyAdd(Y, XMVectorReplicate(m[1][3]), XMVectorMultiplyAdd(Z, XMVectorReplicate(m[2][3]), XMVectorReplicate(m[3][3]))));
+                XMVECTOR dx = X - XMVectorReplicate(previous_origin.x), dy = Y - XMVectorReplicate(previous_origin.y), dz = Z - XMVectorReplicate(previous_origin.z);
+                XMVECTOR distance = XMVectorSqrt(dx * dx + dy * dy + dz * dz);
+
+                // launch coordinates of the previous view, pixel centers at integers like CameraRays
+                XMVECTOR inv_w = XMVectorReciprocal(clip_w);
+                XMVECTOR half = XMVectorReplicate(0.5f);
+                XMFLOAT4A fx, fy, fw, previous_distance;
+                XMStoreFloat4A(&fx, (clip_x * inv_w + XMVectorReplicate(1.0f)) * XMVectorReplicate(0.5f * fwidth) - half);
+                XMStoreFloat4A(&fy, (clip_y * inv_w + XMVectorReplicate(1.0f)) * XMVectorReplicate(0.5f * fheight) - half);
+                XMStoreFloat4A(&fw, clip_w);
+                XMStoreFloat4A(&previous_distance, distance);
+
+                for (uint32_t l = 0; l < lanes && tx + l < tile_width; l++) {
+                    size_t p = size_t(height - 1 - (y0 + ty)) * width + x0 + tx + l;
+                    color.pixels[p] = {};
+                    samples[p] = 0;
+                    // misses start over, sky samples through the pixel center are all the same
+                    float sx = (&fx.x)[l], sy = (&fy.x)[l], dist = (&previous_distance.x)[l];
+                    if (std::isinf(hits.depth[p]) || (&fw.x)[l] <= 0.0f || !(sx > -1.0f && sx < fwidth && sy > -1.0f && sy < fheight)) {
+                        continue;
+                    }
+
+                    XMVECTOR normal = XMLoadFloat3(&hits.normal[p]);
+                    XMVECTOR sum = XMVectorZero();
+                    float weight = 0.0f;
+                    uint32_t history = options.max_history;
+                    int32_t ix = int32_t(std::floor(sx)), iy = int32_t(std::floor(sy));
+                    float ax = sx - float(ix), ay = sy - float(iy);
+                    for (uint32_t j = 0; j < 4; j++) {
+                        int32_t tap_x = ix + int32_t(j & 1), tap_y = iy + int32_t(j >> 1);
+                        float tap_weight = (j & 1 ? ax : 1.0f - ax) * (j >> 1 ? ay : 1.0f - ay);
+                        if (tap_weight <= 0.0f || tap_x < 0 || tap_y < 0 || tap_x >= int32_t(width) || tap_y >= int32_t(height)) {
+                            continue;
+                        }
+                        size_t q = size_t(height - 1 - uint32_t(tap_y)) * width + uint32_t(tap_x);
+                        // another surface moved in front of or out from behind this one
+                        if (!history_samples[q] || !(std::abs(history_hits.depth[q] - dist) <= options.depth_tolerance * dist) ||
+                            XMVectorGetX(XMVector3Dot(XMLoadFloat3(&history_hits.normal[q]), normal)) < options.normal_threshold) {
+                            continue;
+                        }
+                        sum = XMVectorMultiplyAdd(XMLoadFloat3(&history_color.pixels[q]), XMVectorReplicate(tap_weight), sum);
+                        weight += tap_weight;
+                        history = std::min(history, history_samples[q]);
+                    }
+                    // a sliver of a valid tap is mostly the wrong surface's neighbour, not enough to keep
+                    if (weight < 0.25f) {
+                        continue;
+                    }
+                    XMStoreFloat3(&color.pixels[p], sum / weight);
+                    samples[p] = history;
+                    tile_kept++;
+                }
+            }
+        }
+        kept += tile_kept;
+    });
+
+    if (previous) {
+        min_samples = *std::ranges::min_element(samples);
+        stats.reprojections++;
+        stats.pixels += color.pixels.size();
+        stats.kept += kept;
+    }
+}
+
+void w::TemporalAccumulator::Accumulate(const CpuScene& scene, const Scene::RenderSettings& settings, uint32_t sample_count)
+{
+    W_PROFILE_FUNCTION();
+    if (!valid || !sample_count) {
+        return;
+    }
+    const uint32_t width = color.width, height = color.height;
+    // without accumulation only the last sample is shown, the others need not be traced
+    const uint32_t begin = settings.accumulate ? sample_index : sample_index + sample_count - 1;
+    const uint32_t count = settings.accumulate ? sample_count : 1;
+
+    ForEachTile(options.thread_count, width, height, [&](uint32_t x0, uint32_t y0, uint32_t tile_width, uint32_t tile_height) {
+        std::array<XMFLOAT3, tile_size * tile_size> sums{};
+        CpuTracer::RenderTile(scene, rays, settings, x0, y0, tile_width, tile_height, begin, count, { sums.data(), size_t(tile_width) * tile_height });
+        for (uint32_t ty = 0; ty < tile_height; ty++) {
+            for (uint32_t tx = 0; tx < tile_width; tx++) {
+                size_t p = size_t(height - 1 - (y0 + ty)) * width + x0 + tx;
+                uint32_t n = settings.accumulate ? samples[p] : 0;
+                XMVECTOR c = (XMLoadFloat3(&color.pixels[p]) * float(n) + XMLoadFloat3(&sums[ty * tile_width + tx])) / float(n + count);
+                XMStoreFloat3(&color.pixels[p], c);
+                samples[p] = n + count;
+            }
+        }
+    });
+    sample_index += sample_count;
+    min_samples = *std::ranges::min_element(samples);
+}
+
+void w::TemporalAccumulator::FillHoles(const CpuScene& scene, const Scene::RenderSettings& settings)
+{
+    W_PROFILE_FUNCTION();
+    if (!valid || min_samples) {
+        return;
+    }
+    const uint32_t width = color.width, height = color.height;
+    ForEachTile(options.thread_count, width, height, [&](uint32_t x0, uint32_t y0, uint32_t tile_width, uint32_t tile_height) {
+        for (uint32_t ty = 0; ty < tile_height; ty++) {
+            for (uint32_t tx = 0; tx < tile_width; tx++) {
+                size_t p = size_t(height - 1 - (y0 + ty)) * width + x0 + tx;
+                if (samples[p]) {
+                    continue;
+                }
+                XMFLOAT3 sum{};
+                CpuTracer::RenderTile(scene, rays, settings, x0 + tx, y0 + ty, 1, 1, sample_index, 1, { &sum, 1 });
+                color.pixels[p] = sum;
+                samples[p] = 1;
+            }
+        }
+    });
+    sample_index++; // the other pixels skip this one, a pixel never sees the same sample twice
+    min_samples = *std::ranges::min_element(samples);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "cpu_tracer.h"
+#include <vector>
+
+namespace w {
+// Depth and normal of the primary hit of every pixel, the AOV reprojection tells surfaces apart with.
+// Rows top to bottom like Image.
+struct PrimaryHits {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> depth; // distance from the camera along the pixel center ray, infinity for misses
+    std::vector<DirectX::XMFLOAT3> normal; // world space shading normal
+};
+
+// Per pixel accumulation of the CPU tracer that survives camera moves.
+// When the camera changes, the primary hit of every new pixel is projected into the previous view and the history
+// there is resampled. Taps whose hit is at a different depth or has a different normal belong to another surface
+// and are rejected, pixels without a valid tap (disocclusions, the border, the sky) start over. Without camera moves
+// the result is the same as accumulating with CpuTracer::Render.
+class TemporalAccumulator
+{
+public:
+    struct Options {
+        float depth_tolerance = 0.02f; // relative to the distance from the previous camera
+        float normal_threshold = 0.9f; // cosine between the previous and the current normal
+        uint32_t max_history = 64; // samples a pixel keeps through a reprojection, bounds the blur of repeated resampling
+        uint32_t thread_count = 0; // 0 - hardware concurrency
+    };
+    struct Stats {
+        uint64_t reprojections = 0;
+        uint64_t pixels = 0; // over all reprojections
+        uint64_t kept = 0; // pixels that kept history
+        double reproject_ms = 0.0; // including the primary hits
+
+        double KeptFraction() const noexcept
+        {
+            return pixels ? double(kept) / double(pixels) : 0.0;
+        }
+    };
+
+public:
+    TemporalAccumulator();
+    explicit TemporalAccumulator(const Options& options);
+
+public:
+    // the next samples start over, e.g. after a change of the settings or the scene
+    void Reset() noexcept;
+    // View of the next samples. A different camera reprojects the history, a different size resets it.
+    void SetCamera(const CpuScene& scene, const Camera::CBuffer& camera, uint32_t width, uint32_t height);
+    // adds sample_count samples per pixel, settings without accumulate keep only the last one
+    void Accumulate(const CpuScene& scene, const Scene::RenderSettings& settings, uint32_t sample_count);
+    // one sample for the pixels without history only, the disocclusions of a reprojection. Makes the first frame
+    // after a move cost a fraction of a sample.
+    void FillHoles(const CpuScene& scene, const Scene::RenderSettings& settings);
+
+    const Image& GetImage() const noexcept
+    {
+        return color;
+    }
+    const PrimaryHits& GetPrimaryHits() const noexcept
+    {
+        return hits;
+    }
+    // samples of the pixel with the fewest, convergence of the whole image
+    uint32_t MinSamples() const noexcept
+    {
+        return min_samples;
+    }
+    const Stats& GetStats() const noexcept
+    {
+        return stats;
+    }
+
+private:
+    // primary hits of the current camera, and the history resampled from the previous one if given
+    void UpdateView(const CpuScene& scene, const Camera::CBuffer* previous);
+
+private:
+    Options options;
+    Camera::CBuffer camera{};
+    CameraRays rays;
+    bool valid = false; // camera, hits and history belong together
+
+    Image color;
+    std::vector<uint32_t> samples; // per pixel
+    PrimaryHits hits;
+    uint32_t min_samples = 0;
+    uint32_t sample_index = 0; // seed of the next sample, continues through reprojections
+
+    // previous view while reprojecting, kept to reuse the allocations
+    Image history_color;
+    std::vector<uint32_t> history_samples;
+    PrimaryHits history_hits;
+    Stats stats;
+};
+} // namespace w
@@ -0,0 +1,103 @@
+// AssetLoader publishing into a CpuScene that is rendered between publishes
+#include "asset_loader.h"
+#include "cpu_tracer.h"
+#include "test.h"
+#include "uv_sphere.h"
+#include <array>
+#include <string>
+#include <thread>
+
+namespace {
+w::CpuScene DefaultScene()
+{
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    w::CpuScene scene;
+    scene.Update(instances, materials);
+    return scene;
+}
+
+w::AssetLoader::Placement At(float x)
+{
+    w::AssetLoader::Placement placement{};
+    DirectX::XMStoreFloat4x4(&placement.object_to_world, DirectX::XMMatrixScaling(0.5f, 0.5f, 0.5f) * DirectX::XMMatrixTranslation(x, -1.0f, 0.0f));
+    return placement;
+}
+
+w::AssetLoader::MeshData Sphere(uint32_t segments)
+{
+    auto [positions, normals, indices] = uv_sphere_generator::generate(segments, segments);
+    return { std::move(positions), std::move(normals), std::move(indices) };
+}
+} // namespace
+
+W_TEST(asset_loader, PublishesEveryMeshWhileRendering)
+{
+    constexpr uint32_t width = 32, height = 18, mesh_count = 24;
+    w::CpuScene scene = DefaultScene();
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    w::CameraRays rays{ cbuffer, width, height };
+    w::CpuTracer tracer{ 1 };
+    w::Image image{ width, height };
+
+    w::AssetLoader loader;
+    for (uint32_t i = 0; i < mesh_count; i++) {
+        uint32_t segments = 8 + (i * 8) % 56;
+        loader.Add("Sphere " + std::to_string(i), [segments]() { return Sphere(segments); }, { At(float(i % 8) * 2.0f - 7.0f) });
+    }
+    uint32_t published = 0;
+    for (uint32_t frame = 0; loader.Pending(); frame++) {
+        published += loader.Publish(scene);
+        tracer.Render(scene, rays, {}, frame, image);
+    }
+    W_CHECK(published == mesh_count);
+    W_CHECK(scene.InstanceCount() == w::Scene::objects_count + mesh_count);
+    W_CHECK(loader.GetStats().published == mesh_count);
+    W_CHECK(loader.GetStats().failed == 0);
+    W_CHECK(!loader.Ready());
+}
+
+W_TEST(asset_loader, FailedMeshIsSkipped)
+{
+    w::CpuScene scene = DefaultScene();
+    w::AssetLoader loader;
+    loader.Add("Broken", []() {
+        auto data = Sphere(8);
+        data.normals.pop_back();
+        return data;
+    }, { At(0.0f) });
+    loader.Add("Sphere", []() { return Sphere(8); }, { At(2.0f), At(4.0f) });
+    while (loader.Pending()) {
+        loader.Publish(scene);
+        std::this_thread::yield();
+    }
+    W_CHECK(loader.GetStats().failed == 1);
+    W_CHECK(loader.GetStats().published == 1);
+    W_CHECK(scene.InstanceCount() == w::Scene::objects_count + 2);
+}
+
+W_TEST(asset_loader, IndexOutOfRangeFailsTheMesh)
+{
+    w::CpuScene scene = DefaultScene();
+    w::AssetLoader loader;
+    loader.Add("Out of range", []() {
+        auto data = Sphere(8);
+        data.indices.back() = uint32_t(data.positions.size());
+        return data;
+    }, { At(0.0f) });
+    while (loader.Pending()) {
+        loader.Publish(scene);
+        std::this_thread::yield();
+    }
+    W_CHECK(loader.GetStats().failed == 1);
+    W_CHECK(loader.GetStats().published == 0);
+    W_CHECK(scene.InstanceCount() == w::Scene::objects_count);
+}
@@ -0,0 +1,108 @@
+// BufferPool placement and defragmentation, planned on the CPU by a pool without buffers
+#include "buffer_pool.h"
+#include "test.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace {
+constexpr w::BufferPoolDesc desc{ .block_size = 16 * 1024, .granularity = 256, .max_allocations_per_block = 256 };
+
+// slices of the same buffer never overlap
+bool Disjoint(std::vector<w::BufferSlice> slices)
+{
+    std::sort(slices.begin(), slices.end(), [](auto& a, auto& b) { return std::pair{ a.buffer, a.offset } < std::pair{ b.buffer, b.offset }; });
+    for (size_t i = 1; i < slices.size(); i++) {
+        if (slices[i].buffer == slices[i - 1].buffer && slices[i].offset < slices[i - 1].offset + slices[i - 1].size) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+W_TEST(buffer_pool, SlicesDoNotOverlap)
+{
+    w::BufferPool pool{ desc };
+    std::vector<w::BufferSlice> slices;
+    for (uint32_t i = 0; i < 64; i++) {
+        auto handle = pool.Allocate(100 + i * 37, i % 3 ? 0 : 1024);
+        auto slice = pool.View(handle);
+        W_CHECK(slice.size == 100 + i * 37);
+        W_CHECK(slice.offset % (i % 3 ? 256 : 1024) == 0);
+        slices.push_back(slice);
+    }
+    W_CHECK(Disjoint(slices));
+    W_CHECK(pool.Stats().allocation_count == 64);
+}
+
+W_TEST(buffer_pool, DefragmentCompactsLiveEntries)
+{
+    w::BufferPool pool{ desc };
+    std::vector<w::BufferHandle> handles;
+    for (uint32_t i = 0; i < 96; i++) {
+        handles.push_back(pool.Allocate(256 * (1 + i % 3)));
+    }
+    // every other entry leaves a hole
+    std::vector<w::BufferHandle> live;
+    for (uint32_t i = 0; i < handles.size(); i++) {
+        if (i % 2) {
+            pool.Free(handles[i]);
+        } else {
+            live.push_back(handles[i]);
+        }
+    }
+    auto before = pool.Stats();
+    W_CHECK(before.fragmentation > 0.5f);
+    std::map<uint32_t, w::BufferSlice> old_slices;
+    for (auto handle : live) {
+        old_slices[handle.id] = pool.View(handle);
+    }
+
+    auto moves = pool.Defragment();
+    auto after = pool.Stats();
+    W_CHECK(after.allocation_count == live.size());
+    W_CHECK(after.used_bytes == before.used_bytes);
+    W_CHECK(after.block_count < before.block_count);
+    W_CHECK(after.reserved_bytes < before.reserved_bytes);
+    W_CHECK(after.fragmentation < before.fragmentation);
+
+    // one move per live entry, from where its handle pointed to where it points now
+    W_CHECK(moves.size() == live.size());
+    std::vector<w::BufferSlice> new_slices;
+    for (auto& move : moves) {
+        auto old_slice = old_slices.at(move.handle.id);
+        auto new_slice = pool.View(move.handle);
+        W_CHECK(move.src == old_slice.buffer && move.src_offset == old_slice.offset);
+        W_CHECK(move.dst == new_slice.buffer && move.dst_offset == new_slice.offset);
+        W_CHECK(move.size == old_slice.size && new_slice.size == old_slice.size);
+        old_slices.erase(move.handle.id);
+        new_slices.push_back(new_slice);
+    }
+    W_CHECK(old_slices.empty());
+    W_CHECK(Disjoint(new_slices));
+
+    // handles keep working after the move
+    for (auto handle : live) {
+        pool.Free(handle);
+    }
+    W_CHECK(pool.Stats().allocation_count == 0);
+    pool.ReleaseRetired();
+}
+
+W_TEST(buffer_pool, DefragmentKeepsAlignment)
+{
+    w::BufferPool pool{ desc };
+    std::vector<w::BufferHandle> handles;
+    for (uint32_t i = 0; i < 32; i++) {
+        handles.push_back(pool.Allocate(300, 4096));
+    }
+    for (uint32_t i = 0; i < handles.size(); i += 2) {
+        pool.Free(handles[i]);
+    }
+    pool.Defragment();
+    for (uint32_t i = 1; i < handles.size(); i += 2) {
+        W_CHECK(pool.View(handles[i]).offset % 4096 == 0);
+        W_CHECK(pool.View(handles[i]).size == 300);
+    }
+}
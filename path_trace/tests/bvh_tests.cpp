@@ -0,0 +1,86 @@
+// Empty and degenerate BVHs, closest hits against brute force
+#include "bvh.h"
+#include "test.h"
+
+namespace {
+struct Mesh {
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+
+    void AddTriangle(float x, float size)
+    {
+        uint32_t base = uint32_t(positions.size());
+        positions.push_back({ x, -size, -size });
+        positions.push_back({ x, size, -size });
+        positions.push_back({ x, 0.0f, size });
+        indices.insert(indices.end(), { base, base + 1, base + 2 });
+    }
+};
+
+} // namespace
+
+W_TEST(bvh, EmptyIsSafe)
+{
+    w::BVH unbuilt;
+    W_CHECK(unbuilt.Stats().nodes == 0);
+    W_CHECK(unbuilt.Bounds().Area() == 0.0f);
+
+    w::BVH empty{ {}, {} };
+    W_CHECK(empty.Stats().nodes == 0);
+    W_CHECK(empty.Bounds().Area() == 0.0f);
+
+    w::BVHHit hit;
+    w::TraceCounters counters;
+    W_CHECK(!empty.Intersect({ .origin = {}, .direction = { 1.0f, 0.0f, 0.0f } }, hit, counters));
+}
+
+// identical centroids leave SAH without a split, ranges are halved instead
+W_TEST(bvh, CoincidentTriangles)
+{
+    Mesh mesh;
+    for (uint32_t i = 0; i < 10000; i++) {
+        mesh.AddTriangle(1.0f, 1.0f);
+    }
+    w::BVH bvh{ mesh.positions, mesh.indices };
+    auto stats = bvh.Stats();
+    W_CHECK(stats.max_depth <= w::BVH::max_depth);
+    W_CHECK(stats.average_leaf_size * float(stats.leaves) == 10000.0f); // every triangle in a leaf
+
+    w::BVHHit hit;
+    w::TraceCounters counters;
+    W_CHECK(bvh.Intersect({ .origin = { 0.0f, 0.0f, 0.0f }, .direction = { 1.0f, 0.0f, 0.0f } }, hit, counters));
+    W_CHECK(hit.triangle.t == 1.0f);
+}
+
+W_TEST(bvh, MatchesBruteForce)
+{
+    Mesh mesh;
+    for (uint32_t i = 0; i < 500; i++) {
+        mesh.AddTriangle(float(i % 50) * 0.3f, 0.2f + float(i % 7) * 0.1f);
+        for (uint32_t k = 0; k < 3; k++) { // spread over y and z, overlapping in x
+            auto& p = mesh.positions[mesh.positions.size() - 1 - k];
+            p.y += float(i / 50) * 0.25f;
+            p.z += float(i % 3) * 0.2f;
+        }
+    }
+    w::BVH bvh{ mesh.positions, mesh.indices };
+
+    for (uint32_t r = 0; r < 200; r++) {
+        w::Ray ray{ .origin = { -1.0f, float(r % 20) * 0.13f, float(r / 20) * 0.07f }, .direction = { 1.0f, 0.01f, 0.0f } };
+        float closest = FLT_MAX;
+        uint32_t expected = ~0u;
+        for (uint32_t t = 0; t < mesh.indices.size() / 3; t++) {
+            w::TriangleHit th;
+            if (w::IntersectTriangle(ray, mesh.positions[mesh.indices[t * 3]], mesh.positions[mesh.indices[t * 3 + 1]], mesh.positions[mesh.indices[t * 3 + 2]], th) &&
+                th.t < closest && th.t < ray.t_max) {
+                closest = th.t;
+                expected = t;
+            }
+        }
+
+        w::BVHHit hit;
+        w::TraceCounters counters;
+        W_CHECK(bvh.Intersect(ray, hit, counters) == (expected != ~0u));
+        W_CHECK(hit.triangle.t == closest); // triangles at the same distance may tie, compare distances
+    }
+}
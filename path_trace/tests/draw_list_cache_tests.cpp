@@ -0,0 +1,113 @@
+// DrawListCache keeping a mapped buffer in sync with changing draw lists, and GrowCapacity
+#include "draw_list_cache.h"
+#include "test.h"
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace {
+constexpr size_t list_count = 16;
+constexpr size_t list_bytes = 1024;
+
+// draw lists copied into one buffer the way the UI uploads them, each list at a fixed offset
+struct UiFrame {
+    std::vector<std::vector<std::byte>> lists{ list_count, std::vector<std::byte>(list_bytes) };
+    std::vector<std::byte> buffer = std::vector<std::byte>(list_count * list_bytes);
+    std::mt19937 rng{ 42 };
+
+    void Change(size_t count)
+    {
+        for (size_t list = 0; list < count; list++) {
+            lists[list][rng() % list_bytes] = std::byte(rng());
+        }
+    }
+    void Upload(w::DrawListCache& cache)
+    {
+        cache.Begin(list_count);
+        for (size_t list = 0; list < list_count; list++) {
+            auto& data = lists[list];
+            if (cache.Update(list, std::span{ data }.first(list_bytes / 2), std::span{ data }.last(list_bytes / 2), list * list_bytes, 0)) {
+                std::memcpy(buffer.data() + list * list_bytes, data.data(), data.size());
+            }
+        }
+    }
+    bool InSync() const
+    {
+        for (size_t list = 0; list < list_count; list++) {
+            if (std::memcmp(buffer.data() + list * list_bytes, lists[list].data(), list_bytes) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+} // namespace
+
+W_TEST(draw_list_cache, BufferFollowsChangedLists)
+{
+    UiFrame frame;
+    w::DrawListCache cache;
+    for (size_t changed : { 0, 1, 4, 16, 0, 3 }) {
+        for (uint32_t i = 0; i < 32; i++) {
+            frame.Change(changed);
+            frame.Upload(cache);
+            W_CHECK(frame.InSync());
+        }
+    }
+}
+
+W_TEST(draw_list_cache, UnchangedListsAreSkipped)
+{
+    UiFrame frame;
+    w::DrawListCache cache;
+    frame.Upload(cache);
+    W_CHECK(cache.GetStats().lists_uploaded == list_count);
+
+    frame.Change(3);
+    frame.Upload(cache);
+    W_CHECK(cache.GetStats().lists_uploaded == 3);
+    W_CHECK(cache.GetStats().lists_skipped == list_count - 3);
+    W_CHECK(cache.GetStats().bytes_uploaded == 3 * list_bytes);
+}
+
+W_TEST(draw_list_cache, InvalidateUploadsEverything)
+{
+    UiFrame frame;
+    w::DrawListCache cache;
+    frame.Upload(cache);
+    std::memset(frame.buffer.data(), 0, frame.buffer.size()); // a recreated buffer
+    frame.lists[0][0] = std::byte(1); // content that cannot be zeros by chance
+    cache.Invalidate();
+    frame.Upload(cache);
+    W_CHECK(cache.GetStats().lists_uploaded == list_count);
+    W_CHECK(frame.InSync());
+}
+
+W_TEST(draw_list_cache, MovedListIsUploaded)
+{
+    std::vector<std::byte> data(64, std::byte(3));
+    w::DrawListCache cache;
+    cache.Begin(1);
+    W_CHECK(cache.Update(0, data, {}, 0, 0));
+    cache.Begin(1);
+    W_CHECK(!cache.Update(0, data, {}, 0, 0));
+    cache.Begin(1);
+    W_CHECK(cache.Update(0, data, {}, 64, 0));
+    cache.Begin(1);
+    W_CHECK(cache.Update(0, std::span{ data }.first(32), std::span{ data }.last(32), 64, 0)); // same bytes, other split
+}
+
+W_TEST(draw_list_cache, CapacityGrowsGeometrically)
+{
+    size_t capacity = 0, growths = 0;
+    for (size_t required = 1; required <= 1'000'000; required += 97) {
+        size_t next = w::GrowCapacity(capacity, required, 5000);
+        W_CHECK(next >= required && next >= capacity);
+        growths += next != capacity;
+        capacity = next;
+    }
+    W_CHECK(growths <= 10);
+    W_CHECK(w::GrowCapacity(0, 1, 5000) == 5000);
+    W_CHECK(w::GrowCapacity(8000, 100, 5000) == 8000);
+}
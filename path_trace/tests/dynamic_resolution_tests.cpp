@@ -0,0 +1,56 @@
+// DynamicResolution preview scale and the ramp back to full resolution
+#include "dynamic_resolution.h"
+#include "test.h"
+
+W_TEST(dynamic_resolution, RampReturnsToFullResolution)
+{
+    w::DynamicResolution resolution{ { .target_ms = 16.0f, .ramp_frames = 4 } };
+    W_CHECK(resolution.FullResolution());
+    resolution.Interact();
+    W_CHECK(!resolution.FullResolution()); // the next frame is a preview
+
+    float previous = resolution.BeginFrame();
+    W_CHECK(previous < 1.0f);
+    uint32_t ramp = 0;
+    while (!resolution.FullResolution()) {
+        float scale = resolution.BeginFrame();
+        W_CHECK(scale > previous);
+        previous = scale;
+        W_CHECK(++ramp <= 4);
+    }
+    W_CHECK(ramp == 4);
+    W_CHECK(resolution.BeginFrame() == 1.0f);
+}
+
+W_TEST(dynamic_resolution, OffStaysAtFullResolution)
+{
+    w::DynamicResolution resolution;
+    resolution.Interact();
+    W_CHECK(resolution.FullResolution());
+    W_CHECK(resolution.BeginFrame() == 1.0f);
+}
+
+W_TEST(dynamic_resolution, ResetSkipsTheRamp)
+{
+    w::DynamicResolution resolution{ { .target_ms = 16.0f } };
+    resolution.Interact();
+    resolution.BeginFrame();
+    W_CHECK(!resolution.FullResolution());
+    resolution.Reset();
+    W_CHECK(resolution.FullResolution());
+    W_CHECK(resolution.BeginFrame() == 1.0f);
+}
+
+W_TEST(dynamic_resolution, SlowPreviewsLowerTheScale)
+{
+    w::DynamicResolution resolution{ { .target_ms = 10.0f, .min_scale = 0.25f } };
+    float first = 0.0f, scale = 0.0f;
+    for (uint32_t i = 0; i < 16; i++) {
+        resolution.Interact();
+        scale = resolution.BeginFrame();
+        first = i ? first : scale;
+        resolution.EndFrame(100.0); // ten times the target at any scale
+    }
+    W_CHECK(scale < first);
+    W_CHECK(scale >= 0.25f);
+}
@@ -0,0 +1,96 @@
+// LinearAllocator and BasicFrameAllocator over plain memory
+#include "frame_allocator.h"
+#include "test.h"
+#include <vector>
+
+namespace {
+constexpr uint32_t frames = 3;
+constexpr uint64_t frame_capacity = 4096;
+
+struct FrameMemory {
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(frame_capacity * frames);
+    w::BasicFrameAllocator<frames> allocator{ bytes.data(), frame_capacity };
+};
+} // namespace
+
+W_TEST(frame_allocator, LinearAlignsAndFails)
+{
+    w::LinearAllocator linear{ 1024, 1024 };
+    W_CHECK(linear.Allocate(10) == 1024);
+    W_CHECK(linear.Allocate(10) == 1280); // next constant buffer boundary
+    W_CHECK(linear.Allocate(4, 4) == 1292);
+    W_CHECK(linear.Used() == 272);
+    W_CHECK(!linear.Allocate(1024)); // past base + capacity
+    W_CHECK(linear.Used() == 272); // a failed allocation takes nothing
+
+    linear.Reset();
+    W_CHECK(linear.Used() == 0);
+    W_CHECK(linear.Allocate(1024) == 1024);
+}
+
+W_TEST(frame_allocator, FramesUseDisjointRegions)
+{
+    FrameMemory memory;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        memory.allocator.BeginFrame(frame);
+        for (uint32_t i = 0; i < frame_capacity / w::constant_buffer_alignment; i++) {
+            auto a = memory.allocator.Allocate(64);
+            W_CHECK(a.offset >= frame * frame_capacity);
+            W_CHECK(a.offset + a.size <= (frame + 1) * frame_capacity);
+            W_CHECK(a.offset % w::constant_buffer_alignment == 0);
+            W_CHECK(a.data == memory.bytes.data() + a.offset);
+        }
+    }
+}
+
+W_TEST(frame_allocator, WrapResetsOnlyTheReusedRegion)
+{
+    FrameMemory memory;
+    std::vector<w::FrameAllocation> pushed;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        memory.allocator.BeginFrame(frame);
+        memory.allocator.Allocate(1000);
+        pushed.push_back(memory.allocator.Push(frame + 100u));
+    }
+
+    // frame index keeps counting, the region of frame 0 is reused and starts over
+    memory.allocator.BeginFrame(frames);
+    W_CHECK(memory.allocator.CurrentFrame() == 0);
+    W_CHECK(memory.allocator.Region(0).Used() == 0);
+    for (uint32_t frame = 1; frame < frames; frame++) {
+        W_CHECK(memory.allocator.Region(frame).Used() > 0);
+    }
+
+    auto a = memory.allocator.Push(7u);
+    W_CHECK(a.offset == 0);
+    W_CHECK(*a.As<uint32_t>() == 7u);
+    // constants of the frames still in flight are untouched
+    for (uint32_t frame = 1; frame < frames; frame++) {
+        W_CHECK(*pushed[frame].As<uint32_t>() == frame + 100u);
+    }
+}
+
+W_TEST(frame_allocator, ManyFramesNeverLeak)
+{
+    FrameMemory memory;
+    for (uint32_t frame = 0; frame < 1000; frame++) {
+        memory.allocator.BeginFrame(frame);
+        for (uint32_t i = 0; i < frame % 16; i++) {
+            memory.allocator.Allocate(200);
+        }
+        W_CHECK(memory.allocator.Region(frame).Used() <= frame_capacity);
+    }
+}
+
+W_TEST(frame_allocator, FullRegionThrows)
+{
+    FrameMemory memory;
+    memory.allocator.BeginFrame(1);
+    memory.allocator.Allocate(frame_capacity - 256);
+    W_CHECK_THROWS(memory.allocator.Allocate(512));
+    W_CHECK_THROWS(memory.allocator.Allocate(frame_capacity + 1));
+
+    // the next frame has its own region
+    memory.allocator.BeginFrame(2);
+    W_CHECK(memory.allocator.Allocate(frame_capacity).offset == 2 * frame_capacity);
+}
@@ -0,0 +1,48 @@
+// Hash64 over inputs that a word-wise hash without the size confuses
+#include "hash.h"
+#include "test.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+uint64_t HashOf(std::span<const uint8_t> bytes, uint64_t seed = 0xcbf29ce484222325ull)
+{
+    return w::Hash64(std::as_bytes(bytes), seed);
+}
+} // namespace
+
+W_TEST(hash, TrailingZerosChangeTheHash)
+{
+    std::vector<uint8_t> blob{ 1, 2, 3 };
+    std::unordered_set<uint64_t> hashes;
+    for (uint32_t zeros = 0; zeros < 24; zeros++) { // within the padded tail word and past it
+        hashes.insert(HashOf(blob));
+        blob.push_back(0);
+    }
+    W_CHECK(hashes.size() == 24);
+    W_CHECK(HashOf({}) != HashOf(std::array<uint8_t, 8>{}));
+}
+
+W_TEST(hash, SeedChangesTheHash)
+{
+    std::array<uint8_t, 13> blob{ 7, 7, 7 };
+    W_CHECK(HashOf(blob, 1) != HashOf(blob, 2));
+    W_CHECK(HashOf(blob) == HashOf(blob));
+}
+
+// a single flipped bit changes many bits of the result, hash maps keyed by it use the low bits
+W_TEST(hash, BitFlipsAvalanche)
+{
+    std::array<uint8_t, 32> blob{};
+    uint64_t base = HashOf(blob);
+    uint32_t min_changed = 64;
+    for (uint32_t bit = 0; bit < blob.size() * 8; bit++) {
+        blob[bit / 8] ^= uint8_t(1u << (bit % 8));
+        min_changed = std::min(min_changed, uint32_t(std::popcount(HashOf(blob) ^ base)));
+        blob[bit / 8] ^= uint8_t(1u << (bit % 8));
+    }
+    W_CHECK(min_changed >= 12);
+}
@@ -0,0 +1,133 @@
+// OffsetAllocator placement, coalescing and bookkeeping
+#include "offset_allocator.h"
+#include "test.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+struct Live {
+    w::OffsetAllocator::Allocation allocation;
+    uint32_t size; // as reported by the allocator
+};
+
+bool Disjoint(std::vector<Live> live, uint32_t size)
+{
+    std::sort(live.begin(), live.end(), [](auto& a, auto& b) { return a.allocation.offset < b.allocation.offset; });
+    uint32_t end = 0;
+    for (auto& l : live) {
+        if (l.allocation.offset < end) {
+            return false;
+        }
+        end = l.allocation.offset + l.size;
+    }
+    return end <= size;
+}
+} // namespace
+
+W_TEST(offset_allocator, FillsWithoutOverlap)
+{
+    w::OffsetAllocator allocator{ 1024, 256 };
+    std::vector<Live> live;
+    for (uint32_t i = 0; i < 64; i++) {
+        auto a = allocator.Allocate(16);
+        W_CHECK(a.Valid());
+        W_CHECK(allocator.AllocationSize(a) == 16);
+        live.push_back({ a, 16 });
+    }
+    W_CHECK(Disjoint(live, 1024));
+    W_CHECK(allocator.FreeStorage() == 0);
+    W_CHECK(!allocator.Allocate(1).Valid());
+}
+
+// sizes are bin boundaries, other sizes round up on Allocate and down on Free and may not fill the range exactly
+W_TEST(offset_allocator, FreeMergesNeighbors)
+{
+    w::OffsetAllocator allocator{ 384 };
+    auto a = allocator.Allocate(128);
+    auto b = allocator.Allocate(128);
+    auto c = allocator.Allocate(128);
+    W_CHECK(a.Valid() && b.Valid() && c.Valid());
+
+    allocator.Free(a);
+    allocator.Free(c);
+    auto report = allocator.Report();
+    W_CHECK(report.total_free == 256);
+    W_CHECK(report.free_regions == 2);
+    W_CHECK(report.largest_free == 128);
+    W_CHECK(!allocator.Allocate(256).Valid()); // free, but not in one piece
+
+    allocator.Free(b); // joins both neighbors
+    report = allocator.Report();
+    W_CHECK(report.total_free == 384);
+    W_CHECK(report.free_regions == 1);
+    W_CHECK(report.largest_free == 384);
+    W_CHECK(allocator.Fragmentation() == 0.0f);
+
+    auto whole = allocator.Allocate(384);
+    W_CHECK(whole.Valid() && whole.offset == 0);
+}
+
+W_TEST(offset_allocator, RandomAllocFreeKeepsBookkeeping)
+{
+    constexpr uint32_t size = 1u << 20;
+    w::OffsetAllocator allocator{ size, 4096 };
+    std::mt19937 rng{ 42 };
+    std::uniform_int_distribution<uint32_t> sizes{ 1, 8192 };
+    std::vector<Live> live;
+
+    for (uint32_t i = 0; i < 20000; i++) {
+        if (live.empty() || rng() % 3 != 0) {
+            uint32_t request = sizes(rng);
+            auto a = allocator.Allocate(request);
+            if (a.Valid()) {
+                W_CHECK(allocator.AllocationSize(a) >= request);
+                live.push_back({ a, allocator.AllocationSize(a) });
+            }
+        } else {
+            size_t index = rng() % live.size();
+            allocator.Free(live[index].allocation);
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if (i % 1000 == 0) {
+            W_CHECK(Disjoint(live, size));
+            uint32_t used = 0;
+            for (auto& l : live) {
+                used += l.size;
+            }
+            W_CHECK(allocator.FreeStorage() == size - used);
+        }
+    }
+    W_CHECK(Disjoint(live, size));
+
+    for (auto& l : live) {
+        allocator.Free(l.allocation);
+    }
+    auto report = allocator.Report();
+    W_CHECK(report.total_free == size);
+    W_CHECK(report.free_regions == 1);
+    W_CHECK(report.largest_free == size);
+}
+
+W_TEST(offset_allocator, OutOfNodesFailsCleanly)
+{
+    w::OffsetAllocator allocator{ 1024, 8 };
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        valid += allocator.Allocate(1).Valid();
+    }
+    W_CHECK(valid > 0 && valid < 8);
+    W_CHECK(allocator.Report().total_free == 0); // nothing can be allocated without a node
+}
+
+W_TEST(offset_allocator, ResetFreesEverything)
+{
+    w::OffsetAllocator allocator{ 4096 };
+    for (uint32_t i = 0; i < 10; i++) {
+        allocator.Allocate(300);
+    }
+    allocator.Reset();
+    W_CHECK(allocator.FreeStorage() == 4096);
+    W_CHECK(allocator.Allocate(4096).offset == 0);
+}
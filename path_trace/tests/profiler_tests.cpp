@@ -0,0 +1,80 @@
+// ThreadBuffer ring and its concurrent Collect
+#include "profiler.h"
+#include "test.h"
+#include <thread>
+
+namespace {
+constexpr const char* names[] = { "a", "b", "c", "d" };
+
+// every field derives from begin, a torn copy breaks the relation
+w::prof::Event Expected(uint64_t i)
+{
+    return { names[i % 4], i + 1, i + 2, uint32_t(i % 7) };
+}
+bool Consistent(const w::prof::Event& e)
+{
+    auto expected = Expected(e.begin - 1);
+    return e.begin > 0 && e.name == expected.name && e.end == expected.end && e.depth == expected.depth;
+}
+} // namespace
+
+W_TEST(profiler, CollectReturnsLastLap)
+{
+    w::prof::ThreadBuffer buffer{ 0 };
+    uint64_t count = w::prof::ThreadBuffer::capacity + 100;
+    for (uint64_t i = 0; i < count; i++) {
+        buffer.Push(Expected(i));
+    }
+
+    std::vector<w::prof::Event> events;
+    buffer.Collect(0, ~0ull, events);
+    W_CHECK(events.size() == w::prof::ThreadBuffer::capacity);
+    W_CHECK(events.front().begin == 101); // the oldest 100 were overwritten
+    for (auto& e : events) {
+        W_CHECK(Consistent(e));
+    }
+
+    events.clear();
+    buffer.Collect(count - 9, count + 1, events); // overlapping the window, the last 10
+    W_CHECK(events.size() == 10);
+}
+
+W_TEST(profiler, ConcurrentCollectNeverTears)
+{
+    w::prof::ThreadBuffer buffer{ 0 };
+    std::atomic<bool> done = false;
+    std::thread owner{ [&] {
+        for (uint64_t i = 0; i < 4'000'000; i++) {
+            buffer.Push(Expected(i));
+        }
+        done = true;
+    } };
+
+    uint32_t collects = 0;
+    bool consistent = true;
+    std::vector<w::prof::Event> events;
+    while (!done || collects == 0) {
+        events.clear();
+        buffer.Collect(0, ~0ull, events);
+        for (auto& e : events) {
+            consistent &= Consistent(e);
+        }
+        collects++;
+    }
+    owner.join();
+    W_CHECK(consistent);
+}
+
+W_TEST(profiler, InternedNamesOutliveTheirSource)
+{
+    auto& profiler = w::prof::Profiler::Get();
+    const char* interned = nullptr;
+    {
+        std::string name = "Task graph task";
+        interned = profiler.Intern(name);
+        W_CHECK(interned != name.c_str());
+        name.assign(name.size(), 'x');
+    }
+    W_CHECK(std::string_view(interned) == "Task graph task");
+    W_CHECK(profiler.Intern(std::string("Task graph task")) == interned);
+}
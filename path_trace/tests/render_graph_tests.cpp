@@ -0,0 +1,305 @@
+// BasicRenderGraph recorded against a mock backend, asserts the emitted barriers, culling and transient placement
+#include "render_graph.h"
+#include "test.h"
+#include <variant>
+
+namespace {
+struct MockTexture {
+    uint32_t id = 0;
+};
+struct MockBuffer {
+    uint32_t id = 0;
+};
+
+struct RecordedBarrier {
+    uint32_t id; // of the texture or buffer
+    w::RGState before;
+    w::RGState after;
+};
+struct BarrierBatch {
+    std::vector<RecordedBarrier> textures;
+    std::vector<RecordedBarrier> buffers;
+};
+struct PassRun {
+    std::string name;
+};
+
+// commands in recording order
+struct MockCommandList {
+    std::vector<std::variant<BarrierBatch, PassRun>> commands;
+
+    const BarrierBatch& Batch(size_t i) const
+    {
+        auto* batch = std::get_if<BarrierBatch>(&commands.at(i));
+        W_CHECK(batch);
+        return *batch;
+    }
+    std::string_view Pass(size_t i) const
+    {
+        auto* pass = std::get_if<PassRun>(&commands.at(i));
+        W_CHECK(pass);
+        return pass->name;
+    }
+};
+
+class MockGraphBackend
+{
+public:
+    using CommandList = MockCommandList;
+    using Texture = MockTexture;
+    using Buffer = MockBuffer;
+
+    static constexpr uint32_t transient_id = 1000; // ids of realized transients start here
+    static constexpr uint64_t alignment = 65536;
+
+public:
+    void Barriers(CommandList& cmd_list, std::span<const w::RGResolvedBarrier<Texture>> textures, std::span<const w::RGResolvedBarrier<Buffer>> buffers)
+    {
+        BarrierBatch batch;
+        for (auto& b : textures) {
+            batch.textures.push_back({ b.resource->id, b.before, b.after });
+        }
+        for (auto& b : buffers) {
+            batch.buffers.push_back({ b.resource->id, b.before, b.after });
+        }
+        cmd_list.commands.emplace_back(std::move(batch));
+    }
+    w::RGMemoryInfo TextureMemory(const w::RGTextureDesc& desc) const
+    {
+        return { (uint64_t(desc.width) * desc.height * 4 + alignment - 1) / alignment * alignment, alignment };
+    }
+    void Realize(uint64_t heap_size, std::span<const w::RGTransient> transients)
+    {
+        realized_heap_size = heap_size;
+        textures.clear();
+        for (uint32_t i = 0; i < transients.size(); i++) {
+            textures.push_back({ transient_id + i });
+        }
+        realize_count++;
+    }
+    const Texture& Transient(uint32_t index) const
+    {
+        return textures.at(index);
+    }
+
+public:
+    std::vector<MockTexture> textures;
+    uint64_t realized_heap_size = 0;
+    uint32_t realize_count = 0;
+};
+
+using Graph = w::BasicRenderGraph<MockGraphBackend>;
+
+// pass body that records itself, so barriers can be checked against pass boundaries
+Graph::ExecuteFn Run(std::string name)
+{
+    return [name](MockCommandList& cmd) { cmd.commands.emplace_back(PassRun{ name }); };
+}
+
+constexpr w::RGTextureDesc half_res{ .width = 640, .height = 360 };
+} // namespace
+
+// the path tracer frame: trace into the accumulation texture, filter it into the swapchain, present
+W_TEST(render_graph, TraceFilterPresentBarriers)
+{
+    MockTexture output{ 1 }, swap{ 2 };
+    w::RGState output_state{}; // freshly created
+    w::RGState swap_state = w::StateOf(w::RGUsage::Present);
+
+    Graph graph;
+    auto out = graph.ImportTexture(output, output_state);
+    auto back = graph.ImportTexture(swap, swap_state, w::RGUsage::Present);
+    graph.AddPass("trace", { { out, w::RGUsage::RaytracingStorage } }, Run("trace"));
+    graph.AddPass("filter", { { out, w::RGUsage::PixelStorageRead }, { back, w::RGUsage::RenderTarget } }, Run("filter"));
+    graph.Compile();
+
+    MockCommandList cmd;
+    graph.Execute(cmd);
+    W_CHECK(cmd.commands.size() == 5);
+
+    auto& before_trace = cmd.Batch(0);
+    W_CHECK(before_trace.textures.size() == 1 && before_trace.buffers.empty());
+    W_CHECK(before_trace.textures[0].id == 1);
+    W_CHECK(before_trace.textures[0].before == w::RGState{});
+    W_CHECK(before_trace.textures[0].after == w::StateOf(w::RGUsage::RaytracingStorage));
+    W_CHECK(cmd.Pass(1) == "trace");
+
+    // both transitions of the filter pass are merged into one batch
+    auto& before_filter = cmd.Batch(2);
+    W_CHECK(before_filter.textures.size() == 2);
+    W_CHECK(before_filter.textures[0].id == 1);
+    W_CHECK(before_filter.textures[0].before == w::StateOf(w::RGUsage::RaytracingStorage));
+    W_CHECK(before_filter.textures[0].after == w::StateOf(w::RGUsage::PixelStorageRead));
+    W_CHECK(before_filter.textures[1].id == 2);
+    W_CHECK(before_filter.textures[1].before == w::StateOf(w::RGUsage::Present));
+    W_CHECK(before_filter.textures[1].after == w::StateOf(w::RGUsage::RenderTarget));
+    W_CHECK(cmd.Pass(3) == "filter");
+
+    auto& final_batch = cmd.Batch(4);
+    W_CHECK(final_batch.textures.size() == 1);
+    W_CHECK(final_batch.textures[0].id == 2);
+    W_CHECK(final_batch.textures[0].after == w::StateOf(w::RGUsage::Present));
+
+    // imported states carry over to the next frame
+    W_CHECK(output_state == w::StateOf(w::RGUsage::PixelStorageRead));
+    W_CHECK(swap_state == w::StateOf(w::RGUsage::Present));
+}
+
+W_TEST(render_graph, NextFrameStartsFromTrackedState)
+{
+    MockTexture output{ 1 };
+    w::RGState output_state = w::StateOf(w::RGUsage::PixelStorageRead);
+
+    Graph graph;
+    auto out = graph.ImportTexture(output, output_state);
+    graph.AddPass("trace", { { out, w::RGUsage::RaytracingStorage } }, Run("trace"));
+    graph.Compile();
+
+    W_CHECK(graph.BarriersBefore(0).size() == 1);
+    W_CHECK(graph.BarriersBefore(0)[0].before == w::StateOf(w::RGUsage::PixelStorageRead));
+    W_CHECK(graph.FinalBarriers().empty()); // no final usage
+}
+
+W_TEST(render_graph, RedundantTransitionsAreSkipped)
+{
+    MockTexture a{ 1 }, target{ 2 };
+    w::RGState a_state{}, target_state{};
+
+    Graph graph;
+    auto ra = graph.ImportTexture(a, a_state);
+    auto rt = graph.ImportTexture(target, target_state);
+    graph.AddPass("write 0", { { ra, w::RGUsage::RaytracingStorage } }, Run("write 0"));
+    graph.AddPass("write 1", { { ra, w::RGUsage::RaytracingStorage } }, Run("write 1"));
+    graph.AddPass("read 0", { { ra, w::RGUsage::CopySource }, { rt, w::RGUsage::RenderTarget } }, Run("read 0"));
+    graph.AddPass("read 1", { { ra, w::RGUsage::CopySource }, { rt, w::RGUsage::RenderTarget } }, Run("read 1"));
+    graph.Compile();
+
+    W_CHECK(graph.BarriersBefore(0).size() == 1);
+    // storage write after write needs an execution dependency even in the same state
+    W_CHECK(graph.BarriersBefore(1).size() == 1);
+    W_CHECK(graph.BarriersBefore(1)[0].before == graph.BarriersBefore(1)[0].after);
+    W_CHECK(graph.BarriersBefore(2).size() == 2);
+    // same state read and render target writes are kept in order without a barrier
+    W_CHECK(graph.BarriersBefore(3).empty());
+
+    MockCommandList cmd;
+    graph.Execute(cmd);
+    uint32_t batches = 0;
+    for (auto& c : cmd.commands) {
+        batches += std::holds_alternative<BarrierBatch>(c);
+    }
+    W_CHECK(batches == 3); // no empty batch for the last pass
+}
+
+W_TEST(render_graph, BuffersGoToBufferBarriers)
+{
+    MockBuffer blas{ 7 };
+    MockTexture output{ 1 };
+    w::RGState blas_state{}, output_state{};
+
+    Graph graph;
+    auto as = graph.ImportBuffer(blas, blas_state);
+    auto out = graph.ImportTexture(output, output_state);
+    graph.AddPass("build", { { as, w::RGUsage::BuildAccelerationStructure } }, Run("build"));
+    graph.AddPass("trace", { { as, w::RGUsage::ReadAccelerationStructure }, { out, w::RGUsage::RaytracingStorage } }, Run("trace"));
+    graph.Compile();
+
+    MockCommandList cmd;
+    graph.Execute(cmd);
+    W_CHECK(cmd.Pass(1) == "build");
+    auto& before_trace = cmd.Batch(2);
+    W_CHECK(before_trace.buffers.size() == 1);
+    W_CHECK(before_trace.buffers[0].id == 7);
+    W_CHECK(before_trace.buffers[0].before.access == wis::ResourceAccess::AccelerationStructureWrite);
+    W_CHECK(before_trace.buffers[0].after.access == wis::ResourceAccess::AccelerationStructureRead);
+    W_CHECK(before_trace.textures.size() == 1);
+    W_CHECK(blas_state == w::StateOf(w::RGUsage::ReadAccelerationStructure));
+}
+
+W_TEST(render_graph, UnreadTransientWritesAreCulled)
+{
+    MockTexture output{ 1 };
+    w::RGState output_state{};
+
+    Graph graph;
+    auto out = graph.ImportTexture(output, output_state);
+    auto unused = graph.CreateTexture(half_res);
+    auto used = graph.CreateTexture(half_res);
+    graph.AddPass("dead", { { unused, w::RGUsage::RaytracingStorage } }, Run("dead"));
+    graph.AddPass("produce", { { used, w::RGUsage::RaytracingStorage } }, Run("produce"));
+    graph.AddPass("consume", { { used, w::RGUsage::CopySource }, { out, w::RGUsage::CopyDest } }, Run("consume"));
+    graph.Compile();
+
+    W_CHECK(graph.Culled(0));
+    W_CHECK(!graph.Culled(1));
+    W_CHECK(!graph.Culled(2));
+    W_CHECK(graph.BarriersBefore(0).empty());
+    W_CHECK(graph.Transients().size() == 1); // the culled pass does not keep its texture alive
+
+    MockCommandList cmd;
+    graph.Execute(cmd);
+    for (auto& c : cmd.commands) {
+        auto* pass = std::get_if<PassRun>(&c);
+        W_CHECK(!pass || pass->name != "dead");
+    }
+    // barriers of transients resolve to the realized textures
+    W_CHECK(cmd.Batch(0).textures[0].id == MockGraphBackend::transient_id);
+}
+
+W_TEST(render_graph, DisjointTransientsAlias)
+{
+    MockTexture output{ 1 };
+    w::RGState output_state{};
+
+    Graph graph;
+    auto out = graph.ImportTexture(output, output_state);
+    auto a = graph.CreateTexture(half_res);
+    auto b = graph.CreateTexture(half_res);
+    auto c = graph.CreateTexture(half_res);
+    graph.AddPass("a", { { a, w::RGUsage::RaytracingStorage } }, Run("a"));
+    graph.AddPass("a to b", { { a, w::RGUsage::CopySource }, { b, w::RGUsage::CopyDest } }, Run("a to b"));
+    graph.AddPass("b to c", { { b, w::RGUsage::CopySource }, { c, w::RGUsage::CopyDest } }, Run("b to c"));
+    graph.AddPass("c to out", { { c, w::RGUsage::CopySource }, { out, w::RGUsage::CopyDest } }, Run("c to out"));
+    graph.Compile();
+
+    auto transients = graph.Transients();
+    W_CHECK(transients.size() == 3);
+    uint64_t size = MockGraphBackend{}.TextureMemory(half_res).size;
+    // a and c are never alive at the same time, b overlaps both
+    W_CHECK(transients[0].offset == transients[2].offset);
+    W_CHECK(transients[1].offset != transients[0].offset);
+    W_CHECK(transients[1].offset % MockGraphBackend::alignment == 0);
+    W_CHECK(graph.TransientHeapSize() == 2 * size);
+
+    MockCommandList cmd;
+    graph.Execute(cmd);
+    W_CHECK(graph.GetBackend().realize_count == 1);
+    W_CHECK(graph.GetBackend().realized_heap_size == 2 * size);
+}
+
+W_TEST(render_graph, ResetKeepsNothingOfThePreviousFrame)
+{
+    MockTexture output{ 1 };
+    w::RGState output_state{};
+
+    Graph graph;
+    auto out = graph.ImportTexture(output, output_state);
+    auto t = graph.CreateTexture(half_res);
+    graph.AddPass("produce", { { t, w::RGUsage::RaytracingStorage } }, Run("produce"));
+    graph.AddPass("consume", { { t, w::RGUsage::CopySource }, { out, w::RGUsage::CopyDest } }, Run("consume"));
+    graph.Compile();
+    MockCommandList cmd;
+    graph.Execute(cmd);
+
+    graph.Reset();
+    W_CHECK(graph.PassCount() == 0);
+    W_CHECK(graph.Transients().empty());
+    W_CHECK(graph.TransientHeapSize() == 0);
+
+    out = graph.ImportTexture(output, output_state);
+    graph.AddPass("copy", { { out, w::RGUsage::CopyDest } }, Run("copy"));
+    graph.Compile();
+    W_CHECK(graph.BarriersBefore(0).size() == 1);
+    W_CHECK(graph.BarriersBefore(0)[0].before == w::StateOf(w::RGUsage::CopyDest));
+    W_CHECK(graph.FinalBarriers().empty());
+}
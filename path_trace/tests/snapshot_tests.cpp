@@ -0,0 +1,80 @@
+// SnapshotChannel versions, pinned views and reads racing a writer
+#include "snapshot.h"
+#include "test.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+// every word of a published payload holds the same number, a reader that sees two numbers read a torn version
+struct Payload {
+    std::array<uint64_t, 64> words{};
+};
+} // namespace
+
+W_TEST(snapshot, ReadSeesTheLatestVersion)
+{
+    w::SnapshotChannel<int> channel{ 7 };
+    W_CHECK(channel.Version() == 1);
+    W_CHECK(*channel.Read() == 7);
+    for (int i = 0; i < 10; i++) {
+        uint64_t version = channel.Publish(i);
+        W_CHECK(version == uint64_t(i) + 2);
+        auto view = channel.Read();
+        W_CHECK(*view == i);
+        W_CHECK(view.Version() == version);
+    }
+}
+
+W_TEST(snapshot, ViewsKeepTheirVersion)
+{
+    w::SnapshotChannel<int, 2> channel{ 0 };
+    auto first = channel.Read();
+    channel.Publish(1);
+    auto second = channel.Read();
+    // with max_readers views alive the writer still finds a free slot
+    for (int i = 2; i < 20; i++) {
+        channel.Publish(i);
+    }
+    W_CHECK(*first == 0 && first.Version() == 1);
+    W_CHECK(*second == 1 && second.Version() == 2);
+    W_CHECK(*channel.Read() == 19);
+
+    auto moved = std::move(first);
+    W_CHECK(!first && *moved == 0);
+}
+
+W_TEST(snapshot, ReadersNeverSeeTornOrOlderVersions)
+{
+    constexpr uint32_t reader_count = 4;
+    constexpr uint32_t reads = 200000;
+    w::SnapshotChannel<Payload, reader_count> channel;
+    std::atomic<uint32_t> torn = 0, older = 0;
+    {
+        std::jthread writer([&channel](std::stop_token stop) {
+            Payload payload;
+            for (uint64_t i = 1; !stop.stop_requested(); i++) {
+                payload.words.fill(i);
+                channel.Publish(payload);
+            }
+        });
+        std::vector<std::jthread> readers;
+        for (uint32_t r = 0; r < reader_count; r++) {
+            readers.emplace_back([&]() {
+                uint64_t last_version = 0;
+                for (uint32_t i = 0; i < reads; i++) {
+                    auto view = channel.Read();
+                    for (uint64_t word : view->words) {
+                        torn += word != view->words[0];
+                    }
+                    older += view.Version() < last_version;
+                    last_version = view.Version();
+                }
+            });
+        }
+        readers.clear();
+    }
+    W_CHECK(torn == 0);
+    W_CHECK(older == 0);
+}
@@ -0,0 +1,127 @@
+// TaskGraph dependency order, main thread pinning and failure propagation
+#include "task_graph.h"
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace {
+// global order of task starts and ends, a dependency has to end before its dependent starts
+struct Order {
+    std::atomic<uint32_t> clock = 0;
+    std::vector<uint32_t> started;
+    std::vector<uint32_t> ended;
+
+    explicit Order(size_t tasks)
+        : started(tasks), ended(tasks)
+    {
+    }
+    std::function<void()> Task(uint32_t id)
+    {
+        return [this, id]() {
+            started[id] = clock++;
+            std::this_thread::yield(); // give other threads the chance to start something too early
+            ended[id] = clock++;
+        };
+    }
+};
+} // namespace
+
+W_TEST(task_graph, DependenciesFinishFirst)
+{
+    constexpr uint32_t layers = 6;
+    constexpr uint32_t width = 5;
+    Order order{ layers * width };
+    w::TaskGraph graph;
+    std::vector<std::pair<uint32_t, uint32_t>> edges; // dependency, dependent
+    for (uint32_t layer = 0; layer < layers; layer++) {
+        for (uint32_t i = 0; i < width; i++) {
+            uint32_t id = layer * width + i;
+            if (layer == 0) {
+                W_CHECK(graph.Add("t" + std::to_string(id), order.Task(id)) == id);
+                continue;
+            }
+            // two tasks of the previous layer, crossing lanes
+            uint32_t a = (layer - 1) * width + i, b = (layer - 1) * width + (i + 2) % width;
+            W_CHECK(graph.Add("t" + std::to_string(id), order.Task(id), { a, b }) == id);
+            edges.push_back({ a, id });
+            edges.push_back({ b, id });
+        }
+    }
+    graph.Run(4);
+
+    for (auto [dependency, dependent] : edges) {
+        W_CHECK(order.ended[dependency] < order.started[dependent]);
+    }
+    for (auto& record : graph.Timeline()) {
+        W_CHECK(record.ran);
+        W_CHECK(record.thread < 4);
+        W_CHECK(record.start_ms <= record.end_ms);
+    }
+}
+
+W_TEST(task_graph, MainThreadTasksStayOnTheCaller)
+{
+    const auto caller = std::this_thread::get_id();
+    std::vector<std::thread::id> ran_on(12);
+    w::TaskGraph graph;
+    std::vector<w::TaskGraph::TaskId> ids;
+    for (uint32_t i = 0; i < 12; i++) {
+        bool main_thread = i % 3 == 0;
+        auto work = [&ran_on, i]() {
+            ran_on[i] = std::this_thread::get_id();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+        // main thread tasks between pool tasks, so the pool is busy when they become ready
+        ids.push_back(i == 0 ? graph.Add("task", work, {}, main_thread) : graph.Add("task", work, { ids[i - 1] }, main_thread));
+    }
+    graph.Run(4);
+
+    for (uint32_t i = 0; i < 12; i++) {
+        if (i % 3 == 0) {
+            W_CHECK(ran_on[i] == caller);
+            W_CHECK(graph.Timeline()[i].thread == 0);
+        }
+    }
+}
+
+W_TEST(task_graph, FailureSkipsDependents)
+{
+    std::atomic<uint32_t> runs = 0;
+    w::TaskGraph graph;
+    auto fail = graph.Add("fail", []() { throw std::runtime_error("task failed"); });
+    auto after = graph.Add("after", [&]() { runs++; }, { fail });
+    graph.Add("after after", [&]() { runs++; }, { after });
+    graph.Add("independent", [&]() { runs++; });
+
+    bool thrown = false;
+    try {
+        graph.Run(2);
+    } catch (const std::runtime_error& e) {
+        thrown = std::string_view(e.what()) == "task failed";
+    }
+    W_CHECK(thrown);
+    W_CHECK(runs == 1);
+    auto timeline = graph.Timeline();
+    W_CHECK(timeline[0].ran && !timeline[1].ran && !timeline[2].ran && timeline[3].ran);
+}
+
+W_TEST(task_graph, ForwardDependenciesAreRejected)
+{
+    w::TaskGraph graph;
+    graph.Add("first", []() {});
+    W_CHECK_THROWS(graph.Add("second", []() {}, { 1 }));
+}
+
+W_TEST(task_graph, SingleThreadRunsEverything)
+{
+    Order order{ 3 };
+    w::TaskGraph graph;
+    auto a = graph.Add("a", order.Task(0));
+    auto b = graph.Add("b", order.Task(1), { a }, true);
+    graph.Add("c", order.Task(2), { a, b });
+    graph.Run(1);
+    W_CHECK(order.ended[0] < order.started[1] && order.ended[1] < order.started[2]);
+}
@@ -0,0 +1,147 @@
+// TemporalAccumulator history through camera moves and scene changes
+#include "temporal_reprojection.h"
+#include "test.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+constexpr uint32_t width = 48, height = 27;
+
+// default scene, spheres_away moves the spheres out of the box
+w::CpuScene DefaultScene(bool spheres_away = false)
+{
+    auto views = w::Scene::DefaultObjects();
+    std::array<wis::AccelerationInstance, w::Scene::objects_count> instances;
+    std::array<w::MaterialCBuffer, w::Scene::objects_count> materials;
+    for (uint32_t i = 0; i < w::Scene::objects_count; i++) {
+        if (spheres_away && i >= 2) {
+            views[i].data.pos.y += 1000.0f;
+        }
+        instances[i] = w::Scene::MakeInstance(i, views[i]);
+        materials[i] = views[i].material;
+    }
+    w::CpuScene scene;
+    scene.Update(instances, materials);
+    return scene;
+}
+
+// default view, orbited by step radians and zoomed out by half as much
+w::Camera::CBuffer View(float step = 0.0f)
+{
+    w::Camera camera;
+    camera.SetPerspective(w::Scene::fov, float(width) / float(height), 0.1f, 1000.0f);
+    camera.ResetOrientation();
+    auto state = camera.GetState();
+    state.orientation.y += step;
+    state.radius *= 1.0f + step * 0.5f;
+    camera.SetState(state);
+    w::Camera::CBuffer cbuffer;
+    camera.PutCBuffer(&cbuffer);
+    return cbuffer;
+}
+
+// the same view in a buffer that compares different, so SetCamera reprojects onto itself
+w::Camera::CBuffer Identity(w::Camera::CBuffer cbuffer)
+{
+    cbuffer.ray_origin.w += 1.0f;
+    return cbuffer;
+}
+
+bool IsBlack(const DirectX::XMFLOAT3& c)
+{
+    return c.x == 0.0f && c.y == 0.0f && c.z == 0.0f;
+}
+} // namespace
+
+W_TEST(temporal_reprojection, IdentityMoveKeepsEveryHit)
+{
+    w::CpuScene scene = DefaultScene();
+    w::TemporalAccumulator temporal;
+    temporal.SetCamera(scene, View(), width, height);
+    temporal.Accumulate(scene, {}, 16);
+    w::Image before = temporal.GetImage();
+
+    temporal.SetCamera(scene, Identity(View()), width, height);
+    const auto& hits = temporal.GetPrimaryHits();
+    uint64_t hit_count = 0;
+    float max_difference = 0.0f;
+    for (size_t p = 0; p < hits.depth.size(); p++) {
+        const auto& a = temporal.GetImage().pixels[p];
+        const auto& b = before.pixels[p];
+        if (std::isinf(hits.depth[p])) {
+            W_CHECK(IsBlack(a)); // misses start over
+            continue;
+        }
+        hit_count++;
+        max_difference = std::max({ max_difference, std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) });
+    }
+    W_CHECK(hit_count > 0);
+    W_CHECK(temporal.GetStats().reprojections == 1);
+    W_CHECK(temporal.GetStats().kept == hit_count);
+    W_CHECK(max_difference < 0.01f);
+}
+
+W_TEST(temporal_reprojection, HistoryBeatsRestart)
+{
+    w::CpuScene scene = DefaultScene();
+    const auto from = View(), to = View(0.05f);
+    w::TemporalAccumulator reference, restarted, temporal;
+    reference.SetCamera(scene, to, width, height);
+    reference.Accumulate(scene, {}, 256);
+    restarted.SetCamera(scene, to, width, height);
+    restarted.Accumulate(scene, {}, 1);
+    temporal.SetCamera(scene, from, width, height);
+    temporal.Accumulate(scene, {}, 64);
+    temporal.SetCamera(scene, to, width, height);
+    temporal.Accumulate(scene, {}, 1);
+
+    W_CHECK(temporal.GetStats().KeptFraction() > 0.5);
+    W_CHECK(temporal.MinSamples() >= 1);
+    W_CHECK(w::RMSE(temporal.GetImage(), reference.GetImage()) < 0.5f * w::RMSE(restarted.GetImage(), reference.GetImage()));
+}
+
+W_TEST(temporal_reprojection, DisoccludedPixelsReset)
+{
+    // the spheres leave, the walls behind them are at another depth
+    w::CpuScene scene = DefaultScene(), moved = DefaultScene(true);
+    w::TemporalAccumulator temporal;
+    temporal.SetCamera(scene, View(), width, height);
+    temporal.Accumulate(scene, {}, 16);
+    const auto before = temporal.GetPrimaryHits();
+
+    temporal.SetCamera(moved, Identity(View()), width, height);
+    const auto& hits = temporal.GetPrimaryHits();
+    uint64_t hit_count = 0, disoccluded = 0;
+    for (size_t p = 0; p < hits.depth.size(); p++) {
+        hit_count += !std::isinf(hits.depth[p]);
+        if (std::isinf(before.depth[p]) || std::isinf(hits.depth[p]) || std::abs(before.depth[p] - hits.depth[p]) < 0.1f * hits.depth[p]) {
+            continue;
+        }
+        disoccluded++;
+        W_CHECK(IsBlack(temporal.GetImage().pixels[p]));
+    }
+    W_CHECK(disoccluded > 0);
+    W_CHECK(temporal.MinSamples() == 0);
+    W_CHECK(temporal.GetStats().kept <= hit_count - disoccluded);
+
+    temporal.FillHoles(moved, {});
+    W_CHECK(temporal.MinSamples() == 1);
+}
+
+W_TEST(temporal_reprojection, MovesReuseTheBuffers)
+{
+    w::CpuScene scene = DefaultScene();
+    w::TemporalAccumulator temporal;
+    temporal.SetCamera(scene, View(), width, height);
+    temporal.Accumulate(scene, {}, 1);
+    temporal.SetCamera(scene, View(0.01f), width, height);
+    const auto* color = temporal.GetImage().pixels.data();
+    const auto* depth = temporal.GetPrimaryHits().depth.data();
+    temporal.SetCamera(scene, View(0.02f), width, height);
+    temporal.SetCamera(scene, View(0.03f), width, height);
+    // the current and the previous view swap, every other move writes into the same allocations
+    W_CHECK(temporal.GetImage().pixels.data() == color);
+    W_CHECK(temporal.GetPrimaryHits().depth.data() == depth);
+    W_CHECK(temporal.GetImage().pixels.size() == size_t(width) * height);
+}
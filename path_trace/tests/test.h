@@ -0,0 +1,57 @@
+#pragma once
+// Minimal test harness of PathTracerTests, no GPU and no dependencies beyond the Core library.
+// Tests register themselves per suite, every suite is a separate ctest entry:
+//
+//   W_TEST(upload, LargeUploadStreamsThroughRing) { W_CHECK(...); }
+//
+// A failed check throws and ends the test, the remaining tests still run.
+#include <string>
+#include <vector>
+
+namespace w::test {
+struct TestCase {
+    const char* suite;
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<TestCase>& Registry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Registrar {
+    Registrar(const char* suite, const char* name, void (*run)())
+    {
+        Registry().push_back({ suite, name, run });
+    }
+};
+
+struct Failure {
+    std::string message;
+};
+
+[[noreturn]] inline void Fail(const char* expression, const char* file, int line)
+{
+    throw Failure{ std::string(file) + ":" + std::to_string(line) + ": check failed: " + expression };
+}
+} // namespace w::test
+
+#define W_TEST(suite, name)                                                                   \
+    static void suite##_##name();                                                             \
+    static const w::test::Registrar suite##_##name##_registrar{ #suite, #name, suite##_##name }; \
+    static void suite##_##name()
+
+#define W_CHECK(expression) ((expression) ? void() : w::test::Fail(#expression, __FILE__, __LINE__))
+
+#define W_CHECK_THROWS(statement)                            \
+    do {                                                     \
+        bool thrown = false;                                 \
+        try {                                                \
+            statement;                                       \
+        } catch (...) {                                      \
+            thrown = true;                                   \
+        }                                                    \
+        W_CHECK(thrown && "expected an exception: " #statement); \
+    } while (false)
@@ -0,0 +1,42 @@
+// CPU unit tests, see test.h
+//
+//   PathTracerTests [suite...]
+//
+// runs the given suites, or all of them without arguments. Fails if a selected suite has no tests,
+// so a misspelled ctest entry does not pass silently.
+#include "test.h"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string_view> suites(argv + 1, argv + argc);
+    auto selected = [&](std::string_view suite) {
+        return suites.empty() || std::find(suites.begin(), suites.end(), suite) != suites.end();
+    };
+
+    uint32_t run = 0;
+    uint32_t failed = 0;
+    for (auto& test : w::test::Registry()) {
+        if (!selected(test.suite)) {
+            continue;
+        }
+        run++;
+        try {
+            test.run();
+            std::cout << "[  OK  ] " << test.suite << '.' << test.name << '\n';
+        } catch (const w::test::Failure& f) {
+            failed++;
+            std::cout << "[ FAIL ] " << test.suite << '.' << test.name << "\n    " << f.message << '\n';
+        } catch (const std::exception& e) {
+            failed++;
+            std::cout << "[ FAIL ] " << test.suite << '.' << test.name << "\n    unexpected exception: " << e.what() << '\n';
+        }
+    }
+
+    std::cout << run - failed << '/' << run << " tests passed\n";
+    return run == 0 || failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+// StagingRing and BasicUploadManager against a mock queue
+#include "upload.h"
+#include "test.h"
+#include <numeric>
+
+namespace {
+struct MockBuffer {
+    mutable std::vector<uint8_t> bytes;
+};
+
+// Copies of a submission execute only when its fence completes, and read the staging memory at that point.
+// A staging range reused before its fence completed shows up as corrupted destination bytes.
+class MockUploadQueue
+{
+public:
+    explicit MockUploadQueue(uint64_t capacity)
+        : memory(capacity)
+    {
+    }
+
+public:
+    uint8_t* Mapped() noexcept
+    {
+        return memory.data();
+    }
+    void Copy(const MockBuffer& dst, uint64_t dst_offset, uint64_t src_offset, uint64_t size)
+    {
+        recorded.push_back({ &dst, dst_offset, src_offset, size });
+    }
+    uint64_t Submit()
+    {
+        batches.push_back({ ++fence_value, std::move(recorded) });
+        recorded.clear();
+        return fence_value;
+    }
+    uint64_t Completed() const noexcept
+    {
+        return completed;
+    }
+    void Wait(uint64_t value)
+    {
+        waits++;
+        Complete(value);
+    }
+
+    // the GPU catching up to value
+    void Complete(uint64_t value)
+    {
+        while (!batches.empty() && batches.front().fence_value <= value) {
+            for (auto& c : batches.front().copies) {
+                std::memcpy(c.dst->bytes.data() + c.dst_offset, memory.data() + c.src_offset, c.size);
+            }
+            batches.pop_front();
+        }
+        completed = std::max(completed, value);
+    }
+
+    uint64_t Submitted() const noexcept
+    {
+        return fence_value;
+    }
+    uint32_t Waits() const noexcept
+    {
+        return waits;
+    }
+
+private:
+    struct CopyCommand {
+        const MockBuffer* dst;
+        uint64_t dst_offset;
+        uint64_t src_offset;
+        uint64_t size;
+    };
+    struct Batch {
+        uint64_t fence_value;
+        std::vector<CopyCommand> copies;
+    };
+
+    std::vector<uint8_t> memory;
+    std::vector<CopyCommand> recorded;
+    std::deque<Batch> batches;
+    uint64_t fence_value = 0;
+    uint64_t completed = 0;
+    uint32_t waits = 0;
+};
+
+using MockUploadManager = w::BasicUploadManager<MockUploadQueue>;
+
+std::vector<uint8_t> Pattern(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = uint8_t(i * 31 + seed);
+    }
+    return data;
+}
+} // namespace
+
+W_TEST(upload, RingWrapsAfterRetire)
+{
+    w::StagingRing ring{ 256 };
+    W_CHECK(ring.Allocate(100) == 0);
+    W_CHECK(ring.Allocate(100) == 112); // aligned to 16
+    W_CHECK(!ring.Allocate(100)); // would run past the end, and the start is still in use
+    ring.Submit(1);
+    W_CHECK(!ring.Allocate(100));
+
+    ring.Retire(1);
+    W_CHECK(ring.Used() == 0);
+    W_CHECK(ring.Allocate(100) == 0); // skipped to the next lap instead of splitting across the end
+}
+
+W_TEST(upload, RingRetiresInFenceOrder)
+{
+    w::StagingRing ring{ 1024 };
+    W_CHECK(ring.Allocate(256) == 0);
+    ring.Submit(1);
+    W_CHECK(ring.Allocate(256) == 256);
+    ring.Submit(2);
+    W_CHECK(ring.OldestFence() == 1);
+    W_CHECK(!ring.HasPending());
+
+    ring.Retire(1);
+    W_CHECK(ring.Used() == 256);
+    W_CHECK(ring.OldestFence() == 2);
+    ring.Retire(2);
+    W_CHECK(ring.Used() == 0);
+    W_CHECK(ring.OldestFence() == 0);
+}
+
+W_TEST(upload, RingNeverOverlapsInFlightRanges)
+{
+    struct Range {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t fence_value; // submission that consumes it
+    };
+    w::StagingRing ring{ 1024 }; // alignment holds within a lap, so capacities are multiples of it
+    std::vector<Range> live;
+    uint64_t fence_value = 1;
+    uint32_t retires = 0;
+    for (uint64_t i = 0; i < 2000; i++) {
+        uint64_t size = 16 + i * 37 % 300;
+        auto offset = ring.Allocate(size);
+        if (!offset) { // full, the GPU completes the oldest submission
+            if (ring.HasPending()) {
+                ring.Submit(fence_value++);
+            }
+            uint64_t completed = ring.OldestFence();
+            ring.Retire(completed);
+            std::erase_if(live, [=](const Range& r) { return r.fence_value <= completed; });
+            retires++;
+            continue;
+        }
+        W_CHECK(*offset + size <= 1024);
+        W_CHECK(*offset % 16 == 0);
+        for (auto& r : live) {
+            W_CHECK(*offset + size <= r.offset || r.offset + r.size <= *offset);
+        }
+        live.push_back({ *offset, size, fence_value });
+        if (i % 3 == 0) {
+            ring.Submit(fence_value++);
+        }
+    }
+    W_CHECK(retires > 100);
+}
+
+W_TEST(upload, RingRejectsOversizedAllocations)
+{
+    w::StagingRing ring{ 256 };
+    W_CHECK(!ring.Allocate(257));
+    W_CHECK(ring.Allocate(256) == 0);
+}
+
+W_TEST(upload, CopiesOfOneFlushShareAFence)
+{
+    MockUploadManager uploads{ 4096 };
+    MockBuffer dst{ std::vector<uint8_t>(3 * 64) };
+    auto a = Pattern(64, 1), b = Pattern(64, 2), c = Pattern(64, 3);
+    uploads.Upload(dst, a.data(), 64, 0);
+    uploads.Upload(dst, b.data(), 64, 64);
+    uploads.Upload(dst, c.data(), 64, 128);
+
+    W_CHECK(uploads.Flush() == 1);
+    W_CHECK(uploads.GetQueue().Submitted() == 1);
+    uploads.Wait(1);
+    W_CHECK(std::equal(a.begin(), a.end(), dst.bytes.begin()));
+    W_CHECK(std::equal(b.begin(), b.end(), dst.bytes.begin() + 64));
+    W_CHECK(std::equal(c.begin(), c.end(), dst.bytes.begin() + 128));
+    W_CHECK(uploads.GetRing().Used() == 0);
+    W_CHECK(uploads.FlushCount() == 0);
+}
+
+W_TEST(upload, LargeUploadStreamsThroughRing)
+{
+    MockUploadManager uploads{ 1024 };
+    auto data = Pattern(10000, 7);
+    MockBuffer dst{ std::vector<uint8_t>(data.size()) };
+    uploads.Upload(dst, data.data(), data.size());
+    uploads.WaitIdle();
+
+    W_CHECK(dst.bytes == data);
+    W_CHECK(uploads.FlushCount() > 0); // ten times the ring, could only fit by flushing
+    W_CHECK(uploads.GetRing().Used() == 0);
+}
+
+// the queue never completes on its own, every reuse of staging memory has to wait for its fence
+W_TEST(upload, FullRingWaitsInsteadOfOverwriting)
+{
+    MockUploadManager uploads{ 512 };
+    MockBuffer dst{ std::vector<uint8_t>(64 * 200) };
+    std::vector<uint8_t> expected(dst.bytes.size());
+    for (uint32_t i = 0; i < 200; i++) {
+        auto data = Pattern(64, uint8_t(i));
+        uploads.Upload(dst, data.data(), data.size(), i * 64);
+        std::copy(data.begin(), data.end(), expected.begin() + i * 64);
+        if (i % 5 == 4) {
+            uploads.Flush();
+        }
+    }
+    uploads.WaitIdle();
+
+    W_CHECK(dst.bytes == expected);
+    W_CHECK(uploads.GetQueue().Waits() > 1);
+    W_CHECK(uploads.GetQueue().Completed() == uploads.GetQueue().Submitted());
+}
@@ -0,0 +1,54 @@
+#include "upload.h"
+#include "graphics.h"
+#include <tuple>
+
+w::GpuUploadQueue::GpuUploadQueue(uint64_t capacity, w::Graphics& gfx)
+    : gfx(gfx)
+{
+    wis::Result result = wis::success;
+    ring_buffer = gfx.GetAllocator().CreateUploadBuffer(result, capacity);
+    CheckResult(result);
+    mapped = ring_buffer.Map<uint8_t>(); // persistently mapped
+
+    fence = gfx.GetDevice().CreateFence(result, 0);
+    CheckResult(result);
+
+    lists.push_back({ gfx.GetDevice().CreateCommandList(result, wis::QueueType::Graphics) });
+    CheckResult(result);
+}
+
+w::GpuUploadQueue::~GpuUploadQueue()
+{
+    if (mapped) {
+        std::ignore = fence.Wait(fence_value);
+        ring_buffer.Unmap();
+    }
+}
+
+void w::GpuUploadQueue::Copy(const wis::Buffer& dst, uint64_t dst_offset, uint64_t src_offset, uint64_t size)
+{
+    CommandList().CopyBuffer(ring_buffer, dst, { .src_offset = src_offset, .dst_offset = dst_offset, .size_bytes = size });
+}
+
+uint64_t w::GpuUploadQueue::Submit()
+{
+    auto& recording = lists[current];
+    recording.list.Close();
+    gfx.ExecuteCommandLists({ recording.list });
+    CheckResult(gfx.GetMainQueue().SignalQueue(fence, ++fence_value));
+    recording.fence_value = fence_value;
+
+    // reuse a retired command list, otherwise grow the pool
+    uint64_t completed = fence.GetCompletedValue();
+    auto it = std::find_if(lists.begin(), lists.end(), [completed](const Recording& r) { return r.fence_value <= completed; });
+    if (it != lists.end()) {
+        current = size_t(it - lists.begin());
+        CheckResult(it->list.Reset());
+    } else {
+        wis::Result result = wis::success;
+        lists.push_back({ gfx.GetDevice().CreateCommandList(result, wis::QueueType::Graphics) });
+        CheckResult(result);
+        current = lists.size() - 1;
+    }
+    return fence_value;
+}
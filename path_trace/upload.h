@@ -0,0 +1,250 @@
+#pragma once
+#include "consts.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace w {
+class Graphics;
+
+// Ring of staging bytes. Allocations are tagged with the fence value of the submission
+// that consumes them and are released in order once that fence completes.
+class StagingRing
+{
+public:
+    explicit StagingRing(uint64_t capacity) noexcept
+        : capacity(capacity)
+    {
+    }
+
+public:
+    // returns offset into the ring, or nothing if the ring has no room until older submissions retire
+    std::optional<uint64_t> Allocate(uint64_t size, uint64_t alignment = 16) noexcept
+    {
+        if (size > capacity) {
+            return std::nullopt;
+        }
+        if (head == tail) { // empty, restart at the beginning of a lap
+            head = tail = AlignUp(head, capacity);
+        }
+
+        uint64_t offset = AlignUp(head, alignment);
+        if (offset % capacity + size > capacity) { // does not fit before the end, skip to the next lap
+            offset = AlignUp(offset, capacity);
+        }
+        if (offset + size - tail > capacity) {
+            return std::nullopt;
+        }
+        head = offset + size;
+        return offset % capacity;
+    }
+
+    // everything allocated since the last call is consumed by fence_value
+    void Submit(uint64_t fence_value)
+    {
+        if (in_flight.empty() || in_flight.back().end != head) {
+            in_flight.push_back({ fence_value, head });
+        }
+    }
+    void Retire(uint64_t completed_fence_value) noexcept
+    {
+        while (!in_flight.empty() && in_flight.front().fence_value <= completed_fence_value) {
+            tail = in_flight.front().end;
+            in_flight.pop_front();
+        }
+    }
+    // fence value to wait on to free the oldest range, 0 if nothing is in flight
+    uint64_t OldestFence() const noexcept
+    {
+        return in_flight.empty() ? 0 : in_flight.front().fence_value;
+    }
+
+    uint64_t Capacity() const noexcept
+    {
+        return capacity;
+    }
+    uint64_t Used() const noexcept
+    {
+        return head - tail;
+    }
+    bool HasPending() const noexcept
+    {
+        return in_flight.empty() ? head != tail : in_flight.back().end != head;
+    }
+
+private:
+    static uint64_t AlignUp(uint64_t v, uint64_t a) noexcept
+    {
+        return (v + a - 1) / a * a;
+    }
+
+private:
+    struct Submission {
+        uint64_t fence_value;
+        uint64_t end;
+    };
+    std::deque<Submission> in_flight;
+    uint64_t capacity = 0;
+    uint64_t head = 0; // monotonic, wrapped with % capacity
+    uint64_t tail = 0;
+};
+
+// Batches staging copies and resolves them with a single fence per Flush.
+// Queue provides the GPU side, so the scheduling can run against a mock (tests/upload_tests.cpp):
+//   uint8_t* Mapped();                                            persistently mapped ring memory
+//   void Copy(const Dst&, uint64_t dst_offset, uint64_t src_offset, uint64_t size);
+//   uint64_t Submit();                                            close, execute, signal, returns fence value
+//   uint64_t Completed() const;
+//   void Wait(uint64_t fence_value);
+template<typename Queue>
+class BasicUploadManager
+{
+public:
+    template<typename... Args>
+    BasicUploadManager(uint64_t capacity, Args&&... args)
+        : queue(capacity, std::forward<Args>(args)...), ring(capacity)
+    {
+    }
+
+public:
+    template<typename Dst>
+    void Upload(const Dst& dst, const void* data, uint64_t size, uint64_t dst_offset = 0)
+    {
+        W_PROFILE_SCOPE("Upload");
+        auto* bytes = static_cast<const uint8_t*>(data);
+        const uint64_t chunk = ring.Capacity() / 2; // large uploads are streamed through the ring
+        while (size > 0) {
+            uint64_t part = std::min(size, chunk);
+            uint64_t src_offset = Allocate(part);
+            std::memcpy(queue.Mapped() + src_offset, bytes, part);
+            queue.Copy(dst, dst_offset, src_offset, part);
+
+            bytes += part;
+            dst_offset += part;
+            size -= part;
+        }
+    }
+
+    // submits all recorded copies and work, returns the fence value that resolves them
+    uint64_t Flush()
+    {
+        W_PROFILE_SCOPE("Upload flush");
+        last_fence = queue.Submit();
+        ring.Submit(last_fence);
+        ring.Retire(queue.Completed());
+        return last_fence;
+    }
+    void Wait(uint64_t fence_value)
+    {
+        queue.Wait(fence_value);
+        ring.Retire(fence_value);
+    }
+    void WaitIdle()
+    {
+        Wait(Flush());
+    }
+
+    Queue& GetQueue() noexcept
+    {
+        return queue;
+    }
+    const StagingRing& GetRing() const noexcept
+    {
+        return ring;
+    }
+    uint32_t FlushCount() const noexcept
+    {
+        return flush_count;
+    }
+
+private:
+    uint64_t Allocate(uint64_t size)
+    {
+        while (true) {
+            if (auto offset = ring.Allocate(size)) {
+                return *offset;
+            }
+            // ring is full: submit what we have and wait for the oldest range
+            if (ring.HasPending()) {
+                Flush();
+                flush_count++;
+            }
+            Wait(ring.OldestFence());
+        }
+    }
+
+private:
+    Queue queue;
+    StagingRing ring;
+    uint64_t last_fence = 0;
+    uint32_t flush_count = 0; // forced flushes due to a full ring
+};
+
+// Graphics queue implementation of the upload queue
+class GpuUploadQueue
+{
+public:
+    GpuUploadQueue(uint64_t capacity, w::Graphics& gfx);
+    ~GpuUploadQueue();
+
+public:
+    uint8_t* Mapped() noexcept
+    {
+        return mapped;
+    }
+    void Copy(const wis::Buffer& dst, uint64_t dst_offset, uint64_t src_offset, uint64_t size);
+    uint64_t Submit();
+    uint64_t Completed() const noexcept
+    {
+        return fence.GetCompletedValue();
+    }
+    void Wait(uint64_t fence_value)
+    {
+        CheckResult(fence.Wait(fence_value));
+    }
+
+    // open command list, work recorded here executes after the copies of the same batch
+    wis::CommandList& CommandList() noexcept
+    {
+        return lists[current].list;
+    }
+
+private:
+    struct Recording {
+        wis::CommandList list;
+        uint64_t fence_value = 0;
+    };
+
+    w::Graphics& gfx;
+    wis::Buffer ring_buffer;
+    uint8_t* mapped = nullptr;
+
+    wis::Fence fence;
+    uint64_t fence_value = 0;
+    std::vector<Recording> lists;
+    size_t current = 0;
+};
+
+class UploadManager : public BasicUploadManager<GpuUploadQueue>
+{
+public:
+    static constexpr uint64_t default_capacity = 16ull << 20;
+
+public:
+    UploadManager(w::Graphics& gfx, uint64_t capacity = default_capacity)
+        : BasicUploadManager(capacity, gfx)
+    {
+    }
+
+public:
+    wis::CommandList& CommandList() noexcept
+    {
+        return GetQueue().CommandList();
+    }
+};
+} // namespace w
@@ -0,0 +1,90 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <tuple>
+#include <vector>
+
+struct uv_sphere_generator {
+    // https://gist.github.com/Pikachuxxxx/5c4c490a7d7679824e0e18af42918efc
+    static std::tuple<std::vector<DirectX::XMFLOAT3>, std::vector<DirectX::XMFLOAT3>, std::vector<uint32_t>> generate(uint32_t latitudes, uint32_t longitudes) noexcept
+    {
+        const float radius = 1.0f;
+        std::vector<DirectX::XMFLOAT3> vertices;
+        std::vector<DirectX::XMFLOAT3> normals;
+        std::vector<DirectX::XMFLOAT2> uv;
+        std::vector<uint32_t> indices;
+
+        float nx, ny, nz, lengthInv = 1.0f / radius; // normal
+        // Temporary vertex
+        struct Vertex {
+            float x, y, z, s, t; // Postion and Texcoords
+        };
+
+        float deltaLatitude = std::numbers::pi_v<float> / latitudes;
+        float deltaLongitude = 2 * std::numbers::pi_v<float> / longitudes;
+        float latitudeAngle;
+        float longitudeAngle;
+
+        // Compute all vertices first except normals
+        for (int i = 0; i <= latitudes; ++i) {
+            latitudeAngle = std::numbers::pi_v<float> / 2 - i * deltaLatitude; /* Starting -pi/2 to pi/2 */
+            float xy = radius * cosf(latitudeAngle); /* r * cos(phi) */
+            float z = radius * sinf(latitudeAngle); /* r * sin(phi )*/
+
+            /*
+             * We add (latitudes + 1) vertices per longitude because of equator,
+             * the North pole and South pole are not counted here, as they overlap.
+             * The first and last vertices have same position and normal, but
+             * different tex coords.
+             */
+            for (int j = 0; j <= longitudes; ++j) {
+                longitudeAngle = j * deltaLongitude;
+
+                Vertex vertex;
+                vertex.x = xy * cosf(longitudeAngle); /* x = r * cos(phi) * cos(theta)  */
+                vertex.y = xy * sinf(longitudeAngle); /* y = r * cos(phi) * sin(theta) */
+                vertex.z = z; /* z = r * sin(phi) */
+                vertex.s = (float)j / longitudes; /* s */
+                vertex.t = (float)i / latitudes; /* t */
+                vertices.push_back(DirectX::XMFLOAT3(vertex.x, vertex.y, vertex.z));
+                uv.push_back(DirectX::XMFLOAT2(vertex.s, vertex.t));
+
+                // normalized vertex normal
+                nx = vertex.x * lengthInv;
+                ny = vertex.y * lengthInv;
+                nz = vertex.z * lengthInv;
+                normals.push_back(DirectX::XMFLOAT3(nx, ny, nz));
+            }
+        }
+
+        /*
+         *  Indices
+         *  k1--k1+1
+         *  |  / |
+         *  | /  |
+         *  k2--k2+1
+         */
+        unsigned int k1, k2;
+        for (int i = 0; i < latitudes; ++i) {
+            k1 = i * (longitudes + 1);
+            k2 = k1 + longitudes + 1;
+            // 2 Triangles per latitude block excluding the first and last longitudes blocks
+            for (int j = 0; j < longitudes; ++j, ++k1, ++k2) {
+                if (i != 0) {
+                    indices.push_back(k1);
+                    indices.push_back(k2);
+                    indices.push_back(k1 + 1);
+                }
+
+                if (i != (latitudes - 1)) {
+                    indices.push_back(k1 + 1);
+                    indices.push_back(k2);
+                    indices.push_back(k2 + 1);
+                }
+            }
+        }
+        return { vertices, normals, indices };
+    }
+};